@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drm_fourcc.h"
+#include "drmtest.h"
+#include "igt_frame_compare.h"
+#include "igt_rand.h"
+
+/*
+ * Measures how many frame pairs per second igt_frame_compare() gets
+ * through, for the frame sizes and formats seen on Chamelium captures.
+ * Identical frames are the worst case, nothing stops the comparison.
+ */
+
+static const struct {
+	const char *name;
+	uint32_t width, height;
+} sizes[] = {
+	{ "1080p", 1920, 1080 },
+	{ "4k", 3840, 2160 },
+};
+
+static const struct {
+	const char *name;
+	uint32_t ref, cap;
+} formats[] = {
+	{ "XRGB8888", DRM_FORMAT_XRGB8888, DRM_FORMAT_XRGB8888 },
+	{ "XRGB8888/BGR888", DRM_FORMAT_XRGB8888, DRM_FORMAT_BGR888 },
+	{ "BGR888", DRM_FORMAT_BGR888, DRM_FORMAT_BGR888 },
+	{ "XRGB2101010", DRM_FORMAT_XRGB2101010, DRM_FORMAT_XRGB2101010 },
+};
+
+static double elapsed(const struct timespec *start,
+		      const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) + 1e-9*(end->tv_nsec - start->tv_nsec);
+}
+
+static void *alloc_frame(struct igt_frame_buf *buf, uint32_t format,
+			 uint32_t width, uint32_t height)
+{
+	uint32_t cpp = format == DRM_FORMAT_BGR888 ? 3 : 4;
+	uint8_t *data;
+
+	buf->stride = width * cpp;
+	buf->width = width;
+	buf->height = height;
+	buf->format = format;
+
+	data = malloc((size_t)buf->stride * height);
+	if (!data)
+		abort();
+	buf->data = data;
+
+	return data;
+}
+
+/* The same random pixels in both frames, whatever their formats */
+static void fill_frames(uint8_t *ref, const struct igt_frame_buf *ref_buf,
+			uint8_t *cap, const struct igt_frame_buf *cap_buf)
+{
+	uint32_t seed = 0x1234;
+
+	for (uint32_t y = 0; y < ref_buf->height; y++) {
+		uint8_t *r = ref + (size_t)y * ref_buf->stride;
+		uint8_t *c = cap + (size_t)y * cap_buf->stride;
+
+		for (uint32_t x = 0; x < ref_buf->width; x++) {
+			uint32_t v = hars_petruska_f54_1_random(&seed) & 0xffffff;
+
+			if (ref_buf->format == DRM_FORMAT_BGR888) {
+				*r++ = v >> 16, *r++ = v >> 8, *r++ = v;
+			} else {
+				memcpy(r, &v, 4);
+				r += 4;
+			}
+
+			if (cap_buf->format == DRM_FORMAT_BGR888) {
+				*c++ = v >> 16, *c++ = v >> 8, *c++ = v;
+			} else {
+				memcpy(c, &v, 4);
+				c += 4;
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct igt_frame_compare_params params = {};
+	struct igt_frame_compare_result result;
+	struct timespec start, end;
+	int reps = 3;
+	int c;
+
+	while ((c = getopt(argc, argv, "r:t:H")) != -1) {
+		switch (c) {
+		case 'r':
+			reps = atoi(optarg);
+			if (reps < 1)
+				reps = 1;
+			break;
+
+		case 't':
+			params.threshold = atoi(optarg);
+			break;
+
+		case 'H':
+			params.histogram = true;
+			break;
+
+		default:
+			fprintf(stderr,
+				"usage: %s [-r reps] [-t threshold] [-H (histogram)]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	for (int s = 0; s < ARRAY_SIZE(sizes); s++) {
+		for (int f = 0; f < ARRAY_SIZE(formats); f++) {
+			struct igt_frame_buf ref_buf, cap_buf;
+			uint8_t *ref, *cap;
+			double best = 0;
+			int loops;
+
+			ref = alloc_frame(&ref_buf, formats[f].ref,
+					  sizes[s].width, sizes[s].height);
+			cap = alloc_frame(&cap_buf, formats[f].cap,
+					  sizes[s].width, sizes[s].height);
+			fill_frames(ref, &ref_buf, cap, &cap_buf);
+
+			/* Calibrate to about a second per repetition */
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			if (!igt_frame_compare(&ref_buf, &cap_buf, &params, &result))
+				abort();
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			loops = 1 / elapsed(&start, &end) + 1;
+
+			for (int r = 0; r < reps; r++) {
+				double rate;
+
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				for (int l = 0; l < loops; l++)
+					igt_frame_compare(&ref_buf, &cap_buf, &params, &result);
+				clock_gettime(CLOCK_MONOTONIC, &end);
+
+				rate = loops / elapsed(&start, &end);
+				if (rate > best)
+					best = rate;
+			}
+
+			printf("%-6s %-16s %8.1f pairs/s %7.2f Gpixel/s\n",
+			       sizes[s].name, formats[f].name, best,
+			       best * sizes[s].width * sizes[s].height / 1e9);
+
+			free(ref);
+			free(cap);
+		}
+	}
+
+	return 0;
+}
@@ -42,6 +42,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <math.h>
 #include <ctype.h>
 
@@ -268,6 +269,16 @@ struct ctx {
 	} xe;
 };
 
+#define SUBMIT_HIST_BUCKETS 32
+
+/* Log2 histogram of the time spent in the submission ioctl. */
+struct submit_hist {
+	unsigned long count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	unsigned long buckets[SUBMIT_HIST_BUCKETS];
+};
+
 struct workload {
 	unsigned int id;
 
@@ -277,6 +288,7 @@ struct workload {
 	bool sseu;
 
 	pthread_t thread;
+	int cpu; /* -1 when not pinned */
 	bool run;
 	bool background;
 	unsigned int repeat;
@@ -300,6 +312,8 @@ struct workload {
 
 	struct igt_list_head *requests;
 	unsigned int *nrequest;
+
+	struct submit_hist submit;
 };
 
 #define __for_each_ctx(__ctx, __wrk, __ctx_idx) \
@@ -327,6 +341,7 @@ static struct drm_i915_gem_context_param_sseu device_sseu = {
 #define FLAG_DEPSYNC		(1<<2)
 #define FLAG_SSEU		(1<<3)
 #define FLAG_VERIFY_COMPLETION	(1 << 4)
+#define FLAG_SUBMIT_HIST	(1 << 5)
 
 static void w_step_sync(struct w_step *w)
 {
@@ -2616,6 +2631,73 @@ static int elapsed_us(const struct timespec *start, const struct timespec *end)
 	return elapsed(start, end) * 1e6;
 }
 
+static uint64_t elapsed_ns(const struct timespec *start,
+			   const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000000000ULL +
+	       end->tv_nsec - start->tv_nsec;
+}
+
+static void submit_hist_add(struct submit_hist *h, uint64_t ns)
+{
+	unsigned int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+
+	if (bucket >= SUBMIT_HIST_BUCKETS)
+		bucket = SUBMIT_HIST_BUCKETS - 1;
+
+	h->buckets[bucket]++;
+	h->count++;
+	h->total_ns += ns;
+	if (ns > h->max_ns)
+		h->max_ns = ns;
+}
+
+/* Returns the upper bound of the bucket holding the requested percentile. */
+static uint64_t submit_hist_percentile(const struct submit_hist *h, double pct)
+{
+	unsigned long target = ceil(h->count * pct / 100.0);
+	unsigned long sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < SUBMIT_HIST_BUCKETS; i++) {
+		sum += h->buckets[i];
+		if (sum >= target && sum)
+			return min_t(uint64_t, 1ULL << i, h->max_ns);
+	}
+
+	return h->max_ns;
+}
+
+static void print_submit_hist(const struct workload *wrk)
+{
+	const struct submit_hist *h = &wrk->submit;
+	unsigned int i;
+
+	if (!h->count)
+		return;
+
+	printf("%u: submit latency avg/p50/p90/p99/max=%.1f/%.1f/%.1f/%.1f/%.1fus over %lu submissions",
+	       wrk->id, h->total_ns / h->count / 1e3,
+	       submit_hist_percentile(h, 50) / 1e3,
+	       submit_hist_percentile(h, 90) / 1e3,
+	       submit_hist_percentile(h, 99) / 1e3,
+	       h->max_ns / 1e3, h->count);
+	if (wrk->cpu >= 0)
+		printf(" (cpu%d)", wrk->cpu);
+	putchar('\n');
+
+	if (verbose < 3)
+		return;
+
+	for (i = 0; i < SUBMIT_HIST_BUCKETS; i++) {
+		if (!h->buckets[i])
+			continue;
+
+		printf("%u:   < %10.1fus: %lu\n",
+		       wrk->id, (1ULL << i) / 1e3, h->buckets[i]);
+	}
+}
+
 static void
 update_bb_start(struct workload *wrk, struct w_step *w)
 {
@@ -2745,6 +2827,7 @@ static void *run_workload(void *data)
 {
 	struct workload *wrk = (struct workload *)data;
 	struct timespec t_start, t_end, repeat_start;
+	struct timespec submit_start, submit_end;
 	struct w_step *w;
 	int throttle = -1;
 	int qd_throttle = -1;
@@ -2875,11 +2958,20 @@ static void *run_workload(void *data)
 			if (throttle > 0)
 				w_sync_to(wrk, w, w->idx - throttle);
 
+			if (wrk->flags & FLAG_SUBMIT_HIST)
+				clock_gettime(CLOCK_MONOTONIC, &submit_start);
+
 			if (is_xe)
 				do_xe_exec(wrk, w);
 			else
 				do_eb(wrk, w);
 
+			if (wrk->flags & FLAG_SUBMIT_HIST) {
+				clock_gettime(CLOCK_MONOTONIC, &submit_end);
+				submit_hist_add(&wrk->submit,
+						elapsed_ns(&submit_start, &submit_end));
+			}
+
 			if (w->rq_link.next) {
 				igt_list_del(&w->rq_link);
 				wrk->nrequest[w->request_idx]--;
@@ -2974,6 +3066,9 @@ static void *run_workload(void *data)
 		putchar('\n');
 	}
 
+	if (wrk->flags & FLAG_SUBMIT_HIST)
+		print_submit_hist(wrk);
+
 	return NULL;
 }
 
@@ -3009,6 +3104,10 @@ static void print_help(void)
 "  -S                Synchronize the sequence of random batch durations between\n"
 "                    clients.\n"
 "  -d                Sync between data dependencies in userspace.\n"
+"  -P                Pin each client thread to its own CPU, round-robin over\n"
+"                    the CPUs the process is allowed to run on. Client state\n"
+"                    is also allocated from the client CPU.\n"
+"  -H                Print per-client submission latency histograms at exit.\n"
 "  -f <scale>        Scale factor for batch durations.\n"
 "  -F <scale>        Scale factor for delays.\n"
 "  -L                List GPUs.\n"
@@ -3072,6 +3171,34 @@ add_workload_arg(struct w_arg *w_args, unsigned int nr_args, char *w_arg,
 	return w_args;
 }
 
+static unsigned int allowed_cpus(int **cpus)
+{
+	cpu_set_t mask;
+	unsigned int count = 0;
+	int cpu;
+
+	CPU_ZERO(&mask);
+	igt_assert_eq(sched_getaffinity(0, sizeof(mask), &mask), 0);
+
+	*cpus = calloc(CPU_COUNT(&mask), sizeof(**cpus));
+	igt_assert(*cpus);
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &mask))
+			(*cpus)[count++] = cpu;
+
+	return count;
+}
+
+static void pin_to_cpu(int cpu)
+{
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	igt_assert_eq(sched_setaffinity(0, sizeof(mask), &mask), 0);
+}
+
 static void list_engines(void)
 {
 	struct intel_engines *engines = query_engines();
@@ -3108,6 +3235,10 @@ int main(int argc, char **argv)
 	struct igt_device_card card = { };
 	bool list_devices_arg = false;
 	bool list_engines_arg = false;
+	bool pin_clients = false;
+	cpu_set_t main_cpus;
+	int *cpus = NULL;
+	unsigned int nr_cpus = 0;
 	unsigned int repeat = 1;
 	unsigned int clients = 1;
 	unsigned int flags = 0;
@@ -3130,7 +3261,7 @@ int main(int argc, char **argv)
 	master_prng = time(NULL);
 
 	while ((c = getopt(argc, argv,
-			   "LlhqvVsSdc:r:w:W:a:p:I:f:F:D:")) != -1) {
+			   "LlhqvVsSdPHc:r:w:W:a:p:I:f:F:D:")) != -1) {
 		switch (c) {
 		case 'L':
 			list_devices_arg = true;
@@ -3187,6 +3318,12 @@ int main(int argc, char **argv)
 		case 'd':
 			flags |= FLAG_DEPSYNC;
 			break;
+		case 'P':
+			pin_clients = true;
+			break;
+		case 'H':
+			flags |= FLAG_SUBMIT_HIST;
+			break;
 		case 'I':
 			master_prng = strtol(optarg, NULL, 0);
 			break;
@@ -3331,9 +3468,26 @@ int main(int argc, char **argv)
 	w = calloc(clients, sizeof(struct workload *));
 	igt_assert(w);
 
+	if (pin_clients) {
+		CPU_ZERO(&main_cpus);
+		igt_assert_eq(sched_getaffinity(0, sizeof(main_cpus), &main_cpus), 0);
+		nr_cpus = allowed_cpus(&cpus);
+		igt_assert(nr_cpus);
+	}
+
 	for (i = 0; i < clients; i++) {
+		int cpu = pin_clients ? cpus[i % nr_cpus] : -1;
+
+		/*
+		 * Run the client setup on the CPU the client will be pinned to
+		 * so first-touch places its state on the local NUMA node.
+		 */
+		if (cpu >= 0)
+			pin_to_cpu(cpu);
+
 		w[i] = clone_workload(wrk[nr_w_args > 1 ? i : 0]);
 
+		w[i]->cpu = cpu;
 		w[i]->flags = flags;
 		w[i]->repeat = repeat;
 		w[i]->background = master_workload >= 0 && i != master_workload;
@@ -3346,11 +3500,26 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (pin_clients)
+		igt_assert_eq(sched_setaffinity(0, sizeof(main_cpus), &main_cpus), 0);
+
 	clock_gettime(CLOCK_MONOTONIC, &t_start);
 
 	for (i = 0; i < clients; i++) {
-		ret = pthread_create(&w[i]->thread, NULL, run_workload, w[i]);
+		pthread_attr_t attr;
+
+		pthread_attr_init(&attr);
+		if (w[i]->cpu >= 0) {
+			cpu_set_t mask;
+
+			CPU_ZERO(&mask);
+			CPU_SET(w[i]->cpu, &mask);
+			pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask);
+		}
+
+		ret = pthread_create(&w[i]->thread, &attr, run_workload, w[i]);
 		igt_assert_eq(ret, 0);
+		pthread_attr_destroy(&attr);
 	}
 
 	if (master_workload >= 0) {
@@ -3381,6 +3550,7 @@ int main(int argc, char **argv)
 	for (i = 0; i < nr_w_args; i++)
 		fini_workload(wrk[i]);
 	free(w_args);
+	free(cpus);
 
 out:
 	exitcode = EXIT_SUCCESS;
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "igt.h"
+#include "igt_rand.h"
+
+/*
+ * Measures filling and checking a buffer with pseudo-random data, as tests
+ * do before and after copying it: a rand() call per byte and a memcmp()
+ * against a reference copy, which is how tests used to do it, against
+ * igt_rand_fill() and igt_rand_verify().
+ */
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void report(const char *name, size_t size, int reps, uint64_t ns)
+{
+	printf("%s: %.2f GB/s\n", name, (double)size * reps / ns);
+}
+
+int main(int argc, char **argv)
+{
+	size_t size = 64 << 20;
+	uint64_t start, ns_rand, ns_fill;
+	uint8_t *buf, *ref;
+	int reps = 4, c;
+
+	while ((c = getopt(argc, argv, "s:r:")) != -1) {
+		switch (c) {
+		case 's':
+			size = strtoull(optarg, NULL, 0) << 20;
+			break;
+		case 'r':
+			reps = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s size in MiB] [-r reps]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (!size || reps < 1) {
+		fprintf(stderr, "size and reps must be positive\n");
+		return 1;
+	}
+
+	buf = malloc(size);
+	ref = malloc(size);
+	igt_assert(buf && ref);
+
+	/* Fault everything in first, only the generation is measured */
+	memset(buf, 0, size);
+	memset(ref, 0, size);
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++) {
+		srand(r);
+		for (size_t i = 0; i < size; i++)
+			ref[i] = rand();
+	}
+	ns_rand = now_ns() - start;
+	report("rand() fill", size, reps, ns_rand);
+
+	memcpy(buf, ref, size);
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		igt_assert(!memcmp(buf, ref, size));
+	report("memcmp() check", size, reps, now_ns() - start);
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		igt_rand_fill(buf, size, r, 0);
+	ns_fill = now_ns() - start;
+	report("igt_rand_fill()", size, reps, ns_fill);
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		igt_assert_eq_s64(igt_rand_verify(buf, size, reps - 1, 0), -1);
+	report("igt_rand_verify()", size, reps, now_ns() - start);
+
+	printf("fill %.1fx\n", (double)ns_rand / ns_fill);
+
+	free(ref);
+	free(buf);
+
+	return 0;
+}
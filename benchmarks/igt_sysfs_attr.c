@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "igt.h"
+#include "igt_sysfs.h"
+
+/*
+ * Measures polling a set of attributes, as frequency and power tools do:
+ * igt_sysfs_get_u64() on each, opening, scanning and closing it every time,
+ * against handles kept open, read one by one or all in one snapshot.
+ *
+ * The attributes are plain files in a tmpfs directory, so that it runs
+ * anywhere and measures the syscalls and the parsing rather than the
+ * drivers behind real attributes.
+ */
+
+#define MAX_ATTRS 64
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void report(const char *name, int count, int reps, uint64_t ns)
+{
+	printf("%s: %.0f ns per attribute\n", name, (double)ns / count / reps);
+}
+
+int main(int argc, char **argv)
+{
+	char path[] = "/dev/shm/igt_sysfs_attr.XXXXXX";
+	char names[MAX_ATTRS][16];
+	igt_sysfs_attr_t attrs[MAX_ATTRS];
+	uint64_t values[MAX_ATTRS], sum = 0, start, ns_get, ns_snapshot;
+	int count = 8, reps = 100000, dir, c;
+
+	while ((c = getopt(argc, argv, "n:r:")) != -1) {
+		switch (c) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'r':
+			reps = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n attributes] [-r reps]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (count < 1 || count > MAX_ATTRS || reps < 1) {
+		fprintf(stderr, "attributes must be within 1-%d, reps positive\n",
+			MAX_ATTRS);
+		return 1;
+	}
+
+	igt_assert(mkdtemp(path));
+	dir = open(path, O_RDONLY | O_DIRECTORY);
+	igt_assert(dir >= 0);
+
+	for (int i = 0; i < count; i++) {
+		int fd;
+
+		snprintf(names[i], sizeof(names[i]), "freq%d_mhz", i);
+		fd = openat(dir, names[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		igt_assert(fd >= 0);
+		igt_assert(dprintf(fd, "%d\n", 300 + i) > 0);
+		close(fd);
+	}
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		for (int i = 0; i < count; i++)
+			sum += igt_sysfs_get_u64(dir, names[i]);
+	ns_get = now_ns() - start;
+	report("igt_sysfs_get_u64()", count, reps, ns_get);
+
+	for (int i = 0; i < count; i++)
+		igt_assert_eq(igt_sysfs_attr_open(&attrs[i], dir, names[i],
+						  O_RDONLY), 0);
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		for (int i = 0; i < count; i++)
+			sum += igt_sysfs_attr_get_u64(&attrs[i]);
+	report("igt_sysfs_attr_get_u64()", count, reps, now_ns() - start);
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++) {
+		igt_assert(igt_sysfs_attr_snapshot(attrs, count, values));
+		for (int i = 0; i < count; i++)
+			sum += values[i];
+	}
+	ns_snapshot = now_ns() - start;
+	report("igt_sysfs_attr_snapshot()", count, reps, ns_snapshot);
+
+	printf("snapshot %.1fx (checksum %"PRIu64")\n",
+	       (double)ns_get / ns_snapshot, sum);
+
+	for (int i = 0; i < count; i++) {
+		igt_sysfs_attr_close(&attrs[i]);
+		unlinkat(dir, names[i], 0);
+	}
+	close(dir);
+	rmdir(path);
+
+	return 0;
+}
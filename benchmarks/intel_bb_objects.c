@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <inttypes.h>
+#include <search.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "igt.h"
+#include "igt_rand.h"
+#include "intel_bb_objects.h"
+
+/*
+ * Measures the exec object bookkeeping of intel_bb on its own: many small
+ * batches, each using a few objects out of a working set, with a mocked
+ * execbuf ioctl which only moves the objects. The tsearch() trees intel_bb
+ * used to keep, with a malloc'ed array per execbuf, are compared with the
+ * handle table and the scratch arena.
+ */
+
+struct bookkeeping {
+	const char *name;
+	void (*init)(void);
+	void (*add)(uint32_t handle);
+	struct drm_i915_gem_exec_object2 *(*exec)(uint32_t *count);
+	void (*update)(struct drm_i915_gem_exec_object2 *objects, uint32_t count);
+	void (*reset)(void);
+	void (*fini)(void);
+};
+
+static struct drm_i915_gem_exec_object2 **objects;
+static uint32_t num_objects;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* The kernel moving every object of the batch */
+static void mock_execbuf(struct drm_i915_gem_exec_object2 *exec, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+		exec[i].offset += 0x1000;
+}
+
+/* tsearch() trees, as intel_bb had */
+static void *tree_root, *tree_current;
+
+static int compare_objects(const void *p1, const void *p2)
+{
+	const struct drm_i915_gem_exec_object2 *o1 = p1, *o2 = p2;
+
+	return (int) ((int64_t) o1->handle - (int64_t) o2->handle);
+}
+
+static int compare_handles(const void *p1, const void *p2)
+{
+	return (int) (*(int32_t *) p1 - *(int32_t *) p2);
+}
+
+static void tree_init(void)
+{
+	tree_root = tree_current = NULL;
+}
+
+static void tree_add(uint32_t handle)
+{
+	struct drm_i915_gem_exec_object2 **found, *object;
+	uint32_t **found_handle, *h;
+
+	object = malloc(sizeof(*object));
+	igt_assert(object);
+	object->handle = handle;
+	found = tsearch(object, &tree_root, compare_objects);
+	if (*found == object) {
+		memset(object, 0, sizeof(*object));
+		object->handle = handle;
+	} else {
+		free(object);
+		object = *found;
+	}
+
+	h = malloc(sizeof(*h));
+	igt_assert(h);
+	*h = handle;
+	found_handle = tsearch(h, &tree_current, compare_handles);
+	if (*found_handle == h)
+		objects[num_objects++] = object;
+	else
+		free(h);
+}
+
+static struct drm_i915_gem_exec_object2 *tree_exec(uint32_t *count)
+{
+	struct drm_i915_gem_exec_object2 *exec;
+
+	exec = malloc(num_objects * sizeof(*exec));
+	igt_assert(exec);
+	for (uint32_t i = 0; i < num_objects; i++)
+		exec[i] = *objects[i];
+	*count = num_objects;
+
+	return exec;
+}
+
+static void tree_update(struct drm_i915_gem_exec_object2 *exec, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		struct drm_i915_gem_exec_object2 **found;
+
+		found = tfind(&exec[i], &tree_root, compare_objects);
+		igt_assert(found);
+		(*found)->offset = exec[i].offset;
+	}
+	free(exec);
+}
+
+static void tree_reset(void)
+{
+	tdestroy(tree_current, free);
+	tree_current = NULL;
+	num_objects = 0;
+}
+
+static void tree_fini(void)
+{
+	tree_reset();
+	tdestroy(tree_root, free);
+	tree_root = NULL;
+}
+
+/* The handle table and scratch arena intel_bb uses now */
+static struct intel_bb_object_table table;
+static struct intel_bb_arena arena;
+
+static void table_init(void)
+{
+	intel_bb_object_table_init(&table);
+	memset(&arena, 0, sizeof(arena));
+}
+
+static void table_add(uint32_t handle)
+{
+	struct drm_i915_gem_exec_object2 *object;
+	bool added;
+
+	object = intel_bb_object_table_add(&table, handle, &added);
+	if (intel_bb_object_table_use(&table, handle))
+		objects[num_objects++] = object;
+}
+
+static struct drm_i915_gem_exec_object2 *table_exec(uint32_t *count)
+{
+	struct drm_i915_gem_exec_object2 *exec;
+
+	intel_bb_arena_reset(&arena);
+	exec = intel_bb_arena_alloc(&arena, num_objects * sizeof(*exec));
+	for (uint32_t i = 0; i < num_objects; i++)
+		exec[i] = *objects[i];
+	*count = num_objects;
+
+	return exec;
+}
+
+static void table_update(struct drm_i915_gem_exec_object2 *exec, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+		objects[i]->offset = exec[i].offset;
+}
+
+static void table_reset(void)
+{
+	intel_bb_object_table_new_exec(&table);
+	num_objects = 0;
+}
+
+static void table_fini(void)
+{
+	intel_bb_object_table_fini(&table);
+	intel_bb_arena_fini(&arena);
+}
+
+static const struct bookkeeping bookkeepings[] = {
+	{ "tree", tree_init, tree_add, tree_exec, tree_update, tree_reset, tree_fini },
+	{ "table", table_init, table_add, table_exec, table_update, table_reset, table_fini },
+};
+
+static uint64_t run(const struct bookkeeping *b, int batches, int per_batch,
+		    int working_set, uint64_t *sum)
+{
+	uint32_t seed = 0x1234;
+	uint64_t start;
+
+	b->init();
+	start = now_ns();
+	for (int i = 0; i < batches; i++) {
+		struct drm_i915_gem_exec_object2 *exec;
+		uint32_t count;
+
+		/* The batch itself, then the buffers it uses */
+		b->add(1);
+		for (int j = 0; j < per_batch; j++)
+			b->add(2 + hars_petruska_f54_1_random(&seed) % working_set);
+
+		exec = b->exec(&count);
+		mock_execbuf(exec, count);
+		b->update(exec, count);
+		b->reset();
+	}
+	start = now_ns() - start;
+
+	/* Same batches, same objects moved the same number of times */
+	*sum = 0;
+	for (int h = 1; h < working_set + 2; h++) {
+		struct drm_i915_gem_exec_object2 *object;
+
+		b->add(h);
+		object = objects[num_objects - 1];
+		*sum += object->offset * h;
+	}
+	b->reset();
+	b->fini();
+
+	return start;
+}
+
+int main(int argc, char **argv)
+{
+	int batches = 100000, per_batch = 16, working_set = 1024, c;
+	uint64_t ns[ARRAY_SIZE(bookkeepings)], sum, first_sum = 0;
+
+	while ((c = getopt(argc, argv, "b:o:w:")) != -1) {
+		switch (c) {
+		case 'b':
+			batches = atoi(optarg);
+			break;
+		case 'o':
+			per_batch = atoi(optarg);
+			break;
+		case 'w':
+			working_set = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-b batches] [-o objects per batch] [-w working set]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (batches < 1 || per_batch < 1 || working_set < 1) {
+		fprintf(stderr, "batches, objects and working set must be positive\n");
+		return 1;
+	}
+
+	objects = calloc(max(per_batch, working_set) + 2, sizeof(*objects));
+	igt_assert(objects);
+
+	for (int i = 0; i < ARRAY_SIZE(bookkeepings); i++) {
+		ns[i] = run(&bookkeepings[i], batches, per_batch, working_set, &sum);
+		if (i)
+			igt_assert_eq_u64(sum, first_sum);
+		first_sum = sum;
+
+		printf("%s: %.1f ns per batch of %d objects\n",
+		       bookkeepings[i].name, (double)ns[i] / batches, per_batch + 1);
+	}
+	printf("%.1fx\n", (double)ns[0] / ns[1]);
+
+	free(objects);
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "igt.h"
+#include "igt_rand.h"
+#include "intel_chipset.h"
+
+/*
+ * Measures intel_get_device_info() on every known device id, in random
+ * order so that consecutive lookups are for different ids as when scanning
+ * devices or decoding perf streams of several GPUs, and on all the 16 bit
+ * ids, mostly unknown. The linear search of a pci_id_match table, which
+ * intel_get_device_info() used to do, is measured for comparison.
+ */
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void exchange_u16(void *array, unsigned int i, unsigned int j)
+{
+	uint16_t *a = array, tmp = a[i];
+
+	a[i] = a[j];
+	a[j] = tmp;
+}
+
+static const struct intel_device_info *
+linear_get_device_info(const struct pci_id_match *match, uint16_t devid)
+{
+	int i;
+
+	for (i = 0; match[i].device_id != PCI_MATCH_ANY; i++) {
+		if (devid == match[i].device_id)
+			break;
+	}
+
+	return (void *)match[i].match_data;
+}
+
+static void measure(const char *name, const struct pci_id_match *match,
+		    const uint16_t *ids, unsigned int count, int reps)
+{
+	uint64_t linear_ns, hash_ns, start;
+	uintptr_t linear_sum = 0, hash_sum = 0;
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		for (unsigned int i = 0; i < count; i++)
+			linear_sum += (uintptr_t)linear_get_device_info(match, ids[i]);
+	linear_ns = now_ns() - start;
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		for (unsigned int i = 0; i < count; i++)
+			hash_sum += (uintptr_t)intel_get_device_info(ids[i]);
+	hash_ns = now_ns() - start;
+
+	igt_assert(linear_sum == hash_sum);
+	printf("%s: %u ids, linear %.1f ns, hash %.1f ns, %.1fx\n",
+	       name, count,
+	       (double)linear_ns / ((uint64_t)reps * count),
+	       (double)hash_ns / ((uint64_t)reps * count),
+	       (double)linear_ns / hash_ns);
+}
+
+int main(int argc, char **argv)
+{
+	const struct intel_device_info *generic;
+	struct pci_id_match *match;
+	const uint16_t *known;
+	uint16_t *ids, *all;
+	unsigned int count;
+	int reps = 100, c;
+
+	while ((c = getopt(argc, argv, "r:")) != -1) {
+		switch (c) {
+		case 'r':
+			reps = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-r reps]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (reps < 1) {
+		fprintf(stderr, "reps must be positive\n");
+		return 1;
+	}
+
+	known = intel_get_device_ids(&count);
+	igt_assert(count);
+
+	/* Every known id has an info, unlike the id before the first one */
+	generic = intel_get_device_info(known[0] - 1);
+	igt_assert(!generic->graphics_ver);
+
+	match = calloc(count + 1, sizeof(*match));
+	ids = malloc(count * sizeof(*ids));
+	all = malloc(65536 * sizeof(*all));
+	igt_assert(match && ids && all);
+
+	for (unsigned int i = 0; i < count; i++) {
+		match[i].device_id = known[i];
+		match[i].match_data = (intptr_t)intel_get_device_info(known[i]);
+		igt_assert(match[i].match_data != (intptr_t)generic);
+		ids[i] = known[i];
+	}
+	match[count].device_id = PCI_MATCH_ANY;
+	match[count].match_data = (intptr_t)generic;
+
+	for (unsigned int i = 0; i < 65536; i++)
+		all[i] = i;
+
+	hars_petruska_f54_1_random_seed(0x1234);
+	igt_permute_array(ids, count, exchange_u16);
+	igt_permute_array(all, 65536, exchange_u16);
+
+	measure("known", match, ids, count, reps);
+	measure("all", match, all, 65536, max(reps / 100, 1));
+
+	free(all);
+	free(ids);
+	free(match);
+
+	return 0;
+}
@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "igt.h"
+#include "igt_rand.h"
+
+/*
+ * Measures the format/modifier capability checks of the KMS tests which
+ * sweep every format, modifier and plane, on synthetic IN_FORMATS blobs so
+ * that no display is needed. The linear search of the parsed arrays, which
+ * igt_plane_has_format_mod() used to do, is compared with the plane index,
+ * both for single lookups and for finding all the planes supporting a pair.
+ */
+
+struct plane_caps {
+	uint32_t *formats;
+	uint64_t *modifiers;
+	int count;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Each modifier goes with a random half of the formats, linear with all */
+static struct drm_format_modifier_blob *
+build_blob(const uint32_t *formats, int num_formats,
+	   const uint64_t *modifiers, int num_modifiers, uint32_t *seed)
+{
+	int words = DIV_ROUND_UP(num_formats, 64);
+	struct drm_format_modifier_blob *blob;
+	uint64_t *support;
+
+	support = calloc(num_modifiers * words, sizeof(*support));
+	igt_assert(support);
+
+	for (int i = 0; i < num_modifiers; i++) {
+		for (int w = 0; w < words; w++) {
+			uint64_t *formats_mask = &support[i * words + w];
+			int left = num_formats - w * 64;
+
+			*formats_mask = i ? hars_petruska_f54_1_random64(seed) : ~0ull;
+			if (left < 64)
+				*formats_mask &= (1ull << left) - 1;
+		}
+	}
+
+	blob = igt_format_mod_blob_build(formats, num_formats,
+					 modifiers, num_modifiers,
+					 support, words);
+	free(support);
+
+	return blob;
+}
+
+static bool linear_has(const struct plane_caps *plane, uint32_t format,
+		       uint64_t modifier)
+{
+	for (int i = 0; i < plane->count; i++)
+		if (plane->formats[i] == format && plane->modifiers[i] == modifier)
+			return true;
+
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	int num_planes = 32, num_formats = 48, num_modifiers = 12, reps = 10;
+	uint64_t linear_ns, index_ns, linear_hits, index_hits;
+	struct igt_format_mod_index *index;
+	struct plane_caps *planes;
+	uint64_t *modifiers;
+	uint32_t *formats;
+	uint32_t seed = 0x1234;
+	uint64_t start;
+	int c;
+
+	while ((c = getopt(argc, argv, "p:f:m:r:")) != -1) {
+		switch (c) {
+		case 'p':
+			num_planes = atoi(optarg);
+			break;
+		case 'f':
+			num_formats = atoi(optarg);
+			break;
+		case 'm':
+			num_modifiers = atoi(optarg);
+			break;
+		case 'r':
+			reps = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-p planes] [-f formats] [-m modifiers] [-r reps]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (num_planes < 1 || num_formats < 1 || num_modifiers < 1 || reps < 1) {
+		fprintf(stderr, "planes, formats, modifiers and reps must be positive\n");
+		return 1;
+	}
+
+	formats = calloc(num_formats, sizeof(*formats));
+	modifiers = calloc(num_modifiers, sizeof(*modifiers));
+	planes = calloc(num_planes, sizeof(*planes));
+	igt_assert(formats && modifiers && planes);
+
+	for (int f = 0; f < num_formats; f++)
+		formats[f] = fourcc_code('F', 'M', 'T', 0) | (uint32_t)f << 24;
+	modifiers[0] = DRM_FORMAT_MOD_LINEAR;
+	for (int m = 1; m < num_modifiers; m++)
+		modifiers[m] = fourcc_mod_code(INTEL, m);
+
+	start = now_ns();
+	index = igt_format_mod_index_create(num_planes);
+	for (int p = 0; p < num_planes; p++) {
+		struct drm_format_modifier_blob *blob;
+
+		blob = build_blob(formats, num_formats, modifiers, num_modifiers,
+				  &seed);
+		igt_parse_format_mod_blob(blob, &planes[p].formats,
+					  &planes[p].modifiers, &planes[p].count);
+		free(blob);
+
+		igt_format_mod_index_add(index, p, planes[p].formats,
+					 planes[p].modifiers, planes[p].count);
+	}
+	printf("%d planes, %d formats, %d modifiers, index built in %.1f us\n",
+	       num_planes, num_formats, num_modifiers,
+	       (now_ns() - start) / 1e3);
+
+	/* Every format x modifier x plane, as the KMS format sweeps do */
+	linear_hits = index_hits = 0;
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		for (int f = 0; f < num_formats; f++)
+			for (int m = 0; m < num_modifiers; m++)
+				for (int p = 0; p < num_planes; p++)
+					linear_hits += linear_has(&planes[p], formats[f],
+								  modifiers[m]);
+	linear_ns = now_ns() - start;
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++)
+		for (int f = 0; f < num_formats; f++)
+			for (int m = 0; m < num_modifiers; m++)
+				for (int p = 0; p < num_planes; p++)
+					index_hits += igt_format_mod_index_has(index, p,
+									       formats[f],
+									       modifiers[m]);
+	index_ns = now_ns() - start;
+
+	igt_assert_eq_u64(linear_hits, index_hits);
+	printf("lookup: linear %.1f ns, index %.1f ns, %.1fx\n",
+	       (double)linear_ns / ((uint64_t)reps * num_formats * num_modifiers * num_planes),
+	       (double)index_ns / ((uint64_t)reps * num_formats * num_modifiers * num_planes),
+	       (double)linear_ns / index_ns);
+
+	/* All the planes supporting each pair */
+	linear_hits = index_hits = 0;
+	start = now_ns();
+	for (int r = 0; r < reps; r++) {
+		for (int f = 0; f < num_formats; f++) {
+			for (int m = 0; m < num_modifiers; m++) {
+				for (int p = 0; p < num_planes; p++)
+					if (linear_has(&planes[p], formats[f], modifiers[m]))
+						linear_hits += p;
+			}
+		}
+	}
+	linear_ns = now_ns() - start;
+
+	start = now_ns();
+	for (int r = 0; r < reps; r++) {
+		for (int f = 0; f < num_formats; f++) {
+			for (int m = 0; m < num_modifiers; m++) {
+				const uint64_t *set =
+					igt_format_mod_index_planes(index, formats[f],
+								    modifiers[m]);
+				int p;
+
+				for_each_format_mod_index_plane(index, set, p)
+					index_hits += p;
+			}
+		}
+	}
+	index_ns = now_ns() - start;
+
+	igt_assert_eq_u64(linear_hits, index_hits);
+	printf("planes: linear %.1f ns, index %.1f ns, %.1fx\n",
+	       (double)linear_ns / ((uint64_t)reps * num_formats * num_modifiers),
+	       (double)index_ns / ((uint64_t)reps * num_formats * num_modifiers),
+	       (double)linear_ns / index_ns);
+
+	igt_format_mod_index_destroy(index);
+	for (int p = 0; p < num_planes; p++) {
+		free(planes[p].formats);
+		free(planes[p].modifiers);
+	}
+	free(planes);
+	free(modifiers);
+	free(formats);
+
+	return 0;
+}
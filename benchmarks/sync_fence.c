@@ -0,0 +1,405 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "igt.h"
+#include "sw_sync.h"
+
+/*
+ * Measures the sync_file machinery on sw_sync timelines, which needs no
+ * GPU: creating fences, merging them across timelines as a chain or as a
+ * balanced tree, and how long it takes from a timeline being signaled until
+ * a thread blocked in poll() or epoll_wait() on one of its fences wakes up.
+ */
+
+#define MAX_THREADS 64
+
+enum wait_mode { WAIT_POLL, WAIT_EPOLL };
+
+struct bench {
+	unsigned int ntimelines, nfences, nthreads;
+	int *timelines;
+	int *fences;
+	uint64_t *signaled;
+	bool tree;
+	enum wait_mode wait;
+	uint32_t round;
+	pthread_barrier_t ready;
+};
+
+struct worker {
+	pthread_t thread;
+	struct bench *bench;
+	unsigned int id;
+	igt_stats_t create, chain, tree, wake;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void report(const char *name, const struct bench *b,
+		   struct worker *workers, size_t offset, uint64_t ops,
+		   uint64_t elapsed)
+{
+	igt_stats_t all;
+
+	igt_stats_init(&all);
+	for (unsigned int n = 0; n < b->nthreads; n++) {
+		igt_stats_t *s = (void *)&workers[n] + offset;
+
+		igt_stats_push_array(&all, s->values_u64, s->n_values);
+	}
+
+	if (all.n_values)
+		printf("%-11s %10.0f/s  p50 %8.1fus  p90 %8.1fus  p99 %8.1fus  p99.9 %8.1fus  max %8.1fus\n",
+		       name, ops * 1e9 / elapsed,
+		       igt_stats_get_percentile(&all, 50) / 1e3,
+		       igt_stats_get_percentile(&all, 90) / 1e3,
+		       igt_stats_get_percentile(&all, 99) / 1e3,
+		       igt_stats_get_percentile(&all, 99.9) / 1e3,
+		       igt_stats_get_max(&all) / 1e3);
+
+	igt_stats_fini(&all);
+}
+
+/* Each worker owns the timelines id, id + nthreads, ... */
+#define for_each_timeline(w, i) \
+	for (i = (w)->id; i < (w)->bench->ntimelines; i += (w)->bench->nthreads)
+
+static int *fences_of(struct bench *b, unsigned int timeline)
+{
+	return &b->fences[timeline * b->nfences];
+}
+
+static void *create_thread(void *data)
+{
+	struct worker *w = data;
+	struct bench *b = w->bench;
+	unsigned int i;
+
+	for_each_timeline(w, i) {
+		uint64_t start = now_ns();
+
+		sw_sync_timeline_create_fences(b->timelines[i], 1, b->nfences,
+					       fences_of(b, i));
+		igt_stats_push(&w->create, now_ns() - start);
+	}
+
+	return NULL;
+}
+
+/*
+ * Merge the n-th fence of each of the worker's timelines into a chain or
+ * a tree, either must end up with one fence per timeline.
+ */
+static void *merge_thread(void *data)
+{
+	struct worker *w = data;
+	struct bench *b = w->bench;
+	unsigned int count = 0, i;
+	int *fences;
+
+	fences = malloc(b->ntimelines * sizeof(*fences));
+	igt_assert(fences);
+
+	for (unsigned int n = 0; n < b->nfences; n++) {
+		uint64_t start;
+		int merged;
+
+		count = 0;
+		for_each_timeline(w, i)
+			fences[count++] = fences_of(b, i)[n];
+
+		start = now_ns();
+		if (b->tree) {
+			merged = sync_fence_merge_tree(fences, count);
+		} else {
+			merged = dup(fences[0]);
+			for (i = 1; i < count; i++) {
+				int tmp = sync_fence_merge(merged, fences[i]);
+
+				igt_assert_lte(0, tmp);
+				close(merged);
+				merged = tmp;
+			}
+		}
+		igt_stats_push(b->tree ? &w->tree : &w->chain, now_ns() - start);
+
+		igt_assert_eq(sync_fence_count(merged), count);
+		close(merged);
+	}
+
+	free(fences);
+
+	return NULL;
+}
+
+static void wake(struct worker *w, unsigned int timeline, uint64_t t)
+{
+	uint64_t signaled = __atomic_load_n(&w->bench->signaled[timeline],
+					    __ATOMIC_ACQUIRE);
+
+	igt_stats_push(&w->wake, t - signaled);
+}
+
+static void *wait_thread(void *data)
+{
+	struct worker *w = data;
+	struct bench *b = w->bench;
+	struct epoll_event events[64];
+	unsigned int pending = 0, i;
+	int *fences = fences_of(b, 0);
+	int epfd = -1;
+
+	/* One fence per timeline, for the next value of the timeline */
+	for_each_timeline(w, i) {
+		fences[i] = sw_sync_timeline_create_fence(b->timelines[i],
+							  b->round + 1);
+		pending++;
+	}
+
+	if (b->wait == WAIT_EPOLL) {
+		epfd = epoll_create1(0);
+		igt_assert_lte(0, epfd);
+
+		for_each_timeline(w, i) {
+			struct epoll_event ev = {
+				.events = EPOLLIN,
+				.data.u32 = i,
+			};
+
+			igt_assert_eq(epoll_ctl(epfd, EPOLL_CTL_ADD,
+						fences[i], &ev), 0);
+		}
+	}
+
+	pthread_barrier_wait(&b->ready);
+
+	if (b->wait == WAIT_POLL) {
+		/* The timelines are signaled in order, wait for them in order */
+		for_each_timeline(w, i) {
+			igt_assert_eq(sync_fence_wait(fences[i], -1), 0);
+			wake(w, i, now_ns());
+		}
+	} else {
+		while (pending) {
+			int n = epoll_wait(epfd, events, ARRAY_SIZE(events), -1);
+			uint64_t t = now_ns();
+
+			if (n < 0 && errno == EINTR)
+				continue;
+			igt_assert_lte(0, n);
+
+			for (int e = 0; e < n; e++) {
+				i = events[e].data.u32;
+				wake(w, i, t);
+				epoll_ctl(epfd, EPOLL_CTL_DEL, fences[i], NULL);
+				pending--;
+			}
+		}
+		close(epfd);
+	}
+
+	for_each_timeline(w, i)
+		close(fences[i]);
+
+	return NULL;
+}
+
+static uint64_t run_threads(struct bench *b, struct worker *workers,
+			    void *(*fn)(void *))
+{
+	uint64_t start = now_ns();
+
+	for (unsigned int n = 1; n < b->nthreads; n++)
+		igt_assert_eq(pthread_create(&workers[n].thread, NULL,
+					     fn, &workers[n]), 0);
+	fn(&workers[0]);
+	for (unsigned int n = 1; n < b->nthreads; n++)
+		pthread_join(workers[n].thread, NULL);
+
+	return now_ns() - start;
+}
+
+/* The workers block on the fences while this thread signals the timelines */
+static uint64_t run_wait(struct bench *b, struct worker *workers,
+			 enum wait_mode mode)
+{
+	uint64_t start;
+
+	b->wait = mode;
+	pthread_barrier_init(&b->ready, NULL, b->nthreads + 1);
+
+	for (unsigned int n = 0; n < b->nthreads; n++)
+		igt_assert_eq(pthread_create(&workers[n].thread, NULL,
+					     wait_thread, &workers[n]), 0);
+
+	pthread_barrier_wait(&b->ready);
+
+	start = now_ns();
+	for (unsigned int i = 0; i < b->ntimelines; i++) {
+		__atomic_store_n(&b->signaled[i], now_ns(), __ATOMIC_RELEASE);
+		sw_sync_timeline_inc(b->timelines[i], 1);
+	}
+
+	for (unsigned int n = 0; n < b->nthreads; n++)
+		pthread_join(workers[n].thread, NULL);
+
+	pthread_barrier_destroy(&b->ready);
+	b->round++;
+
+	return now_ns() - start;
+}
+
+static void reset_samples(struct bench *b, struct worker *workers)
+{
+	for (unsigned int n = 0; n < b->nthreads; n++) {
+		igt_stats_fini(&workers[n].create);
+		igt_stats_fini(&workers[n].chain);
+		igt_stats_fini(&workers[n].tree);
+		igt_stats_fini(&workers[n].wake);
+		memset(&workers[n], 0, sizeof(workers[n]));
+		workers[n].bench = b;
+		workers[n].id = n;
+		igt_stats_init(&workers[n].create);
+		igt_stats_init(&workers[n].chain);
+		igt_stats_init(&workers[n].tree);
+		igt_stats_init(&workers[n].wake);
+	}
+}
+
+/* Every timeline and every fence is a file descriptor */
+static void raise_fd_limit(const struct bench *b)
+{
+	rlim_t need = (rlim_t)b->ntimelines * (b->nfences + 1) + 64;
+	struct rlimit rlim;
+
+	igt_assert_eq(getrlimit(RLIMIT_NOFILE, &rlim), 0);
+	if (rlim.rlim_cur >= need)
+		return;
+
+	rlim.rlim_cur = need;
+	if (rlim.rlim_max < need || setrlimit(RLIMIT_NOFILE, &rlim)) {
+		fprintf(stderr, "Need %lu file descriptors, try fewer timelines or fences\n",
+			(unsigned long)need);
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct bench b = {
+		.ntimelines = 4096,
+		.nfences = 8,
+		.nthreads = sysconf(_SC_NPROCESSORS_ONLN),
+	};
+	struct worker workers[MAX_THREADS];
+	uint64_t elapsed;
+	int reps = 3;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:n:j:r:")) != -1) {
+		switch (c) {
+		case 't':
+			b.ntimelines = atoi(optarg);
+			break;
+		case 'n':
+			b.nfences = atoi(optarg);
+			break;
+		case 'j':
+			b.nthreads = atoi(optarg);
+			break;
+		case 'r':
+			reps = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-t timelines] [-n fences per timeline] [-j threads] [-r reps]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	b.ntimelines = max(b.ntimelines, 1u);
+	b.nfences = max(b.nfences, 1u);
+	b.nthreads = min(max(b.nthreads, 1u), min_t(unsigned int, b.ntimelines, MAX_THREADS));
+	reps = max(reps, 1);
+
+	igt_require_sw_sync();
+	raise_fd_limit(&b);
+
+	b.timelines = calloc(b.ntimelines, sizeof(*b.timelines));
+	b.fences = calloc(b.ntimelines * b.nfences, sizeof(*b.fences));
+	b.signaled = calloc(b.ntimelines, sizeof(*b.signaled));
+	igt_assert(b.timelines && b.fences && b.signaled);
+
+	printf("%u timelines, %u fences each, %u threads\n",
+	       b.ntimelines, b.nfences, b.nthreads);
+
+	memset(workers, 0, sizeof(workers));
+	reset_samples(&b, workers);
+
+	for (int r = 0; r < reps; r++) {
+		uint64_t ops = (uint64_t)b.ntimelines * b.nfences;
+
+		for (unsigned int i = 0; i < b.ntimelines; i++)
+			b.timelines[i] = sw_sync_timeline_create();
+		b.round = 0;
+
+		elapsed = run_threads(&b, workers, create_thread);
+		report("create", &b, workers,
+		       offsetof(struct worker, create), ops, elapsed);
+
+		b.tree = false;
+		elapsed = run_threads(&b, workers, merge_thread);
+		report("merge-chain", &b, workers,
+		       offsetof(struct worker, chain), ops, elapsed);
+
+		b.tree = true;
+		elapsed = run_threads(&b, workers, merge_thread);
+		report("merge-tree", &b, workers,
+		       offsetof(struct worker, tree), ops, elapsed);
+
+		for (unsigned int i = 0; i < b.ntimelines * b.nfences; i++)
+			close(b.fences[i]);
+
+		elapsed = run_wait(&b, workers, WAIT_POLL);
+		report("wake-poll", &b, workers,
+		       offsetof(struct worker, wake), b.ntimelines, elapsed);
+		reset_samples(&b, workers);
+
+		elapsed = run_wait(&b, workers, WAIT_EPOLL);
+		report("wake-epoll", &b, workers,
+		       offsetof(struct worker, wake), b.ntimelines, elapsed);
+		reset_samples(&b, workers);
+
+		for (unsigned int i = 0; i < b.ntimelines; i++)
+			close(b.timelines[i]);
+		printf("\n");
+	}
+
+	free(b.timelines);
+	free(b.fences);
+	free(b.signaled);
+
+	return 0;
+}
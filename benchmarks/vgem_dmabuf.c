@@ -0,0 +1,431 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "igt.h"
+#include "igt_vgem.h"
+#include "dmabuf_sync_file.h"
+#include "sw_sync.h"
+
+/*
+ * A producer and a consumer process share a ring of vgem buffers as
+ * dma-bufs, the way a compositor and its clients do, to measure the CPU
+ * cost of each step:
+ *
+ * The producer waits until the consumer is done with the next buffer of the
+ * ring, writes it from the CPU between DMA_BUF_IOCTL_SYNC calls, attaches a
+ * vgem fence standing in for the GPU rendering, exports it as a sync_file
+ * and sends both the dma-buf and the sync_file over a unix socket, then
+ * signals the vgem fence.
+ *
+ * The consumer waits on the sync_file, reads the buffer through its own
+ * mapping of the dma-buf, imports a sw_sync fence as its read fence and
+ * hands the buffer back, then signals its fence.
+ */
+
+enum {
+	P_ACQUIRE,
+	P_WRITE,
+	P_EXPORT,
+	P_SEND,
+	C_RECV,
+	C_WAIT,
+	C_READ,
+	C_RELEASE,
+	E2E,
+	NUM_STAGES
+};
+
+static const char *stage_names[NUM_STAGES] = {
+	[P_ACQUIRE] = "acquire",
+	[P_WRITE] = "write",
+	[P_EXPORT] = "export",
+	[P_SEND] = "send",
+	[C_RECV] = "recv",
+	[C_WAIT] = "wait",
+	[C_READ] = "read",
+	[C_RELEASE] = "release",
+	[E2E] = "end-to-end",
+};
+
+struct frame_msg {
+	uint32_t index;
+	uint32_t frame;
+	uint64_t sent_ns;
+};
+
+struct config {
+	uint64_t size;
+	unsigned int depth;
+	unsigned int frames;
+	bool full;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void send_msg(int sock, const struct frame_msg *msg,
+		     const int *fds, int nfds)
+{
+	char buf[CMSG_SPACE(2 * sizeof(int))] = {};
+	struct iovec iov = {
+		.iov_base = (void *)msg,
+		.iov_len = sizeof(*msg),
+	};
+	struct msghdr hdr = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+
+	if (nfds) {
+		struct cmsghdr *cmsg;
+
+		hdr.msg_control = buf;
+		hdr.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+		cmsg = CMSG_FIRSTHDR(&hdr);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+		memcpy(CMSG_DATA(cmsg), fds, nfds * sizeof(int));
+	}
+
+	igt_assert_eq(sendmsg(sock, &hdr, 0), sizeof(*msg));
+}
+
+static void recv_msg(int sock, struct frame_msg *msg, int *fds, int nfds)
+{
+	char buf[CMSG_SPACE(2 * sizeof(int))];
+	struct iovec iov = {
+		.iov_base = msg,
+		.iov_len = sizeof(*msg),
+	};
+	struct msghdr hdr = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = nfds ? buf : NULL,
+		.msg_controllen = nfds ? CMSG_SPACE(nfds * sizeof(int)) : 0,
+	};
+
+	igt_assert_eq(recvmsg(sock, &hdr, MSG_CMSG_CLOEXEC), sizeof(*msg));
+
+	if (nfds) {
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+
+		igt_assert(cmsg && cmsg->cmsg_type == SCM_RIGHTS);
+		igt_assert_eq(cmsg->cmsg_len, CMSG_LEN(nfds * sizeof(int)));
+		memcpy(fds, CMSG_DATA(cmsg), nfds * sizeof(int));
+	}
+}
+
+static void wait_sync_file(int fence)
+{
+	igt_assert_eq(sync_fence_wait(fence, -1), 0);
+	close(fence);
+}
+
+/* Either every dword or the first dword of every page */
+static void write_frame(uint32_t *ptr, const struct config *cfg, uint32_t frame)
+{
+	unsigned int step = cfg->full ? 1 : 4096 / sizeof(*ptr);
+
+	for (uint64_t i = 0; i < cfg->size / sizeof(*ptr); i += step)
+		ptr[i] = frame;
+}
+
+static void read_frame(const uint32_t *ptr, const struct config *cfg,
+		       uint32_t frame)
+{
+	unsigned int step = cfg->full ? 1 : 4096 / sizeof(*ptr);
+
+	for (uint64_t i = 0; i < cfg->size / sizeof(*ptr); i += step)
+		igt_assert_eq_u32(ptr[i], frame);
+}
+
+static void producer(int sock, const struct config *cfg, uint64_t *samples[])
+{
+	struct vgem_bo bo[cfg->depth];
+	uint32_t *ptr[cfg->depth];
+	int dmabuf[cfg->depth];
+	int vgem = drm_open_driver(DRIVER_VGEM);
+
+	for (unsigned int i = 0; i < cfg->depth; i++) {
+		bo[i].width = 1024;
+		bo[i].height = cfg->size / 4096;
+		bo[i].bpp = 32;
+		vgem_create(vgem, &bo[i]);
+
+		dmabuf[i] = prime_handle_to_fd_for_mmap(vgem, bo[i].handle);
+		igt_assert_lte(0, dmabuf[i]);
+		ptr[i] = mmap(NULL, bo[i].size, PROT_READ | PROT_WRITE,
+			      MAP_SHARED, dmabuf[i], 0);
+		igt_assert(ptr[i] != MAP_FAILED);
+	}
+
+	for (unsigned int f = 0; f < cfg->frames; f++) {
+		unsigned int i = f % cfg->depth;
+		struct frame_msg msg = { .index = i, .frame = f };
+		uint64_t t0, t1;
+		uint32_t fence;
+		int fds[2];
+
+		/* Wait for the buffer to come back and its readers to finish */
+		t0 = now_ns();
+		if (f >= cfg->depth) {
+			recv_msg(sock, &msg, NULL, 0);
+			igt_assert_eq_u32(msg.index, i);
+		}
+		wait_sync_file(dmabuf_export_sync_file(dmabuf[i],
+						       DMA_BUF_SYNC_WRITE));
+		t1 = now_ns();
+		samples[P_ACQUIRE][f] = t1 - t0;
+
+		t0 = t1;
+		prime_sync_start(dmabuf[i], true);
+		write_frame(ptr[i], cfg, f);
+		prime_sync_end(dmabuf[i], true);
+		t1 = now_ns();
+		samples[P_WRITE][f] = t1 - t0;
+
+		t0 = t1;
+		fence = vgem_fence_attach(vgem, &bo[i], VGEM_FENCE_WRITE);
+		fds[0] = dmabuf[i];
+		fds[1] = dmabuf_export_sync_file(dmabuf[i], DMA_BUF_SYNC_READ);
+		t1 = now_ns();
+		samples[P_EXPORT][f] = t1 - t0;
+
+		t0 = t1;
+		msg.index = i;
+		msg.frame = f;
+		msg.sent_ns = t0;
+		send_msg(sock, &msg, fds, 2);
+		close(fds[1]);
+		t1 = now_ns();
+		samples[P_SEND][f] = t1 - t0;
+
+		/* and the "rendering" completes */
+		vgem_fence_signal(vgem, fence);
+	}
+
+	/* Drain the buffers still held by the consumer */
+	for (unsigned int f = cfg->frames > cfg->depth ? cfg->frames - cfg->depth : 0;
+	     f < cfg->frames; f++) {
+		struct frame_msg msg;
+
+		recv_msg(sock, &msg, NULL, 0);
+	}
+
+	for (unsigned int i = 0; i < cfg->depth; i++) {
+		munmap(ptr[i], bo[i].size);
+		close(dmabuf[i]);
+		gem_close(vgem, bo[i].handle);
+	}
+	drm_close_driver(vgem);
+}
+
+static void consumer(int sock, const struct config *cfg, uint64_t *samples[])
+{
+	uint32_t *ptr[cfg->depth];
+	int dmabuf[cfg->depth];
+	int timeline = sw_sync_timeline_create();
+
+	memset(ptr, 0, sizeof(ptr));
+
+	for (unsigned int f = 0; f < cfg->frames; f++) {
+		struct frame_msg msg;
+		uint64_t t0, t1;
+		unsigned int i;
+		int fds[2];
+
+		t0 = now_ns();
+		recv_msg(sock, &msg, fds, 2);
+		t1 = now_ns();
+		samples[C_RECV][f] = t1 - t0;
+		igt_assert_eq_u32(msg.frame, f);
+		i = msg.index;
+
+		/* Map each buffer of the ring once, the same dma-buf keeps coming back */
+		if (!ptr[i]) {
+			dmabuf[i] = fds[0];
+			ptr[i] = mmap(NULL, cfg->size, PROT_READ, MAP_SHARED,
+				      dmabuf[i], 0);
+			igt_assert(ptr[i] != MAP_FAILED);
+		} else {
+			close(fds[0]);
+		}
+
+		t0 = t1;
+		wait_sync_file(fds[1]);
+		t1 = now_ns();
+		samples[C_WAIT][f] = t1 - t0;
+
+		t0 = t1;
+		prime_sync_start(dmabuf[i], false);
+		read_frame(ptr[i], cfg, f);
+		prime_sync_end(dmabuf[i], false);
+		t1 = now_ns();
+		samples[C_READ][f] = t1 - t0;
+		samples[E2E][f] = t1 - msg.sent_ns;
+
+		/* Hand the buffer back with a fence for our "read" */
+		t0 = t1;
+		dmabuf_import_timeline_fence(dmabuf[i], DMA_BUF_SYNC_READ,
+					     timeline, f + 1);
+		send_msg(sock, &msg, NULL, 0);
+		t1 = now_ns();
+		samples[C_RELEASE][f] = t1 - t0;
+
+		sw_sync_timeline_inc(timeline, 1);
+	}
+
+	for (unsigned int i = 0; i < cfg->depth; i++) {
+		if (!ptr[i])
+			continue;
+
+		munmap(ptr[i], cfg->size);
+		close(dmabuf[i]);
+	}
+	close(timeline);
+}
+
+static void run(const struct config *cfg)
+{
+	uint64_t *samples[NUM_STAGES];
+	uint64_t *shared, start, elapsed;
+	size_t len = sizeof(uint64_t) * NUM_STAGES * cfg->frames;
+	int sv[2], status;
+	pid_t pid;
+
+	/* The consumer fills in its stages directly */
+	shared = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	igt_assert(shared != MAP_FAILED);
+	for (int s = 0; s < NUM_STAGES; s++)
+		samples[s] = shared + s * cfg->frames;
+
+	igt_assert_eq(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv), 0);
+
+	fflush(stdout);
+	pid = fork();
+	igt_assert_lte(0, pid);
+	if (pid == 0) {
+		close(sv[0]);
+		consumer(sv[1], cfg, samples);
+		exit(0);
+	}
+	close(sv[1]);
+
+	start = now_ns();
+	producer(sv[0], cfg, samples);
+	elapsed = now_ns() - start;
+
+	close(sv[0]);
+	igt_assert_eq(waitpid(pid, &status, 0), pid);
+	igt_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	printf("%6"PRIu64"KiB depth %-2u %9.0f frames/s %8.2f GiB/s\n",
+	       cfg->size >> 10, cfg->depth, cfg->frames * 1e9 / elapsed,
+	       (double)cfg->size * cfg->frames / elapsed * 1e9 / (1ull << 30));
+
+	for (int s = 0; s < NUM_STAGES; s++) {
+		igt_stats_t stats;
+
+		igt_stats_init_with_size(&stats, cfg->frames);
+		igt_stats_push_array(&stats, samples[s], cfg->frames);
+		printf("\t%-10s p50 %8.1fus  p90 %8.1fus  p99 %8.1fus  max %8.1fus\n",
+		       stage_names[s],
+		       igt_stats_get_percentile(&stats, 50) / 1e3,
+		       igt_stats_get_percentile(&stats, 90) / 1e3,
+		       igt_stats_get_percentile(&stats, 99) / 1e3,
+		       igt_stats_get_max(&stats) / 1e3);
+		igt_stats_fini(&stats);
+	}
+
+	munmap(shared, len);
+}
+
+static unsigned int parse_list(char *arg, uint64_t *values, unsigned int max,
+			       uint64_t scale)
+{
+	unsigned int count = 0;
+	char *tok, *save;
+
+	for (tok = strtok_r(arg, ",", &save); tok && count < max;
+	     tok = strtok_r(NULL, ",", &save)) {
+		uint64_t v = strtoull(tok, NULL, 0) * scale;
+
+		if (v)
+			values[count++] = v;
+	}
+
+	return count;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t sizes[16] = { 64 << 10, 1 << 20, 8 << 20 };
+	uint64_t depths[16] = { 1, 2, 4 };
+	unsigned int nsizes = 3, ndepths = 3;
+	struct config cfg = { .frames = 1000 };
+	int vgem;
+	int c;
+
+	while ((c = getopt(argc, argv, "s:d:n:w")) != -1) {
+		switch (c) {
+		case 's':
+			nsizes = parse_list(optarg, sizes, ARRAY_SIZE(sizes), 1024);
+			break;
+		case 'd':
+			ndepths = parse_list(optarg, depths, ARRAY_SIZE(depths), 1);
+			break;
+		case 'n':
+			cfg.frames = max(atoi(optarg), 1);
+			break;
+		case 'w':
+			cfg.full = true;
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-s size_kib,...] [-d depth,...] [-n frames] [-w (write and read all of the buffer)]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	vgem = drm_open_driver(DRIVER_VGEM);
+	igt_require(vgem_has_fences(vgem));
+	igt_require(has_dmabuf_export_sync_file(vgem));
+	igt_require_sw_sync();
+	igt_require(has_dmabuf_import_sync_file(vgem));
+	drm_close_driver(vgem);
+
+	for (unsigned int s = 0; s < nsizes; s++) {
+		for (unsigned int d = 0; d < ndepths; d++) {
+			/* whole pages */
+			cfg.size = ALIGN(sizes[s], 4096);
+			cfg.depth = depths[d];
+			run(&cfg);
+		}
+	}
+
+	return 0;
+}
@@ -30,9 +30,11 @@
 #include <fcntl.h>
 #include <gsl/gsl_fft_real.h>
 #include <math.h>
+#include <pthread.h>
 #include <unistd.h>
 
 #include "igt_audio.h"
+#include "igt_aux.h"
 #include "igt_core.h"
 
 #define FREQS_MAX 64
@@ -50,6 +52,8 @@
  */
 #define MIN_FREQ 200 /* Hz */
 #define NOISE_THRESHOLD 0.0005
+/* Samples per analysis above which channels are transformed in parallel */
+#define ANALYZER_PARALLEL_THRESHOLD (32 * 1024)
 
 /**
  * SECTION:igt_audio
@@ -322,49 +326,38 @@ static double hann_window(double v, size_t i, size_t N)
 	return v * 0.5 * (1 - cos(2.0 * M_PI * (double) i / (double) N));
 }
 
-/**
- * Checks that frequencies specified in signal, and only those, are included
- * in the input data.
- *
- * sampling_rate is given in Hz. samples_len is the number of elements in
- * samples.
- */
-bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
-			 int channel, const double *samples, size_t samples_len)
+/* The frequencies expected on one channel */
+struct audio_channel_plan {
+	int freqs[FREQS_MAX];
+	size_t freqs_count;
+};
+
+static void audio_channel_plan_init(struct audio_channel_plan *plan,
+				    const struct audio_signal *signal,
+				    int channel)
 {
-	double *data;
-	size_t data_len = samples_len;
-	size_t bin_power_len = data_len / 2 + 1;
-	double bin_power[bin_power_len];
-	bool detected[FREQS_MAX];
-	int ret, freq_accuracy, freq, local_max_freq;
-	double max, local_max, threshold;
-	size_t i, j;
-	bool above, success;
+	size_t i;
 
-	/* gsl will mutate the array in-place, so make a copy */
-	data = malloc(samples_len * sizeof(double));
-	memcpy(data, samples, samples_len * sizeof(double));
+	plan->freqs_count = 0;
+	for (i = 0; i < signal->freqs_count; i++) {
+		if (signal->freqs[i].channel >= 0 &&
+		    signal->freqs[i].channel != channel)
+			continue;
 
-	/* Apply a Hann window to the input signal, to reduce frequency leaks
-	 * due to the endpoints of the signal being discontinuous.
-	 *
-	 * For more info:
-	 * - https://download.ni.com/evaluation/pxi/Understanding%20FFTs%20and%20Windowing.pdf
-	 * - https://en.wikipedia.org/wiki/Window_function
-	 */
-	for (i = 0; i < data_len; i++)
-		data[i] = hann_window(data[i], i, data_len);
+		plan->freqs[plan->freqs_count++] = signal->freqs[i].freq;
+	}
+}
 
-	/* Allowed error in Hz due to FFT step */
-	freq_accuracy = sampling_rate / data_len;
-	igt_debug("Allowed freq. error: %d Hz\n", freq_accuracy);
+/*
+ * Transforms the windowed samples in data, in-place, and stores the
+ * normalized power of each of the data_len / 2 + 1 bins in bin_power.
+ */
+static void audio_bin_power(double *data, size_t data_len, double *bin_power)
+{
+	size_t bin_power_len = data_len / 2 + 1;
+	size_t i;
 
-	ret = gsl_fft_real_radix2_transform(data, 1, data_len);
-	if (ret != 0) {
-		free(data);
-		igt_assert(0);
-	}
+	igt_assert(gsl_fft_real_radix2_transform(data, 1, data_len) == 0);
 
 	/* Compute the power received by every bin of the FFT.
 	 *
@@ -385,6 +378,26 @@ bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
 	/* Normalize the power */
 	for (i = 0; i < bin_power_len; i++)
 		bin_power[i] = 2 * bin_power[i] / data_len;
+}
+
+/*
+ * Checks that the frequencies of the plan, and only those, stand out in
+ * the spectrum of a data_len samples window.
+ */
+static bool audio_detect_peaks(const struct audio_channel_plan *plan,
+			       int sampling_rate, size_t data_len,
+			       const double *bin_power)
+{
+	size_t bin_power_len = data_len / 2 + 1;
+	bool detected[FREQS_MAX];
+	int freq_accuracy, freq, local_max_freq;
+	double max, local_max, threshold;
+	size_t i, j;
+	bool above, success;
+
+	/* Allowed error in Hz due to FFT step */
+	freq_accuracy = sampling_rate / data_len;
+	igt_debug("Allowed freq. error: %d Hz\n", freq_accuracy);
 
 	/* Detect noise with a threshold on the power of low frequencies */
 	for (i = 0; i < bin_power_len; i++) {
@@ -406,7 +419,7 @@ bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
 			max = bin_power[i];
 	}
 
-	for (i = 0; i < signal->freqs_count; i++)
+	for (i = 0; i < plan->freqs_count; i++)
 		detected[i] = false;
 
 	/* Do a linear search through the FFT bins' power to find the the local
@@ -439,15 +452,9 @@ bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
 		 * time to decide whether the peak frequency is correct or
 		 * invalid. */
 		if (bin_power[i] < threshold) {
-			for (j = 0; j < signal->freqs_count; j++) {
-				if (signal->freqs[j].channel >= 0 &&
-				    signal->freqs[j].channel != channel)
-					continue;
-
-				if (signal->freqs[j].freq >
-				    local_max_freq - freq_accuracy &&
-				    signal->freqs[j].freq <
-				    local_max_freq + freq_accuracy) {
+			for (j = 0; j < plan->freqs_count; j++) {
+				if (plan->freqs[j] > local_max_freq - freq_accuracy &&
+				    plan->freqs[j] < local_max_freq + freq_accuracy) {
 					detected[j] = true;
 					igt_debug("Frequency %d detected\n",
 						  local_max_freq);
@@ -457,7 +464,7 @@ bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
 
 			/* We haven't generated this frequency, but we detected
 			 * it. */
-			if (j == signal->freqs_count) {
+			if (j == plan->freqs_count) {
 				igt_debug("Detected additional frequency: %d\n",
 					  local_max_freq);
 				success = false;
@@ -475,23 +482,406 @@ bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
 	}
 
 	/* Check that all frequencies we generated have been detected. */
-	for (i = 0; i < signal->freqs_count; i++) {
-		if (signal->freqs[i].channel >= 0 &&
-		    signal->freqs[i].channel != channel)
-			continue;
-
+	for (i = 0; i < plan->freqs_count; i++) {
 		if (!detected[i]) {
-			igt_debug("Missing frequency: %d\n",
-				  signal->freqs[i].freq);
+			igt_debug("Missing frequency: %d\n", plan->freqs[i]);
 			success = false;
 		}
 	}
 
+	return success;
+}
+
+/**
+ * Checks that frequencies specified in signal, and only those, are included
+ * in the input data.
+ *
+ * sampling_rate is given in Hz. samples_len is the number of elements in
+ * samples.
+ */
+bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
+			 int channel, const double *samples, size_t samples_len)
+{
+	struct audio_channel_plan plan;
+	double *data, *bin_power;
+	size_t data_len = samples_len;
+	size_t i;
+	bool success;
+
+	/* gsl will mutate the array in-place, so make a copy */
+	data = malloc(samples_len * sizeof(double));
+	bin_power = malloc((data_len / 2 + 1) * sizeof(double));
+	igt_assert(data && bin_power);
+
+	/* Apply a Hann window to the input signal, to reduce frequency leaks
+	 * due to the endpoints of the signal being discontinuous.
+	 *
+	 * For more info:
+	 * - https://download.ni.com/evaluation/pxi/Understanding%20FFTs%20and%20Windowing.pdf
+	 * - https://en.wikipedia.org/wiki/Window_function
+	 */
+	for (i = 0; i < data_len; i++)
+		data[i] = hann_window(samples[i], i, data_len);
+
+	audio_bin_power(data, data_len, bin_power);
+
+	audio_channel_plan_init(&plan, signal, channel);
+	success = audio_detect_peaks(&plan, sampling_rate, data_len, bin_power);
+
+	free(bin_power);
 	free(data);
 
 	return success;
 }
 
+struct audio_analyzer_channel {
+	struct audio_analyzer *analyzer;
+	int index;
+	struct audio_channel_plan plan;
+	double *data;
+	double *bin_power;
+	bool detected;
+};
+
+struct audio_analyzer {
+	int sampling_rate;
+	int channels;
+	int input_channels;
+	int channel_map[CHANNELS_MAX];
+
+	size_t window_len;
+	size_t hop_len;
+	double *window;
+
+	/* Per channel rings of the last window_len samples */
+	double *history;
+	size_t pos;
+	size_t filled;
+	size_t pending;
+
+	size_t windows;
+	uint32_t detected;
+	int streak;
+
+	struct audio_analyzer_channel chans[CHANNELS_MAX];
+};
+
+/**
+ * audio_analyzer_init:
+ * @signal: The signal to look for, its frequencies must not change while
+ * the analyzer is in use
+ * @sampling_rate: The sampling rate of the analyzed samples, in Hz
+ * @window_len: The number of samples per channel of each analyzed window, a
+ * power of two
+ * @hop_len: The number of samples between the starts of two consecutive
+ * windows when streaming, at most @window_len
+ * @input_channels: The number of interleaved channels of the input
+ * @channel_map: Which input channel carries each channel of @signal, or
+ * NULL if they are the same
+ *
+ * Prepares the detection of @signal on all of its channels at once. The
+ * Hann window, the expected frequencies of every channel and all buffers
+ * are set up here, so that analyzing a window only deinterleaves the
+ * samples and runs one FFT per channel, the channels in parallel for large
+ * windows.
+ *
+ * Returns: A newly-allocated analyzer, to be freed with
+ * audio_analyzer_fini()
+ */
+struct audio_analyzer *audio_analyzer_init(struct audio_signal *signal,
+					   int sampling_rate,
+					   size_t window_len, size_t hop_len,
+					   int input_channels,
+					   const int *channel_map)
+{
+	struct audio_analyzer *analyzer;
+	size_t j;
+	int i;
+
+	igt_assert(window_len >= 2 && !(window_len & (window_len - 1)));
+	igt_assert(hop_len > 0 && hop_len <= window_len);
+
+	analyzer = calloc(1, sizeof(*analyzer));
+	igt_assert(analyzer);
+
+	analyzer->sampling_rate = sampling_rate;
+	analyzer->channels = signal->channels;
+	analyzer->input_channels = input_channels;
+	analyzer->window_len = window_len;
+	analyzer->hop_len = hop_len;
+
+	analyzer->window = malloc(window_len * sizeof(double));
+	analyzer->history = calloc(signal->channels * window_len, sizeof(double));
+	igt_assert(analyzer->window && analyzer->history);
+	for (j = 0; j < window_len; j++)
+		analyzer->window[j] = hann_window(1.0, j, window_len);
+
+	for (i = 0; i < signal->channels; i++) {
+		struct audio_analyzer_channel *chan = &analyzer->chans[i];
+
+		analyzer->channel_map[i] = channel_map ? channel_map[i] : i;
+		igt_assert(analyzer->channel_map[i] >= 0 &&
+			   analyzer->channel_map[i] < input_channels);
+
+		chan->analyzer = analyzer;
+		chan->index = i;
+		audio_channel_plan_init(&chan->plan, signal, i);
+		chan->data = malloc(window_len * sizeof(double));
+		chan->bin_power = malloc((window_len / 2 + 1) * sizeof(double));
+		igt_assert(chan->data && chan->bin_power);
+	}
+
+	return analyzer;
+}
+
+/**
+ * audio_analyzer_fini:
+ * @analyzer: The analyzer to free
+ */
+void audio_analyzer_fini(struct audio_analyzer *analyzer)
+{
+	int i;
+
+	for (i = 0; i < analyzer->channels; i++) {
+		free(analyzer->chans[i].data);
+		free(analyzer->chans[i].bin_power);
+	}
+	free(analyzer->history);
+	free(analyzer->window);
+	free(analyzer);
+}
+
+static void *audio_analyzer_channel_detect(void *arg)
+{
+	struct audio_analyzer_channel *chan = arg;
+	struct audio_analyzer *analyzer = chan->analyzer;
+
+	audio_bin_power(chan->data, analyzer->window_len, chan->bin_power);
+	chan->detected = audio_detect_peaks(&chan->plan, analyzer->sampling_rate,
+					    analyzer->window_len, chan->bin_power);
+
+	return NULL;
+}
+
+/* Runs the FFTs of all channels, whose windowed samples are in their data */
+static uint32_t audio_analyzer_run(struct audio_analyzer *analyzer)
+{
+	pthread_t threads[CHANNELS_MAX];
+	uint32_t detected = 0;
+	int nthreads = 1;
+	int i;
+
+	if (analyzer->channels > 1 &&
+	    analyzer->window_len * analyzer->channels >= ANALYZER_PARALLEL_THRESHOLD)
+		nthreads = analyzer->channels;
+
+	if (nthreads == 1) {
+		for (i = 0; i < analyzer->channels; i++)
+			audio_analyzer_channel_detect(&analyzer->chans[i]);
+	} else {
+		for (i = 1; i < nthreads; i++)
+			igt_assert_eq(pthread_create(&threads[i], NULL,
+						     audio_analyzer_channel_detect,
+						     &analyzer->chans[i]), 0);
+
+		audio_analyzer_channel_detect(&analyzer->chans[0]);
+
+		for (i = 1; i < nthreads; i++)
+			pthread_join(threads[i], NULL);
+	}
+
+	for (i = 0; i < analyzer->channels; i++)
+		if (analyzer->chans[i].detected)
+			detected |= 1 << i;
+
+	analyzer->windows++;
+	analyzer->detected = detected;
+	if (detected == (1u << analyzer->channels) - 1)
+		analyzer->streak++;
+	else
+		analyzer->streak = 0;
+
+	return detected;
+}
+
+/**
+ * audio_analyzer_detect:
+ * @analyzer: The target analyzer
+ * @samples: @window_len frames of @input_channels interleaved samples
+ *
+ * Looks for the signal on all channels of one window of samples.
+ *
+ * Returns: A mask of the channels on which the signal was found
+ */
+uint32_t audio_analyzer_detect(struct audio_analyzer *analyzer,
+			       const double *samples)
+{
+	size_t i;
+	int c;
+
+	for (c = 0; c < analyzer->channels; c++) {
+		const double *src = samples + analyzer->channel_map[c];
+		double *data = analyzer->chans[c].data;
+
+		for (i = 0; i < analyzer->window_len; i++)
+			data[i] = src[i * analyzer->input_channels] * analyzer->window[i];
+	}
+
+	return audio_analyzer_run(analyzer);
+}
+
+/* Copies the samples of the ring into data, oldest first, windowed */
+static void audio_analyzer_window_history(struct audio_analyzer *analyzer)
+{
+	size_t n = analyzer->window_len;
+	size_t head = n - analyzer->pos;
+	size_t i;
+	int c;
+
+	for (c = 0; c < analyzer->channels; c++) {
+		const double *ring = analyzer->history + c * n;
+		double *data = analyzer->chans[c].data;
+
+		for (i = 0; i < head; i++)
+			data[i] = ring[analyzer->pos + i] * analyzer->window[i];
+		for (i = head; i < n; i++)
+			data[i] = ring[i - head] * analyzer->window[i];
+	}
+}
+
+static size_t audio_analyzer_push(struct audio_analyzer *analyzer,
+				  const void *samples, size_t frames,
+				  bool s32)
+{
+	size_t n = analyzer->window_len;
+	size_t windows = 0;
+
+	while (frames) {
+		size_t want, count, i;
+		bool ready;
+		int c;
+
+		/* Fill up the first window, then one hop at a time */
+		if (analyzer->filled < n)
+			want = n - analyzer->filled;
+		else
+			want = analyzer->hop_len - analyzer->pending;
+		count = min(min(want, frames), n - analyzer->pos);
+
+		for (c = 0; c < analyzer->channels; c++) {
+			double *ring = analyzer->history + c * n + analyzer->pos;
+			size_t stride = analyzer->input_channels;
+			int src = analyzer->channel_map[c];
+
+			if (s32) {
+				const int32_t *in = (const int32_t *)samples + src;
+
+				for (i = 0; i < count; i++)
+					ring[i] = (double) in[i * stride] / INT32_MAX;
+			} else {
+				const double *in = (const double *)samples + src;
+
+				for (i = 0; i < count; i++)
+					ring[i] = in[i * stride];
+			}
+		}
+
+		if (s32)
+			samples = (const int32_t *)samples + count * analyzer->input_channels;
+		else
+			samples = (const double *)samples + count * analyzer->input_channels;
+		frames -= count;
+
+		analyzer->pos = (analyzer->pos + count) % n;
+		if (analyzer->filled < n) {
+			analyzer->filled += count;
+			ready = analyzer->filled == n;
+		} else {
+			analyzer->pending += count;
+			ready = analyzer->pending == analyzer->hop_len;
+		}
+
+		if (ready) {
+			audio_analyzer_window_history(analyzer);
+			audio_analyzer_run(analyzer);
+			analyzer->pending = 0;
+			windows++;
+		}
+	}
+
+	return windows;
+}
+
+/**
+ * audio_analyzer_feed:
+ * @analyzer: The target analyzer
+ * @samples: @frames frames of @input_channels interleaved samples
+ * @frames: The number of frames to add
+ *
+ * Streams samples through the analyzer. A window is analyzed once the
+ * first @window_len frames arrived, and then again every @hop_len frames.
+ * Each sample is only deinterleaved once, overlapping windows are built
+ * from a history of the last @window_len frames.
+ *
+ * Returns: The number of windows analyzed
+ */
+size_t audio_analyzer_feed(struct audio_analyzer *analyzer,
+			   const double *samples, size_t frames)
+{
+	return audio_analyzer_push(analyzer, samples, frames, false);
+}
+
+/**
+ * audio_analyzer_feed_s32_le:
+ * @analyzer: The target analyzer
+ * @samples: @frames frames of @input_channels interleaved S32_LE samples
+ * @frames: The number of frames to add
+ *
+ * Same as audio_analyzer_feed(), for samples as captured.
+ *
+ * Returns: The number of windows analyzed
+ */
+size_t audio_analyzer_feed_s32_le(struct audio_analyzer *analyzer,
+				  const int32_t *samples, size_t frames)
+{
+	return audio_analyzer_push(analyzer, samples, frames, true);
+}
+
+/**
+ * audio_analyzer_detected:
+ * @analyzer: The target analyzer
+ *
+ * Returns: A mask of the channels on which the signal was found in the last
+ * analyzed window
+ */
+uint32_t audio_analyzer_detected(const struct audio_analyzer *analyzer)
+{
+	return analyzer->detected;
+}
+
+/**
+ * audio_analyzer_streak:
+ * @analyzer: The target analyzer
+ *
+ * Returns: The number of consecutive windows, up to the last analyzed one,
+ * in which the signal was found on all channels
+ */
+int audio_analyzer_streak(const struct audio_analyzer *analyzer)
+{
+	return analyzer->streak;
+}
+
+/**
+ * audio_analyzer_windows:
+ * @analyzer: The target analyzer
+ *
+ * Returns: The number of windows analyzed so far
+ */
+size_t audio_analyzer_windows(const struct audio_analyzer *analyzer)
+{
+	return analyzer->windows;
+}
+
 /**
  * audio_extract_channel_s32_le: extracts a single channel from a multi-channel
  * S32_LE input buffer.
@@ -46,6 +46,25 @@ void audio_signal_fill(struct audio_signal *signal, double *buffer,
 		       size_t samples);
 bool audio_signal_detect(struct audio_signal *signal, int sampling_rate,
 			 int channel, const double *samples, size_t samples_len);
+
+struct audio_analyzer;
+
+struct audio_analyzer *audio_analyzer_init(struct audio_signal *signal,
+					   int sampling_rate,
+					   size_t window_len, size_t hop_len,
+					   int input_channels,
+					   const int *channel_map);
+void audio_analyzer_fini(struct audio_analyzer *analyzer);
+uint32_t audio_analyzer_detect(struct audio_analyzer *analyzer,
+			       const double *samples);
+size_t audio_analyzer_feed(struct audio_analyzer *analyzer,
+			   const double *samples, size_t frames);
+size_t audio_analyzer_feed_s32_le(struct audio_analyzer *analyzer,
+				  const int32_t *samples, size_t frames);
+uint32_t audio_analyzer_detected(const struct audio_analyzer *analyzer);
+int audio_analyzer_streak(const struct audio_analyzer *analyzer);
+size_t audio_analyzer_windows(const struct audio_analyzer *analyzer);
+
 size_t audio_extract_channel_s32_le(double *dst, size_t dst_cap,
 				    int32_t *src, size_t src_len,
 				    int n_channels, int channel);
@@ -42,10 +42,12 @@
 #include <cairo.h>
 
 #include "igt_chamelium.h"
+#include "igt_chamelium_stream.h"
 #include "igt_core.h"
 #include "igt_aux.h"
 #include "igt_edid.h"
 #include "igt_frame.h"
+#include "igt_frame_compare.h"
 #include "igt_list.h"
 #include "igt_kms.h"
 #include "igt_pipe_crc.h"
@@ -129,6 +131,10 @@ struct chamelium {
 	/* Indicates the last port to have been used for capturing video */
 	struct chamelium_port *capturing_port;
 
+	/* Streaming server for captured frames, connected on first use */
+	struct chamelium_stream *stream;
+	bool stream_unavailable;
+
 	int drm_fd;
 
 	struct igt_list_head edids;
@@ -1313,6 +1319,31 @@ static struct chamelium_frame_dump *frame_from_xml(struct chamelium *chamelium,
 	return ret;
 }
 
+static struct chamelium_stream *chamelium_get_stream(struct chamelium *chamelium)
+{
+	if (!chamelium->stream && !chamelium->stream_unavailable) {
+		chamelium->stream = chamelium_stream_init();
+		if (!chamelium->stream) {
+			igt_debug("No Chamelium streaming server, dumping frames over XML-RPC\n");
+			chamelium->stream_unavailable = true;
+		}
+	}
+
+	return chamelium->stream;
+}
+
+static void chamelium_close_stream(struct chamelium *chamelium)
+{
+	chamelium_stream_deinit(chamelium->stream);
+	chamelium->stream = NULL;
+}
+
+static void chamelium_drop_stream(struct chamelium *chamelium)
+{
+	chamelium_close_stream(chamelium);
+	chamelium->stream_unavailable = true;
+}
+
 /**
  * chamelium_port_dump_pixels:
  * @chamelium: The Chamelium instance to use
@@ -1541,6 +1572,228 @@ igt_crc_t *chamelium_read_captured_crcs(struct chamelium *chamelium,
 	return ret;
 }
 
+/*
+ * chameleond dumps the frames of a capture back to back from the start of
+ * its video dump area, where the streaming server can read them from.
+ */
+#define CHAMELIUM_VIDEO_DUMP_ADDR 0xc0000000
+
+struct captured_frames {
+	struct chamelium *chamelium;
+	igt_crc_t *crcs;
+	int crc_count;
+	int width, height;
+	int next;
+	bool stop;
+	chamelium_frame_dump_cb cb;
+	void *data;
+};
+
+static struct chamelium_frame_dump *
+xml_read_captured_frame(struct chamelium *chamelium, unsigned int index)
+{
+	xmlrpc_value *res;
+	struct chamelium_frame_dump *frame;
+
+	res = chamelium_rpc(chamelium, NULL, "ReadCapturedFrame", "(i)", index);
+	frame = frame_from_xml(chamelium, res);
+	xmlrpc_DECREF(res);
+
+	return frame;
+}
+
+/*
+ * The Chamelium's checksum of a streamed frame, in the same way as
+ * chamelium_do_calculate_fb_crc() but over packed 24-bit RGB, with the four
+ * interleaved sums computed in a single pass.
+ */
+static bool stream_frame_crc_matches(const struct chamelium_stream_frame *sframe,
+				     const igt_crc_t *crc)
+{
+	const int n = 4;
+	uint64_t sum[4] = {}, count[4] = {};
+	const uint8_t *p = sframe->data;
+	int i, k;
+
+	if (crc->n_words != n)
+		return false;
+
+	for (i = 0; i < sframe->width * sframe->height; i++, p += 3) {
+		uint64_t value = p[0] | (p[1] << 8) | (p[2] << 16);
+
+		k = i % n;
+		sum[k] += ++count[k] * value;
+	}
+
+	for (k = 0; k < n; k++) {
+		uint32_t hash = ((sum[k] >> 0) ^ (sum[k] >> 16) ^
+				 (sum[k] >> 32) ^ (sum[k] >> 48)) & 0xffff;
+
+		if (crc->crc[n - k - 1] != hash)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * The dump area layout isn't part of the XML-RPC API, so each streamed frame
+ * is checked against the checksum the Chamelium computed while capturing it.
+ * This also catches the half frames of a dual pixel mode port.
+ */
+static bool stream_frame_is_captured(const struct captured_frames *captured,
+				     const struct chamelium_stream_frame *sframe,
+				     int index)
+{
+	if (sframe->width == captured->width &&
+	    sframe->height == captured->height &&
+	    stream_frame_crc_matches(sframe, &captured->crcs[index]))
+		return true;
+
+	igt_debug("Streamed frame %d doesn't match the capture, reading captured frames over XML-RPC\n",
+		  index);
+	return false;
+}
+
+/*
+ * Asks the streaming server for captured frames @captured->next up to @count.
+ * Returns false when streaming isn't possible, without reading anything.
+ */
+static bool stream_request_captured_frames(struct captured_frames *captured,
+					   struct chamelium_stream *stream,
+					   int count)
+{
+	uint32_t size = captured->width * captured->height * 3;
+
+	if (count > captured->crc_count)
+		return false;
+
+	if (!chamelium_stream_config_video(stream, captured->width,
+					   captured->height) ||
+	    !chamelium_stream_request_video_frames(stream,
+						   CHAMELIUM_VIDEO_DUMP_ADDR +
+						   captured->next * size,
+						   0, count - captured->next)) {
+		chamelium_drop_stream(captured->chamelium);
+		return false;
+	}
+
+	return true;
+}
+
+static bool stream_captured_frame_cb(const struct chamelium_stream_frame *sframe,
+				     void *data)
+{
+	struct captured_frames *captured = data;
+	struct chamelium_frame_dump frame = {
+		.bgr = sframe->data,
+		.size = sframe->size,
+		.width = sframe->width,
+		.height = sframe->height,
+		.port = captured->chamelium->capturing_port,
+	};
+
+	if (!stream_frame_is_captured(captured, sframe, captured->next))
+		return false;
+
+	captured->next++;
+	captured->stop = !captured->cb(&frame, captured->data);
+
+	return !captured->stop;
+}
+
+static void stream_read_captured_frames(struct captured_frames *captured,
+					int count)
+{
+	struct chamelium *chamelium = captured->chamelium;
+	struct chamelium_stream *stream;
+	int first = captured->next;
+	int ret;
+
+	if (first >= count)
+		return;
+
+	stream = chamelium_get_stream(chamelium);
+	if (!stream)
+		return;
+
+	chamelium_get_captured_resolution(chamelium, &captured->width,
+					  &captured->height);
+	captured->crcs = chamelium_read_captured_crcs(chamelium,
+						      &captured->crc_count);
+
+	if (stream_request_captured_frames(captured, stream, count)) {
+		ret = chamelium_stream_capture_video(stream, count - first,
+						     stream_captured_frame_cb,
+						     captured);
+
+		/*
+		 * Frames left in flight can't be told apart from the ones of
+		 * the next request, reconnect on the next read.
+		 */
+		if (ret < 0 || captured->next - first != ret)
+			chamelium_drop_stream(chamelium);
+		else if (captured->next < count)
+			chamelium_close_stream(chamelium);
+	}
+
+	free(captured->crcs);
+}
+
+/**
+ * chamelium_read_captured_frames:
+ * @chamelium: The Chamelium instance to use
+ * @count: The number of captured frames to read, starting from the first one
+ * @cb: Called with each frame in order, returns false to stop early
+ * @data: Passed to @cb
+ *
+ * Reads the first @count video frames captured during the last video capture
+ * on the Chamelium. The frame dump passed to @cb is only valid for the
+ * duration of the call.
+ *
+ * When the Chamelium streaming server is reachable, the frames are received
+ * from it as raw pixels, and @cb processes each frame while the following
+ * ones are being received. Otherwise, or if streaming fails, the remaining
+ * frames are read over XML-RPC like #chamelium_read_captured_frame does.
+ *
+ * Returns: the number of frames passed to @cb
+ */
+int chamelium_read_captured_frames(struct chamelium *chamelium, int count,
+				   chamelium_frame_dump_cb cb, void *data)
+{
+	struct captured_frames captured = {
+		.chamelium = chamelium,
+		.cb = cb,
+		.data = data,
+	};
+	struct chamelium_frame_dump *frame;
+
+	stream_read_captured_frames(&captured, count);
+
+	for (; !captured.stop && captured.next < count; captured.next++) {
+		frame = xml_read_captured_frame(chamelium, captured.next);
+		captured.stop = !cb(frame, data);
+		chamelium_destroy_frame_dump(frame);
+	}
+
+	return captured.next;
+}
+
+static bool keep_captured_frame(const struct chamelium_frame_dump *frame,
+				void *data)
+{
+	struct chamelium_frame_dump **dump = data;
+
+	*dump = malloc(sizeof(**dump));
+	igt_assert(*dump);
+	**dump = *frame;
+	(*dump)->bgr = malloc(frame->size);
+	igt_assert((*dump)->bgr);
+	memcpy((*dump)->bgr, frame->bgr, frame->size);
+
+	return false;
+}
+
 /**
  * chamelium_port_read_captured_frame:
  *
@@ -1550,17 +1803,25 @@ igt_crc_t *chamelium_read_captured_crcs(struct chamelium *chamelium,
  * Retrieves a single video frame captured during the last video capture on the
  * Chamelium. This data should be freed using #chamelium_destroy_frame_data
  *
+ * When the Chamelium streaming server is reachable, the frame is received
+ * from it as raw pixels rather than base64 encoded over XML-RPC.
+ *
  * Returns: a chamelium_frame_dump struct
  */
 struct chamelium_frame_dump *chamelium_read_captured_frame(struct chamelium *chamelium,
 							   unsigned int index)
 {
-	xmlrpc_value *res;
-	struct chamelium_frame_dump *frame;
+	struct captured_frames captured = {
+		.chamelium = chamelium,
+		.next = index,
+		.cb = keep_captured_frame,
+	};
+	struct chamelium_frame_dump *frame = NULL;
 
-	res = chamelium_rpc(chamelium, NULL, "ReadCapturedFrame", "(i)", index);
-	frame = frame_from_xml(chamelium, res);
-	xmlrpc_DECREF(res);
+	captured.data = &frame;
+	stream_read_captured_frames(&captured, index + 1);
+	if (!frame)
+		frame = xml_read_captured_frame(chamelium, index);
 
 	return frame;
 }
@@ -1864,6 +2125,17 @@ static cairo_surface_t *convert_frame_dump_argb32(const struct chamelium_frame_d
 	return dump_surface;
 }
 
+static struct igt_frame_buf frame_dump_buf(const struct chamelium_frame_dump *dump)
+{
+	return (struct igt_frame_buf) {
+		.data = dump->bgr,
+		.stride = dump->width * 3,
+		.width = dump->width,
+		.height = dump->height,
+		.format = DRM_FORMAT_BGR888,
+	};
+}
+
 static void compared_frames_dump(cairo_surface_t *reference,
 				 cairo_surface_t *capture,
 				 igt_crc_t *reference_crc,
@@ -1910,29 +2182,31 @@ bool chamelium_frame_eq_or_dump_frame_pair(const struct chamelium *chamelium,
 			                   const struct chamelium_frame_dump *frame0,
 			                   const struct chamelium_frame_dump *frame1)
 {
+	struct igt_frame_buf buf0, buf1;
 	cairo_surface_t *reference;
 	cairo_surface_t *capture;
-	bool eq;
-
-	/* Grab the captured reference frame from chamelium */
-	reference = convert_frame_dump_argb32(frame0);
-
-	/* Grab the captured frame from chamelium */
-	capture = convert_frame_dump_argb32(frame1);
 
-	if (frame0->size != frame1->size)
+	if (frame0->width != frame1->width || frame0->height != frame1->height)
 		return false;
 
 	/* Now do the actual comparison */
-	eq = memcmp(frame0->bgr, frame1->bgr, frame0->size) == 0;
+	buf0 = frame_dump_buf(frame0);
+	buf1 = frame_dump_buf(frame1);
+	if (igt_frame_compare(&buf0, &buf1, NULL, NULL))
+		return true;
+
+	/* Only convert the frames when they are written out */
+	if (igt_frame_dump_is_enabled()) {
+		reference = convert_frame_dump_argb32(frame0);
+		capture = convert_frame_dump_argb32(frame1);
 
-	if (!eq && igt_frame_dump_is_enabled())
 		compared_frames_dump(reference, capture, 0, 0);
 
-	cairo_surface_destroy(reference);
-	cairo_surface_destroy(capture);
+		cairo_surface_destroy(reference);
+		cairo_surface_destroy(capture);
+	}
 
-	return eq;
+	return false;
 }
 
 /**
@@ -1950,31 +2224,22 @@ void chamelium_assert_frame_eq(const struct chamelium *chamelium,
 			       struct igt_fb *fb)
 {
 	cairo_surface_t *fb_surface;
-	pixman_image_t *reference_src, *reference_bgr;
-	int w = dump->width, h = dump->height;
-	bool eq;
+	struct igt_frame_buf reference, capture;
 
 	/* Get the cairo surface for the framebuffer */
 	fb_surface = igt_get_cairo_surface(chamelium->drm_fd, fb);
 
-	/*
-	 * Convert the reference image into the same format as the chamelium
-	 * image
-	 */
-	reference_src = pixman_image_create_bits(
-	    PIXMAN_x8r8g8b8, w, h,
-	    (void*)cairo_image_surface_get_data(fb_surface),
-	    cairo_image_surface_get_stride(fb_surface));
-	reference_bgr = convert_frame_format(reference_src, PIXMAN_b8g8r8);
-	pixman_image_unref(reference_src);
-
-	/* Now do the actual comparison */
-	eq = memcmp(dump->bgr, pixman_image_get_data(reference_bgr),
-		    dump->size) == 0;
-
-	pixman_image_unref(reference_bgr);
-
-	igt_fail_on_f(!eq,
+	/* Compare the packed dump directly against the XRGB reference */
+	reference = (struct igt_frame_buf) {
+		.data = cairo_image_surface_get_data(fb_surface),
+		.stride = cairo_image_surface_get_stride(fb_surface),
+		.width = dump->width,
+		.height = dump->height,
+		.format = DRM_FORMAT_XRGB8888,
+	};
+	capture = frame_dump_buf(dump);
+
+	igt_fail_on_f(!igt_frame_compare(&reference, &capture, NULL, NULL),
 		      "Chamelium frame dump didn't match reference image\n");
 }
 
@@ -3152,6 +3417,9 @@ void chamelium_deinit(struct chamelium *chamelium)
 
 	close(chamelium->drm_fd);
 
+	if (chamelium->stream)
+		chamelium_stream_deinit(chamelium->stream);
+
 	xmlrpc_client_destroy(chamelium->client);
 
 	for (i = 0; i < chamelium->port_count; i++)
@@ -45,6 +45,18 @@ struct chamelium_port;
 struct chamelium_frame_dump;
 struct chamelium_fb_crc_async_data;
 
+/**
+ * chamelium_frame_dump_cb:
+ * @frame: A captured frame, only valid for the duration of the call
+ * @data: The data passed along with the callback
+ *
+ * Called by #chamelium_read_captured_frames for each frame it reads.
+ *
+ * Returns: true to read the next frame, false to stop
+ */
+typedef bool (*chamelium_frame_dump_cb)(const struct chamelium_frame_dump *frame,
+					void *data);
+
 /**
  * chamelium_check:
  * @CHAMELIUM_CHECK_ANALOG: Fuzzy checking method for analog interfaces
@@ -228,6 +240,8 @@ igt_crc_t *chamelium_read_captured_crcs(struct chamelium *chamelium,
 					int *frame_count);
 struct chamelium_frame_dump *chamelium_read_captured_frame(struct chamelium *chamelium,
 							   unsigned int index);
+int chamelium_read_captured_frames(struct chamelium *chamelium, int count,
+				   chamelium_frame_dump_cb cb, void *data);
 struct chamelium_frame_dump *chamelium_port_dump_pixels(struct chamelium *chamelium,
 							struct chamelium_port *port,
 							int x, int y,
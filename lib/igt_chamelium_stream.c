@@ -28,6 +28,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netdb.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -71,11 +72,18 @@ enum stream_message_type {
 	STREAM_MESSAGE_STOP_DUMP_AUDIO = 8,
 };
 
+/* frame number (u32), width (u16), height (u16), channel (u8), padding */
+#define STREAM_VIDEO_FRAME_HEADER_SIZE 12
+
 struct chamelium_stream {
 	char *host;
 	unsigned int port;
 
 	int fd;
+
+	/* Responses to pipelined video frame requests still to be read */
+	unsigned int pending_responses;
+	unsigned int dropped_frames;
 };
 
 static const char *stream_error_str(enum stream_error err)
@@ -321,9 +329,26 @@ static bool chamelium_stream_read_response(struct chamelium_stream *client,
 	enum stream_error read_err;
 	size_t read_len;
 
-	if (!chamelium_stream_read_header(client, &read_kind, &read_type,
-					  &read_err, &read_len))
-		return false;
+	while (true) {
+		if (!chamelium_stream_read_header(client, &read_kind, &read_type,
+						  &read_err, &read_len))
+			return false;
+
+		/* Frame requests may be answered after their last frame */
+		if (read_kind != STREAM_MESSAGE_RESPONSE ||
+		    read_type != STREAM_MESSAGE_VIDEO_FRAME ||
+		    read_type == type || !client->pending_responses)
+			break;
+
+		client->pending_responses--;
+		if (read_err != STREAM_ERROR_NONE) {
+			igt_warn("Received error: %s (%d)\n",
+				 stream_error_str(read_err), read_err);
+			return false;
+		}
+		if (!read_and_discard(client->fd, read_len))
+			return false;
+	}
 
 	if (read_kind != STREAM_MESSAGE_RESPONSE) {
 		igt_warn("Expected a response, got kind %d\n", read_kind);
@@ -487,25 +512,15 @@ bool chamelium_stream_receive_realtime_audio(struct chamelium_stream *client,
 	return read_whole(client->fd, *buf, body_len);
 }
 
-/**
- * chamelium_stream_stop_realtime_audio:
- *
- * Stops real-time audio capture. This also drops any buffered audio pages.
- * The caller shouldn't call #chamelium_stream_receive_realtime_audio after
- * stopping audio capture.
- */
-bool chamelium_stream_stop_realtime_audio(struct chamelium_stream *client)
+static bool chamelium_stream_stop(struct chamelium_stream *client,
+				  enum stream_message_type stop_type)
 {
 	enum stream_message_kind kind;
 	enum stream_message_type type;
 	enum stream_error err;
 	size_t len;
 
-	igt_debug("Stopping real-time audio capture\n");
-
-	if (!chamelium_stream_write_request(client,
-					    STREAM_MESSAGE_STOP_DUMP_AUDIO,
-					    NULL, 0))
+	if (!chamelium_stream_write_request(client, stop_type, NULL, 0))
 		return false;
 
 	while (true) {
@@ -513,17 +528,16 @@ bool chamelium_stream_stop_realtime_audio(struct chamelium_stream *client)
 						  &err, &len))
 			return false;
 
-		if (kind == STREAM_MESSAGE_RESPONSE)
+		if (kind == STREAM_MESSAGE_RESPONSE && type == stop_type)
 			break;
 
+		if (kind == STREAM_MESSAGE_RESPONSE && client->pending_responses)
+			client->pending_responses--;
+
 		if (!read_and_discard(client->fd, len))
 			return false;
 	}
 
-	if (type != STREAM_MESSAGE_STOP_DUMP_AUDIO) {
-		igt_warn("Unexpected response type %d\n", type);
-		return false;
-	}
 	if (err != STREAM_ERROR_NONE) {
 		igt_warn("Received error: %s (%d)\n",
 			 stream_error_str(err), err);
@@ -538,18 +552,350 @@ bool chamelium_stream_stop_realtime_audio(struct chamelium_stream *client)
 }
 
 /**
- * chamelium_stream_init:
+ * chamelium_stream_stop_realtime_audio:
  *
- * Connects to the Chamelium streaming server.
+ * Stops real-time audio capture. This also drops any buffered audio pages.
+ * The caller shouldn't call #chamelium_stream_receive_realtime_audio after
+ * stopping audio capture.
  */
-struct chamelium_stream *chamelium_stream_init(void)
+bool chamelium_stream_stop_realtime_audio(struct chamelium_stream *client)
+{
+	igt_debug("Stopping real-time audio capture\n");
+
+	return chamelium_stream_stop(client, STREAM_MESSAGE_STOP_DUMP_AUDIO);
+}
+
+/**
+ * chamelium_stream_config_video:
+ * @width: width of the captured area
+ * @height: height of the captured area
+ *
+ * Sets the size of the frames sent by the streaming server.
+ */
+bool chamelium_stream_config_video(struct chamelium_stream *client,
+				   int width, int height)
+{
+	char req[4];
+
+	igt_debug("Configuring video stream for %dx%d\n", width, height);
+
+	*(uint16_t *) &req[0] = htons(width);
+	*(uint16_t *) &req[2] = htons(height);
+	return chamelium_stream_call(client, STREAM_MESSAGE_VIDEO_STREAM,
+				     req, sizeof(req), NULL, 0);
+}
+
+/**
+ * chamelium_stream_request_video_frames:
+ * @addr: Chamelium memory address of the first captured frame
+ * @addr2: address of the second half of dual pixel mode frames, or 0
+ * @count: number of frames to dump
+ *
+ * Asks the streaming server to dump frames from capture memory, without
+ * waiting for the answer. Several requests can be queued back to back,
+ * the frames are then read with #chamelium_stream_receive_video_frame in
+ * the order they were requested.
+ */
+bool chamelium_stream_request_video_frames(struct chamelium_stream *client,
+					   uint32_t addr, uint32_t addr2,
+					   uint16_t count)
+{
+	char req[10];
+
+	*(uint32_t *) &req[0] = htonl(addr);
+	*(uint32_t *) &req[4] = htonl(addr2);
+	*(uint16_t *) &req[8] = htons(count);
+
+	if (!chamelium_stream_write_request(client, STREAM_MESSAGE_VIDEO_FRAME,
+					    req, sizeof(req)))
+		return false;
+
+	client->pending_responses++;
+	return true;
+}
+
+/**
+ * chamelium_stream_dump_realtime_video:
+ * @dual: whether the port captures in dual pixel mode
+ * @mode: what to do when the Chamelium runs out of memory
+ *
+ * Starts streaming captured frames as they arrive. The caller can then
+ * call #chamelium_stream_receive_video_frame or
+ * #chamelium_stream_capture_video to receive them.
+ */
+bool chamelium_stream_dump_realtime_video(struct chamelium_stream *client,
+					  bool dual,
+					  enum chamelium_stream_realtime_mode mode)
+{
+	char req[2];
+
+	igt_debug("Starting real-time video capture\n");
+
+	req[0] = dual;
+	req[1] = mode;
+	return chamelium_stream_call(client, STREAM_MESSAGE_DUMP_REALTIME_VIDEO,
+				     req, sizeof(req), NULL, 0);
+}
+
+static bool chamelium_stream_read_frame(struct chamelium_stream *client,
+					struct chamelium_stream_frame *frame,
+					size_t body_len)
+{
+	char header[STREAM_VIDEO_FRAME_HEADER_SIZE];
+	uint8_t *ptr;
+
+	if (body_len < sizeof(header)) {
+		igt_warn("Video frame message too short (%zu bytes)\n",
+			 body_len);
+		return false;
+	}
+
+	if (!read_whole(client->fd, header, sizeof(header)))
+		return false;
+	body_len -= sizeof(header);
+
+	frame->frame_number = ntohl(*(uint32_t *) &header[0]);
+	frame->width = ntohs(*(uint16_t *) &header[4]);
+	frame->height = ntohs(*(uint16_t *) &header[6]);
+	frame->channel = header[8];
+
+	if (body_len != (size_t)frame->width * frame->height * 3) {
+		igt_warn("Video frame %ux%u with %zu bytes of pixels\n",
+			 frame->width, frame->height, body_len);
+		return false;
+	}
+
+	/* Frames are received in place, the buffer only grows */
+	if (body_len > frame->capacity) {
+		ptr = realloc(frame->data, body_len);
+		if (!ptr) {
+			igt_warn("realloc failed: %s\n", strerror(errno));
+			return false;
+		}
+		frame->data = ptr;
+		frame->capacity = body_len;
+	}
+	frame->size = body_len;
+
+	return read_whole(client->fd, frame->data, body_len);
+}
+
+/**
+ * chamelium_stream_receive_video_frame:
+ * @frame: frame to fill, its buffer is reused and grown as needed
+ *
+ * Receives one frame, either requested with
+ * #chamelium_stream_request_video_frames or from a real-time capture.
+ * Frames dropped by the Chamelium in best effort mode are skipped and
+ * can be detected through the frame numbers.
+ *
+ * The caller is responsible for calling
+ * #chamelium_stream_frame_fini on @frame.
+ */
+bool chamelium_stream_receive_video_frame(struct chamelium_stream *client,
+					  struct chamelium_stream_frame *frame)
+{
+	enum stream_message_kind kind;
+	enum stream_message_type type;
+	enum stream_error err;
+	size_t body_len;
+
+	while (true) {
+		if (!chamelium_stream_read_header(client, &kind, &type,
+						  &err, &body_len))
+			return false;
+
+		if (kind == STREAM_MESSAGE_RESPONSE &&
+		    type == STREAM_MESSAGE_VIDEO_FRAME &&
+		    client->pending_responses) {
+			client->pending_responses--;
+			if (err != STREAM_ERROR_NONE) {
+				igt_warn("Received error: %s (%d)\n",
+					 stream_error_str(err), err);
+				return false;
+			}
+			if (!read_and_discard(client->fd, body_len))
+				return false;
+			continue;
+		}
+
+		if (kind != STREAM_MESSAGE_DATA) {
+			igt_warn("Expected a data message, got kind %d\n", kind);
+			return false;
+		}
+		if (type != STREAM_MESSAGE_VIDEO_FRAME &&
+		    type != STREAM_MESSAGE_DUMP_REALTIME_VIDEO) {
+			igt_warn("Expected a video frame message, got type %d\n",
+				 type);
+			return false;
+		}
+
+		if (err == STREAM_ERROR_NONE)
+			break;
+		else if (err != STREAM_ERROR_VIDEO_MEM_OVERFLOW_DROP) {
+			igt_warn("Received error: %s (%d)\n",
+				 stream_error_str(err), err);
+			return false;
+		}
+
+		igt_debug("Dropped a video frame because of an overflow\n");
+		client->dropped_frames++;
+		if (!read_and_discard(client->fd, body_len))
+			return false;
+	}
+
+	return chamelium_stream_read_frame(client, frame, body_len);
+}
+
+/**
+ * chamelium_stream_get_dropped_frames:
+ *
+ * Returns: the number of frames the Chamelium reported as dropped so far.
+ */
+unsigned int chamelium_stream_get_dropped_frames(struct chamelium_stream *client)
+{
+	return client->dropped_frames;
+}
+
+/**
+ * chamelium_stream_frame_fini:
+ * @frame: frame received with #chamelium_stream_receive_video_frame
+ *
+ * Frees the pixel buffer of @frame.
+ */
+void chamelium_stream_frame_fini(struct chamelium_stream_frame *frame)
 {
+	free(frame->data);
+	memset(frame, 0, sizeof(*frame));
+}
+
+#define CAPTURE_BUFFERS 3
+
+struct capture_ring {
 	struct chamelium_stream *client;
+	struct chamelium_stream_frame frames[CAPTURE_BUFFERS];
+	int count;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int received; /* frames filled by the receiver */
+	int consumed; /* frames released by the consumer */
+	bool failed, stop;
+};
 
-	client = calloc(1, sizeof(*client));
+static void *capture_receiver(void *data)
+{
+	struct capture_ring *ring = data;
+	int i;
+
+	for (i = 0; i < ring->count; i++) {
+		struct chamelium_stream_frame *frame =
+			&ring->frames[i % CAPTURE_BUFFERS];
+		bool ok, stop;
+
+		pthread_mutex_lock(&ring->lock);
+		while (i - ring->consumed >= CAPTURE_BUFFERS && !ring->stop)
+			pthread_cond_wait(&ring->cond, &ring->lock);
+		stop = ring->stop;
+		pthread_mutex_unlock(&ring->lock);
+		if (stop)
+			break;
 
-	if (!chamelium_stream_read_config(client))
-		goto error_client;
+		ok = chamelium_stream_receive_video_frame(ring->client, frame);
+
+		pthread_mutex_lock(&ring->lock);
+		if (ok)
+			ring->received++;
+		else
+			ring->failed = true;
+		pthread_cond_broadcast(&ring->cond);
+		pthread_mutex_unlock(&ring->lock);
+
+		if (!ok)
+			break;
+	}
+
+	return NULL;
+}
+
+/**
+ * chamelium_stream_capture_video:
+ * @count: number of frames to receive
+ * @cb: called for each frame, returns false to stop early
+ * @data: passed to @cb
+ *
+ * Receives @count frames of a real-time capture or of pipelined frame
+ * requests. Frames are read into a small ring of reusable buffers by a
+ * helper thread, so that @cb processing a frame overlaps with the
+ * reception of the following ones.
+ *
+ * When @cb stops early, frames already in flight are left in the
+ * stream and discarded when the capture is stopped.
+ *
+ * Returns: the number of frames passed to @cb, or -1 on a receive error.
+ */
+int chamelium_stream_capture_video(struct chamelium_stream *client, int count,
+				   chamelium_stream_frame_cb cb, void *data)
+{
+	struct capture_ring ring = {
+		.client = client,
+		.count = count,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+	};
+	pthread_t thread;
+	int i, ret;
+
+	igt_assert_eq(pthread_create(&thread, NULL, capture_receiver, &ring), 0);
+
+	for (i = 0; i < count; i++) {
+		bool more, ready;
+
+		pthread_mutex_lock(&ring.lock);
+		while (ring.received <= i && !ring.failed)
+			pthread_cond_wait(&ring.cond, &ring.lock);
+		ready = ring.received > i;
+		pthread_mutex_unlock(&ring.lock);
+		if (!ready)
+			break;
+
+		more = cb(&ring.frames[i % CAPTURE_BUFFERS], data);
+
+		pthread_mutex_lock(&ring.lock);
+		ring.consumed++;
+		ring.stop = !more;
+		pthread_cond_broadcast(&ring.cond);
+		pthread_mutex_unlock(&ring.lock);
+
+		if (!more) {
+			i++;
+			break;
+		}
+	}
+
+	pthread_join(thread, NULL);
+
+	ret = ring.failed ? -1 : i;
+	for (i = 0; i < CAPTURE_BUFFERS; i++)
+		chamelium_stream_frame_fini(&ring.frames[i]);
+
+	return ret;
+}
+
+/**
+ * chamelium_stream_stop_realtime_video:
+ *
+ * Stops real-time video capture and drops any frame still in flight.
+ */
+bool chamelium_stream_stop_realtime_video(struct chamelium_stream *client)
+{
+	igt_debug("Stopping real-time video capture\n");
+
+	return chamelium_stream_stop(client, STREAM_MESSAGE_STOP_DUMP_VIDEO);
+}
+
+static struct chamelium_stream *chamelium_stream_open(struct chamelium_stream *client)
+{
 	if (!chamelium_stream_connect(client))
 		goto error_client;
 	if (!chamelium_stream_check_version(client))
@@ -560,13 +906,55 @@ struct chamelium_stream *chamelium_stream_init(void)
 error_fd:
 	close(client->fd);
 error_client:
+	free(client->host);
 	free(client);
 	return NULL;
 }
 
+/**
+ * chamelium_stream_init:
+ *
+ * Connects to the Chamelium streaming server.
+ */
+struct chamelium_stream *chamelium_stream_init(void)
+{
+	struct chamelium_stream *client;
+
+	client = calloc(1, sizeof(*client));
+
+	if (!chamelium_stream_read_config(client)) {
+		free(client->host);
+		free(client);
+		return NULL;
+	}
+
+	return chamelium_stream_open(client);
+}
+
+/**
+ * chamelium_stream_init_with_address:
+ * @host: host name or address of the streaming server
+ * @port: TCP port, 0 for the default one
+ *
+ * Connects to a streaming server without going through the
+ * configuration file, e.g. a local stand-in server.
+ */
+struct chamelium_stream *chamelium_stream_init_with_address(const char *host,
+							    unsigned int port)
+{
+	struct chamelium_stream *client;
+
+	client = calloc(1, sizeof(*client));
+	client->host = strdup(host);
+	client->port = port ?: STREAM_PORT;
+
+	return chamelium_stream_open(client);
+}
+
 void chamelium_stream_deinit(struct chamelium_stream *client)
 {
 	if (close(client->fd) != 0)
 		igt_warn("close failed: %s\n", strerror(errno));
+	free(client->host);
 	free(client);
 }
@@ -41,7 +41,35 @@ enum chamelium_stream_realtime_mode {
 
 struct chamelium_stream;
 
+/**
+ * chamelium_stream_frame:
+ * @frame_number: number of the frame in the capture
+ * @width: width in pixels
+ * @height: height in pixels
+ * @channel: which half of the frame in dual pixel mode
+ * @data: packed 24-bit RGB pixels
+ * @size: number of valid bytes in @data
+ * @capacity: allocated size of @data
+ *
+ * A video frame received from the streaming server. The pixel buffer is
+ * reused by subsequent receives into the same frame.
+ */
+struct chamelium_stream_frame {
+	uint32_t frame_number;
+	uint16_t width;
+	uint16_t height;
+	uint8_t channel;
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+};
+
+typedef bool (*chamelium_stream_frame_cb)(const struct chamelium_stream_frame *frame,
+					  void *data);
+
 struct chamelium_stream *chamelium_stream_init(void);
+struct chamelium_stream *chamelium_stream_init_with_address(const char *host,
+							    unsigned int port);
 void chamelium_stream_deinit(struct chamelium_stream *client);
 bool chamelium_stream_dump_realtime_audio(struct chamelium_stream *client,
 					  enum chamelium_stream_realtime_mode mode);
@@ -50,4 +78,20 @@ bool chamelium_stream_receive_realtime_audio(struct chamelium_stream *client,
 					     int32_t **buf, size_t *buf_len);
 bool chamelium_stream_stop_realtime_audio(struct chamelium_stream *client);
 
+bool chamelium_stream_config_video(struct chamelium_stream *client,
+				   int width, int height);
+bool chamelium_stream_request_video_frames(struct chamelium_stream *client,
+					   uint32_t addr, uint32_t addr2,
+					   uint16_t count);
+bool chamelium_stream_dump_realtime_video(struct chamelium_stream *client,
+					  bool dual,
+					  enum chamelium_stream_realtime_mode mode);
+bool chamelium_stream_receive_video_frame(struct chamelium_stream *client,
+					  struct chamelium_stream_frame *frame);
+int chamelium_stream_capture_video(struct chamelium_stream *client, int count,
+				   chamelium_stream_frame_cb cb, void *data);
+unsigned int chamelium_stream_get_dropped_frames(struct chamelium_stream *client);
+void chamelium_stream_frame_fini(struct chamelium_stream_frame *frame);
+bool chamelium_stream_stop_realtime_video(struct chamelium_stream *client);
+
 #endif
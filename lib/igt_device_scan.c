@@ -32,7 +32,9 @@
 
 #include <ctype.h>
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <libudev.h>
 #ifdef __linux__
 #include <linux/limits.h>
@@ -43,9 +45,11 @@
 #define PCI_HEADER_TYPE_MASK 0x7f
 #endif
 #include <pci/pci.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 /**
  * SECTION:igt_device_scan
@@ -234,6 +238,13 @@ struct igt_device {
 	struct igt_map *props_map;
 	struct igt_map *attrs_map;
 
+	/*
+	 * Sysattrs are read from sysfs on first access, the whole set
+	 * (limited or all) only when it is needed for printing.
+	 */
+	bool limit_attrs;
+	bool attrs_loaded;
+
 	/* Most usable variables from udev device */
 	char *subsystem;
 	char *syspath;
@@ -264,6 +275,16 @@ static __thread struct {
 	struct igt_list_head all;
 	struct igt_list_head filtered;
 	bool devs_scanned;
+
+	/* syspath to device, for the devices in all */
+	struct igt_map *by_syspath;
+
+	/* What the devices reflect, to tell whether a rescan can be skipped */
+	uint64_t seqnum;
+	bool limit_attrs;
+	bool from_cache;
+	struct stat cache;
+	uint64_t cache_hash;
 } igt_devs;
 
 static void igt_device_free(struct igt_device *dev);
@@ -512,6 +533,7 @@ static void igt_device_add_prop(struct igt_device *dev,
 static void igt_device_add_attr(struct igt_device *dev,
 				const char *key, const char *value)
 {
+	struct igt_map_entry *entry;
 	char linkto[PATH_MAX];
 	const char *v = value;
 
@@ -540,9 +562,78 @@ static void igt_device_add_attr(struct igt_device *dev,
 		v++;
 	}
 
+	/* Fill in an attribute a lazy lookup found missing before */
+	entry = igt_map_search_entry(dev->attrs_map, key);
+	if (entry) {
+		if (!entry->data)
+			entry->data = strdup(v);
+		return;
+	}
+
 	igt_map_insert(dev->attrs_map, strdup(key), strdup(v));
 }
 
+/*
+ * Read a single sysattr directly from sysfs, the same way udev does:
+ * trailing whitespace is stripped from file contents and symlinks
+ * resolve to the name of their target.
+ */
+static void read_attr(struct igt_device *dev, const char *key)
+{
+	char path[PATH_MAX], value[4096];
+	struct stat st;
+	ssize_t len;
+	int fd;
+
+	if (!dev->syspath)
+		return;
+
+	snprintf(path, sizeof(path), "%s/%s", dev->syspath, key);
+	if (lstat(path, &st) != 0)
+		return;
+
+	if (S_ISLNK(st.st_mode)) {
+		igt_device_add_attr(dev, key, NULL);
+		return;
+	}
+
+	if (!S_ISREG(st.st_mode))
+		return;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	len = read(fd, value, sizeof(value) - 1);
+	close(fd);
+	if (len < 0)
+		return;
+
+	while (len && isspace(value[len - 1]))
+		len--;
+	value[len] = '\0';
+
+	igt_device_add_attr(dev, key, value);
+}
+
+/*
+ * Missing attributes are remembered with a NULL value, filters look up
+ * physfn or sriov_numvfs of every device for every filter they resolve.
+ */
+static char *get_attr(struct igt_device *dev, const char *key)
+{
+	struct igt_map_entry *entry = igt_map_search_entry(dev->attrs_map, key);
+
+	if (!entry && !dev->attrs_loaded) {
+		read_attr(dev, key);
+		entry = igt_map_search_entry(dev->attrs_map, key);
+		if (!entry)
+			entry = igt_map_insert(dev->attrs_map, strdup(key), NULL);
+	}
+
+	return entry ? entry->data : NULL;
+}
+
 /* Iterate over udev properties list and rewrite it to igt_device properties
  * hash table for instant access.
  */
@@ -587,19 +678,43 @@ static void get_attrs_all(struct udev_device *dev, struct igt_device *idev)
 	}
 }
 
-static void get_attrs_limited(struct udev_device *dev, struct igt_device *idev)
+static void get_attrs_limited(struct igt_device *idev)
 {
-	const char *value;
-
 	for (int i = 0; i < ARRAY_SIZE(attrs); i++) {
-		value = udev_device_get_sysattr_value(dev, attrs[i]);
-		igt_device_add_attr(idev, attrs[i], value);
-		DBG("attr: %s, val: %s\n", attrs[i], value);
+		get_attr(idev, attrs[i]);
+		DBG("attr: %s, val: %s\n", attrs[i], get_attr(idev, attrs[i]));
 	}
 }
 
+/* Fill in the complete set of sysattrs, in place of lazy lookups */
+static void load_attrs(struct igt_device *idev)
+{
+	struct udev_device *dev;
+	struct udev *udev;
+
+	if (idev->attrs_loaded)
+		return;
+
+	if (idev->limit_attrs) {
+		get_attrs_limited(idev);
+		idev->attrs_loaded = true;
+		return;
+	}
+
+	udev = udev_new();
+	igt_assert(udev);
+
+	dev = udev_device_new_from_syspath(udev, idev->syspath);
+	if (dev) {
+		get_attrs_all(dev, idev);
+		udev_device_unref(dev);
+	}
+	udev_unref(udev);
+
+	idev->attrs_loaded = true;
+}
+
 #define get_prop(dev, prop) ((char *) igt_map_search((dev)->props_map, prop))
-#define get_attr(dev, attr) ((char *) igt_map_search((dev)->attrs_map, attr))
 #define get_prop_subsystem(dev) get_prop(dev, "SUBSYSTEM")
 #define is_drm_subsystem(dev)  (strequal(get_prop_subsystem(dev), "drm"))
 #define is_pci_subsystem(dev)  (strequal(get_prop_subsystem(dev), "pci"))
@@ -624,10 +739,12 @@ static bool is_aer_attr(const char *name)
 	       !strcmp(name, "aer_dev_fatal");
 }
 
-static void dump_props_and_attrs(const struct igt_device *dev, bool omit_link)
+static void dump_props_and_attrs(struct igt_device *dev, bool omit_link)
 {
 	struct igt_map_entry *entry;
 
+	load_attrs(dev);
+
 	printf("\n[properties]\n");
 	igt_map_foreach(dev->props_map, entry) {
 		_print_key_value((char *)entry->key, (char *)entry->data);
@@ -635,6 +752,9 @@ static void dump_props_and_attrs(const struct igt_device *dev, bool omit_link)
 
 	printf("\n[attributes]\n");
 	igt_map_foreach(dev->attrs_map, entry) {
+		if (!entry->data)
+			continue;
+
 		/* omit link bandwidth attributes if requested */
 		if (omit_link && is_link_attr(entry->key))
 			continue;
@@ -719,8 +839,7 @@ static struct igt_device *igt_device_new_from_udev(struct udev_device *dev,
 		idev->drm_render = strdup(idev->devnode);
 
 	get_props(dev, idev);
-	limit_attrs ? get_attrs_limited(dev, idev) :
-		      get_attrs_all(dev, idev);
+	idev->limit_attrs = limit_attrs;
 
 	if (is_pci_subsystem(idev)) {
 		uint16_t vendor, device;
@@ -918,10 +1037,42 @@ bool igt_device_find_xe_integrated_card(struct igt_device_card *card)
 	return __find_first_intel_card_by_driver_name(card, false, "xe");
 }
 
+/* FNV-1a, syspaths share too long a prefix for igt_map_hash_32() */
+static uint32_t hash_syspath(const void *key)
+{
+	uint32_t hash = 2166136261u;
+
+	for (const char *c = key; *c; c++)
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+
+	return hash;
+}
+
+/* Indexes the devices found so far, no devices are to be added after it */
+static void index_syspaths(void)
+{
+	struct igt_device *dev;
+
+	igt_devs.by_syspath = igt_map_create(hash_syspath, key_equals);
+	igt_assert(igt_devs.by_syspath);
+
+	igt_list_for_each_entry(dev, &igt_devs.all, link)
+		igt_map_insert(igt_devs.by_syspath, dev->syspath, dev);
+}
+
+static void unindex_syspaths(void)
+{
+	igt_map_destroy(igt_devs.by_syspath, NULL);
+	igt_devs.by_syspath = NULL;
+}
+
 static struct igt_device *igt_device_from_syspath(const char *syspath)
 {
 	struct igt_device *dev;
 
+	if (igt_devs.by_syspath)
+		return igt_map_search(igt_devs.by_syspath, syspath);
+
 	igt_list_for_each_entry(dev, &igt_devs.all, link)
 	{
 		if (strcmp(dev->syspath, syspath) == 0)
@@ -1165,13 +1316,22 @@ static void index_pci_devices(void)
  * Function sorts all found devices to keep same order of bus devices
  * for providing predictable search.
  */
+static void copy_all_to_filtered(void)
+{
+	struct igt_device *dev;
+
+	igt_list_for_each_entry(dev, &igt_devs.all, link) {
+		struct igt_device *dev_dup = duplicate_device(dev);
+		igt_list_add_tail(&dev_dup->link, &igt_devs.filtered);
+	}
+}
+
 static void scan_drm_devices(bool limit_attrs)
 {
 	struct udev *udev;
 	struct udev_enumerate *enumerate;
 	struct udev_list_entry *devices, *dev_list_entry;
 	struct pci_access *pacc = NULL;
-	struct igt_device *dev;
 	int ret;
 
 	udev = udev_new();
@@ -1220,11 +1380,8 @@ static void scan_drm_devices(bool limit_attrs)
 
 	sort_all_devices();
 	index_pci_devices();
-
-	igt_list_for_each_entry(dev, &igt_devs.all, link) {
-		struct igt_device *dev_dup = duplicate_device(dev);
-		igt_list_add_tail(&dev_dup->link, &igt_devs.filtered);
-	}
+	index_syspaths();
+	copy_all_to_filtered();
 }
 
 static void free_key_value(struct igt_map_entry *entry)
@@ -1259,6 +1416,9 @@ void igt_devices_free(void)
 		free(dev);
 	}
 
+	unindex_syspaths();
+	igt_devs.from_cache = false;
+
 	igt_list_for_each_entry_safe(dev, tmp, &igt_devs.all, link) {
 		igt_list_del(&dev->link);
 		igt_device_free(dev);
@@ -1267,20 +1427,511 @@ void igt_devices_free(void)
 	igt_devs.devs_scanned = false;
 }
 
+/*
+ * Scan cache.
+ *
+ * The result of a scan can be saved to a file and reused by other
+ * processes through the IGT_DEVICE_SCAN_CACHE environment variable, as
+ * long as no uevent happened in between. Every hotplug, driver bind or
+ * unbind bumps the kernel uevent sequence number, which is used as the
+ * cache key.
+ *
+ * The format is line based, one "key value" pair per line with '\\' and
+ * newlines escaped in values. Every device is a record of such lines
+ * between "begin" and "end". It is mapped rather than read through stdio,
+ * and as long as neither the file nor the sequence number change, a
+ * process keeps the devices it loaded from it instead of parsing it again
+ * for every filter it resolves.
+ */
+#define SCAN_CACHE_MAGIC "IGT-DEVICE-SCAN-CACHE 2"
+#define UEVENT_SEQNUM_PATH "/sys/kernel/uevent_seqnum"
+
+static const char *uevent_seqnum_path = UEVENT_SEQNUM_PATH;
+
+/**
+ * igt_devices_set_uevent_seqnum_path
+ * @path: file to read the uevent sequence number from, NULL for the default
+ *
+ * Makes the scan cache take its key from @path instead of
+ * /sys/kernel/uevent_seqnum, so that tests can control when the cache goes
+ * stale. @path must stay valid until it is replaced.
+ */
+void igt_devices_set_uevent_seqnum_path(const char *path)
+{
+	uevent_seqnum_path = path ?: UEVENT_SEQNUM_PATH;
+}
+
+/**
+ * igt_devices_uevent_seqnum
+ *
+ * Returns:
+ * The kernel uevent sequence number the scan cache is keyed on, 0 if it
+ * can't be read.
+ */
+uint64_t igt_devices_uevent_seqnum(void)
+{
+	unsigned long long seqnum = 0;
+	FILE *f;
+
+	f = fopen(uevent_seqnum_path, "r");
+	if (!f)
+		return 0;
+
+	if (fscanf(f, "%llu", &seqnum) != 1)
+		seqnum = 0;
+	fclose(f);
+
+	return seqnum;
+}
+
+static void cache_put(FILE *f, const char *key, const char *value)
+{
+	if (!value)
+		return;
+
+	fprintf(f, "%s ", key);
+	for (; *value; value++) {
+		if (*value == '\\')
+			fputs("\\\\", f);
+		else if (*value == '\n')
+			fputs("\\n", f);
+		else
+			fputc(*value, f);
+	}
+	fputc('\n', f);
+}
+
+static void cache_unescape(char *str)
+{
+	char *out = str;
+
+	for (; *str; str++) {
+		if (*str == '\\' && str[1]) {
+			str++;
+			*out++ = *str == 'n' ? '\n' : *str;
+		} else {
+			*out++ = *str;
+		}
+	}
+	*out = '\0';
+}
+
+/**
+ * igt_devices_scan_cache_save
+ * @path: file to write the cache to
+ *
+ * Saves the devices found by the last scan so that other processes can
+ * skip scanning udev by pointing the IGT_DEVICE_SCAN_CACHE environment
+ * variable at @path. The file is replaced atomically.
+ *
+ * Returns:
+ * 0 on success, negative errno otherwise.
+ */
+int igt_devices_scan_cache_save(const char *path)
+{
+	struct igt_device *dev;
+	struct igt_map_entry *entry;
+	uint64_t seqnum = igt_devs.seqnum;
+	char tmp[PATH_MAX];
+	bool limit_attrs = true;
+	FILE *f;
+	int fd, ret = 0;
+
+	if (!igt_devs.devs_scanned)
+		return -ENODEV;
+
+	if (!seqnum)
+		return -ENOENT;
+
+	igt_list_for_each_entry(dev, &igt_devs.all, link)
+		limit_attrs &= dev->limit_attrs;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= sizeof(tmp))
+		return -ENAMETOOLONG;
+
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		return -errno;
+
+	f = fdopen(fd, "w");
+	if (!f) {
+		ret = -errno;
+		close(fd);
+		unlink(tmp);
+		return ret;
+	}
+
+	fprintf(f, "%s\nseqnum %" PRIu64 "\nlimit %d\n",
+		SCAN_CACHE_MAGIC, seqnum, limit_attrs);
+
+	igt_list_for_each_entry(dev, &igt_devs.all, link) {
+		/* Children shouldn't have to go back to sysfs for these */
+		if (dev->limit_attrs)
+			load_attrs(dev);
+
+		fprintf(f, "begin\n");
+		cache_put(f, "subsystem", dev->subsystem);
+		cache_put(f, "syspath", dev->syspath);
+		cache_put(f, "devnode", dev->devnode);
+		cache_put(f, "sysname", dev->sysname);
+		cache_put(f, "drm_card", dev->drm_card);
+		cache_put(f, "drm_render", dev->drm_render);
+		cache_put(f, "vendor", dev->vendor);
+		cache_put(f, "device", dev->device);
+		cache_put(f, "pci_slot_name", dev->pci_slot_name);
+		cache_put(f, "driver", dev->driver);
+		cache_put(f, "codename", dev->codename);
+		cache_put(f, "pci_gpu", dev->pci_gpu);
+		if (dev->parent)
+			cache_put(f, "parent", dev->parent->syspath);
+		fprintf(f, "gpu_index %d\ndev_type %d\nattrs_loaded %d\n",
+			dev->gpu_index, dev->dev_type, dev->attrs_loaded);
+
+		igt_map_foreach(dev->props_map, entry) {
+			if (!entry->data)
+				continue;
+			fprintf(f, "prop %s", (char *)entry->key);
+			cache_put(f, "", entry->data);
+		}
+		igt_map_foreach(dev->attrs_map, entry) {
+			if (!entry->data)
+				continue;
+			fprintf(f, "attr %s", (char *)entry->key);
+			cache_put(f, "", entry->data);
+		}
+		fprintf(f, "end\n");
+	}
+
+	if (ferror(f))
+		ret = -EIO;
+	if (fclose(f) && !ret)
+		ret = -errno;
+
+	if (!ret && rename(tmp, path))
+		ret = -errno;
+	if (ret)
+		unlink(tmp);
+
+	return ret;
+}
+
+static char **cache_field(struct igt_device *dev, const char *key)
+{
+	static const struct {
+		const char *key;
+		size_t offset;
+	} fields[] = {
+#define FIELD(x) { #x, offsetof(struct igt_device, x) }
+		FIELD(subsystem),
+		FIELD(syspath),
+		FIELD(devnode),
+		FIELD(sysname),
+		FIELD(drm_card),
+		FIELD(drm_render),
+		FIELD(vendor),
+		FIELD(device),
+		FIELD(pci_slot_name),
+		FIELD(driver),
+		FIELD(codename),
+		FIELD(pci_gpu),
+#undef FIELD
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(fields); i++)
+		if (!strcmp(fields[i].key, key))
+			return (char **)((char *)dev + fields[i].offset);
+
+	return NULL;
+}
+
+/* Parents are linked once all devices are known, stash their syspath */
+struct cache_parent {
+	struct igt_device *dev;
+	char *syspath;
+};
+
+/* Copies the next line of the mapped cache, without its newline */
+static bool cache_next_line(const char **pos, const char *end,
+			    char **line, size_t *size)
+{
+	const char *eol;
+	size_t len;
+
+	if (*pos >= end)
+		return false;
+
+	eol = memchr(*pos, '\n', end - *pos);
+	len = (eol ?: end) - *pos;
+
+	if (len + 1 > *size) {
+		*size = len + 1;
+		*line = realloc(*line, *size);
+		igt_assert(*line);
+	}
+	memcpy(*line, *pos, len);
+	(*line)[len] = '\0';
+
+	*pos = eol ? eol + 1 : end;
+
+	return true;
+}
+
+static bool cache_header(const char **pos, const char *end,
+			 char **line, size_t *size,
+			 const char *key, unsigned long long *value)
+{
+	size_t len = strlen(key);
+	char *num_end;
+
+	if (!cache_next_line(pos, end, line, size) ||
+	    strncmp(*line, key, len) || (*line)[len] != ' ')
+		return false;
+
+	*value = strtoull(*line + len + 1, &num_end, 10);
+
+	return num_end != *line + len + 1 && !*num_end;
+}
+
+/* FNV-1a, for the contents of the cache */
+static uint64_t cache_hash(const char *data, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	while (len--)
+		hash = (hash ^ (unsigned char)*data++) * 0x100000001b3ull;
+
+	return hash;
+}
+
+static bool load_scan_cache(bool limit_attrs)
+{
+	const char *path = getenv("IGT_DEVICE_SCAN_CACHE");
+	unsigned long long seqnum = 0, cache_limit = 0;
+	struct cache_parent *parents = NULL;
+	struct igt_device *dev = NULL;
+	const char *map, *pos, *end;
+	int nr_parents = 0, fd;
+	char *line = NULL;
+	size_t size = 0;
+	struct stat st;
+	bool ok = false;
+
+	if (!path || !*path)
+		return false;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &st) || !st.st_size) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	pos = map;
+	end = map + st.st_size;
+
+	if (!cache_next_line(&pos, end, &line, &size) ||
+	    strcmp(line, SCAN_CACHE_MAGIC))
+		goto out;
+
+	if (!cache_header(&pos, end, &line, &size, "seqnum", &seqnum) ||
+	    !cache_header(&pos, end, &line, &size, "limit", &cache_limit) ||
+	    !seqnum || seqnum != igt_devs.seqnum || cache_limit != limit_attrs) {
+		igt_debug("Device scan cache %s is stale\n", path);
+		goto out;
+	}
+
+	while (cache_next_line(&pos, end, &line, &size)) {
+		char *key = line, *value, **field;
+
+		value = strchr(line, ' ');
+		if (value) {
+			*value++ = '\0';
+			cache_unescape(value);
+		}
+
+		if (!strcmp(key, "begin")) {
+			if (dev)
+				goto out;
+			dev = igt_device_new();
+			igt_assert(dev);
+			dev->limit_attrs = limit_attrs;
+			continue;
+		}
+
+		if (!dev)
+			goto out;
+
+		if (!strcmp(key, "end")) {
+			if (!dev->subsystem || !dev->syspath)
+				goto out;
+			igt_list_add_tail(&dev->link, &igt_devs.all);
+			dev = NULL;
+			continue;
+		}
+
+		if (!value)
+			goto out;
+
+		if ((field = cache_field(dev, key))) {
+			free(*field);
+			*field = strdup(value);
+		} else if (!strcmp(key, "gpu_index")) {
+			dev->gpu_index = atoi(value);
+		} else if (!strcmp(key, "dev_type")) {
+			dev->dev_type = atoi(value);
+		} else if (!strcmp(key, "attrs_loaded")) {
+			dev->attrs_loaded = atoi(value);
+		} else if (!strcmp(key, "parent")) {
+			parents = realloc(parents, (nr_parents + 1) * sizeof(*parents));
+			igt_assert(parents);
+			parents[nr_parents].dev = dev;
+			parents[nr_parents++].syspath = strdup(value);
+		} else if (!strcmp(key, "prop") || !strcmp(key, "attr")) {
+			char *data = strchr(value, ' ');
+
+			if (!data)
+				goto out;
+			*data++ = '\0';
+
+			if (key[0] == 'p')
+				igt_device_add_prop(dev, value, data);
+			else
+				igt_device_add_attr(dev, value, data);
+		}
+	}
+
+	if (dev)
+		goto out;
+
+	index_syspaths();
+	for (int i = 0; i < nr_parents; i++) {
+		parents[i].dev->parent = igt_device_from_syspath(parents[i].syspath);
+		if (!parents[i].dev->parent)
+			goto out;
+	}
+
+	copy_all_to_filtered();
+	igt_devs.from_cache = true;
+	igt_devs.cache = st;
+	igt_devs.cache_hash = cache_hash(map, st.st_size);
+	ok = true;
+	igt_debug("Loaded %d devices from scan cache %s\n",
+		  igt_list_length(&igt_devs.all), path);
+
+out:
+	if (dev) {
+		igt_device_free(dev);
+		free(dev);
+	}
+
+	if (!ok) {
+		struct igt_device *tmp;
+
+		unindex_syspaths();
+		igt_list_for_each_entry_safe(dev, tmp, &igt_devs.all, link) {
+			igt_list_del(&dev->link);
+			igt_device_free(dev);
+			free(dev);
+		}
+	}
+
+	for (int i = 0; i < nr_parents; i++)
+		free(parents[i].syspath);
+	free(parents);
+	free(line);
+	munmap((void *)map, st.st_size);
+
+	return ok;
+}
+
+/*
+ * Whether the devices loaded from the cache are still what loading it again
+ * would give: same file with the same contents, and no uevent since. The
+ * contents are compared as well, as a rewrite in place can keep the size
+ * and, within the timestamp granularity, the times of the file.
+ */
+static bool scan_cache_unchanged(bool limit_attrs)
+{
+	const char *path = getenv("IGT_DEVICE_SCAN_CACHE");
+	const char *map;
+	struct stat st;
+	bool same;
+	int fd;
+
+	if (!igt_devs.from_cache || limit_attrs != igt_devs.limit_attrs)
+		return false;
+
+	if (!path || igt_devices_uevent_seqnum() != igt_devs.seqnum)
+		return false;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &st) ||
+	    st.st_dev != igt_devs.cache.st_dev ||
+	    st.st_ino != igt_devs.cache.st_ino ||
+	    st.st_size != igt_devs.cache.st_size ||
+	    st.st_mtim.tv_sec != igt_devs.cache.st_mtim.tv_sec ||
+	    st.st_mtim.tv_nsec != igt_devs.cache.st_mtim.tv_nsec ||
+	    st.st_ctim.tv_sec != igt_devs.cache.st_ctim.tv_sec ||
+	    st.st_ctim.tv_nsec != igt_devs.cache.st_ctim.tv_nsec) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	same = cache_hash(map, st.st_size) == igt_devs.cache_hash;
+	munmap((void *)map, st.st_size);
+
+	return same;
+}
+
 /**
  * igt_devices_scan
  * @force: enforce scanning devices
  *
- * Function scans udev in search of gpu devices.
+ * Function scans udev in search of gpu devices. If IGT_DEVICE_SCAN_CACHE
+ * points to an up to date cache written by igt_devices_scan_cache_save(),
+ * devices are loaded from it instead, and kept as they are by later calls
+ * until the cache or the devices change.
  */
 
 static void __igt_devices_scan(bool limit_attrs)
 {
+	if (igt_devs.devs_scanned && scan_cache_unchanged(limit_attrs)) {
+		struct igt_device *dev, *tmp;
+
+		igt_list_for_each_entry_safe(dev, tmp, &igt_devs.filtered, link) {
+			igt_list_del(&dev->link);
+			free(dev);
+		}
+		copy_all_to_filtered();
+		return;
+	}
+
 	if (igt_devs.devs_scanned)
 		igt_devices_free();
 
 	prepare_scan();
-	scan_drm_devices(limit_attrs);
+
+	/* Before scanning, so that a uevent during the scan makes it stale */
+	igt_devs.seqnum = igt_devices_uevent_seqnum();
+	igt_devs.limit_attrs = limit_attrs;
+
+	if (!load_scan_cache(limit_attrs))
+		scan_drm_devices(limit_attrs);
 
 	igt_devs.devs_scanned = true;
 }
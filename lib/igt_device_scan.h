@@ -66,6 +66,9 @@ struct igt_device_card {
 
 void igt_devices_scan(void);
 void igt_devices_scan_all_attrs(void);
+int igt_devices_scan_cache_save(const char *path);
+uint64_t igt_devices_uevent_seqnum(void);
+void igt_devices_set_uevent_seqnum_path(const char *path);
 
 void igt_devices_print(const struct igt_devices_print_format *fmt);
 void igt_devices_print_vendors(void);
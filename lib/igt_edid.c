@@ -27,11 +27,15 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
+#include <unistd.h>
 #include <xf86drmMode.h>
 
+#include "drmtest.h"
 #include "igt_aux.h"
 #include "igt_core.h"
 #include "igt_edid.h"
@@ -42,7 +46,8 @@
  * @title: EDID
  * @include: igt_edid.h
  *
- * This library contains helpers to generate custom EDIDs.
+ * This library contains helpers to generate custom EDIDs, to generate
+ * batches of EDID permutations and to parse EDIDs into an index.
 
  * The E-EDID specification is available at:
  * https://glenwing.github.io/docs/VESA-EEDID-A2.pdf
@@ -737,3 +742,569 @@ void *dispid_done(struct dispid_header *dispid, void *ptr)
 
 	return ptr + 1;
 }
+
+static bool edid_block_is_valid(const uint8_t *block)
+{
+	uint8_t sum = 0;
+
+	for (int i = 0; i < EDID_BLOCK_SIZE; i++)
+		sum += block[i];
+
+	return sum == 0;
+}
+
+static void parse_dtd(struct edid_parsed *p, size_t offset)
+{
+	const struct detailed_timing *dt = (const void *)(p->raw + offset);
+	const struct detailed_pixel_timing *pt = &dt->data.pixel_data;
+	struct edid_parsed_dtd *dtd;
+
+	if (!dt->pixel_clock[0] && !dt->pixel_clock[1])
+		return; /* display descriptor */
+
+	if (p->num_dtds == EDID_PARSED_MAX_DTDS) {
+		p->errors |= EDID_PARSE_OVERFLOW;
+		return;
+	}
+
+	dtd = &p->dtds[p->num_dtds++];
+	dtd->offset = offset;
+	dtd->clock = (dt->pixel_clock[0] | dt->pixel_clock[1] << 8) * 10;
+	dtd->hactive = pt->hactive_lo | (pt->hactive_hblank_hi & 0xf0) << 4;
+	dtd->hblank = pt->hblank_lo | (pt->hactive_hblank_hi & 0x0f) << 8;
+	dtd->vactive = pt->vactive_lo | (pt->vactive_vblank_hi & 0xf0) << 4;
+	dtd->vblank = pt->vblank_lo | (pt->vactive_vblank_hi & 0x0f) << 8;
+}
+
+static void parse_cea_block(struct edid_parsed *p, int ext,
+			    uint8_t type, uint8_t len, size_t offset)
+{
+	const uint8_t *data = p->raw + offset;
+	struct edid_parsed_block *block;
+
+	switch (type) {
+	case EDID_CEA_DATA_AUDIO:
+		p->num_sads += len / sizeof(struct cea_sad);
+		break;
+	case EDID_CEA_DATA_VIDEO:
+		p->num_svds += len;
+		break;
+	case EDID_CEA_DATA_VENDOR_SPECIFIC:
+		if (len < CEA_VSDB_HEADER_SIZE ||
+		    memcmp(data, hdmi_ieee_oui, sizeof(hdmi_ieee_oui)))
+			break;
+		p->hdmi_vsdb = true;
+		if (len > CEA_VSDB_HEADER_SIZE + offsetof(struct hdmi_vsdb, flags1))
+			p->deep_color = data[CEA_VSDB_HEADER_SIZE +
+					     offsetof(struct hdmi_vsdb, flags1)];
+		break;
+	case EDID_CEA_DATA_SPEAKER_ALLOC:
+		if (len)
+			p->speakers = data[0];
+		break;
+	}
+
+	if (p->num_blocks == EDID_PARSED_MAX_BLOCKS) {
+		p->errors |= EDID_PARSE_OVERFLOW;
+		return;
+	}
+
+	if (p->first_block[type] < 0)
+		p->first_block[type] = p->num_blocks;
+
+	block = &p->blocks[p->num_blocks++];
+	block->ext = ext;
+	block->type = type;
+	block->ext_tag = type == 7 && len ? data[0] : 0;
+	block->len = len;
+	block->offset = offset;
+}
+
+static void parse_cea(struct edid_parsed *p, int ext, size_t base)
+{
+	const struct edid_cea *cea = (const void *)(p->raw + base + 1);
+	const uint8_t *block = p->raw + base;
+	size_t dtd_start = cea->dtd_start;
+	size_t i;
+
+	p->cea_flags |= cea->misc & 0xf0;
+
+	/* No data blocks nor DTDs */
+	if (!dtd_start)
+		return;
+
+	if (dtd_start < 4 || dtd_start >= EDID_BLOCK_SIZE) {
+		p->errors |= EDID_PARSE_MALFORMED;
+		return;
+	}
+
+	for (i = 4; cea->revision >= 3 && i < dtd_start; ) {
+		uint8_t type = block[i] >> 5;
+		uint8_t len = block[i] & 0x1f;
+
+		if (i + 1 + len > dtd_start) {
+			p->errors |= EDID_PARSE_MALFORMED;
+			break;
+		}
+
+		parse_cea_block(p, ext, type, len, base + i + 1);
+		i += 1 + len;
+	}
+
+	/* DTDs run up to the checksum, the first zero clock ends them */
+	for (i = dtd_start; i + sizeof(struct detailed_timing) < EDID_BLOCK_SIZE;
+	     i += sizeof(struct detailed_timing)) {
+		if (!block[i] && !block[i + 1])
+			break;
+		parse_dtd(p, base + i);
+	}
+}
+
+static void parse_dispid_tile(struct edid_parsed *p, const uint8_t *data)
+{
+	const struct dispid_tiled_block *tiled = (const void *)data;
+	struct edid_parsed_tile *tile;
+
+	if (p->num_tiles == EDID_PARSED_MAX_TILES) {
+		p->errors |= EDID_PARSE_OVERFLOW;
+		return;
+	}
+
+	/* Inverse of dispid_block_tiled() */
+	tile = &p->tiles[p->num_tiles++];
+	tile->caps = tiled->tile_caps;
+	tile->num_htiles = ((tiled->topo[0] >> 4) | ((tiled->topo[2] >> 6) & 3) << 4) + 1;
+	tile->num_vtiles = ((tiled->topo[0] & 0xf) | ((tiled->topo[2] >> 4) & 3) << 4) + 1;
+	tile->htile = (tiled->topo[1] >> 4) | ((tiled->topo[2] >> 2) & 3) << 4;
+	tile->vtile = (tiled->topo[1] & 0xf) | (tiled->topo[2] & 3) << 4;
+	tile->hsize = (tiled->tile_size[0] | tiled->tile_size[1] << 8) + 1;
+	tile->vsize = (tiled->tile_size[2] | tiled->tile_size[3] << 8) + 1;
+}
+
+static void parse_dispid(struct edid_parsed *p, size_t base)
+{
+	const struct dispid_header *header = (const void *)(p->raw + base + 1);
+	const uint8_t *data = (const uint8_t *)(header + 1);
+	size_t end = sizeof(*header) + header->num_bytes;
+	size_t i;
+
+	/* The section and its checksum have to fit after the tag */
+	if (end + 1 > EDID_BLOCK_SIZE - 1) {
+		p->errors |= EDID_PARSE_MALFORMED;
+		return;
+	}
+
+	end -= sizeof(*header);
+	for (i = 0; i + sizeof(struct dispid_block_header) <= end; ) {
+		const struct dispid_block_header *block = (const void *)(data + i);
+		size_t len = block->num_bytes;
+
+		i += sizeof(*block);
+		if (i + len > end) {
+			p->errors |= EDID_PARSE_MALFORMED;
+			break;
+		}
+
+		if (block->tag == 0x12 && len >= sizeof(struct dispid_tiled_block))
+			parse_dispid_tile(p, data + i);
+
+		i += len;
+	}
+}
+
+/**
+ * edid_parse:
+ * @raw: EDID, base block followed by the extension blocks
+ * @size: size of @raw in bytes
+ * @parsed: index to fill
+ *
+ * Walks the base block and all CEA and DisplayID extension blocks once,
+ * recording every Detailed Timing Descriptor, CEA data block and tiled
+ * topology block. Checksum mismatches and blocks overrunning their
+ * container are flagged in @parsed->errors, parsing carries on with the
+ * rest of the EDID.
+ *
+ * Returns:
+ * 0 on success, -EINVAL if @raw is not an EDID or is truncated.
+ */
+int edid_parse(const void *raw, size_t size, struct edid_parsed *parsed)
+{
+	const struct edid *edid = raw;
+	size_t i;
+
+	if (size < EDID_BLOCK_SIZE ||
+	    memcmp(edid->header, edid_header, sizeof(edid_header)) ||
+	    size < edid_get_size(edid))
+		return -EINVAL;
+
+	memset(parsed, 0, sizeof(*parsed));
+	memset(parsed->first_block, -1, sizeof(parsed->first_block));
+
+	parsed->raw = raw;
+	parsed->size = edid_get_size(edid);
+	edid_get_mfg(edid, parsed->mfg);
+	parsed->prod_code = edid->prod_code[0] | edid->prod_code[1] << 8;
+	parsed->serial = edid->serial[0] | edid->serial[1] << 8 |
+			 edid->serial[2] << 16 | (uint32_t)edid->serial[3] << 24;
+	parsed->version = edid->version;
+	parsed->revision = edid->revision;
+	parsed->input = edid->input;
+	parsed->num_exts = edid->extensions_len;
+
+	if (!edid_block_is_valid(raw))
+		parsed->errors |= EDID_PARSE_BAD_CHECKSUM;
+
+	for (i = 0; i < DETAILED_TIMINGS_LEN; i++)
+		parse_dtd(parsed, offsetof(struct edid, detailed_timings[i]));
+
+	for (i = 0; i < edid->extensions_len; i++) {
+		size_t base = (i + 1) * EDID_BLOCK_SIZE;
+
+		if (!edid_block_is_valid(parsed->raw + base))
+			parsed->errors |= EDID_PARSE_BAD_CHECKSUM;
+
+		switch (parsed->raw[base]) {
+		case EDID_EXT_CEA:
+			parse_cea(parsed, i, base);
+			break;
+		case EDID_EXT_DISPLAYID:
+			parse_dispid(parsed, base);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+#define EDID_PARALLEL_THRESHOLD 1024
+#define EDID_MAX_THREADS 32
+
+struct edid_work {
+	void (*fn)(void *data, uint32_t first, uint32_t last);
+	void *data;
+	uint32_t first, last;
+};
+
+static void *edid_work_thread(void *arg)
+{
+	struct edid_work *work = arg;
+
+	work->fn(work->data, work->first, work->last);
+
+	return NULL;
+}
+
+/* Split [0, count) into bands processed on all CPUs for large batches */
+static void edid_run_parallel(uint32_t count,
+			      void (*fn)(void *data, uint32_t first, uint32_t last),
+			      void *data)
+{
+	struct edid_work work[EDID_MAX_THREADS];
+	pthread_t threads[EDID_MAX_THREADS];
+	uint32_t nthreads = 1, i;
+
+	if (count >= EDID_PARALLEL_THRESHOLD)
+		nthreads = min_t(uint32_t, sysconf(_SC_NPROCESSORS_ONLN),
+				 EDID_MAX_THREADS);
+	nthreads = max(min(nthreads, count), 1u);
+
+	for (i = 0; i < nthreads; i++) {
+		work[i].fn = fn;
+		work[i].data = data;
+		work[i].first = (uint64_t)count * i / nthreads;
+		work[i].last = (uint64_t)count * (i + 1) / nthreads;
+	}
+
+	for (i = 1; i < nthreads; i++)
+		igt_assert_eq(pthread_create(&threads[i], NULL,
+					     edid_work_thread, &work[i]), 0);
+
+	fn(data, work[0].first, work[0].last);
+
+	for (i = 1; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+}
+
+static void parse_stream_range(void *data, uint32_t first, uint32_t last)
+{
+	struct edid_parsed *parsed = data;
+
+	for (uint32_t i = first; i < last; i++)
+		igt_assert_eq(edid_parse(parsed[i].raw, parsed[i].size,
+					 &parsed[i]), 0);
+}
+
+/**
+ * edid_parse_stream:
+ * @buf: concatenated EDIDs
+ * @size: size of @buf in bytes
+ * @parsed: array of at least @max indices
+ * @max: maximum number of EDIDs to parse
+ *
+ * Parses back to back EDIDs, like the output of edid_gen_batch(). The
+ * EDID boundaries are found first and large streams are then parsed in
+ * parallel. Parsing stops at the first invalid or truncated EDID.
+ *
+ * Returns:
+ * The number of EDIDs parsed.
+ */
+int edid_parse_stream(const void *buf, size_t size,
+		      struct edid_parsed *parsed, int max)
+{
+	const uint8_t *raw = buf;
+	size_t offset = 0;
+	int count = 0;
+
+	while (count < max && size - offset >= EDID_BLOCK_SIZE) {
+		const struct edid *edid = (const void *)(raw + offset);
+		size_t len = edid_get_size(edid);
+
+		if (memcmp(edid->header, edid_header, sizeof(edid_header)) ||
+		    size - offset < len)
+			break;
+
+		parsed[count].raw = raw + offset;
+		parsed[count].size = len;
+		count++;
+		offset += len;
+	}
+
+	edid_run_parallel(count, parse_stream_range, parsed);
+
+	return count;
+}
+
+static const drmModeModeInfo gen_modes[] = {
+	{ .clock = 148500, .hdisplay = 1920, .hsync_start = 2008,
+	  .hsync_end = 2052, .htotal = 2200, .vdisplay = 1080,
+	  .vsync_start = 1084, .vsync_end = 1089, .vtotal = 1125,
+	  .vrefresh = 60, .name = "1920x1080",
+	  .flags = DRM_MODE_FLAG_PHSYNC | DRM_MODE_FLAG_PVSYNC },
+	{ .clock = 74250, .hdisplay = 1280, .hsync_start = 1390,
+	  .hsync_end = 1430, .htotal = 1650, .vdisplay = 720,
+	  .vsync_start = 725, .vsync_end = 730, .vtotal = 750,
+	  .vrefresh = 60, .name = "1280x720",
+	  .flags = DRM_MODE_FLAG_PHSYNC | DRM_MODE_FLAG_PVSYNC },
+	{ .clock = 297000, .hdisplay = 3840, .hsync_start = 4016,
+	  .hsync_end = 4104, .htotal = 4400, .vdisplay = 2160,
+	  .vsync_start = 2168, .vsync_end = 2178, .vtotal = 2250,
+	  .vrefresh = 30, .name = "3840x2160",
+	  .flags = DRM_MODE_FLAG_PHSYNC | DRM_MODE_FLAG_PVSYNC },
+};
+
+static const uint8_t gen_deep_color[] = {
+	0,
+	HDMI_VSDB_DC_30BIT,
+	HDMI_VSDB_DC_30BIT | HDMI_VSDB_DC_36BIT,
+	HDMI_VSDB_DC_30BIT | HDMI_VSDB_DC_36BIT | HDMI_VSDB_DC_48BIT |
+	HDMI_VSDB_DC_Y444,
+};
+
+/**
+ * edid_gen_describe:
+ * @index: permutation index
+ * @desc: filled with the contents of the EDID
+ *
+ * Decodes @index into the features of the EDID edid_gen() builds for it.
+ * All combinations repeat every #EDID_GEN_PERMUTATIONS indices, the
+ * serial number is @index itself so generated EDIDs are all distinct.
+ */
+void edid_gen_describe(uint32_t index, struct edid_gen_desc *desc)
+{
+	uint32_t i = index % EDID_GEN_PERMUTATIONS;
+	uint32_t vsdb;
+
+	memset(desc, 0, sizeof(*desc));
+	desc->serial = index;
+
+	desc->num_svds = i % 8;
+	i /= 8;
+	desc->num_sads = i % 4;
+	i /= 4;
+	vsdb = i % (ARRAY_SIZE(gen_deep_color) + 1);
+	i /= ARRAY_SIZE(gen_deep_color) + 1;
+	desc->speakers = i % 2;
+	i /= 2;
+	desc->tiled = i % 3;
+	desc->htile = desc->tiled ? i % 3 - 1 : 0;
+	i /= 3;
+	desc->mode = gen_modes[i % ARRAY_SIZE(gen_modes)];
+
+	if (vsdb) {
+		desc->hdmi_vsdb = true;
+		desc->deep_color = gen_deep_color[vsdb - 1];
+	}
+}
+
+/**
+ * edid_gen_size:
+ * @index: permutation index
+ *
+ * Returns: size in bytes of the EDID edid_gen() builds for @index.
+ */
+size_t edid_gen_size(uint32_t index)
+{
+	struct edid_gen_desc desc;
+
+	edid_gen_describe(index, &desc);
+
+	return (2 + desc.tiled) * EDID_BLOCK_SIZE;
+}
+
+static struct edid gen_templates[ARRAY_SIZE(gen_modes)];
+static pthread_once_t gen_templates_once = PTHREAD_ONCE_INIT;
+
+static void gen_templates_init(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(gen_modes); i++)
+		edid_init_with_mode(&gen_templates[i],
+				    (drmModeModeInfo *)&gen_modes[i]);
+}
+
+/**
+ * edid_gen:
+ * @ptr: destination, at least #EDID_GEN_MAX_SIZE bytes
+ * @index: permutation index
+ *
+ * Builds the EDID permutation described by edid_gen_describe(): a base
+ * block with the preferred mode, a CEA extension with the data blocks
+ * and, for tiled permutations, a DisplayID extension.
+ *
+ * Returns:
+ * The size of the EDID in bytes.
+ */
+size_t edid_gen(void *ptr, uint32_t index)
+{
+	struct edid *edid = ptr;
+	struct edid_gen_desc desc;
+	struct edid_ext *ext;
+	struct cea_sad sads[4];
+	uint8_t svds[8];
+	char *data;
+	size_t size = 0;
+	int mode;
+
+	pthread_once(&gen_templates_once, gen_templates_init);
+
+	edid_gen_describe(index, &desc);
+	for (mode = 0; gen_modes[mode].clock != desc.mode.clock; mode++)
+		;
+
+	memcpy(edid, &gen_templates[mode], sizeof(*edid));
+	edid->serial[0] = index;
+	edid->serial[1] = index >> 8;
+	edid->serial[2] = index >> 16;
+	edid->serial[3] = index >> 24;
+
+	ext = &edid->extensions[edid->extensions_len++];
+	memset(ext, 0, sizeof(*ext));
+	data = ext->data.cea.data;
+
+	for (int i = 0; i < desc.num_sads; i++)
+		cea_sad_init_pcm(&sads[i], 2 * (i + 1),
+				 CEA_SAD_SAMPLING_RATE_48KHZ,
+				 CEA_SAD_SAMPLE_SIZE_16);
+	if (desc.num_sads)
+		size += edid_cea_data_block_set_sad((void *)(data + size),
+						    sads, desc.num_sads);
+
+	for (int i = 0; i < desc.num_svds; i++)
+		svds[i] = i + 1;
+	if (desc.num_svds)
+		size += edid_cea_data_block_set_svd((void *)(data + size),
+						    svds, desc.num_svds);
+
+	if (desc.hdmi_vsdb) {
+		struct hdmi_vsdb hdmi = {
+			.src_phy_addr = { 0x10, 0x00 },
+			.flags1 = desc.deep_color,
+			.max_tdms_clock = 0x2d,
+		};
+
+		size += edid_cea_data_block_set_hdmi_vsdb((void *)(data + size),
+							  &hdmi, 4);
+	}
+
+	if (desc.speakers) {
+		struct cea_speaker_alloc speakers = {
+			.speakers = CEA_SPEAKER_FRONT_LEFT_RIGHT |
+				    CEA_SPEAKER_LFE | CEA_SPEAKER_FRONT_CENTER,
+		};
+
+		size += edid_cea_data_block_set_speaker_alloc((void *)(data + size),
+							      &speakers);
+	}
+
+	edid_ext_set_cea(ext, size, 1, 0);
+	detailed_timing_set_mode((void *)(data + size), &desc.mode,
+				 edid->width_cm * 10, edid->height_cm * 10);
+
+	if (desc.tiled) {
+		struct dispid_header *dispid;
+		void *p;
+
+		ext = &edid->extensions[edid->extensions_len++];
+		memset(ext, 0, sizeof(*ext));
+
+		dispid = p = edid_ext_dispid(ext);
+		p = dispid_init(p);
+		p = dispid_block_tiled(p, 2, 1, desc.htile, 0,
+				       desc.mode.hdisplay, desc.mode.vdisplay,
+				       "IGT-GEN");
+		dispid_done(dispid, p);
+	}
+
+	edid_update_checksum(edid);
+
+	return edid_get_size(edid);
+}
+
+struct gen_batch {
+	uint8_t *arena;
+	uint32_t first;
+};
+
+static void gen_batch_range(void *data, uint32_t first, uint32_t last)
+{
+	struct gen_batch *batch = data;
+	size_t offset = 0;
+	uint32_t i;
+
+	/* Only the number of blocks varies, finding our start is cheap */
+	for (i = 0; i < first; i++)
+		offset += edid_gen_size(batch->first + i);
+
+	for (; i < last; i++)
+		offset += edid_gen(batch->arena + offset, batch->first + i);
+}
+
+/**
+ * edid_gen_batch:
+ * @arena: preallocated destination
+ * @arena_size: size of @arena in bytes
+ * @first: index of the first permutation
+ * @count: number of EDIDs to generate
+ *
+ * Generates permutations @first to @first + @count - 1 back to back in
+ * @arena, in parallel for large batches. The result can be read back
+ * with edid_parse_stream().
+ *
+ * Returns:
+ * The number of bytes used in @arena.
+ */
+size_t edid_gen_batch(void *arena, size_t arena_size,
+		      uint32_t first, uint32_t count)
+{
+	struct gen_batch batch = { .arena = arena, .first = first };
+	size_t size = 0;
+
+	for (uint32_t i = 0; i < count; i++)
+		size += edid_gen_size(first + i);
+	igt_assert_f(size <= arena_size,
+		     "EDID arena too small, %zu bytes needed\n", size);
+
+	pthread_once(&gen_templates_once, gen_templates_init);
+	edid_run_parallel(count, gen_batch_range, &batch);
+
+	return size;
+}
@@ -28,6 +28,7 @@
 
 #include "config.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -458,4 +459,116 @@ void *dispid_block_tiled(void *ptr,
 			 const char *topology_id);
 void edid_get_monitor_name(const struct edid *edid, char *name, size_t name_size);
 
+#define EDID_PARSED_MAX_DTDS 16
+#define EDID_PARSED_MAX_BLOCKS 32
+#define EDID_PARSED_MAX_TILES 4
+
+enum edid_parse_error {
+	EDID_PARSE_BAD_CHECKSUM = 1 << 0,
+	EDID_PARSE_MALFORMED = 1 << 1, /* a block overruns its container */
+	EDID_PARSE_OVERFLOW = 1 << 2, /* more entries than the index holds */
+};
+
+/**
+ * edid_parsed_dtd: a Detailed Timing Descriptor with a pixel timing
+ */
+struct edid_parsed_dtd {
+	uint32_t clock; /* kHz */
+	uint16_t hactive, hblank;
+	uint16_t vactive, vblank;
+	uint16_t offset; /* from the start of the EDID */
+};
+
+/**
+ * edid_parsed_block: a CEA data block
+ */
+struct edid_parsed_block {
+	uint8_t ext; /* extension block index */
+	uint8_t type; /* enum edid_cea_data_type, 7 for extended tags */
+	uint8_t ext_tag; /* extended tag if type is 7 */
+	uint8_t len; /* payload size */
+	uint16_t offset; /* payload offset from the start of the EDID */
+};
+
+/**
+ * edid_parsed_tile: a DisplayID tiled display topology block
+ */
+struct edid_parsed_tile {
+	uint8_t caps; /* enum dispid_tile_caps */
+	uint8_t num_htiles, num_vtiles;
+	uint8_t htile, vtile;
+	uint16_t hsize, vsize;
+};
+
+/**
+ * edid_parsed: index of an EDID built by edid_parse() in a single pass
+ *
+ * Data blocks and descriptors refer to the raw EDID by offset, it must
+ * outlive the index.
+ */
+struct edid_parsed {
+	const uint8_t *raw;
+	size_t size;
+	uint32_t errors; /* enum edid_parse_error */
+
+	char mfg[3];
+	uint16_t prod_code;
+	uint32_t serial;
+	uint8_t version, revision;
+	uint8_t input;
+	uint8_t num_exts;
+
+	int num_dtds;
+	struct edid_parsed_dtd dtds[EDID_PARSED_MAX_DTDS];
+
+	int num_blocks;
+	struct edid_parsed_block blocks[EDID_PARSED_MAX_BLOCKS];
+	int8_t first_block[8]; /* by type, -1 if absent */
+
+	/* Summary of the CEA extensions */
+	uint8_t cea_flags; /* enum edid_cea_flag */
+	uint8_t num_sads;
+	uint8_t num_svds;
+	uint8_t speakers; /* enum cea_speaker_alloc_item */
+	bool hdmi_vsdb;
+	uint8_t deep_color; /* HDMI VSDB flags1 */
+
+	int num_tiles;
+	struct edid_parsed_tile tiles[EDID_PARSED_MAX_TILES];
+};
+
+int edid_parse(const void *raw, size_t size, struct edid_parsed *parsed);
+int edid_parse_stream(const void *buf, size_t size,
+		      struct edid_parsed *parsed, int max);
+
+static inline const uint8_t *
+edid_parsed_block_data(const struct edid_parsed *parsed, int i)
+{
+	return parsed->raw + parsed->blocks[i].offset;
+}
+
+#define EDID_GEN_PERMUTATIONS (8 * 4 * 5 * 2 * 3 * 3)
+#define EDID_GEN_MAX_SIZE (3 * EDID_BLOCK_SIZE)
+
+/**
+ * edid_gen_desc: contents of a generated EDID permutation
+ */
+struct edid_gen_desc {
+	drmModeModeInfo mode; /* preferred mode */
+	uint32_t serial;
+	uint8_t num_svds;
+	uint8_t num_sads;
+	bool hdmi_vsdb;
+	uint8_t deep_color; /* HDMI VSDB flags1 */
+	bool speakers;
+	bool tiled;
+	uint8_t htile; /* of a 2x1 tiled display */
+};
+
+void edid_gen_describe(uint32_t index, struct edid_gen_desc *desc);
+size_t edid_gen_size(uint32_t index);
+size_t edid_gen(void *ptr, uint32_t index);
+size_t edid_gen_batch(void *arena, size_t arena_size,
+		      uint32_t first, uint32_t count);
+
 #endif
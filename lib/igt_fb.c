@@ -53,6 +53,7 @@
 #include "intel_batchbuffer.h"
 #include "intel_chipset.h"
 #include "intel_bufops.h"
+#include "intel_detile.h"
 #include "xe/xe_ioctl.h"
 #include "xe/xe_query.h"
 
@@ -2717,6 +2718,30 @@ static bool use_blitter(const struct igt_fb *fb)
 	       is_xe_device(fb->fd);
 }
 
+/*
+ * Uncompressed tiled framebuffers are (de)tiled on the CPU, there's no
+ * bit6 swizzling to take care of from gen9 on.
+ */
+static bool use_detile(const struct igt_fb *fb)
+{
+	uint32_t tiling;
+
+	if (!is_intel_device(fb->fd) ||
+	    intel_display_ver(intel_get_drm_devid(fb->fd)) < 9)
+		return false;
+
+	if (fb->modifier == DRM_FORMAT_MOD_LINEAR ||
+	    igt_fb_is_ccs_modifier(fb->modifier))
+		return false;
+
+	tiling = intel_detile_tiling_from_modifier(fb->modifier);
+	for (int i = 0; i < fb->num_planes; i++)
+		if (!intel_detile_supported(tiling, fb->plane_bpp[i] / 8))
+			return false;
+
+	return true;
+}
+
 static void init_buf_ccs(struct intel_buf *buf, int ccs_idx,
 			 uint32_t offset, uint32_t stride)
 {
@@ -3334,6 +3359,33 @@ void igt_xe2_blit_with_dst_pat(const struct igt_fb *dst_fb,
 			      src_fb->fd, NULL);
 }
 
+static void detile_fb(const struct igt_fb *fb, uint8_t *map,
+		      const struct igt_fb *linear, uint8_t *linear_map,
+		      bool to_linear)
+{
+	uint32_t tiling = intel_detile_tiling_from_modifier(fb->modifier);
+
+	for (int i = 0; i < fb->num_planes; i++) {
+		struct intel_detile_surface surf = {
+			.ptr = map + fb->offsets[i],
+			.stride = fb->strides[i],
+			.width = fb->plane_width[i],
+			.height = fb->plane_height[i],
+			.cpp = fb->plane_bpp[i] / 8,
+			.tiling = tiling,
+		};
+
+		if (to_linear)
+			intel_detile_to_linear(&surf,
+					       linear_map + linear->offsets[i],
+					       linear->strides[i]);
+		else
+			intel_detile_from_linear(&surf,
+						 linear_map + linear->offsets[i],
+						 linear->strides[i]);
+	}
+}
+
 static void free_linear_mapping(struct fb_blit_upload *blit)
 {
 	int fd = blit->fd;
@@ -3352,6 +3404,14 @@ static void free_linear_mapping(struct fb_blit_upload *blit)
 		igt_amd_fb_convert_plane_to_tiled(fb, map, &linear->fb, linear->map);
 
 		munmap(map, fb->size);
+	} else if (use_detile(fb)) {
+		void *map = map_buffer(fd, fb->gem_handle, fb->size);
+
+		detile_fb(fb, map, &linear->fb, linear->map, false);
+
+		munmap(map, fb->size);
+		gem_munmap(linear->map, linear->fb.size);
+		gem_close(fd, linear->fb.gem_handle);
 	} else if (is_nouveau_device(fd)) {
 		igt_nouveau_fb_blit(fb, &linear->fb);
 		igt_nouveau_delete_bo(&linear->fb);
@@ -3401,7 +3461,8 @@ static void setup_linear_mapping(struct fb_blit_upload *blit)
 	struct igt_fb *fb = blit->fb;
 	struct fb_blit_linear *linear = &blit->linear;
 
-	if (!igt_vc4_is_tiled(fb->modifier) && use_enginecopy(fb)) {
+	if (!igt_vc4_is_tiled(fb->modifier) && !use_detile(fb) &&
+	    use_enginecopy(fb)) {
 		blit->bops = buf_ops_create(fd);
 		blit->ibb = intel_bb_create(fd, 4096);
 	}
@@ -3434,6 +3495,14 @@ static void setup_linear_mapping(struct fb_blit_upload *blit)
 		linear->map = igt_amd_mmap_bo(fd, linear->fb.gem_handle,
 					      linear->fb.size,
 					      PROT_READ | PROT_WRITE);
+	} else if (use_detile(fb)) {
+		void *map = map_buffer(fd, fb->gem_handle, fb->size);
+
+		linear->map = map_buffer(fd, linear->fb.gem_handle,
+					 linear->fb.size);
+		detile_fb(fb, map, &linear->fb, linear->map, true);
+
+		munmap(map, fb->size);
 	} else if (is_nouveau_device(fd)) {
 		/* Currently we also blit linear bos instead of mapping them as-is, as mmap() on
 		 * nouveau is quite slow right now
@@ -4717,8 +4786,8 @@ static void create_cairo_surface__convert(int fd, struct igt_fb *fb)
 	igt_assert(blit->shadow_ptr);
 
 	/* Note for nouveau, it's currently faster to copy fbs to/from vram (even linear ones) */
-	if (use_enginecopy(fb) || use_blitter(fb) || igt_vc4_is_tiled(fb->modifier) ||
-	    is_nouveau_device(fd)) {
+	if (use_detile(fb) || use_enginecopy(fb) || use_blitter(fb) ||
+	    igt_vc4_is_tiled(fb->modifier) || is_nouveau_device(fd)) {
 		setup_linear_mapping(&blit->base);
 
 		/* speed things up by working from a copy in system memory */
@@ -4805,7 +4874,8 @@ cairo_surface_t *igt_get_cairo_surface(int fd, struct igt_fb *fb)
 	if (fb->cairo_surface == NULL) {
 		if (use_convert(fb))
 			create_cairo_surface__convert(fd, fb);
-		else if (use_blitter(fb) || use_enginecopy(fb) ||
+		else if (use_detile(fb) || use_blitter(fb) ||
+			 use_enginecopy(fb) ||
 			 igt_vc4_is_tiled(fb->modifier) ||
 			 igt_amd_is_tiled(fb->modifier) ||
 			 is_nouveau_device(fb->fd))
@@ -0,0 +1,482 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+/**
+ * SECTION:igt_format_mod_index
+ * @short_description: Index of the format/modifier pairs supported by planes
+ * @title: Format/modifier index
+ * @include: igt_format_mod_index.h
+ *
+ * Answers "does this plane support this format with this modifier" in
+ * constant time. Formats and modifiers are interned to small ids through
+ * hash tables when the planes are added, and every format, modifier and
+ * format/modifier pair gets a bitset of the planes supporting it. Queries
+ * about sets of planes, like the planes supporting a pair or the planes
+ * supporting two pairs at once, then come down to bit operations on those
+ * sets.
+ *
+ * Planes are numbered from 0 by the caller, igt_kms uses the index of the
+ * plane in the #igt_display_t.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <xf86drmMode.h>
+
+#include "drmtest.h"
+#include "igt_aux.h"
+#include "igt_core.h"
+#include "igt_format_mod_index.h"
+
+/* Open addressing table interning 64 bit keys to consecutive ids */
+struct intern_table {
+	uint64_t *keys;
+	int *ids;		/* -1 for free slots */
+	unsigned int mask;
+	int count;
+};
+
+struct igt_format_mod_index {
+	int num_planes;
+	int words;		/* uint64_t per plane set */
+
+	struct intern_table formats;
+	struct intern_table modifiers;
+	int format_capacity;
+	int modifier_capacity;
+
+	/* Plane sets, by format id, modifier id and [format id][modifier id] */
+	uint64_t *format_planes;
+	uint64_t *modifier_planes;
+	uint64_t *pair_planes;
+
+	/* Returned for anything no plane supports */
+	uint64_t *empty;
+};
+
+static unsigned int intern_hash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+
+	return key;
+}
+
+static void intern_init(struct intern_table *t, unsigned int size)
+{
+	t->keys = calloc(size, sizeof(*t->keys));
+	igt_assert(t->keys);
+	t->ids = malloc(size * sizeof(*t->ids));
+	igt_assert(t->ids);
+	memset(t->ids, 0xff, size * sizeof(*t->ids));
+	t->mask = size - 1;
+	t->count = 0;
+}
+
+static void intern_fini(struct intern_table *t)
+{
+	free(t->keys);
+	free(t->ids);
+}
+
+static int intern_find(const struct intern_table *t, uint64_t key)
+{
+	for (unsigned int i = intern_hash(key) & t->mask; ; i = (i + 1) & t->mask) {
+		if (t->ids[i] < 0 || t->keys[i] == key)
+			return t->ids[i];
+	}
+}
+
+static void intern_insert(struct intern_table *t, uint64_t key, int id)
+{
+	unsigned int i = intern_hash(key) & t->mask;
+
+	while (t->ids[i] >= 0)
+		i = (i + 1) & t->mask;
+
+	t->keys[i] = key;
+	t->ids[i] = id;
+}
+
+/* Returns the id of @key, interning it if needed. Keeps the load below 1/2. */
+static int intern(struct intern_table *t, uint64_t key, bool *added)
+{
+	int id = intern_find(t, key);
+
+	*added = id < 0;
+	if (id >= 0)
+		return id;
+
+	if (2 * (t->count + 1) > t->mask + 1) {
+		struct intern_table old = *t;
+
+		intern_init(t, 2 * (old.mask + 1));
+		for (unsigned int i = 0; i <= old.mask; i++)
+			if (old.ids[i] >= 0)
+				intern_insert(t, old.keys[i], old.ids[i]);
+		t->count = old.count;
+		intern_fini(&old);
+	}
+
+	id = t->count++;
+	intern_insert(t, key, id);
+
+	return id;
+}
+
+static uint64_t *grow_sets(uint64_t *sets, int words, int old, int new)
+{
+	sets = realloc(sets, (size_t)new * words * sizeof(*sets));
+	igt_assert(sets);
+	memset(sets + (size_t)old * words, 0,
+	       (size_t)(new - old) * words * sizeof(*sets));
+
+	return sets;
+}
+
+static void grow_formats(struct igt_format_mod_index *index)
+{
+	int old = index->format_capacity, new = 2 * old;
+
+	index->format_planes = grow_sets(index->format_planes, index->words,
+					 old, new);
+	/* Rows of pairs are by format, new formats append rows */
+	index->pair_planes = grow_sets(index->pair_planes,
+				       index->words * index->modifier_capacity,
+				       old, new);
+	index->format_capacity = new;
+}
+
+static void grow_modifiers(struct igt_format_mod_index *index)
+{
+	int old = index->modifier_capacity, new = 2 * old;
+	size_t row = (size_t)new * index->words;
+	uint64_t *pairs;
+
+	index->modifier_planes = grow_sets(index->modifier_planes, index->words,
+					   old, new);
+
+	pairs = calloc(index->format_capacity, row * sizeof(*pairs));
+	igt_assert(pairs);
+	for (int f = 0; f < index->formats.count; f++)
+		memcpy(pairs + f * row,
+		       index->pair_planes + (size_t)f * old * index->words,
+		       (size_t)old * index->words * sizeof(*pairs));
+	free(index->pair_planes);
+	index->pair_planes = pairs;
+	index->modifier_capacity = new;
+}
+
+static uint64_t *pair_set(const struct igt_format_mod_index *index,
+			  int format_id, int modifier_id)
+{
+	return index->pair_planes +
+		((size_t)format_id * index->modifier_capacity + modifier_id) *
+		index->words;
+}
+
+static void set_plane(uint64_t *set, int plane)
+{
+	set[plane / 64] |= 1ull << (plane % 64);
+}
+
+/**
+ * igt_format_mod_index_create:
+ * @num_planes: number of planes to index
+ *
+ * Returns: an empty index for planes 0 to @num_planes - 1, to be freed with
+ * igt_format_mod_index_destroy().
+ */
+struct igt_format_mod_index *igt_format_mod_index_create(int num_planes)
+{
+	struct igt_format_mod_index *index;
+
+	igt_assert_lte(0, num_planes);
+
+	index = calloc(1, sizeof(*index));
+	igt_assert(index);
+
+	index->num_planes = num_planes;
+	index->words = max(DIV_ROUND_UP(num_planes, 64), 1);
+
+	intern_init(&index->formats, 64);
+	intern_init(&index->modifiers, 16);
+	index->format_capacity = 32;
+	index->modifier_capacity = 8;
+
+	index->format_planes = grow_sets(NULL, index->words, 0,
+					 index->format_capacity);
+	index->modifier_planes = grow_sets(NULL, index->words, 0,
+					   index->modifier_capacity);
+	index->pair_planes = grow_sets(NULL, index->words,
+				       0, index->format_capacity *
+				       index->modifier_capacity);
+	index->empty = grow_sets(NULL, index->words, 0, 1);
+
+	return index;
+}
+
+/**
+ * igt_format_mod_index_destroy:
+ * @index: index to free, can be NULL
+ */
+void igt_format_mod_index_destroy(struct igt_format_mod_index *index)
+{
+	if (!index)
+		return;
+
+	intern_fini(&index->formats);
+	intern_fini(&index->modifiers);
+	free(index->format_planes);
+	free(index->modifier_planes);
+	free(index->pair_planes);
+	free(index->empty);
+	free(index);
+}
+
+/**
+ * igt_format_mod_index_add:
+ * @index: a format/modifier index
+ * @plane: plane number
+ * @formats: formats supported by @plane
+ * @modifiers: modifiers going with @formats
+ * @count: number of format/modifier pairs
+ *
+ * Records that @plane supports the pairs of @formats and @modifiers, as
+ * returned by igt_parse_format_mod_blob(). A plane can be added several
+ * times, the pairs accumulate.
+ */
+void igt_format_mod_index_add(struct igt_format_mod_index *index, int plane,
+			      const uint32_t *formats,
+			      const uint64_t *modifiers, int count)
+{
+	igt_assert(plane >= 0 && plane < index->num_planes);
+
+	for (int i = 0; i < count; i++) {
+		int format_id, modifier_id;
+		bool added;
+
+		format_id = intern(&index->formats, formats[i], &added);
+		if (added && format_id == index->format_capacity)
+			grow_formats(index);
+
+		modifier_id = intern(&index->modifiers, modifiers[i], &added);
+		if (added && modifier_id == index->modifier_capacity)
+			grow_modifiers(index);
+
+		set_plane(index->format_planes + format_id * index->words, plane);
+		set_plane(index->modifier_planes + modifier_id * index->words, plane);
+		set_plane(pair_set(index, format_id, modifier_id), plane);
+	}
+}
+
+/**
+ * igt_format_mod_index_format_id:
+ * @index: a format/modifier index
+ * @format: a DRM fourcc format
+ *
+ * Returns: the id @format was interned to, in the order formats were first
+ * added, or -1 if no plane supports @format.
+ */
+int igt_format_mod_index_format_id(const struct igt_format_mod_index *index,
+				   uint32_t format)
+{
+	return intern_find(&index->formats, format);
+}
+
+/**
+ * igt_format_mod_index_modifier_id:
+ * @index: a format/modifier index
+ * @modifier: a DRM format modifier
+ *
+ * Returns: the id @modifier was interned to, in the order modifiers were
+ * first added, or -1 if no plane supports @modifier.
+ */
+int igt_format_mod_index_modifier_id(const struct igt_format_mod_index *index,
+				     uint64_t modifier)
+{
+	return intern_find(&index->modifiers, modifier);
+}
+
+/**
+ * igt_format_mod_index_planes:
+ * @index: a format/modifier index
+ * @format: a DRM fourcc format
+ * @modifier: a DRM format modifier
+ *
+ * Returns: the set of planes supporting @format with @modifier, as
+ * igt_format_mod_index_words() 64 bit words. The set is only valid until
+ * the next igt_format_mod_index_add().
+ */
+const uint64_t *
+igt_format_mod_index_planes(const struct igt_format_mod_index *index,
+			    uint32_t format, uint64_t modifier)
+{
+	int format_id = intern_find(&index->formats, format);
+	int modifier_id;
+
+	if (format_id < 0)
+		return index->empty;
+
+	modifier_id = intern_find(&index->modifiers, modifier);
+	if (modifier_id < 0)
+		return index->empty;
+
+	return pair_set(index, format_id, modifier_id);
+}
+
+/**
+ * igt_format_mod_index_format_planes:
+ * @index: a format/modifier index
+ * @format: a DRM fourcc format
+ *
+ * Returns: the set of planes supporting @format with any modifier, see
+ * igt_format_mod_index_planes().
+ */
+const uint64_t *
+igt_format_mod_index_format_planes(const struct igt_format_mod_index *index,
+				   uint32_t format)
+{
+	int format_id = intern_find(&index->formats, format);
+
+	if (format_id < 0)
+		return index->empty;
+
+	return index->format_planes + format_id * index->words;
+}
+
+/**
+ * igt_format_mod_index_modifier_planes:
+ * @index: a format/modifier index
+ * @modifier: a DRM format modifier
+ *
+ * Returns: the set of planes supporting @modifier with any format, see
+ * igt_format_mod_index_planes().
+ */
+const uint64_t *
+igt_format_mod_index_modifier_planes(const struct igt_format_mod_index *index,
+				     uint64_t modifier)
+{
+	int modifier_id = intern_find(&index->modifiers, modifier);
+
+	if (modifier_id < 0)
+		return index->empty;
+
+	return index->modifier_planes + modifier_id * index->words;
+}
+
+/**
+ * igt_format_mod_index_has:
+ * @index: a format/modifier index
+ * @plane: plane number
+ * @format: a DRM fourcc format
+ * @modifier: a DRM format modifier
+ *
+ * Returns: True if @plane supports @format with @modifier, else false.
+ */
+bool igt_format_mod_index_has(const struct igt_format_mod_index *index,
+			      int plane, uint32_t format, uint64_t modifier)
+{
+	const uint64_t *planes = igt_format_mod_index_planes(index, format,
+							     modifier);
+
+	igt_assert(plane >= 0 && plane < index->num_planes);
+
+	return planes[plane / 64] & (1ull << (plane % 64));
+}
+
+/**
+ * igt_format_mod_index_words:
+ * @index: a format/modifier index
+ *
+ * Returns: the number of 64 bit words of the plane sets of @index, plane n
+ * being bit n % 64 of word n / 64.
+ */
+int igt_format_mod_index_words(const struct igt_format_mod_index *index)
+{
+	return index->words;
+}
+
+/**
+ * igt_format_mod_index_next_plane:
+ * @index: a format/modifier index
+ * @planes: a set of planes of @index
+ * @plane: first plane to consider
+ *
+ * Returns: the first plane of @planes from @plane on, or -1 if there is
+ * none.
+ */
+int igt_format_mod_index_next_plane(const struct igt_format_mod_index *index,
+				    const uint64_t *planes, int plane)
+{
+	while (plane < index->num_planes) {
+		uint64_t word = planes[plane / 64] >> (plane % 64);
+
+		if (word)
+			return plane + __builtin_ctzll(word);
+
+		plane = (plane | 63) + 1;
+	}
+
+	return -1;
+}
+
+/**
+ * igt_format_mod_blob_build:
+ * @formats: formats of the blob
+ * @num_formats: number of @formats
+ * @modifiers: modifiers of the blob
+ * @num_modifiers: number of @modifiers
+ * @support: @words words of format bits for each of @modifiers
+ * @words: number of 64 bit words per modifier in @support
+ *
+ * Builds a synthetic IN_FORMATS property blob, for testing and benchmarking
+ * the parsing and the index without a display. @modifiers[m] goes with
+ * @formats[f] when bit f % 64 of word f / 64 of @support[m] is set, words
+ * without any bit set are left out of the blob.
+ *
+ * Returns: the blob, to be freed with free().
+ */
+struct drm_format_modifier_blob *
+igt_format_mod_blob_build(const uint32_t *formats, int num_formats,
+			  const uint64_t *modifiers, int num_modifiers,
+			  const uint64_t *support, int words)
+{
+	struct drm_format_modifier_blob *blob;
+	struct drm_format_modifier *m;
+	int count = 0;
+	size_t size;
+
+	for (int i = 0; i < num_modifiers * words; i++)
+		count += !!support[i];
+
+	size = sizeof(*blob) + num_formats * sizeof(uint32_t);
+	size = ALIGN(size, 8);
+	blob = calloc(1, size + count * sizeof(*m));
+	igt_assert(blob);
+
+	blob->version = FORMAT_BLOB_CURRENT;
+	blob->count_formats = num_formats;
+	blob->formats_offset = sizeof(*blob);
+	blob->count_modifiers = count;
+	blob->modifiers_offset = size;
+	memcpy(blob + 1, formats, num_formats * sizeof(uint32_t));
+
+	m = (struct drm_format_modifier *)((char *)blob + size);
+	for (int i = 0; i < num_modifiers; i++) {
+		for (int w = 0; w < words; w++) {
+			if (!support[i * words + w])
+				continue;
+
+			m->formats = support[i * words + w];
+			m->offset = w * 64;
+			m->modifier = modifiers[i];
+			m++;
+		}
+	}
+
+	return blob;
+}
@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#ifndef IGT_FORMAT_MOD_INDEX_H
+#define IGT_FORMAT_MOD_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct drm_format_modifier_blob;
+struct igt_format_mod_index;
+
+struct igt_format_mod_index *igt_format_mod_index_create(int num_planes);
+void igt_format_mod_index_destroy(struct igt_format_mod_index *index);
+
+void igt_format_mod_index_add(struct igt_format_mod_index *index, int plane,
+			      const uint32_t *formats,
+			      const uint64_t *modifiers, int count);
+
+int igt_format_mod_index_format_id(const struct igt_format_mod_index *index,
+				   uint32_t format);
+int igt_format_mod_index_modifier_id(const struct igt_format_mod_index *index,
+				     uint64_t modifier);
+
+bool igt_format_mod_index_has(const struct igt_format_mod_index *index,
+			      int plane, uint32_t format, uint64_t modifier);
+const uint64_t *
+igt_format_mod_index_planes(const struct igt_format_mod_index *index,
+			    uint32_t format, uint64_t modifier);
+const uint64_t *
+igt_format_mod_index_format_planes(const struct igt_format_mod_index *index,
+				   uint32_t format);
+const uint64_t *
+igt_format_mod_index_modifier_planes(const struct igt_format_mod_index *index,
+				     uint64_t modifier);
+
+int igt_format_mod_index_words(const struct igt_format_mod_index *index);
+int igt_format_mod_index_next_plane(const struct igt_format_mod_index *index,
+				    const uint64_t *planes, int plane);
+
+struct drm_format_modifier_blob *
+igt_format_mod_blob_build(const uint32_t *formats, int num_formats,
+			  const uint64_t *modifiers, int num_modifiers,
+			  const uint64_t *support, int words);
+
+/**
+ * for_each_format_mod_index_plane:
+ * @index: a format/modifier index
+ * @planes: a set of planes of @index
+ * @plane: plane number, the iterator
+ *
+ * Iterates over the planes in @planes in increasing order.
+ */
+#define for_each_format_mod_index_plane(index, planes, plane) \
+	for ((plane) = igt_format_mod_index_next_plane((index), (planes), 0); \
+	     (plane) >= 0; \
+	     (plane) = igt_format_mod_index_next_plane((index), (planes), (plane) + 1))
+
+#endif /* IGT_FORMAT_MOD_INDEX_H */
@@ -275,8 +275,35 @@ complete:
 	return match;
 }
 
-#define XR24_COLOR_VALUE(data, stride, x, y, c) \
-	*((uint8_t *)(data) + (y) * (stride) + 4 * (x) + (c))
+static void checkerboard_edges_row(const uint8_t *data, unsigned int stride,
+				   unsigned int width, unsigned int height,
+				   unsigned int y, unsigned int span,
+				   unsigned int threshold, uint8_t *edges)
+{
+	const uint8_t *row, *up, *down;
+	unsigned int x, c;
+
+	memset(edges, 0, width);
+
+	if (y < span || y + span >= height)
+		return;
+
+	row = data + y * stride;
+	up = row - span * stride;
+	down = row + span * stride;
+
+	for (x = span; x + span < width; x++) {
+		unsigned int xdiff = 0, ydiff = 0;
+
+		for (c = 0; c < 3; c++) {
+			xdiff += abs(row[4 * (x + span) + c] -
+				     row[4 * (x - span) + c]);
+			ydiff += abs(down[4 * x + c] - up[4 * x + c]);
+		}
+
+		edges[x] = xdiff > threshold || ydiff > threshold;
+	}
+}
 
 /**
  * igt_check_checkerboard_frame_match:
@@ -305,21 +332,25 @@ complete:
  * does not count excluded pixels) is then calculated and compared to the error
  * rate threshold to determine whether the frames match or not.
  *
+ * Both steps run in a single pass over the frames. Only the edges of the few
+ * rows around the current one are kept, in a small ring of rows.
+ *
  * Returns: a boolean indicating whether the frames match
  */
 bool igt_check_checkerboard_frame_match(cairo_surface_t *reference,
 					cairo_surface_t *capture)
 {
 	unsigned int width, height, ref_stride, cap_stride;
-	void *ref_data, *cap_data;
-	unsigned char *edges_map;
-	unsigned int x, y, c;
-	unsigned int errors = 0, pixels = 0;
+	const uint8_t *ref_data, *cap_data;
+	uint8_t *edges;
+	unsigned int x, y, c, next = 0;
+	uint64_t errors = 0, pixels = 0;
 	unsigned int edge_threshold = 100;
 	unsigned int color_error_threshold = 24;
 	double error_rate_threshold = 0.01;
 	double error_rate;
 	unsigned int span = 2;
+	unsigned int window = 2 * span + 1;
 	bool match = false;
 
 	width = cairo_image_surface_get_width(reference);
@@ -333,71 +364,56 @@ bool igt_check_checkerboard_frame_match(cairo_surface_t *reference,
 	cap_data = cairo_image_surface_get_data(capture);
 	igt_assert(cap_data);
 
-	edges_map = calloc(1, width * height);
-	igt_assert(edges_map);
+	/* Edges of rows y - span to y + span, indexed by row modulo window. */
+	edges = malloc(window * width);
+	igt_assert(edges);
 
-	/* First pass to detect the pattern edges. */
 	for (y = 0; y < height; y++) {
-		if (y < span || y > (height - span - 1))
-			continue;
-
-		for (x = 0; x < width; x++) {
-			unsigned int xdiff = 0, ydiff = 0;
-
-			if (x < span || x > (width - span - 1))
-				continue;
-
-			for (c = 0; c < 3; c++) {
-				xdiff += abs(XR24_COLOR_VALUE(ref_data, ref_stride, x + span, y, c) -
-					     XR24_COLOR_VALUE(ref_data, ref_stride, x - span, y, c));
-				ydiff += abs(XR24_COLOR_VALUE(ref_data, ref_stride, x, y + span, c) -
-					     XR24_COLOR_VALUE(ref_data, ref_stride, x, y - span, c));
-			}
-
-			edges_map[y * width + x] = (xdiff > edge_threshold ||
-						    ydiff > edge_threshold);
+		const uint8_t *ref_row = ref_data + y * ref_stride;
+		const uint8_t *cap_row = cap_data + y * cap_stride;
+		const uint8_t *cur, *above = NULL, *below = NULL;
+
+		for (; next < height && next <= y + span; next++)
+			checkerboard_edges_row(ref_data, ref_stride,
+					       width, height, next, span,
+					       edge_threshold,
+					       edges + (next % window) * width);
+
+		cur = edges + (y % window) * width;
+		if (y >= span && y + span < height) {
+			above = edges + ((y - span) % window) * width;
+			below = edges + ((y + span) % window) * width;
 		}
-	}
 
-	/* Second pass to detect errors. */
-	for (y = 0; y < height; y++) {
 		for (x = 0; x < width; x++) {
 			bool error = false;
 
-			if (edges_map[y * width + x])
+			if (cur[x])
 				continue;
 
-			for (c = 0; c < 3; c++) {
-				unsigned int diff;
-
-				/* Compare the reference and capture values. */
-				diff = abs(XR24_COLOR_VALUE(ref_data, ref_stride, x, y, c) -
-					   XR24_COLOR_VALUE(cap_data, cap_stride, x, y, c));
-
-				if (diff > color_error_threshold)
+			for (c = 0; c < 3; c++)
+				if (abs(ref_row[4 * x + c] - cap_row[4 * x + c]) >
+				    color_error_threshold)
 					error = true;
-			}
 
-			/* Allow error if coming on or off an edge (on x). */
-			if (error && x >= span && x <= (width - span - 1) &&
-			    edges_map[y * width + (x - span)] !=
-			    edges_map[y * width + (x + span)])
-				continue;
+			if (error) {
+				/* Allow error if coming on or off an edge (on x). */
+				if (x >= span && x + span < width &&
+				    cur[x - span] != cur[x + span])
+					continue;
 
-			/* Allow error if coming on or off an edge (on y). */
-			if (error && y >= span && y <= (height - span - 1) &&
-			    edges_map[(y - span) * width + x] !=
-			    edges_map[(y + span) * width + x] && error)
-				continue;
+				/* Allow error if coming on or off an edge (on y). */
+				if (above && above[x] != below[x])
+					continue;
 
-			if (error)
 				errors++;
+			}
 
 			pixels++;
 		}
 	}
 
-	free(edges_map);
+	free(edges);
 
 	error_rate = (double) errors / pixels;
 
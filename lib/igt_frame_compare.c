@@ -0,0 +1,439 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+/**
+ * SECTION:igt_frame_compare
+ * @short_description: Comparison of CPU mapped frames
+ * @title: Frame comparison
+ * @include: igt_frame_compare.h
+ *
+ * Compares two frames where they are, without converting them to a common
+ * surface format first. Every pixel is reduced to the largest difference
+ * of its colour components, which is checked against a threshold and
+ * optionally counted in a histogram. The row kernels use SSE4.1 when the
+ * CPU has it. 24 bit rows are widened to 32 bit one row at a time, and
+ * large frames are split into bands of rows compared in parallel.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drm_fourcc.h"
+#include "igt_aux.h"
+#include "igt_core.h"
+#include "igt_frame_compare.h"
+#include "igt_x86.h"
+
+#define MAX_THREADS 32
+#define PARALLEL_THRESHOLD (1 << 20) /* pixels */
+
+typedef uint32_t (*row_diff_fn)(const uint32_t *ref, const uint32_t *cap,
+				const uint8_t *mask, uint32_t n,
+				uint32_t threshold, uint32_t *max_diff,
+				uint32_t *hist);
+
+struct compare_shared {
+	const struct igt_frame_buf *ref, *cap;
+	const struct igt_frame_compare_params *params;
+	row_diff_fn row_diff;
+	uint32_t threshold;
+	uint32_t x, width;
+	uint64_t errors; /* running total, only kept for early exit */
+	bool stop;
+};
+
+struct compare_work {
+	struct compare_shared *shared;
+	uint32_t first_row, last_row; /* last excluded */
+	uint32_t *ref_row, *cap_row; /* widened 24 bit rows */
+	uint64_t compared, errors;
+	uint32_t max_diff;
+	uint32_t hist[IGT_FRAME_HIST_BINS];
+};
+
+/* Bits per component, 0 if unsupported */
+static int format_depth(uint32_t format)
+{
+	switch (format) {
+	case DRM_FORMAT_BGR888:
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_ARGB8888:
+		return 8;
+	case DRM_FORMAT_XRGB2101010:
+	case DRM_FORMAT_ARGB2101010:
+		return 10;
+	}
+
+	return 0;
+}
+
+static uint32_t absdiff(uint32_t a, uint32_t b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static uint32_t pixel_diff_8(uint32_t a, uint32_t b)
+{
+	uint32_t d = absdiff(a & 0xff, b & 0xff);
+
+	d = max(d, absdiff(a >> 8 & 0xff, b >> 8 & 0xff));
+
+	return max(d, absdiff(a >> 16 & 0xff, b >> 16 & 0xff));
+}
+
+static uint32_t pixel_diff_10(uint32_t a, uint32_t b)
+{
+	uint32_t d = absdiff(a & 0x3ff, b & 0x3ff);
+
+	d = max(d, absdiff(a >> 10 & 0x3ff, b >> 10 & 0x3ff));
+
+	return max(d, absdiff(a >> 20 & 0x3ff, b >> 20 & 0x3ff));
+}
+
+static inline uint32_t row_diff(const uint32_t *ref, const uint32_t *cap,
+				const uint8_t *mask, uint32_t n,
+				uint32_t threshold, uint32_t *max_diff,
+				uint32_t *hist, int depth)
+{
+	uint32_t errors = 0, i;
+
+	for (i = 0; i < n; i++) {
+		uint32_t d;
+
+		if (mask && !mask[i])
+			continue;
+
+		d = depth == 10 ? pixel_diff_10(ref[i], cap[i]) :
+				  pixel_diff_8(ref[i], cap[i]);
+		errors += d > threshold;
+		*max_diff = max(*max_diff, d);
+		if (hist)
+			hist[d]++;
+	}
+
+	return errors;
+}
+
+static uint32_t row_diff_8(const uint32_t *ref, const uint32_t *cap,
+			   const uint8_t *mask, uint32_t n, uint32_t threshold,
+			   uint32_t *max_diff, uint32_t *hist)
+{
+	return row_diff(ref, cap, mask, n, threshold, max_diff, hist, 8);
+}
+
+static uint32_t row_diff_10(const uint32_t *ref, const uint32_t *cap,
+			    const uint8_t *mask, uint32_t n, uint32_t threshold,
+			    uint32_t *max_diff, uint32_t *hist)
+{
+	return row_diff(ref, cap, mask, n, threshold, max_diff, hist, 10);
+}
+
+#if defined(__x86_64__) && !defined(__clang__) && defined(__GLIBC__) && !defined(__UCLIBC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+
+#include <smmintrin.h>
+
+/* Largest component difference of each of four 8 bit pixels */
+static inline __m128i pixel_diff_8_sse41(__m128i a, __m128i b)
+{
+	__m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+
+	d = _mm_and_si128(d, _mm_set1_epi32(0xffffff));
+	d = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+	d = _mm_max_epu8(d, _mm_srli_epi32(d, 16));
+
+	return _mm_and_si128(d, _mm_set1_epi32(0xff));
+}
+
+static inline __m128i component_diff_10_sse41(__m128i a, __m128i b, int shift)
+{
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	const __m128i bits = _mm_set1_epi32(0x3ff);
+
+	a = _mm_and_si128(_mm_srl_epi32(a, count), bits);
+	b = _mm_and_si128(_mm_srl_epi32(b, count), bits);
+
+	return _mm_sub_epi32(_mm_max_epu32(a, b), _mm_min_epu32(a, b));
+}
+
+/* Largest component difference of each of four 10 bit pixels */
+static inline __m128i pixel_diff_10_sse41(__m128i a, __m128i b)
+{
+	__m128i d = component_diff_10_sse41(a, b, 0);
+
+	d = _mm_max_epu32(d, component_diff_10_sse41(a, b, 10));
+
+	return _mm_max_epu32(d, component_diff_10_sse41(a, b, 20));
+}
+
+static inline uint32_t row_diff_sse41(const uint32_t *ref, const uint32_t *cap,
+				      const uint8_t *mask, uint32_t n,
+				      uint32_t threshold, uint32_t *max_diff,
+				      uint32_t *hist, int depth)
+{
+	/* The threshold is clamped to the depth, the signed compare is safe */
+	const __m128i thresh = _mm_set1_epi32(threshold);
+	__m128i vmax = _mm_setzero_si128();
+	uint32_t errors = 0, i;
+	uint32_t d[4];
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(ref + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(cap + i));
+		__m128i diff = depth == 10 ? pixel_diff_10_sse41(a, b) :
+					     pixel_diff_8_sse41(a, b);
+
+		if (mask) {
+			uint32_t m;
+
+			memcpy(&m, mask + i, sizeof(m));
+			diff = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(m)),
+								_mm_setzero_si128()),
+						diff);
+		}
+
+		vmax = _mm_max_epu32(vmax, diff);
+		errors += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(diff, thresh))));
+
+		if (hist) {
+			_mm_storeu_si128((__m128i *)d, diff);
+			for (int k = 0; k < 4; k++)
+				if (!mask || mask[i + k])
+					hist[d[k]]++;
+		}
+	}
+
+	_mm_storeu_si128((__m128i *)d, vmax);
+	*max_diff = max(*max_diff, max(max(d[0], d[1]), max(d[2], d[3])));
+
+	return errors + row_diff(ref + i, cap + i, mask ? mask + i : NULL, n - i,
+				 threshold, max_diff, hist, depth);
+}
+
+static uint32_t row_diff_8_sse41(const uint32_t *ref, const uint32_t *cap,
+				 const uint8_t *mask, uint32_t n,
+				 uint32_t threshold, uint32_t *max_diff,
+				 uint32_t *hist)
+{
+	return row_diff_sse41(ref, cap, mask, n, threshold, max_diff, hist, 8);
+}
+
+static uint32_t row_diff_10_sse41(const uint32_t *ref, const uint32_t *cap,
+				  const uint8_t *mask, uint32_t n,
+				  uint32_t threshold, uint32_t *max_diff,
+				  uint32_t *hist)
+{
+	return row_diff_sse41(ref, cap, mask, n, threshold, max_diff, hist, 10);
+}
+
+#pragma GCC pop_options
+#endif
+
+static row_diff_fn get_row_diff(int depth)
+{
+#if defined(__x86_64__) && !defined(__clang__) && defined(__GLIBC__) && !defined(__UCLIBC__)
+	if (igt_x86_features() & SSE4_1)
+		return depth == 10 ? row_diff_10_sse41 : row_diff_8_sse41;
+#endif
+
+	return depth == 10 ? row_diff_10 : row_diff_8;
+}
+
+/* Row @y of @buf from column @x on, as 32 bit pixels in XRGB order */
+static const uint32_t *get_row(const struct igt_frame_buf *buf,
+			       uint32_t x, uint32_t y, uint32_t n,
+			       uint32_t *scratch)
+{
+	const uint8_t *row = (const uint8_t *)buf->data + (uint64_t)y * buf->stride;
+
+	if (buf->format != DRM_FORMAT_BGR888)
+		return (const uint32_t *)row + x;
+
+	/* Bytes are R, G, B in memory */
+	row += x * 3;
+	for (uint32_t i = 0; i < n; i++, row += 3)
+		scratch[i] = row[0] << 16 | row[1] << 8 | row[2];
+
+	return scratch;
+}
+
+static void compare_rows(struct compare_work *work)
+{
+	struct compare_shared *shared = work->shared;
+	const struct igt_frame_compare_params *params = shared->params;
+	uint32_t *hist = params->histogram ? work->hist : NULL;
+	const uint32_t n = shared->width;
+
+	for (uint32_t y = work->first_row; y < work->last_row; y++) {
+		const uint32_t *ref, *cap;
+		const uint8_t *mask = NULL;
+		uint32_t errors;
+
+		if (params->early_exit && READ_ONCE(shared->stop))
+			break;
+
+		if (params->mask) {
+			mask = params->mask + (uint64_t)y * params->mask_stride + shared->x;
+			for (uint32_t i = 0; i < n; i++)
+				work->compared += !!mask[i];
+		} else {
+			work->compared += n;
+		}
+
+		ref = get_row(shared->ref, shared->x, y, n, work->ref_row);
+		cap = get_row(shared->cap, shared->x, y, n, work->cap_row);
+		errors = shared->row_diff(ref, cap, mask, n, shared->threshold,
+					  &work->max_diff, hist);
+		work->errors += errors;
+
+		if (params->early_exit && errors &&
+		    __sync_add_and_fetch(&shared->errors, errors) > params->max_errors)
+			WRITE_ONCE(shared->stop, true);
+	}
+}
+
+static void *compare_rows_thread(void *data)
+{
+	compare_rows(data);
+
+	return NULL;
+}
+
+static void check_buf(const struct igt_frame_buf *buf)
+{
+	uint32_t cpp = buf->format == DRM_FORMAT_BGR888 ? 3 : 4;
+
+	igt_assert_f(format_depth(buf->format),
+		     "Unsupported format 0x%08x\n", buf->format);
+	igt_assert(buf->data);
+	igt_assert(buf->stride >= buf->width * cpp);
+	if (cpp == 4)
+		igt_assert(!((uintptr_t)buf->data & 3) && !(buf->stride & 3));
+}
+
+/**
+ * igt_frame_compare_supported:
+ * @format: DRM fourcc
+ *
+ * Returns: true if frames in @format can be compared. 8 bit formats can
+ * be compared with each other, 10 bit ones only with 10 bit ones.
+ */
+bool igt_frame_compare_supported(uint32_t format)
+{
+	return format_depth(format);
+}
+
+/**
+ * igt_frame_compare:
+ * @reference: the expected frame
+ * @capture: the frame to check, of the same size as @reference
+ * @params: how to compare the frames, or NULL for an exact comparison of
+ *          the whole frames
+ * @result: returns the statistics of the comparison, may be NULL
+ *
+ * Compares the colour components of the pixels of two frames. A pixel is
+ * in error when one of its components differs by more than the threshold.
+ *
+ * Returns: true if no more than @params->max_errors pixels are in error.
+ */
+bool igt_frame_compare(const struct igt_frame_buf *reference,
+		       const struct igt_frame_buf *capture,
+		       const struct igt_frame_compare_params *params,
+		       struct igt_frame_compare_result *result)
+{
+	static const struct igt_frame_compare_params exact = {
+		.early_exit = true,
+	};
+	struct igt_frame_compare_result local;
+	pthread_t threads[MAX_THREADS];
+	struct compare_shared shared;
+	struct compare_work *work;
+	uint32_t height, nthreads, i;
+	int depth;
+
+	if (!params)
+		params = &exact;
+	if (!result)
+		result = &local;
+
+	check_buf(reference);
+	check_buf(capture);
+	depth = format_depth(reference->format);
+	igt_assert_f(format_depth(capture->format) == depth,
+		     "Cannot compare format 0x%08x with 0x%08x\n",
+		     reference->format, capture->format);
+	igt_assert_eq_u32(reference->width, capture->width);
+	igt_assert_eq_u32(reference->height, capture->height);
+
+	shared = (struct compare_shared) {
+		.ref = reference,
+		.cap = capture,
+		.params = params,
+		.row_diff = get_row_diff(depth),
+		.threshold = min_t(uint32_t, params->threshold, (1u << depth) - 1),
+		.x = params->x,
+		.width = params->width ?: reference->width - params->x,
+	};
+	height = params->height ?: reference->height - params->y;
+	igt_assert(params->x <= reference->width &&
+		   shared.width <= reference->width - params->x);
+	igt_assert(params->y <= reference->height &&
+		   height <= reference->height - params->y);
+
+	nthreads = 1;
+	if ((uint64_t)shared.width * height >= PARALLEL_THRESHOLD)
+		nthreads = min_t(uint32_t, sysconf(_SC_NPROCESSORS_ONLN), MAX_THREADS);
+	nthreads = max(min(nthreads, height), 1u);
+
+	work = calloc(nthreads, sizeof(*work));
+	igt_assert(work);
+
+	for (i = 0; i < nthreads; i++) {
+		work[i].shared = &shared;
+		work[i].first_row = params->y + (uint64_t)height * i / nthreads;
+		work[i].last_row = params->y + (uint64_t)height * (i + 1) / nthreads;
+
+		if (reference->format == DRM_FORMAT_BGR888) {
+			work[i].ref_row = malloc(shared.width * sizeof(uint32_t));
+			igt_assert(work[i].ref_row);
+		}
+		if (capture->format == DRM_FORMAT_BGR888) {
+			work[i].cap_row = malloc(shared.width * sizeof(uint32_t));
+			igt_assert(work[i].cap_row);
+		}
+	}
+
+	for (i = 1; i < nthreads; i++)
+		igt_assert_eq(pthread_create(&threads[i], NULL,
+					     compare_rows_thread, &work[i]), 0);
+
+	compare_rows(&work[0]);
+
+	for (i = 1; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	memset(result, 0, sizeof(*result));
+	for (i = 0; i < nthreads; i++) {
+		result->compared += work[i].compared;
+		result->errors += work[i].errors;
+		result->max_diff = max(result->max_diff, work[i].max_diff);
+
+		if (params->histogram)
+			for (int bin = 0; bin < IGT_FRAME_HIST_BINS; bin++)
+				result->histogram[bin] += work[i].hist[bin];
+
+		free(work[i].ref_row);
+		free(work[i].cap_row);
+	}
+	free(work);
+
+	result->aborted = shared.stop;
+	result->match = result->errors <= params->max_errors;
+
+	return result->match;
+}
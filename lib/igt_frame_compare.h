@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#ifndef IGT_FRAME_COMPARE_H
+#define IGT_FRAME_COMPARE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Large enough for the maximum difference of a 10 bit component */
+#define IGT_FRAME_HIST_BINS 1024
+
+/**
+ * struct igt_frame_buf - description of a CPU mapped frame
+ * @data:    first pixel of the frame
+ * @stride:  distance between rows in bytes
+ * @width:   width in pixels
+ * @height:  height in pixels
+ * @format:  DRM_FORMAT_BGR888 (as dumped by the Chamelium), one of the
+ *           little endian XRGB8888 family or the XRGB2101010 family. The
+ *           alpha or padding bits are never compared.
+ */
+struct igt_frame_buf {
+	const void *data;
+	uint32_t stride;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+};
+
+/**
+ * struct igt_frame_compare_params - how to compare two frames
+ * @threshold:   largest tolerated per-component difference, in units of
+ *               the component depth of the frames
+ * @max_errors:  the frames match if at most this many pixels have a
+ *               component difference above @threshold
+ * @early_exit:  stop as soon as @max_errors is exceeded, leaving the
+ *               counters and histogram of the result incomplete
+ * @histogram:   fill in the histogram of the result
+ * @x:           left edge of the region of interest
+ * @y:           top edge of the region of interest
+ * @width:       width of the region of interest, 0 for the whole frame
+ * @height:      height of the region of interest, 0 for the whole frame
+ * @mask:        optional byte per pixel of the whole frame, only pixels
+ *               with a non-zero mask are compared
+ * @mask_stride: distance between rows of @mask in bytes
+ */
+struct igt_frame_compare_params {
+	uint32_t threshold;
+	uint64_t max_errors;
+	bool early_exit;
+	bool histogram;
+
+	uint32_t x, y;
+	uint32_t width, height;
+	const uint8_t *mask;
+	uint32_t mask_stride;
+};
+
+/**
+ * struct igt_frame_compare_result - outcome of a frame comparison
+ * @match:     whether no more than @max_errors pixels were in error
+ * @aborted:   the comparison stopped early, see @early_exit
+ * @compared:  number of pixels compared
+ * @errors:    number of pixels with a component difference above the
+ *             threshold
+ * @max_diff:  largest component difference seen
+ * @histogram: number of compared pixels by largest component difference,
+ *             only filled in when requested
+ */
+struct igt_frame_compare_result {
+	bool match;
+	bool aborted;
+	uint64_t compared;
+	uint64_t errors;
+	uint32_t max_diff;
+	uint64_t histogram[IGT_FRAME_HIST_BINS];
+};
+
+bool igt_frame_compare_supported(uint32_t format);
+bool igt_frame_compare(const struct igt_frame_buf *reference,
+		       const struct igt_frame_buf *capture,
+		       const struct igt_frame_compare_params *params,
+		       struct igt_frame_compare_result *result);
+
+#endif /* IGT_FRAME_COMPARE_H */
@@ -986,37 +986,28 @@ static int kunit_get_results(struct igt_list_head *results, const char *debugfs_
 			     const char *suite, struct igt_ktap_results **ktap)
 {
 	char results_path[PATH_MAX];
-	FILE *results_stream;
-	char *buf = NULL;
-	size_t size = 0;
-	ssize_t len;
+	int results_fd;
 	int err;
 
 	if (igt_debug_on(strlen(debugfs_path) + strlen(suite) + strlen("/results") >= PATH_MAX))
 		return -ENOSPC;
 
 	strcpy(stpcpy(stpcpy(results_path, debugfs_path), suite), "/results");
-	results_stream = fopen(results_path, "r");
-	if (igt_debug_on(!results_stream))
+	results_fd = open(results_path, O_RDONLY);
+	if (igt_debug_on(results_fd < 0))
 		return -errno;
 
 	*ktap = igt_ktap_alloc(results);
 	if (igt_debug_on(!*ktap)) {
 		err = -ENOMEM;
-		goto out_fclose;
+		goto out_close;
 	}
 
-	while (len = getline(&buf, &size, results_stream), len > 0) {
-		err = igt_ktap_parse(buf, *ktap);
-		if (err != -EINPROGRESS)
-			break;
-	}
-
-	free(buf);
+	err = igt_ktap_read(results_fd, *ktap);
 
 	igt_ktap_free(ktap);
-out_fclose:
-	fclose(results_stream);
+out_close:
+	close(results_fd);
 
 	return err;
 }
@@ -3201,6 +3201,7 @@ void igt_display_require(igt_display_t *display, int drm_fd)
 	display->n_planes = plane_resources->count_planes;
 	display->planes = calloc(display->n_planes, sizeof(igt_plane_t));
 	igt_assert_f(display->planes, "Failed to allocate memory for %d planes\n", display->n_planes);
+	display->format_mod_index = igt_format_mod_index_create(display->n_planes);
 
 	for (i = 0; i < plane_resources->count_planes; ++i) {
 		igt_plane_t *plane = &display->planes[i];
@@ -3440,6 +3441,8 @@ void igt_display_fini(igt_display_t *display)
 	display->crtcs = NULL;
 	free(display->planes);
 	display->planes = NULL;
+	igt_format_mod_index_destroy(display->format_mod_index);
+	display->format_mod_index = NULL;
 	free(display->colorops);
 	display->colorops = NULL;
 }
@@ -6178,8 +6181,19 @@ static int igt_count_plane_format_mod(const struct drm_format_modifier_blob *blo
 	return count;
 }
 
-static void igt_parse_format_mod_blob(const struct drm_format_modifier_blob *blob_data,
-				      uint32_t **formats, uint64_t **modifiers, int *count)
+/**
+ * igt_parse_format_mod_blob:
+ * @blob_data: contents of an IN_FORMATS or IN_FORMATS_ASYNC blob
+ * @formats: returns an allocated array of formats
+ * @modifiers: returns an allocated array of the modifiers going with @formats
+ * @count: returns the number of format/modifier pairs
+ *
+ * Flattens the format/modifier pairs of a plane capability blob into two
+ * parallel arrays. @formats and @modifiers are left untouched if the blob
+ * has no pairs.
+ */
+void igt_parse_format_mod_blob(const struct drm_format_modifier_blob *blob_data,
+			       uint32_t **formats, uint64_t **modifiers, int *count)
 {
 	const struct drm_format_modifier *m = modifiers_ptr(blob_data);
 	const uint32_t *f = formats_ptr(blob_data);
@@ -6236,6 +6250,10 @@ static void igt_fill_plane_format_mod(igt_display_t *display, igt_plane_t *plane
 			plane->modifiers[i] = DRM_FORMAT_MOD_LINEAR;
 		}
 
+		igt_format_mod_index_add(display->format_mod_index,
+					 plane->ref - display->planes,
+					 plane->formats, plane->modifiers,
+					 plane->format_mod_count);
 		return;
 	}
 
@@ -6248,6 +6266,11 @@ static void igt_fill_plane_format_mod(igt_display_t *display, igt_plane_t *plane
 	igt_parse_format_mod_blob(blob_data, &plane->formats, &plane->modifiers, &plane->format_mod_count);
 	drmModeFreePropertyBlob(blob);
 
+	igt_format_mod_index_add(display->format_mod_index,
+				 plane->ref - display->planes,
+				 plane->formats, plane->modifiers,
+				 plane->format_mod_count);
+
 	if (igt_plane_has_prop(plane, IGT_PLANE_IN_FORMATS_ASYNC)) {
 		blob_id = igt_plane_get_prop(plane, IGT_PLANE_IN_FORMATS_ASYNC);
 		blob = drmModeGetPropertyBlob(display->drm_fd, blob_id);
@@ -6260,6 +6283,26 @@ static void igt_fill_plane_format_mod(igt_display_t *display, igt_plane_t *plane
 	}
 }
 
+/*
+ * Index of @plane in the format/modifier index of its display, -1 for
+ * planes which aren't indexed, like the global planes.
+ */
+static int igt_plane_format_mod_index(igt_plane_t *plane)
+{
+	igt_display_t *display;
+
+	if (!plane->crtc || !plane->ref)
+		return -1;
+
+	display = plane->crtc->display;
+	if (!display->format_mod_index ||
+	    plane->ref < display->planes ||
+	    plane->ref >= display->planes + display->n_planes)
+		return -1;
+
+	return plane->ref - display->planes;
+}
+
 /**
  * igt_plane_has_format_mod:
  * @plane: Target plane
@@ -6271,7 +6314,11 @@ static void igt_fill_plane_format_mod(igt_display_t *display, igt_plane_t *plane
 bool igt_plane_has_format_mod(igt_plane_t *plane, uint32_t format,
 			      uint64_t modifier)
 {
-	int i;
+	int i = igt_plane_format_mod_index(plane);
+
+	if (i >= 0)
+		return igt_format_mod_index_has(plane->crtc->display->format_mod_index,
+						i, format, modifier);
 
 	for (i = 0; i < plane->format_mod_count; i++) {
 		if (plane->formats[i] == format &&
@@ -6357,8 +6404,14 @@ static void igt_fill_display_format_mod(igt_display_t *display)
 bool igt_display_has_format_mod(igt_display_t *display, uint32_t format,
 				uint64_t modifier)
 {
+	struct igt_format_mod_index *index = display->format_mod_index;
 	int i;
 
+	if (index)
+		return igt_format_mod_index_next_plane(index,
+						       igt_format_mod_index_planes(index, format, modifier),
+						       0) >= 0;
+
 	for (i = 0; i < display->format_mod_count; i++) {
 		if (display->formats[i] == format &&
 		    display->modifiers[i] == modifier)
@@ -38,6 +38,7 @@
 #include <xf86drmMode.h>
 
 #include "igt_fb.h"
+#include "igt_format_mod_index.h"
 #include "ioctl_wrappers.h"
 
 /* Low-level helpers with kmstest_ prefix */
@@ -536,6 +537,9 @@ struct _igt_display {
 	uint64_t *modifiers;
 	uint32_t *formats;
 	int format_mod_count;
+
+	/* format/modifier pairs of the planes, by index in planes */
+	struct igt_format_mod_index *format_mod_index;
 };
 
 typedef struct {
@@ -1148,6 +1152,8 @@ bool igt_connector_event_detected(struct udev_monitor *mon, uint32_t conn_id,
 void igt_flush_uevents(struct udev_monitor *mon);
 void igt_cleanup_uevents(struct udev_monitor *mon);
 
+void igt_parse_format_mod_blob(const struct drm_format_modifier_blob *blob_data,
+			       uint32_t **formats, uint64_t **modifiers, int *count);
 bool igt_display_has_format_mod(igt_display_t *display, uint32_t format, uint64_t modifier);
 bool igt_plane_has_format_mod(igt_plane_t *plane, uint32_t format, uint64_t modifier);
 
@@ -4,11 +4,14 @@
  * Copyright © 2023 Intel Corporation
  */
 
+#include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "igt_aux.h"
 #include "igt_core.h"
 #include "igt_ktap.h"
 #include "igt_list.h"
@@ -32,269 +35,671 @@ struct igt_ktap_results {
 	char *suite_name;
 	unsigned int case_count;
 	unsigned int case_last;
-	char *case_name;
+	char *case_name; /* our own copy, results get theirs */
 	unsigned int sub_last;
 	struct igt_list_head *results;
+
+	igt_ktap_result_fn result_fn;
+	void *result_data;
+
+	/* an incomplete line left over from the last igt_ktap_parse_buf() */
+	char *partial;
+	size_t partial_len, partial_size;
 };
 
-/**
- * igt_ktap_parse:
- *
- * This function parses a line of text for KTAP report data
- * and passes results back to IGT kunit layer.
- * https://kernel.org/doc/html/latest/dev-tools/ktap.html
+/*
+ * Every line is classified in a single pass over it, into one of the line
+ * types below plus the fields they carry. The grammar accepted is the one of
+ * the scanf() patterns this replaced: each indentation level is exactly four
+ * spaces, words are separated by one or more spaces and trailing whitespace
+ * is ignored.
  */
-int igt_ktap_parse(const char *buf, struct igt_ktap_results *ktap)
+enum ktap_line_type {
+	LINE_OTHER,
+	LINE_BAD_PLAN,
+	LINE_VERSION,
+	LINE_PLAN,
+	LINE_SUBTEST,
+	LINE_RESULT,
+};
+
+struct ktap_line {
+	enum ktap_line_type type;
+	unsigned int indent;
+	unsigned int n;
+	int code;
+	const char *name, *msg;
+	size_t name_len, msg_len;
+};
+
+struct ktap_cursor {
+	const char *p, *end;
+};
+
+static bool ktap_literal(struct ktap_cursor *c, const char *str)
 {
-	char *suite_name = NULL, *case_name = NULL, *msg = NULL;
-	struct igt_ktap_result *result;
-	int code = IGT_EXIT_INVALID;
-	unsigned int n, len;
-	char s[2];
-
-	/* KTAP report header */
-	if (igt_debug_on(sscanf(buf, "KTAP%*[ ]version%*[ ]%u %n",
-				&n, &len) == 1 && len == strlen(buf))) {
-		if (igt_debug_on(ktap->expect != KTAP_START))
-			return -EPROTO;
+	size_t len = strlen(str);
 
-		ktap->suite_count = 0;
-		ktap->expect = SUITE_COUNT;
+	if (c->end - c->p < len || memcmp(c->p, str, len))
+		return false;
+
+	c->p += len;
+	return true;
+}
+
+static bool ktap_char(struct ktap_cursor *c, char ch)
+{
+	if (c->p == c->end || *c->p != ch)
+		return false;
+
+	c->p++;
+	return true;
+}
+
+/* one or more spaces */
+static bool ktap_spaces(struct ktap_cursor *c)
+{
+	const char *start = c->p;
+
+	while (c->p < c->end && *c->p == ' ')
+		c->p++;
+
+	return c->p != start;
+}
+
+static void ktap_skip_whitespace(struct ktap_cursor *c)
+{
+	while (c->p < c->end && isspace((unsigned char)*c->p))
+		c->p++;
+}
+
+static bool ktap_uint(struct ktap_cursor *c, unsigned int *n)
+{
+	bool neg = false;
+	unsigned int v = 0;
+	const char *start;
+
+	ktap_skip_whitespace(c);
+	if (c->p < c->end && (*c->p == '+' || *c->p == '-'))
+		neg = *c->p++ == '-';
+
+	start = c->p;
+	while (c->p < c->end && isdigit((unsigned char)*c->p))
+		v = v * 10 + (*c->p++ - '0');
+	if (c->p == start)
+		return false;
+
+	*n = neg ? -v : v;
+	return true;
+}
+
+/* a word, up to the next whitespace */
+static bool ktap_word(struct ktap_cursor *c, const char **word, size_t *len)
+{
+	ktap_skip_whitespace(c);
+
+	*word = c->p;
+	while (c->p < c->end && !isspace((unsigned char)*c->p))
+		c->p++;
+	*len = c->p - *word;
+
+	return *len;
+}
+
+/* the rest of the line, which can't be empty */
+static bool ktap_rest(struct ktap_cursor *c, const char **rest, size_t *len)
+{
+	*rest = c->p;
+	while (c->p < c->end && *c->p != '\n')
+		c->p++;
+	*len = c->p - *rest;
+
+	return *len;
+}
+
+/* nothing but whitespace left */
+static bool ktap_eol(struct ktap_cursor *c)
+{
+	ktap_skip_whitespace(c);
+
+	return c->p == c->end;
+}
+
+static bool ktap_version(struct ktap_cursor *c)
+{
+	unsigned int n;
+
+	return ktap_literal(c, "KTAP") && ktap_spaces(c) &&
+	       ktap_literal(c, "version") && ktap_spaces(c) &&
+	       ktap_uint(c, &n) && ktap_eol(c);
+}
+
+static bool ktap_subtest(struct ktap_cursor *c, struct ktap_line *line)
+{
+	return ktap_char(c, '#') && ktap_spaces(c) &&
+	       ktap_literal(c, "Subtest:") && ktap_spaces(c) &&
+	       ktap_word(c, &line->name, &line->name_len) && ktap_eol(c);
+}
+
+/* "ok" or "not ok", with any number of spaces between the words if @loose */
+static bool ktap_ok(struct ktap_cursor *c, struct ktap_line *line, bool loose)
+{
+	if (ktap_literal(c, "ok")) {
+		line->code = IGT_EXIT_SUCCESS;
+		return true;
+	}
+
+	if (ktap_literal(c, "not") &&
+	    (loose ? ktap_spaces(c) : ktap_char(c, ' ')) &&
+	    ktap_literal(c, "ok")) {
+		line->code = IGT_EXIT_FAILURE;
+		return true;
+	}
+
+	return false;
+}
+
+/* "# comment", from the spaces before the hash */
+static bool ktap_comment(struct ktap_cursor *c, struct ktap_line *line)
+{
+	return ktap_spaces(c) && ktap_char(c, '#') && ktap_spaces(c) &&
+	       ktap_rest(c, &line->msg, &line->msg_len);
+}
+
+/* test case result: "ok|not ok <n> <name>[ # [SKIP][ <message>]]" */
+static bool ktap_case_result(struct ktap_cursor *c, struct ktap_line *line)
+{
+	struct ktap_cursor after_name;
+
+	if (!ktap_ok(c, line, false) || !ktap_spaces(c) ||
+	    !ktap_uint(c, &line->n) || !ktap_spaces(c) ||
+	    !ktap_word(c, &line->name, &line->name_len))
+		return false;
+
+	after_name = *c;
+	if (line->code == IGT_EXIT_SUCCESS &&
+	    ktap_spaces(c) && ktap_char(c, '#') && ktap_spaces(c) &&
+	    ktap_literal(c, "SKIP")) {
+		struct ktap_cursor after_skip = *c;
+
+		line->code = IGT_EXIT_SKIP;
+		if (ktap_eol(c))
+			return true;
+
+		*c = after_skip;
+		if (ktap_spaces(c) && ktap_rest(c, &line->msg, &line->msg_len))
+			return true;
+
+		line->code = IGT_EXIT_SUCCESS;
+	}
+
+	*c = after_name;
+	if (ktap_eol(c))
+		return true;
+
+	*c = after_name;
+	return ktap_comment(c, line);
+}
+
+/* parametrized subtest result: "ok|not ok <n> <description>" */
+static bool ktap_sub_result(struct ktap_cursor *c, struct ktap_line *line)
+{
+	const char *desc;
+
+	if (!ktap_ok(c, line, false) || !ktap_spaces(c) ||
+	    !ktap_uint(c, &line->n) || !ktap_spaces(c))
+		return false;
+
+	desc = c->p;
+	while (c->p < c->end && *c->p != '#' && *c->p != '\n')
+		c->p++;
+
+	/* a description, followed by a comment or the end of the line */
+	return c->p != desc && c->p != c->end;
+}
+
+/* test suite result: "ok|not ok <n> <name>[ #...]" */
+static bool ktap_suite_result(struct ktap_cursor *c, struct ktap_line *line)
+{
+	struct ktap_cursor after_name;
+
+	if (!ktap_ok(c, line, true) || !ktap_spaces(c) ||
+	    !ktap_uint(c, &line->n) || !ktap_spaces(c) ||
+	    !ktap_word(c, &line->name, &line->name_len))
+		return false;
+
+	after_name = *c;
+	if (ktap_eol(c))
+		return true;
+
+	*c = after_name;
+	return ktap_spaces(c) && ktap_char(c, '#');
+}
+
+static void ktap_classify(const char *buf, size_t len, struct ktap_line *line)
+{
+	struct ktap_cursor c = { buf, buf + len };
+	struct ktap_cursor start;
+
+	memset(line, 0, sizeof(*line));
+	line->code = IGT_EXIT_INVALID;
 
 	/* malformed TAP test plan? */
-	} else if (len = 0,
-		   igt_debug_on(sscanf(buf, " 1..%1[ ]", s) == 1)) {
+	ktap_skip_whitespace(&c);
+	if (ktap_literal(&c, "1..") && ktap_char(&c, ' ')) {
+		line->type = LINE_BAD_PLAN;
+		return;
+	}
+
+	c.p = buf;
+	while (c.p < c.end && *c.p == ' ')
+		c.p++;
+	line->indent = c.p - buf;
+	start = c;
+
+	switch (line->indent) {
+	case 0:
+		if (ktap_version(&c)) {
+			line->type = LINE_VERSION;
+		} else if (c = start, ktap_literal(&c, "1..") &&
+			   ktap_uint(&c, &line->n) && ktap_eol(&c)) {
+			line->type = LINE_PLAN;
+		} else if (c = start, ktap_suite_result(&c, line)) {
+			line->type = LINE_RESULT;
+		}
+		break;
+
+	case 4:
+		if (ktap_version(&c)) {
+			line->type = LINE_VERSION;
+		} else if (c = start, ktap_subtest(&c, line)) {
+			line->type = LINE_SUBTEST;
+		} else if (c = start, ktap_literal(&c, "1..") &&
+			   ktap_uint(&c, &line->n) && ktap_eol(&c)) {
+			line->type = LINE_PLAN;
+		} else if (c = start, ktap_case_result(&c, line)) {
+			line->type = LINE_RESULT;
+		}
+		break;
+
+	case 8:
+		if (ktap_version(&c)) {
+			line->type = LINE_VERSION;
+		} else if (c = start, ktap_subtest(&c, line)) {
+			line->type = LINE_SUBTEST;
+		} else if (c = start, ktap_sub_result(&c, line)) {
+			line->type = LINE_RESULT;
+			line->code = IGT_EXIT_INVALID;
+		}
+		break;
+	}
+}
+static int ktap_emit(struct igt_ktap_results *ktap, char *case_name,
+		     char *msg, int code)
+{
+	struct igt_ktap_result *result;
+
+	if (igt_debug_on((result = calloc(1, sizeof(*result)), !result))) {
+		free(case_name);
+		free(msg);
+		return -ENOMEM;
+	}
+
+	result->suite_name = ktap->suite_name;
+	result->case_name = case_name;
+	result->code = code;
+	result->msg = msg;
+
+	if (ktap->result_fn)
+		ktap->result_fn(result, ktap->result_data);
+	else
+		igt_list_add_tail(&result->link, ktap->results);
+
+	return -EINPROGRESS;
+}
+
+static int ktap_parse_case_name(struct igt_ktap_results *ktap,
+				const struct ktap_line *line)
+{
+	char *case_name;
+
+	if (igt_debug_on(ktap->expect != CASE_NAME))
+		return -EPROTO;
+
+	ktap->expect = SUB_RESULT;
+
+	if (igt_debug_on(!ktap->suite_name) ||
+	    igt_debug_on(ktap->case_last + 1 > ktap->case_count))
+		return -EPROTO;
+
+	case_name = strndup(line->name, line->name_len);
+	if (igt_debug_on(!case_name))
+		return -ENOMEM;
+
+	/* The emitted result owns case_name, keep a copy to match against */
+	free(ktap->case_name);
+	ktap->case_name = strdup(case_name);
+	if (igt_debug_on(!ktap->case_name)) {
+		free(case_name);
+		return -ENOMEM;
+	}
+
+	/* KTAP parametrized test case name */
+	return ktap_emit(ktap, case_name, NULL, IGT_EXIT_INVALID);
+}
+
+static int ktap_parse_case_result(struct igt_ktap_results *ktap,
+				  const struct ktap_line *line)
+{
+	char *case_name, *msg = NULL;
+
+	if (igt_debug_on(ktap->expect == SUB_RESULT) ||
+	    igt_debug_on(ktap->expect != CASE_RESULT) ||
+	    igt_debug_on(!ktap->suite_name) ||
+	    igt_debug_on(ktap->case_name &&
+			 (strlen(ktap->case_name) != line->name_len ||
+			  memcmp(line->name, ktap->case_name, line->name_len))) ||
+	    igt_debug_on(line->n > ktap->case_count) ||
+	    igt_debug_on(line->n != ++ktap->case_last))
+		return -EPROTO;
+
+	case_name = strndup(line->name, line->name_len);
+	if (line->msg)
+		msg = strndup(line->msg, line->msg_len);
+	if (igt_debug_on(!case_name || (line->msg && !msg))) {
+		free(case_name);
+		free(msg);
+		return -ENOMEM;
+	}
+
+	/* KTAP test case result */
+	free(ktap->case_name);
+	ktap->case_name = NULL;
+
+	/* last test case in a suite */
+	if (line->n == ktap->case_count)
+		ktap->expect = SUITE_RESULT;
+
+	return ktap_emit(ktap, case_name, msg, line->code);
+}
+
+static int ktap_parse_line(struct igt_ktap_results *ktap,
+			   const char *buf, size_t len)
+{
+	struct ktap_line line;
+	char *suite_name;
+
+	ktap_classify(buf, len, &line);
+
+	switch (line.type) {
+	case LINE_OTHER:
+	case LINE_BAD_PLAN:
 		return -EINPROGRESS;
 
-	/* valid test plan of a KTAP report */
-	} else if (igt_debug_on(sscanf(buf, "1..%u %n", &n, &len) == 1 &&
-				len == strlen(buf))) {
-		if (igt_debug_on(ktap->expect != SUITE_COUNT))
-			return -EPROTO;
+	case LINE_VERSION:
+		switch (line.indent) {
+		case 0: /* KTAP report header */
+			if (igt_debug_on(ktap->expect != KTAP_START))
+				return -EPROTO;
+
+			ktap->suite_count = 0;
+			ktap->expect = SUITE_COUNT;
+			break;
+
+		case 4: /* KTAP test suite header */
+			/*
+			 * TODO: drop the following workaround, which addresses a kernel
+			 * side issue of missing lines that provide top level KTAP
+			 * version and test suite plan, as soon as no longer needed.
+			 *
+			 * The issue has been fixed in v6.6-rc1, commit c95e7c05c139
+			 * ("kunit: Report the count of test suites in a module"),
+			 * but we still need this workaround for as long as LTS kernel
+			 * version 6.1, with DRM selftests already converted to Kunit,
+			 * but without that missing Kunit headers issue fixed, is used
+			 * by major Linux distributions.
+			 */
+			if (ktap->expect == KTAP_START) {
+				ktap->suite_count = 1;
+				ktap->suite_last = 0;
+				ktap->suite_name = NULL;
+				ktap->expect = SUITE_START;
+			}
+
+			if (igt_debug_on(ktap->expect != SUITE_START))
+				return -EPROTO;
+
+			ktap->expect = SUITE_NAME;
+			break;
+
+		case 8: /* KTAP parametrized test case header */
+			if (igt_debug_on(ktap->expect != CASE_RESULT))
+				return -EPROTO;
+
+			ktap->sub_last = 0;
+			ktap->expect = CASE_NAME;
+			break;
+		}
+		return -EINPROGRESS;
+
+	case LINE_PLAN:
+		if (line.indent == 0) {
+			/* valid test plan of a KTAP report */
+			if (igt_debug_on(ktap->expect != SUITE_COUNT))
+				return -EPROTO;
+
+			if (!line.n)
+				return 0;
 
-		if (!n)
-			return 0;
-
-		ktap->suite_count = n;
-		ktap->suite_last = 0;
-		ktap->suite_name = NULL;
-		ktap->expect = SUITE_START;
-
-	/* KTAP test suite header */
-	} else if (len = 0,
-		   igt_debug_on(sscanf(buf,
-				       "%*1[ ]%*1[ ]%*1[ ]%*1[ ]KTAP%*[ ]version%*[ ]%u %n",
-				       &n, &len) == 1 && len == strlen(buf))) {
-		/*
-		 * TODO: drop the following workaround, which addresses a kernel
-		 * side issue of missing lines that provide top level KTAP
-		 * version and test suite plan, as soon as no longer needed.
-		 *
-		 * The issue has been fixed in v6.6-rc1, commit c95e7c05c139
-		 * ("kunit: Report the count of test suites in a module"),
-		 * but we still need this workaround for as long as LTS kernel
-		 * version 6.1, with DRM selftests already converted to Kunit,
-		 * but without that missing Kunit headers issue fixed, is used
-		 * by major Linux distributions.
-		 */
-		if (ktap->expect == KTAP_START) {
-			ktap->suite_count = 1;
+			ktap->suite_count = line.n;
 			ktap->suite_last = 0;
 			ktap->suite_name = NULL;
 			ktap->expect = SUITE_START;
+		} else {
+			/* valid test plan of a KTAP test suite */
+			if (igt_debug_on(ktap->expect != CASE_COUNT))
+				return -EPROTO;
+
+			if (line.n) {
+				ktap->case_count = line.n;
+				ktap->case_last = 0;
+				free(ktap->case_name);
+				ktap->case_name = NULL;
+				ktap->expect = CASE_RESULT;
+			} else {
+				ktap->expect = SUITE_RESULT;
+			}
 		}
+		return -EINPROGRESS;
 
-		if (igt_debug_on(ktap->expect != SUITE_START))
-			return -EPROTO;
-
-		ktap->expect = SUITE_NAME;
+	case LINE_SUBTEST:
+		if (line.indent == 8)
+			return ktap_parse_case_name(ktap, &line);
 
-	/* KTAP test suite name */
-	} else if (len = 0,
-		   igt_debug_on(sscanf(buf,
-				       "%*1[ ]%*1[ ]%*1[ ]%*1[ ]#%*[ ]Subtest:%*[ ]%ms %n",
-				       &suite_name, &len) == 1 && len == strlen(buf))) {
+		/* KTAP test suite name */
 		if (igt_debug_on(ktap->expect != SUITE_NAME))
 			return -EPROTO;
 
+		suite_name = strndup(line.name, line.name_len);
+		if (igt_debug_on(!suite_name))
+			return -ENOMEM;
+
 		ktap->suite_name = suite_name;
-		suite_name = NULL;
 		ktap->case_count = 0;
 		ktap->expect = CASE_COUNT;
+		return -EINPROGRESS;
 
-	/* valid test plan of a KTAP test suite */
-	} else if (len = 0, free(suite_name), suite_name = NULL,
-		   igt_debug_on(sscanf(buf,
-				       "%*1[ ]%*1[ ]%*1[ ]%*1[ ]1..%u %n",
-				       &n, &len) == 1 && len == strlen(buf))) {
-		if (igt_debug_on(ktap->expect != CASE_COUNT))
-			return -EPROTO;
-
-		if (n) {
-			ktap->case_count = n;
-			ktap->case_last = 0;
-			ktap->case_name = NULL;
-			ktap->expect = CASE_RESULT;
-		} else {
-			ktap->expect = SUITE_RESULT;
-		}
-
-	/* KTAP parametrized test case header */
-	} else if (len = 0,
-		   igt_debug_on(sscanf(buf,
-				       "%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]KTAP%*[ ]version%*[ ]%u %n",
-				       &n, &len) == 1 && len == strlen(buf))) {
-		if (igt_debug_on(ktap->expect != CASE_RESULT))
-			return -EPROTO;
-
-		ktap->sub_last = 0;
-		ktap->expect = CASE_NAME;
+	case LINE_RESULT:
+		break;
+	}
 
-	/* KTAP parametrized test case name */
-	} else if (len = 0,
-		   igt_debug_on(sscanf(buf,
-				       "%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]#%*[ ]Subtest:%*[ ]%ms %n",
-				       &case_name, &len) == 1 && len == strlen(buf))) {
-		if (igt_debug_on(ktap->expect != CASE_NAME))
-			return -EPROTO;
+	switch (line.indent) {
+	case 8:
+		/* KTAP parametrized subtest result */
 
-		n = ktap->case_last + 1;
-		ktap->expect = SUB_RESULT;
-
-	/* KTAP parametrized subtest result */
-	} else if (len = 0, free(case_name), case_name = NULL,
-		   igt_debug_on(sscanf(buf,
-				       "%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]ok%*[ ]%u%*[ ]%*[^#\n]%1[#\n]",
-				       &n, s) == 2) ||
-		   igt_debug_on(sscanf(buf,
-				       "%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]%*1[ ]not%*1[ ]ok%*[ ]%u%*[ ]%*[^#\n]%1[#\n]",
-				       &n, s) == 2)) {
 		/* at lease one result of a parametrised subtest expected */
 		if (igt_debug_on(ktap->expect == SUB_RESULT &&
 				 ktap->sub_last == 0))
 			ktap->expect = CASE_RESULT;
 
 		if (igt_debug_on(ktap->expect != CASE_RESULT) ||
-		    igt_debug_on(n != ++ktap->sub_last))
+		    igt_debug_on(line.n != ++ktap->sub_last))
 			return -EPROTO;
 
-	/* KTAP test case skip result */
-	} else if ((igt_debug_on(sscanf(buf,
-					"%*1[ ]%*1[ ]%*1[ ]%*1[ ]ok%*[ ]%u%*[ ]%ms%*[ ]#%*[ ]SKIP %n",
-					&n, &case_name, &len) == 2 &&
-				 len == strlen(buf))) ||
-		   (len = 0, free(case_name), case_name = NULL,
-		    igt_debug_on(sscanf(buf,
-					"%*1[ ]%*1[ ]%*1[ ]%*1[ ]ok%*[ ]%u%*[ ]%ms%*[ ]#%*[ ]SKIP%*[ ]%m[^\n]",
-					&n, &case_name, &msg) == 3))) {
-		code = IGT_EXIT_SKIP;
-
-	/* KTAP test case pass result */
-	} else if ((free(case_name), case_name = NULL, free(msg), msg = NULL,
-		    igt_debug_on(sscanf(buf,
-					"%*1[ ]%*1[ ]%*1[ ]%*1[ ]ok%*[ ]%u%*[ ]%ms %n",
-					&n, &case_name, &len) == 2 &&
-				 len == strlen(buf))) ||
-		   (len = 0, free(case_name), case_name = NULL,
-		    igt_debug_on(sscanf(buf,
-					"%*1[ ]%*1[ ]%*1[ ]%*1[ ]ok%*[ ]%u%*[ ]%ms%*[ ]#%*[ ]%m[^\n]",
-					&n, &case_name, &msg) == 3))) {
-		code = IGT_EXIT_SUCCESS;
-
-	/* KTAP test case fail result */
-	} else if ((free(case_name), case_name = NULL, free(msg), msg = NULL,
-		    igt_debug_on(sscanf(buf,
-					"%*1[ ]%*1[ ]%*1[ ]%*1[ ]not%*1[ ]ok%*[ ]%u%*[ ]%ms %n",
-					&n, &case_name, &len) == 2 &&
-				 len == strlen(buf))) ||
-		   (len = 0, free(case_name), case_name = NULL,
-		    igt_debug_on(sscanf(buf,
-					"%*1[ ]%*1[ ]%*1[ ]%*1[ ]not%*1[ ]ok%*[ ]%u%*[ ]%ms%*[ ]#%*[ ]%m[^\n]",
-					&n, &case_name, &msg) == 3))) {
-		code = IGT_EXIT_FAILURE;
+		return -EINPROGRESS;
+
+	case 4:
+		return ktap_parse_case_result(ktap, &line);
+	}
 
 	/* KTAP test suite result */
-	} else if ((free(case_name), free(msg),
-		    igt_debug_on(sscanf(buf, "ok%*[ ]%u%*[ ]%ms %n",
-					&n, &suite_name, &len) == 2 &&
-				 len == strlen(buf))) ||
-		   (len = 0, free(suite_name), suite_name = NULL,
-		    igt_debug_on(sscanf(buf, "ok%*[ ]%u%*[ ]%ms%*[ ]%1[#]",
-					&n, &suite_name, s) == 3)) ||
-		   (free(suite_name), suite_name = NULL,
-		    igt_debug_on(sscanf(buf,
-					"not%*[ ]ok%*[ ]%u%*[ ]%ms %n",
-					&n, &suite_name, &len) == 2 &&
-				 len == strlen(buf))) ||
-		   (len = 0, free(suite_name), suite_name = NULL,
-		    igt_debug_on(sscanf(buf,
-					"not%*[ ]ok%*[ ]%u%*[ ]%ms%*[ ]%1[#]",
-					&n, &suite_name, s) == 3))) {
-		if (igt_debug_on(ktap->expect != SUITE_RESULT) ||
-		    igt_debug_on(strcmp(suite_name, ktap->suite_name)) ||
-		    igt_debug_on(n != ++ktap->suite_last) ||
-		    igt_debug_on(n > ktap->suite_count)) {
-			free(suite_name);
-			return -EPROTO;
-		}
-		free(suite_name);
+	if (igt_debug_on(ktap->expect != SUITE_RESULT) ||
+	    igt_debug_on(strlen(ktap->suite_name) != line.name_len ||
+			 memcmp(line.name, ktap->suite_name, line.name_len)) ||
+	    igt_debug_on(line.n != ++ktap->suite_last) ||
+	    igt_debug_on(line.n > ktap->suite_count))
+		return -EPROTO;
 
-		/* last test suite? */
-		if (igt_debug_on(n == ktap->suite_count))
-			return 0;
+	/* last test suite? */
+	if (igt_debug_on(line.n == ktap->suite_count))
+		return 0;
 
-		ktap->suite_name = NULL;
-		ktap->expect = SUITE_START;
+	ktap->suite_name = NULL;
+	ktap->expect = SUITE_START;
 
-	} else {
-		return -EINPROGRESS;
-	}
+	return -EINPROGRESS;
+}
 
-	/* neither a test case name nor result */
-	if (ktap->expect != SUB_RESULT && code == IGT_EXIT_INVALID)
-		return -EINPROGRESS;
+/**
+ * igt_ktap_parse:
+ *
+ * This function parses a line of text for KTAP report data
+ * and passes results back to IGT kunit layer.
+ * https://kernel.org/doc/html/latest/dev-tools/ktap.html
+ */
+int igt_ktap_parse(const char *buf, struct igt_ktap_results *ktap)
+{
+	return ktap_parse_line(ktap, buf, strlen(buf));
+}
 
-	if (igt_debug_on(ktap->expect == SUB_RESULT &&
-			 code != IGT_EXIT_INVALID) ||
-	    igt_debug_on(code != IGT_EXIT_INVALID &&
-			 ktap->expect != CASE_RESULT) ||
-	    igt_debug_on(!ktap->suite_name) || igt_debug_on(!case_name) ||
-	    igt_debug_on(ktap->expect == CASE_RESULT && ktap->case_name &&
-			 strcmp(case_name, ktap->case_name)) ||
-	    igt_debug_on(n > ktap->case_count) ||
-	    igt_debug_on(n != (ktap->expect == SUB_RESULT ?
-			       ktap->case_last + 1: ++ktap->case_last))) {
-		free(case_name);
-		free(msg);
-		return -EPROTO;
-	}
+/**
+ * igt_ktap_parse_buf:
+ * @ktap: the parser state
+ * @buf: a chunk of a KTAP report
+ * @len: length of @buf
+ *
+ * Parses the lines of a KTAP report as it arrives, in chunks of any size.
+ * Complete lines are parsed in place, only a line split across chunks is
+ * copied until the rest of it arrives.
+ *
+ * Returns: -EINPROGRESS while more of the report is expected, 0 once it is
+ * complete or a negative error code, as igt_ktap_parse().
+ */
+int igt_ktap_parse_buf(struct igt_ktap_results *ktap, const char *buf, size_t len)
+{
+	const char *end = buf + len;
+	int err;
 
-	if (ktap->expect == SUB_RESULT) {
-		/* KTAP parametrized test case name */
-		ktap->case_name = case_name;
+	while (buf < end) {
+		const char *eol = memchr(buf, '\n', end - buf);
+		size_t n = eol ? eol + 1 - buf : end - buf;
+
+		if (!ktap->partial_len && eol) {
+			err = ktap_parse_line(ktap, buf, n);
+		} else {
+			if (ktap->partial_len + n > ktap->partial_size) {
+				size_t size = max(2 * ktap->partial_size,
+						  ktap->partial_len + n);
+				char *partial = realloc(ktap->partial, size);
+
+				if (igt_debug_on(!partial))
+					return -ENOMEM;
+
+				ktap->partial = partial;
+				ktap->partial_size = size;
+			}
+			memcpy(ktap->partial + ktap->partial_len, buf, n);
+			ktap->partial_len += n;
+
+			if (!eol)
+				return -EINPROGRESS;
+
+			err = ktap_parse_line(ktap, ktap->partial,
+					      ktap->partial_len);
+			ktap->partial_len = 0;
+		}
 
-	} else {
-		/* KTAP test case result */
-		ktap->case_name = NULL;
+		if (err != -EINPROGRESS)
+			return err;
 
-		/* last test case in a suite */
-		if (n == ktap->case_count)
-			ktap->expect = SUITE_RESULT;
+		buf += n;
 	}
 
-	if (igt_debug_on((result = calloc(1, sizeof(*result)), !result))) {
-		free(case_name);
-		free(msg);
+	return -EINPROGRESS;
+}
+
+/**
+ * igt_ktap_read:
+ * @fd: file to read the KTAP report from
+ * @ktap: the parser state
+ *
+ * Reads and parses a KTAP report in large chunks, until it is complete or
+ * the end of @fd.
+ *
+ * Returns: 0 if the report is complete, -EINPROGRESS if the file ended
+ * before that, or a negative error code.
+ */
+int igt_ktap_read(int fd, struct igt_ktap_results *ktap)
+{
+	const size_t size = 64 << 10;
+	char *buf = malloc(size);
+	int err = -EINPROGRESS;
+	ssize_t len;
+
+	if (igt_debug_on(!buf))
 		return -ENOMEM;
+
+	while (err == -EINPROGRESS) {
+		len = read(fd, buf, size);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (igt_debug_on(len < 0)) {
+			err = -errno;
+			break;
+		}
+		if (!len)
+			break;
+
+		err = igt_ktap_parse_buf(ktap, buf, len);
 	}
 
-	result->suite_name = ktap->suite_name;
-	result->case_name = case_name;
-	result->code = code;
-	result->msg = msg;
-	igt_list_add_tail(&result->link, ktap->results);
+	/* the last line may lack its newline */
+	if (err == -EINPROGRESS && ktap->partial_len) {
+		err = ktap_parse_line(ktap, ktap->partial, ktap->partial_len);
+		ktap->partial_len = 0;
+	}
 
-	return -EINPROGRESS;
+	free(buf);
+
+	return err;
+}
+
+/**
+ * igt_ktap_set_result_fn:
+ * @ktap: the parser state
+ * @fn: called with each result as soon as it is parsed
+ * @data: passed to @fn
+ *
+ * Hands the results to @fn instead of adding them to the list passed to
+ * igt_ktap_alloc(). @fn takes ownership of the result, its case name and
+ * message. The suite name is shared by all results of a suite, it may be
+ * freed once a result from another suite arrives, or after parsing.
+ */
+void igt_ktap_set_result_fn(struct igt_ktap_results *ktap,
+			    igt_ktap_result_fn fn, void *data)
+{
+	ktap->result_fn = fn;
+	ktap->result_data = data;
 }
 
 struct igt_ktap_results *igt_ktap_alloc(struct igt_list_head *results)
@@ -312,6 +717,10 @@ struct igt_ktap_results *igt_ktap_alloc(struct igt_list_head *results)
 
 void igt_ktap_free(struct igt_ktap_results **ktap)
 {
+	if (*ktap) {
+		free((*ktap)->case_name);
+		free((*ktap)->partial);
+	}
 	free(*ktap);
 	*ktap = NULL;
 }
@@ -27,6 +27,8 @@
 
 #define BUF_LEN 4096
 
+#include <stddef.h>
+
 #include "igt_list.h"
 
 struct igt_ktap_result {
@@ -39,8 +41,14 @@ struct igt_ktap_result {
 
 struct igt_ktap_results;
 
+typedef void (*igt_ktap_result_fn)(struct igt_ktap_result *result, void *data);
+
 struct igt_ktap_results *igt_ktap_alloc(struct igt_list_head *results);
+void igt_ktap_set_result_fn(struct igt_ktap_results *ktap,
+			    igt_ktap_result_fn fn, void *data);
 int igt_ktap_parse(const char *buf, struct igt_ktap_results *ktap);
+int igt_ktap_parse_buf(struct igt_ktap_results *ktap, const char *buf, size_t len);
+int igt_ktap_read(int fd, struct igt_ktap_results *ktap);
 void igt_ktap_free(struct igt_ktap_results **ktap);
 
 #endif /* IGT_KTAP_H */
@@ -0,0 +1,470 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+/**
+ * SECTION:igt_power_sampler
+ * @short_description: Periodic sampling of several energy counters
+ * @title: Power sampler
+ * @include: igt_power_sampler.h
+ *
+ * Where igt_power_get_energy() reads one counter when asked to, a sampler
+ * reads all of its domains together from a thread, at a fixed period. The
+ * RAPL domains are opened once as a single perf group, read with one
+ * read(), and the hwmon attributes are kept open and read with pread(),
+ * so that the samples of all domains are taken within a few microseconds
+ * of each other.
+ *
+ * The thread hands the raw samples over through a single producer, single
+ * consumer ring. igt_power_sampler_update() consumes them into the energy
+ * of each domain, correcting counter wraparounds, and the power over each
+ * period, for percentiles:
+ *
+ * |[<!-- language="c" -->
+ *	s = igt_power_sampler_create(1000, 4096);
+ *	gpu = igt_power_sampler_add_device(s, fd);
+ *	pkg = igt_power_sampler_add_rapl(s, "pkg");
+ *	igt_power_sampler_start(s);
+ *	... workload, calling igt_power_sampler_update() at times ...
+ *	igt_power_sampler_stop(s);
+ *
+ *	igt_info("gpu: %.1fmJ, p99 %.1fmW\n",
+ *		 igt_power_sampler_get_mJ(s, gpu),
+ *		 igt_stats_get_percentile(igt_power_sampler_get_mW(s, gpu), 99));
+ * ]|
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "igt_core.h"
+#include "igt_hwmon.h"
+#include "igt_perf.h"
+#include "igt_power.h"
+#include "igt_power_sampler.h"
+#include "igt_sysfs.h"
+#include "intel_common.h"
+
+struct sampler_domain {
+	int fd;			/* hwmon attribute or perf event */
+	int slot;		/* in the RAPL group read, -1 for hwmon */
+	uint64_t mask;		/* counter width */
+	double scale;		/* uJ per counter unit */
+
+	double energy;		/* uJ */
+	igt_stats_t power;	/* mW */
+};
+
+struct igt_power_sampler {
+	struct sampler_domain domain[IGT_POWER_SAMPLER_MAX_DOMAINS];
+	int nr_domains;
+
+	int rapl_group;
+	uint64_t rapl_type;
+	int nr_rapl;
+
+	uint64_t period;
+	pthread_t thread;
+	bool running;
+	bool stop;
+
+	/* Written by the sampling thread only */
+	struct igt_power_sampler_sample *ring;
+	unsigned int mask;
+	unsigned int head;
+	uint64_t dropped;
+
+	/* Written by the consumer only */
+	unsigned int tail;
+	struct igt_power_sampler_sample last;
+	bool has_last;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/**
+ * igt_power_sampler_create:
+ * @period_us: sampling period
+ * @ring_size: samples kept until igt_power_sampler_update(), rounded up to
+ * a power of two
+ *
+ * Returns: a sampler without any domain yet.
+ */
+struct igt_power_sampler *igt_power_sampler_create(unsigned int period_us,
+						   unsigned int ring_size)
+{
+	struct igt_power_sampler *s;
+	unsigned int size = 2;
+
+	while (size < ring_size)
+		size *= 2;
+
+	s = calloc(1, sizeof(*s));
+	igt_assert(s);
+
+	s->ring = calloc(size, sizeof(*s->ring));
+	igt_assert(s->ring);
+
+	s->mask = size - 1;
+	s->period = period_us * 1000ull;
+	s->rapl_group = -1;
+
+	return s;
+}
+
+/**
+ * igt_power_sampler_destroy:
+ * @s: sampler, stopped or not
+ */
+void igt_power_sampler_destroy(struct igt_power_sampler *s)
+{
+	igt_power_sampler_stop(s);
+
+	/* The RAPL group leader is one of them */
+	for (int i = 0; i < s->nr_domains; i++) {
+		close(s->domain[i].fd);
+		igt_stats_fini(&s->domain[i].power);
+	}
+
+	free(s->ring);
+	free(s);
+}
+
+static int add_domain(struct igt_power_sampler *s, int fd, int slot,
+		      unsigned int bits, double scale)
+{
+	struct sampler_domain *d;
+
+	igt_assert(!s->running);
+	igt_assert(s->nr_domains < IGT_POWER_SAMPLER_MAX_DOMAINS);
+
+	d = &s->domain[s->nr_domains];
+	d->fd = fd;
+	d->slot = slot;
+	d->mask = bits >= 64 ? ~0ull : (1ull << bits) - 1;
+	d->scale = scale;
+	d->energy = 0;
+	igt_stats_init(&d->power);
+	igt_stats_set_population(&d->power, true);
+
+	return s->nr_domains++;
+}
+
+/**
+ * igt_power_sampler_add_rapl:
+ * @s: sampler
+ * @domain: RAPL domain, as for igt_power_open()
+ *
+ * Returns: the index of the domain in the samples, or a negative errno.
+ */
+int igt_power_sampler_add_rapl(struct igt_power_sampler *s, const char *domain)
+{
+	struct igt_power p;
+	int err, fd;
+
+	/* Only for the event and its scale */
+	err = igt_power_open(-1, &p, domain);
+	if (err)
+		return err;
+	igt_power_close(&p);
+
+	if (s->rapl_group >= 0 && p.rapl.type != s->rapl_type)
+		return -EINVAL;
+
+	fd = igt_perf_open_group(p.rapl.type, p.rapl.power, s->rapl_group);
+	if (fd < 0)
+		return -errno;
+
+	if (s->rapl_group < 0) {
+		s->rapl_group = fd;
+		s->rapl_type = p.rapl.type;
+	}
+
+	/* Only the group leader is read, perf counters are 64 bit */
+	return add_domain(s, fd, s->nr_rapl++, 64, p.rapl.scale * 1e6);
+}
+
+/**
+ * igt_power_sampler_add_hwmon:
+ * @s: sampler
+ * @dir: hwmon directory
+ * @attr: energy attribute, in uJ, like "energy1_input"
+ * @bits: width of the counter, for wraparounds
+ *
+ * Returns: the index of the domain in the samples, or a negative errno.
+ */
+int igt_power_sampler_add_hwmon(struct igt_power_sampler *s, int dir,
+				const char *attr, unsigned int bits)
+{
+	int fd;
+
+	fd = openat(dir, attr, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+
+	return add_domain(s, fd, -1, bits, 1.);
+}
+
+/**
+ * igt_power_sampler_add_device:
+ * @s: sampler
+ * @fd: device fd
+ *
+ * Adds the energy of the GPU, from hwmon for discrete devices and from
+ * RAPL otherwise, as igt_power_open() does.
+ *
+ * Returns: the index of the domain in the samples, or a negative errno.
+ */
+int igt_power_sampler_add_device(struct igt_power_sampler *s, int fd)
+{
+	int dir, ret;
+
+	if (!is_intel_dgfx(fd))
+		return igt_power_sampler_add_rapl(s, "gpu");
+
+	dir = igt_hwmon_open(fd);
+	if (dir < 0)
+		return -ENOENT;
+
+	ret = igt_power_sampler_add_hwmon(s, dir, "energy1_input", 64);
+	close(dir);
+
+	return ret;
+}
+
+static bool read_hwmon(int fd, uint64_t *value)
+{
+	char buf[32];
+	ssize_t len;
+
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (len <= 0)
+		return false;
+	buf[len] = '\0';
+
+	*value = strtoull(buf, NULL, 0);
+	return true;
+}
+
+/**
+ * igt_power_sampler_sample:
+ * @s: sampler
+ *
+ * Takes a sample of all the domains now, as the sampling thread does at
+ * each period. Not to be called while the thread runs. The sample is
+ * dropped if the ring is full or a counter cannot be read.
+ */
+void igt_power_sampler_sample(struct igt_power_sampler *s)
+{
+	uint64_t rapl[2 + IGT_POWER_SAMPLER_MAX_DOMAINS];
+	struct igt_power_sampler_sample *sample;
+	unsigned int head = s->head;
+
+	if (head - __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE) > s->mask)
+		goto drop;
+
+	sample = &s->ring[head & s->mask];
+	sample->time = now_ns();
+
+	/* nr, time enabled, then the values in the order they were added */
+	if (s->rapl_group >= 0 &&
+	    read(s->rapl_group, rapl, (2 + s->nr_rapl) * sizeof(rapl[0])) < 0)
+		goto drop;
+
+	for (int i = 0; i < s->nr_domains; i++) {
+		const struct sampler_domain *d = &s->domain[i];
+
+		if (d->slot >= 0)
+			sample->counter[i] = rapl[2 + d->slot];
+		else if (!read_hwmon(d->fd, &sample->counter[i]))
+			goto drop;
+	}
+
+	__atomic_store_n(&s->head, head + 1, __ATOMIC_RELEASE);
+	return;
+
+drop:
+	__atomic_fetch_add(&s->dropped, 1, __ATOMIC_RELAXED);
+}
+
+static void *sampler_thread(void *data)
+{
+	struct igt_power_sampler *s = data;
+	uint64_t next = now_ns();
+
+	while (!__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) {
+		struct timespec ts;
+		uint64_t now;
+
+		igt_power_sampler_sample(s);
+
+		/*
+		 * Keep to a fixed grid, with absolute deadlines, but skip the
+		 * periods already missed rather than catching up.
+		 */
+		next += s->period;
+		now = now_ns();
+		if (next < now)
+			next = now;
+
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+			;
+	}
+
+	return NULL;
+}
+
+/**
+ * igt_power_sampler_start:
+ * @s: sampler
+ *
+ * Starts sampling all the domains added so far from a thread.
+ */
+void igt_power_sampler_start(struct igt_power_sampler *s)
+{
+	igt_assert(!s->running);
+
+	s->stop = false;
+	igt_assert_eq(pthread_create(&s->thread, NULL, sampler_thread, s), 0);
+	s->running = true;
+}
+
+/**
+ * igt_power_sampler_stop:
+ * @s: sampler
+ *
+ * Stops the sampling thread. The samples it took are left in the ring, for
+ * igt_power_sampler_update() or igt_power_sampler_read().
+ */
+void igt_power_sampler_stop(struct igt_power_sampler *s)
+{
+	if (!s->running)
+		return;
+
+	__atomic_store_n(&s->stop, true, __ATOMIC_RELEASE);
+	pthread_join(s->thread, NULL);
+	s->running = false;
+}
+
+/**
+ * igt_power_sampler_read:
+ * @s: sampler
+ * @samples: array to copy the samples to
+ * @count: size of @samples
+ *
+ * Consumes up to @count raw samples from the ring, without accounting for
+ * them in the energy and power of the domains. Use either this or
+ * igt_power_sampler_update().
+ *
+ * Returns: the number of samples copied.
+ */
+unsigned int igt_power_sampler_read(struct igt_power_sampler *s,
+				    struct igt_power_sampler_sample *samples,
+				    unsigned int count)
+{
+	unsigned int head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+	unsigned int n;
+
+	for (n = 0; n < count && s->tail + n != head; n++)
+		samples[n] = s->ring[(s->tail + n) & s->mask];
+
+	__atomic_store_n(&s->tail, s->tail + n, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+/**
+ * igt_power_sampler_update:
+ * @s: sampler
+ *
+ * Consumes the samples taken since the last update, adding the energy of
+ * each period to its domain, and its average power to the power
+ * statistics of the domain.
+ *
+ * Returns: the number of samples consumed.
+ */
+unsigned int igt_power_sampler_update(struct igt_power_sampler *s)
+{
+	struct igt_power_sampler_sample sample;
+	unsigned int count = 0;
+
+	while (igt_power_sampler_read(s, &sample, 1)) {
+		uint64_t dt = sample.time - s->last.time;
+
+		count++;
+
+		if (s->has_last && dt) {
+			for (int i = 0; i < s->nr_domains; i++) {
+				struct sampler_domain *d = &s->domain[i];
+				double uJ;
+
+				/* Modular arithmetic takes care of one wraparound */
+				uJ = ((sample.counter[i] - s->last.counter[i]) & d->mask) *
+					d->scale;
+
+				d->energy += uJ;
+				igt_stats_push_float(&d->power, uJ * 1e6 / dt);
+			}
+		}
+
+		s->last = sample;
+		s->has_last = true;
+	}
+
+	return count;
+}
+
+/**
+ * igt_power_sampler_get_mJ:
+ * @s: sampler
+ * @domain: index of the domain
+ *
+ * Returns: the energy used in @domain over the samples consumed so far.
+ */
+double igt_power_sampler_get_mJ(struct igt_power_sampler *s, int domain)
+{
+	igt_assert(domain >= 0 && domain < s->nr_domains);
+
+	return s->domain[domain].energy * 1e-3;
+}
+
+/**
+ * igt_power_sampler_get_mW:
+ * @s: sampler
+ * @domain: index of the domain
+ *
+ * Returns: the average power of @domain over each sampling period, for
+ * igt_stats_get_percentile() and the like.
+ */
+igt_stats_t *igt_power_sampler_get_mW(struct igt_power_sampler *s, int domain)
+{
+	igt_assert(domain >= 0 && domain < s->nr_domains);
+
+	return &s->domain[domain].power;
+}
+
+/**
+ * igt_power_sampler_dropped:
+ * @s: sampler
+ *
+ * Returns: the number of samples dropped, mostly as the ring was full.
+ */
+uint64_t igt_power_sampler_dropped(struct igt_power_sampler *s)
+{
+	return __atomic_load_n(&s->dropped, __ATOMIC_RELAXED);
+}
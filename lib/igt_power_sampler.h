@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#ifndef IGT_POWER_SAMPLER_H
+#define IGT_POWER_SAMPLER_H
+
+#include <stdint.h>
+
+#include "igt_stats.h"
+
+#define IGT_POWER_SAMPLER_MAX_DOMAINS 8
+
+/**
+ * igt_power_sampler_sample:
+ * @time: CLOCK_MONOTONIC timestamp, in ns
+ * @counter: raw energy counter of each domain
+ */
+struct igt_power_sampler_sample {
+	uint64_t time;
+	uint64_t counter[IGT_POWER_SAMPLER_MAX_DOMAINS];
+};
+
+struct igt_power_sampler;
+
+struct igt_power_sampler *igt_power_sampler_create(unsigned int period_us,
+						   unsigned int ring_size);
+void igt_power_sampler_destroy(struct igt_power_sampler *s);
+
+int igt_power_sampler_add_rapl(struct igt_power_sampler *s, const char *domain);
+int igt_power_sampler_add_hwmon(struct igt_power_sampler *s, int dir,
+				const char *attr, unsigned int bits);
+int igt_power_sampler_add_device(struct igt_power_sampler *s, int fd);
+
+void igt_power_sampler_start(struct igt_power_sampler *s);
+void igt_power_sampler_stop(struct igt_power_sampler *s);
+void igt_power_sampler_sample(struct igt_power_sampler *s);
+
+unsigned int igt_power_sampler_update(struct igt_power_sampler *s);
+unsigned int igt_power_sampler_read(struct igt_power_sampler *s,
+				    struct igt_power_sampler_sample *samples,
+				    unsigned int count);
+
+double igt_power_sampler_get_mJ(struct igt_power_sampler *s, int domain);
+igt_stats_t *igt_power_sampler_get_mW(struct igt_power_sampler *s, int domain);
+uint64_t igt_power_sampler_dropped(struct igt_power_sampler *s);
+
+#endif /* IGT_POWER_SAMPLER_H */
@@ -1,10 +1,23 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
 #include "igt_rand.h"
+#include "igt_x86.h"
 
 /**
  * SECTION:igt_rand
  * @short_description: Random numbers helper library
  * @title: Random
  * @include: igt_rand.h
+ *
+ * Besides the small sequential generators, igt_rand_fill() and
+ * igt_rand_verify() fill and check buffers with a counter based stream:
+ * every 32 bit word of the stream is a hash of the seed and of its index.
+ * Any part of the stream can be regenerated on its own, so that a range of
+ * a buffer can be checked without keeping a reference copy of it, and the
+ * words are computed in vectors and by several threads for big buffers.
  */
 
 static uint32_t global = 0x12345678;
@@ -35,3 +48,360 @@ uint32_t hars_petruska_f54_1_random_unsafe(void)
 {
 	return hars_petruska_f54_1_random(&global);
 }
+
+/*
+ * The word of index i of the stream of @seed is
+ * mix32(mix32(lower 32 bits of i ^ k0) ^ upper 32 bits of i ^ k1),
+ * mix32() being a 32 bit finalizer with good avalanche and k0, k1 derived
+ * from the seed. 8 words are computed at once, in AVX2 registers when
+ * available.
+ */
+struct rand_key {
+	uint32_t k0, k1;
+};
+
+typedef uint32_t rand_v8 __attribute__((vector_size(32)));
+
+#define RAND_LANES 8
+#define RAND_THREAD_MIN (4 << 20)
+#define RAND_MAX_THREADS 64
+
+static inline uint32_t mix32(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+
+	return x;
+}
+
+static struct rand_key rand_key(uint64_t seed)
+{
+	struct rand_key key;
+
+	key.k0 = mix32((uint32_t)seed ^ 0x9e3779b9);
+	key.k1 = mix32((uint32_t)(seed >> 32) ^ key.k0 ^ 0x85ebca6b);
+
+	return key;
+}
+
+static inline uint32_t rand_word(const struct rand_key *key, uint64_t index)
+{
+	return mix32(mix32((uint32_t)index ^ key->k0) ^
+		     (uint32_t)(index >> 32) ^ key->k1);
+}
+
+static inline __attribute__((always_inline)) void
+rand_block(rand_v8 *out, const struct rand_key *key, uint64_t index)
+{
+	const rand_v8 lanes = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	uint32_t lo = index, hi = index >> 32;
+	rand_v8 x = lanes + lo;
+
+	/* Lanes past a wrap of the lower half have the next upper half */
+	rand_v8 y = (rand_v8)(x < lo) & 1;
+
+	x ^= key->k0;
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+
+	x ^= (y + hi) ^ key->k1;
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+
+	*out = x;
+}
+
+/* Fills @count words of @dst, with any alignment, from word @index on */
+static inline __attribute__((always_inline)) void
+fill_words(void *dst, size_t count, const struct rand_key *key, uint64_t index)
+{
+	char *ptr = dst;
+	size_t i = 0;
+
+	for (; i + RAND_LANES <= count; i += RAND_LANES) {
+		rand_v8 x;
+
+		rand_block(&x, key, index + i);
+		memcpy(ptr + i * 4, &x, sizeof(x));
+	}
+
+	for (; i < count; i++) {
+		uint32_t x = rand_word(key, index + i);
+
+		memcpy(ptr + i * 4, &x, sizeof(x));
+	}
+}
+
+/* Returns the first of the @count words of @src not matching, or @count */
+static inline __attribute__((always_inline)) size_t
+verify_words(const void *src, size_t count, const struct rand_key *key,
+	     uint64_t index)
+{
+	const char *ptr = src;
+	size_t i = 0;
+
+	for (; i + RAND_LANES <= count; i += RAND_LANES) {
+		rand_v8 x, y;
+		uint64_t diff[4];
+
+		rand_block(&x, key, index + i);
+		memcpy(&y, ptr + i * 4, sizeof(y));
+		x ^= y;
+		memcpy(diff, &x, sizeof(diff));
+		if (diff[0] | diff[1] | diff[2] | diff[3])
+			break;
+	}
+
+	for (; i < count; i++) {
+		uint32_t x;
+
+		memcpy(&x, ptr + i * 4, sizeof(x));
+		if (x != rand_word(key, index + i))
+			return i;
+	}
+
+	return count;
+}
+
+static void fill_words_generic(void *dst, size_t count,
+			       const struct rand_key *key, uint64_t index)
+{
+	fill_words(dst, count, key, index);
+}
+
+static size_t verify_words_generic(const void *src, size_t count,
+				   const struct rand_key *key, uint64_t index)
+{
+	return verify_words(src, count, key, index);
+}
+
+#if defined(__x86_64__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+static void fill_words_avx2(void *dst, size_t count,
+			    const struct rand_key *key, uint64_t index)
+{
+	fill_words(dst, count, key, index);
+}
+
+static size_t verify_words_avx2(const void *src, size_t count,
+				const struct rand_key *key, uint64_t index)
+{
+	return verify_words(src, count, key, index);
+}
+
+#pragma GCC pop_options
+#endif
+
+struct rand_kernels {
+	void (*fill)(void *dst, size_t count,
+		     const struct rand_key *key, uint64_t index);
+	size_t (*verify)(const void *src, size_t count,
+			 const struct rand_key *key, uint64_t index);
+};
+
+static const struct rand_kernels *rand_kernels(void)
+{
+	static const struct rand_kernels generic = {
+		fill_words_generic, verify_words_generic,
+	};
+#if defined(__x86_64__) && !defined(__clang__)
+	static const struct rand_kernels avx2 = {
+		fill_words_avx2, verify_words_avx2,
+	};
+#endif
+	static const struct rand_kernels *kernels;
+
+	/* Looked up once, cpuid may be slow under virtualization */
+	if (kernels)
+		return kernels;
+
+	kernels = &generic;
+#if defined(__x86_64__) && !defined(__clang__)
+	if (igt_x86_features() & AVX2)
+		kernels = &avx2;
+#endif
+
+	return kernels;
+}
+
+/*
+ * Fills or checks @len bytes from byte @offset of the stream, which is the
+ * sequence of the words in CPU byte order. Returns the first mismatching
+ * byte, or @len.
+ */
+static size_t rand_range(char *buf, size_t len, const struct rand_key *key,
+			 uint64_t offset, bool verify)
+{
+	const struct rand_kernels *kernels = rand_kernels();
+	size_t pos = 0, words, i;
+
+	/* Bytes up to the first whole word and after the last one */
+	while (pos < len && (offset + pos) & 3) {
+		uint32_t x = rand_word(key, (offset + pos) / 4);
+		uint8_t byte = ((uint8_t *)&x)[(offset + pos) & 3];
+
+		if (!verify)
+			buf[pos] = byte;
+		else if ((uint8_t)buf[pos] != byte)
+			return pos;
+		pos++;
+	}
+
+	words = (len - pos) / 4;
+	if (!verify) {
+		kernels->fill(buf + pos, words, key, (offset + pos) / 4);
+	} else {
+		i = kernels->verify(buf + pos, words, key, (offset + pos) / 4);
+		if (i < words) {
+			uint32_t x = rand_word(key, (offset + pos) / 4 + i);
+
+			pos += i * 4;
+			while (buf[pos] == ((char *)&x)[(offset + pos) & 3])
+				pos++;
+
+			return pos;
+		}
+	}
+	pos += words * 4;
+
+	while (pos < len) {
+		uint32_t x = rand_word(key, (offset + pos) / 4);
+		uint8_t byte = ((uint8_t *)&x)[(offset + pos) & 3];
+
+		if (!verify)
+			buf[pos] = byte;
+		else if ((uint8_t)buf[pos] != byte)
+			return pos;
+		pos++;
+	}
+
+	return len;
+}
+
+struct rand_chunk {
+	pthread_t thread;
+	char *buf;
+	size_t len;
+	const struct rand_key *key;
+	uint64_t offset;
+	bool verify;
+	bool threaded;
+	size_t result;
+};
+
+static void *rand_chunk_thread(void *data)
+{
+	struct rand_chunk *chunk = data;
+
+	chunk->result = rand_range(chunk->buf, chunk->len, chunk->key,
+				   chunk->offset, chunk->verify);
+
+	return NULL;
+}
+
+/* Splits big buffers in chunks for a thread per CPU */
+static size_t rand_parallel(char *buf, size_t len, uint64_t seed,
+			    uint64_t offset, bool verify)
+{
+	struct rand_chunk chunks[RAND_MAX_THREADS];
+	struct rand_key key = rand_key(seed);
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t chunk_len, result = len;
+	int n;
+
+	if (nthreads > (long)(len / RAND_THREAD_MIN))
+		nthreads = len / RAND_THREAD_MIN;
+	if (nthreads > RAND_MAX_THREADS)
+		nthreads = RAND_MAX_THREADS;
+	if (nthreads <= 1)
+		return rand_range(buf, len, &key, offset, verify);
+
+	/* Whole cachelines per chunk, the last one takes the rest */
+	chunk_len = (len / nthreads) & ~(size_t)63;
+	for (n = 0; n < nthreads; n++) {
+		chunks[n].buf = buf + n * chunk_len;
+		chunks[n].len = n < nthreads - 1 ? chunk_len : len - n * chunk_len;
+		chunks[n].key = &key;
+		chunks[n].offset = offset + n * chunk_len;
+		chunks[n].verify = verify;
+
+		/* The caller does the first chunk, and any a thread failed for */
+		chunks[n].threaded = n && !pthread_create(&chunks[n].thread, NULL,
+							  rand_chunk_thread,
+							  &chunks[n]);
+	}
+
+	for (n = 0; n < nthreads; n++) {
+		if (chunks[n].threaded)
+			pthread_join(chunks[n].thread, NULL);
+		else
+			rand_chunk_thread(&chunks[n]);
+
+		if (result == len && chunks[n].result < chunks[n].len)
+			result = n * chunk_len + chunks[n].result;
+	}
+
+	return result;
+}
+
+/**
+ * igt_rand_word:
+ * @seed: seed of the stream
+ * @index: index of the 32 bit word in the stream
+ *
+ * Returns: the word @index of the stream of igt_rand_fill().
+ */
+uint32_t igt_rand_word(uint64_t seed, uint64_t index)
+{
+	struct rand_key key = rand_key(seed);
+
+	return rand_word(&key, index);
+}
+
+/**
+ * igt_rand_fill:
+ * @buf: buffer to fill
+ * @len: number of bytes to fill
+ * @seed: seed of the stream
+ * @offset: position in the stream of the first byte of @buf
+ *
+ * Fills @buf with bytes @offset to @offset + @len - 1 of the pseudo-random
+ * stream of @seed. The stream is made of the 32 bit words of
+ * igt_rand_word(), in CPU byte order, so that filling a buffer in several
+ * parts at their offsets gives the same result as filling it at once.
+ */
+void igt_rand_fill(void *buf, size_t len, uint64_t seed, uint64_t offset)
+{
+	rand_parallel(buf, len, seed, offset, false);
+}
+
+/**
+ * igt_rand_verify:
+ * @buf: buffer to check
+ * @len: number of bytes to check
+ * @seed: seed of the stream
+ * @offset: position in the stream of the first byte of @buf
+ *
+ * Checks that @buf holds what igt_rand_fill() would fill it with.
+ *
+ * Returns: the position in @buf of the first byte which differs, or -1 if
+ * @buf matches.
+ */
+ssize_t igt_rand_verify(const void *buf, size_t len, uint64_t seed,
+			uint64_t offset)
+{
+	size_t pos = rand_parallel((char *)buf, len, seed, offset, true);
+
+	return pos < len ? (ssize_t)pos : -1;
+}
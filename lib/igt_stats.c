@@ -479,6 +479,36 @@ double igt_stats_get_median(igt_stats_t *stats)
 					     NULL, NULL);
 }
 
+/**
+ * igt_stats_get_percentile:
+ * @stats: An #igt_stats_t instance
+ * @percentile: between 0 and 100
+ *
+ * Retrieves the @percentile-th percentile of the @stats dataset,
+ * interpolated linearly between the two closest values.
+ */
+double igt_stats_get_percentile(igt_stats_t *stats, double percentile)
+{
+	unsigned int lower;
+	double rank;
+
+	if (stats->n_values == 0)
+		return 0.;
+
+	igt_stats_ensure_sorted_values(stats);
+
+	rank = (stats->n_values - 1) * percentile / 100.;
+	if (rank <= 0.)
+		return sorted_value(stats, 0);
+	if (rank >= stats->n_values - 1)
+		return sorted_value(stats, stats->n_values - 1);
+
+	lower = rank;
+	return sorted_value(stats, lower) +
+		(rank - lower) * ((double)sorted_value(stats, lower + 1) -
+				  (double)sorted_value(stats, lower));
+}
+
 /*
  * Algorithm popularised by Knuth in:
  *
@@ -58,6 +58,10 @@
  *
  * This library provides helpers to access sysfs features. Right now it only
  * provides basic support for like igt_sysfs_open().
+ *
+ * Attributes accessed in a loop are better opened once with
+ * igt_sysfs_attr_open(), and read or written with a single syscall each
+ * through the igt_sysfs_attr_get_u64() family and igt_sysfs_attr_snapshot().
  */
 
 enum {
@@ -1099,6 +1103,313 @@ void igt_sysfs_set_boolean(int dir, const char *attr, bool value)
 		     "Failed to write %u to %s attribute (%s)\n", value, attr, strerror(errno));
 }
 
+/**
+ * igt_sysfs_attr_open:
+ * @attr: handle to initialize
+ * @dir: sysfs or debugfs directory
+ * @name: name of the node to open, must outlive the handle
+ * @flags: O_RDONLY, O_WRONLY or O_RDWR
+ *
+ * Opens an attribute once, for reading or writing it many times with one
+ * pread() or pwrite() each, where the igt_sysfs_get() family opens and
+ * closes it on every access. Meant for polling and sweeping loops.
+ *
+ * Returns:
+ * 0 on success, -errno on failure.
+ */
+int igt_sysfs_attr_open(igt_sysfs_attr_t *attr, int dir, const char *name,
+			int flags)
+{
+	attr->name = name;
+	attr->fd = openat(dir, name, flags | O_CLOEXEC);
+	if (igt_debug_on(attr->fd < 0))
+		return -errno;
+
+	return 0;
+}
+
+/**
+ * igt_sysfs_attr_close:
+ * @attr: handle from igt_sysfs_attr_open()
+ */
+void igt_sysfs_attr_close(igt_sysfs_attr_t *attr)
+{
+	if (attr->fd >= 0)
+		close(attr->fd);
+	attr->fd = -1;
+}
+
+/**
+ * igt_sysfs_attr_read:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @data: the block to read into
+ * @len: the maximum length to read
+ *
+ * Reads the attribute from its start, so that the kernel formats it anew,
+ * with a single pread() as sysfs hands out the whole attribute at once.
+ *
+ * Returns:
+ * The length read, -errno on failure.
+ */
+int igt_sysfs_attr_read(const igt_sysfs_attr_t *attr, void *data, int len)
+{
+	ssize_t ret;
+
+	do {
+		ret = pread(attr->fd, data, len, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -errno : ret;
+}
+
+/**
+ * igt_sysfs_attr_write:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @data: the block to write from
+ * @len: the length to write
+ *
+ * Writes the attribute from its start. As igt_sysfs_set() does, an empty
+ * write is turned into writing the nul char.
+ *
+ * Returns:
+ * The number of bytes written, or -errno on error.
+ */
+int igt_sysfs_attr_write(const igt_sysfs_attr_t *attr, const void *data, int len)
+{
+	ssize_t ret;
+
+	if (!len)
+		return pwrite(attr->fd, "", 1, 0) == 1 ? 0 : -errno;
+
+	do {
+		ret = pwrite(attr->fd, data, len, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -errno : ret;
+}
+
+/* Like "%"SCNu64, without the locale and stdio overhead */
+static bool parse_u64(const char *s, int len, uint64_t *value)
+{
+	uint64_t v = 0;
+	int i = 0;
+
+	while (i < len && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n'))
+		i++;
+
+	if (i == len || s[i] < '0' || s[i] > '9')
+		return false;
+
+	for (; i < len && s[i] >= '0' && s[i] <= '9'; i++) {
+		unsigned int digit = s[i] - '0';
+
+		if (v > (UINT64_MAX - digit) / 10)
+			return false;
+
+		v = v * 10 + digit;
+	}
+
+	*value = v;
+	return true;
+}
+
+/* Writes the digits of @value at the end of @buf, returns the first one */
+static char *format_u64(char buf[static 20], uint64_t value)
+{
+	char *s = buf + 20;
+
+	do {
+		*--s = '0' + value % 10;
+		value /= 10;
+	} while (value);
+
+	return s;
+}
+
+/**
+ * __igt_sysfs_attr_get_u64:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @value: pointer for storing read value
+ *
+ * Reads an unsigned 64bit integer from the attribute.
+ *
+ * Returns:
+ * True if value successfully read, false otherwise.
+ */
+bool __igt_sysfs_attr_get_u64(const igt_sysfs_attr_t *attr, uint64_t *value)
+{
+	char buf[32];
+	int len;
+
+	len = igt_sysfs_attr_read(attr, buf, sizeof(buf));
+	if (igt_debug_on(len <= 0))
+		return false;
+
+	return !igt_debug_on(!parse_u64(buf, len, value));
+}
+
+/**
+ * igt_sysfs_attr_get_u64:
+ * @attr: handle from igt_sysfs_attr_open()
+ *
+ * Reads an unsigned 64bit integer from the attribute. It asserts on failure.
+ *
+ * Returns:
+ * Read value.
+ */
+uint64_t igt_sysfs_attr_get_u64(const igt_sysfs_attr_t *attr)
+{
+	uint64_t value;
+
+	igt_assert_f(__igt_sysfs_attr_get_u64(attr, &value),
+		     "Failed to read %s attribute (%s)\n", attr->name, strerror(errno));
+
+	return value;
+}
+
+/**
+ * __igt_sysfs_attr_set_u64:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @value: value to set
+ *
+ * Writes an unsigned 64bit integer to the attribute.
+ *
+ * Returns:
+ * True if successfully written, false otherwise.
+ */
+bool __igt_sysfs_attr_set_u64(const igt_sysfs_attr_t *attr, uint64_t value)
+{
+	char buf[20], *s = format_u64(buf, value);
+	int len = buf + sizeof(buf) - s;
+
+	return igt_sysfs_attr_write(attr, s, len) == len;
+}
+
+/**
+ * igt_sysfs_attr_set_u64:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @value: value to set
+ *
+ * Writes an unsigned 64bit integer to the attribute. It asserts on failure.
+ */
+void igt_sysfs_attr_set_u64(const igt_sysfs_attr_t *attr, uint64_t value)
+{
+	igt_assert_f(__igt_sysfs_attr_set_u64(attr, value),
+		     "Failed to write %"PRIu64" to %s attribute (%s)\n",
+		     value, attr->name, strerror(errno));
+}
+
+/**
+ * __igt_sysfs_attr_get_u32:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @value: pointer for storing read value
+ *
+ * Reads an unsigned 32bit integer from the attribute.
+ *
+ * Returns:
+ * True if value successfully read and in range, false otherwise.
+ */
+bool __igt_sysfs_attr_get_u32(const igt_sysfs_attr_t *attr, uint32_t *value)
+{
+	uint64_t v;
+
+	if (!__igt_sysfs_attr_get_u64(attr, &v) || igt_debug_on(v > UINT32_MAX))
+		return false;
+
+	*value = v;
+	return true;
+}
+
+/**
+ * igt_sysfs_attr_get_u32:
+ * @attr: handle from igt_sysfs_attr_open()
+ *
+ * Reads an unsigned 32bit integer from the attribute. It asserts on failure.
+ *
+ * Returns:
+ * Read value.
+ */
+uint32_t igt_sysfs_attr_get_u32(const igt_sysfs_attr_t *attr)
+{
+	uint32_t value;
+
+	igt_assert_f(__igt_sysfs_attr_get_u32(attr, &value),
+		     "Failed to read %s attribute (%s)\n", attr->name, strerror(errno));
+
+	return value;
+}
+
+/**
+ * __igt_sysfs_attr_set_u32:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @value: value to set
+ *
+ * Writes an unsigned 32bit integer to the attribute.
+ *
+ * Returns:
+ * True if successfully written, false otherwise.
+ */
+bool __igt_sysfs_attr_set_u32(const igt_sysfs_attr_t *attr, uint32_t value)
+{
+	return __igt_sysfs_attr_set_u64(attr, value);
+}
+
+/**
+ * igt_sysfs_attr_set_u32:
+ * @attr: handle from igt_sysfs_attr_open()
+ * @value: value to set
+ *
+ * Writes an unsigned 32bit integer to the attribute. It asserts on failure.
+ */
+void igt_sysfs_attr_set_u32(const igt_sysfs_attr_t *attr, uint32_t value)
+{
+	igt_assert_f(__igt_sysfs_attr_set_u32(attr, value),
+		     "Failed to write %u to %s attribute (%s)\n",
+		     value, attr->name, strerror(errno));
+}
+
+/**
+ * igt_sysfs_attr_snapshot:
+ * @attrs: handles from igt_sysfs_attr_open()
+ * @count: number of @attrs
+ * @values: array of @count values to read into
+ *
+ * Reads unsigned integers from several attributes at once. All the
+ * attributes are read back to back before any of them is parsed, so that
+ * the values are as close in time to each other as they can be.
+ *
+ * Returns:
+ * True if all the values were successfully read, false otherwise, in which
+ * case only the @values which could be read are updated.
+ */
+bool igt_sysfs_attr_snapshot(const igt_sysfs_attr_t *attrs, int count,
+			     uint64_t *values)
+{
+	char stack[16][32], (*buf)[32] = stack;
+	int stack_len[16], *len = stack_len;
+	bool ret = true;
+
+	if (count > ARRAY_SIZE(stack)) {
+		buf = malloc(count * (sizeof(*buf) + sizeof(*len)));
+		igt_assert(buf);
+		len = (int *)(buf + count);
+	}
+
+	for (int i = 0; i < count; i++)
+		len[i] = pread(attrs[i].fd, buf[i], sizeof(buf[i]), 0);
+
+	for (int i = 0; i < count; i++) {
+		if (igt_debug_on_f(len[i] <= 0 || !parse_u64(buf[i], len[i], &values[i]),
+				   "Failed to read %s attribute\n", attrs[i].name))
+			ret = false;
+	}
+
+	if (buf != stack)
+		free(buf);
+
+	return ret;
+}
+
 static void bind_con(const char *name, bool enable)
 {
 	const char *path = "/sys/class/vtconsole";
@@ -1212,13 +1523,17 @@ static bool rw_attr_equal_within_epsilon(uint64_t x, uint64_t ref, double tol)
 static int rw_attr_sweep(igt_sysfs_rw_attr_t *rw)
 {
 	uint64_t get = 0, set = rw->start;
+	igt_sysfs_attr_t attr;
 	int num_points = 0;
 	bool ret;
 
+	if (igt_sysfs_attr_open(&attr, rw->dir, rw->attr, O_RDWR))
+		return -ENOENT;
+
 	igt_debug("'%s': sweeping range of values\n", rw->attr);
 	while (set < UINT64_MAX / 2) {
-		ret = __igt_sysfs_set_u64(rw->dir, rw->attr, set);
-		__igt_sysfs_get_u64(rw->dir, rw->attr, &get);
+		ret = __igt_sysfs_attr_set_u64(&attr, set);
+		__igt_sysfs_attr_get_u64(&attr, &get);
 		igt_debug("'%s': ret %d set %"PRIu64" get %"PRIu64"\n", rw->attr, ret, set, get);
 		if (ret && rw_attr_equal_within_epsilon(get, set, rw->tol)) {
 			igt_debug("'%s': matches\n", rw->attr);
@@ -1227,6 +1542,7 @@ static int rw_attr_sweep(igt_sysfs_rw_attr_t *rw)
 		set *= 2;
 	}
 	igt_debug("'%s': done sweeping\n", rw->attr);
+	igt_sysfs_attr_close(&attr);
 
 	return num_points ? 0 : -ENOENT;
 }
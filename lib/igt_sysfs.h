@@ -140,6 +140,38 @@ bool igt_sysfs_get_boolean(int dir, const char *attr);
 bool __igt_sysfs_set_boolean(int dir, const char *attr, bool value);
 void igt_sysfs_set_boolean(int dir, const char *attr, bool value);
 
+/**
+ * igt_sysfs_attr:
+ * @fd: the attribute, kept open
+ * @name: name of the attribute, for messages
+ *
+ * Handle to a sysfs or debugfs attribute from igt_sysfs_attr_open()
+ */
+typedef struct igt_sysfs_attr {
+	int fd;
+	const char *name;
+} igt_sysfs_attr_t;
+
+int igt_sysfs_attr_open(igt_sysfs_attr_t *attr, int dir, const char *name,
+			int flags);
+void igt_sysfs_attr_close(igt_sysfs_attr_t *attr);
+
+int igt_sysfs_attr_read(const igt_sysfs_attr_t *attr, void *data, int len);
+int igt_sysfs_attr_write(const igt_sysfs_attr_t *attr, const void *data, int len);
+
+bool __igt_sysfs_attr_get_u32(const igt_sysfs_attr_t *attr, uint32_t *value);
+uint32_t igt_sysfs_attr_get_u32(const igt_sysfs_attr_t *attr);
+bool __igt_sysfs_attr_set_u32(const igt_sysfs_attr_t *attr, uint32_t value);
+void igt_sysfs_attr_set_u32(const igt_sysfs_attr_t *attr, uint32_t value);
+
+bool __igt_sysfs_attr_get_u64(const igt_sysfs_attr_t *attr, uint64_t *value);
+uint64_t igt_sysfs_attr_get_u64(const igt_sysfs_attr_t *attr);
+bool __igt_sysfs_attr_set_u64(const igt_sysfs_attr_t *attr, uint64_t value);
+void igt_sysfs_attr_set_u64(const igt_sysfs_attr_t *attr, uint64_t value);
+
+bool igt_sysfs_attr_snapshot(const igt_sysfs_attr_t *attrs, int count,
+			     uint64_t *values);
+
 void bind_fbcon(bool enable);
 void fbcon_blink_enable(bool enable);
 
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Copyright © 2026 Intel Corporation
+#
+# Generates the perfect hash table intel_get_device_info() looks device ids
+# up with.
+#
+# The PCI id lists are expanded from the INTEL_*_IDS() macros of the pciids
+# headers, in the order intel_device_match[] of intel_device_info.c lists
+# them, so that every id maps to its index in intel_device_match[]. When an
+# id is listed several times the first entry wins, as with the linear search
+# the table replaces.
+#
+# The table is built with hash and displace: the ids are split into buckets
+# by a first hash, then, biggest buckets first, each bucket gets the first
+# seed for which a second hash sends all its ids to free slots. A lookup is
+# two hashes and three loads, without any initialization at runtime.
+
+import argparse
+import re
+import sys
+
+def strip_comments(text):
+    text = re.sub(r'/\*.*?\*/', ' ', text, flags=re.S)
+    text = re.sub(r'//[^\n]*', ' ', text)
+
+    return text.replace('\\\n', ' ')
+
+def parse_id_macros(headers):
+    macros = {}
+    define = re.compile(r'^\s*#\s*define\s+(\w+)\(\s*MACRO__\s*,\s*\.\.\.\s*\)(.*)$',
+                        re.M)
+
+    for header in headers:
+        with open(header) as f:
+            text = strip_comments(f.read())
+
+        # The local headers only define what pciids.h does not (#ifndef)
+        for m in define.finditer(text):
+            macros.setdefault(m.group(1), m.group(2))
+
+    return macros
+
+item = re.compile(r'MACRO__\(\s*([^,)\s]+)|(\w+)\(\s*MACRO__\b')
+
+def parse_id(token):
+    try:
+        return int(token, 0)
+    except ValueError:
+        sys.exit('%s: not a device id' % token)
+
+def expand(macros, name, stack=()):
+    if name not in macros:
+        sys.exit('%s: unknown id list' % name)
+    if name in stack:
+        sys.exit('%s: recursive id list' % name)
+
+    ids = []
+    for m in item.finditer(macros[name]):
+        if m.group(1):
+            ids.append(parse_id(m.group(1)))
+        else:
+            ids += expand(macros, m.group(2), stack + (name,))
+
+    return ids
+
+def parse_match_table(source, macros):
+    with open(source) as f:
+        text = strip_comments(f.read())
+
+    table = re.search(r'intel_device_match\[\]\s*=\s*\{(.*?)\n\};', text, re.S)
+    if not table:
+        sys.exit('%s: intel_device_match[] not found' % source)
+
+    ids = []
+    entry = re.compile(r'(\w+)\(\s*INTEL_PCI_ID_INIT\b|INTEL_PCI_ID_INIT\(\s*(\w+)')
+    for m in entry.finditer(table.group(1)):
+        if m.group(1):
+            ids += expand(macros, m.group(1))
+        elif m.group(2) == 'PCI_MATCH_ANY':
+            return ids
+        else:
+            ids.append(parse_id(m.group(2)))
+
+    sys.exit('%s: intel_device_match[] is not terminated by PCI_MATCH_ANY' % source)
+
+MASK32 = 0xffffffff
+
+# Must be kept in sync with intel_device_hash_mix() below
+def mix(devid, seed):
+    x = ((devid | seed << 16) * 0x9e3779b1) & MASK32
+    x ^= x >> 15
+    x = (x * 0x2c1b3c6d) & MASK32
+    x ^= x >> 12
+
+    return x
+
+def build(ids, num_buckets, num_slots):
+    buckets = [[] for _ in range(num_buckets)]
+    for devid in ids:
+        buckets[mix(devid, 0) & (num_buckets - 1)].append(devid)
+
+    seeds = [0] * num_buckets
+    slots = [None] * num_slots
+    order = sorted(range(num_buckets), key=lambda b: -len(buckets[b]))
+    for b in order:
+        if not buckets[b]:
+            break
+
+        for seed in range(1, 1 << 16):
+            taken = set()
+            for devid in buckets[b]:
+                slot = mix(devid, seed) & (num_slots - 1)
+                if slots[slot] is not None or slot in taken:
+                    break
+                taken.add(slot)
+            else:
+                break
+        else:
+            return None
+
+        seeds[b] = seed
+        for devid in buckets[b]:
+            slots[mix(devid, seed) & (num_slots - 1)] = devid
+
+    return seeds, slots
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--header", required=True, help="Header file to write")
+    parser.add_argument("--source", required=True,
+                        help="intel_device_info.c, listing intel_device_match[]")
+    parser.add_argument("pciids", nargs='+', help="PCI id headers, pciids.h first")
+    args = parser.parse_args()
+
+    macros = parse_id_macros(args.pciids)
+    matches = parse_match_table(args.source, macros)
+
+    index = {}
+    for i, devid in enumerate(matches):
+        if devid > 0xffff:
+            sys.exit('0x%x: not a 16 bit device id' % devid)
+        index.setdefault(devid, i)
+
+    num_slots = 1
+    while num_slots < len(index) * 5 // 4:
+        num_slots *= 2
+    num_buckets = max(num_slots // 4, 1)
+
+    table = build(sorted(index), num_buckets, num_slots)
+    while table is None:
+        num_buckets *= 2
+        table = build(sorted(index), num_buckets, num_slots)
+    seeds, slots = table
+
+    with open(args.header, 'w') as h:
+        h.write('/* Generated by intel-device-info-codegen.py, do not edit */\n\n')
+        h.write('#define INTEL_DEVICE_MATCH_COUNT %d\n' % len(matches))
+        h.write('#define INTEL_DEVICE_HASH_BUCKETS %d\n' % num_buckets)
+        h.write('#define INTEL_DEVICE_HASH_SLOTS %d\n\n' % num_slots)
+
+        h.write('static inline uint32_t intel_device_hash_mix(uint16_t devid, uint16_t seed)\n')
+        h.write('{\n')
+        h.write('\tuint32_t x = (devid | (uint32_t)seed << 16) * 0x9e3779b1u;\n\n')
+        h.write('\tx ^= x >> 15;\n')
+        h.write('\tx *= 0x2c1b3c6du;\n')
+        h.write('\tx ^= x >> 12;\n\n')
+        h.write('\treturn x;\n')
+        h.write('}\n\n')
+
+        def array(ctype, name, size, values):
+            h.write('static const %s %s[%s] = {\n' % (ctype, name, size))
+            for i in range(0, len(values), 8):
+                h.write('\t' + ' '.join('0x%04x,' % v for v in values[i:i + 8]) + '\n')
+            h.write('};\n\n')
+
+        array('uint16_t', 'intel_device_hash_seeds', 'INTEL_DEVICE_HASH_BUCKETS',
+              seeds)
+
+        # Free slots point at the PCI_MATCH_ANY terminator, which no id matches
+        array('uint16_t', 'intel_device_hash_slots', 'INTEL_DEVICE_HASH_SLOTS',
+              [index[s] if s is not None else len(matches) for s in slots])
+
+        array('uint16_t', 'intel_device_ids', '', sorted(index))
+
+        h.write('/* Index in intel_device_match[] to check @devid against */\n')
+        h.write('static inline unsigned int intel_device_hash(uint16_t devid)\n')
+        h.write('{\n')
+        h.write('\tuint16_t seed = intel_device_hash_seeds[intel_device_hash_mix(devid, 0) &\n')
+        h.write('\t\t\t\t\t\t\t(INTEL_DEVICE_HASH_BUCKETS - 1)];\n\n')
+        h.write('\treturn intel_device_hash_slots[intel_device_hash_mix(devid, seed) &\n')
+        h.write('\t\t\t\t       (INTEL_DEVICE_HASH_SLOTS - 1)];\n')
+        h.write('}\n')
+
+if __name__ == '__main__':
+    main()
@@ -25,7 +25,6 @@
  *
  **************************************************************************/
 
-#include <search.h>
 #ifndef ANDROID
 #include <glib.h>
 #else
@@ -1010,6 +1009,7 @@ __intel_bb_create(int fd, uint32_t ctx, uint32_t vm, const intel_ctx_cfg_t *cfg,
 	if ((ibb->gtt_size - 1) >> 32)
 		ibb->supports_48b_address = true;
 
+	intel_bb_object_table_init(&ibb->cache);
 	object = intel_bb_add_object(ibb, ibb->handle, ibb->size,
 				     INTEL_BUF_INVALID_ADDRESS, ibb->alignment,
 				     false);
@@ -1280,17 +1280,22 @@ static void __intel_bb_destroy_objects(struct intel_bb *ibb)
 	free(ibb->objects);
 	ibb->objects = NULL;
 
-	tdestroy(ibb->current, free);
-	ibb->current = NULL;
+	intel_bb_object_table_new_exec(&ibb->cache);
 
 	ibb->num_objects = 0;
 	ibb->allocated_objects = 0;
 }
 
+/* Empties the objects array, keeping its storage for the next execbuf */
+static void __intel_bb_reset_objects(struct intel_bb *ibb)
+{
+	intel_bb_object_table_new_exec(&ibb->cache);
+	ibb->num_objects = 0;
+}
+
 static void __intel_bb_destroy_cache(struct intel_bb *ibb)
 {
-	tdestroy(ibb->root, free);
-	ibb->root = NULL;
+	intel_bb_object_table_fini(&ibb->cache);
 }
 
 static void __intel_bb_remove_intel_bufs(struct intel_bb *ibb)
@@ -1318,6 +1323,7 @@ void intel_bb_destroy(struct intel_bb *ibb)
 	__intel_bb_destroy_relocations(ibb);
 	__intel_bb_destroy_objects(ibb);
 	__intel_bb_destroy_cache(ibb);
+	intel_bb_arena_fini(&ibb->scratch);
 
 	if (ibb->allocator_type != INTEL_ALLOCATOR_NONE) {
 		if (intel_bb_do_tracking) {
@@ -1365,8 +1371,9 @@ static struct drm_xe_vm_bind_op *xe_alloc_bind_ops(struct intel_bb *ibb,
 	struct drm_xe_vm_bind_op *bind_ops, *ops;
 	bool set_obj = (op & 0xffff) == DRM_XE_VM_BIND_OP_MAP;
 
-	bind_ops = calloc(ibb->num_objects, sizeof(*bind_ops));
-	igt_assert(bind_ops);
+	bind_ops = intel_bb_arena_alloc(&ibb->scratch,
+					ibb->num_objects * sizeof(*bind_ops));
+	memset(bind_ops, 0, ibb->num_objects * sizeof(*bind_ops));
 
 	igt_debug("bind_ops: %s\n", set_obj ? "MAP" : "UNMAP");
 	for (int i = 0; i < ibb->num_objects; i++) {
@@ -1410,10 +1417,10 @@ static void __unbind_xe_objects(struct intel_bb *ibb)
 		struct drm_xe_vm_bind_op *bind_ops;
 		uint32_t op = DRM_XE_VM_BIND_OP_UNMAP;
 
+		intel_bb_arena_reset(&ibb->scratch);
 		bind_ops = xe_alloc_bind_ops(ibb, op, 0, 0);
 		xe_vm_bind_array(ibb->fd, ibb->vm_id, 0, bind_ops,
 				 ibb->num_objects, syncs, 2);
-		free(bind_ops);
 	} else {
 		igt_debug("bind: UNMAP\n");
 		igt_debug("  offset: %llx, size: %llx\n",
@@ -1463,12 +1470,12 @@ void intel_bb_reset(struct intel_bb *ibb, bool purge_objects_cache)
 		__unbind_xe_objects(ibb);
 
 	__intel_bb_destroy_relocations(ibb);
-	__intel_bb_destroy_objects(ibb);
-	__reallocate_objects(ibb);
+	__intel_bb_reset_objects(ibb);
 
 	if (purge_objects_cache) {
 		__intel_bb_remove_intel_bufs(ibb);
 		__intel_bb_destroy_cache(ibb);
+		intel_bb_object_table_init(&ibb->cache);
 	}
 
 	/*
@@ -1566,7 +1573,7 @@ void intel_bb_print(struct intel_bb *ibb)
 	igt_info("gtt_size: %" PRIu64 ", supports 48bit: %d\n",
 		 ibb->gtt_size, ibb->supports_48b_address);
 	igt_info("ctx: %u\n", ibb->ctx);
-	igt_info("root: %p\n", ibb->root);
+	igt_info("cache: %u objects\n", ibb->cache.count);
 	igt_info("objects: %p, num_objects: %u, allocated obj: %u\n",
 		 ibb->objects, ibb->num_objects, ibb->allocated_objects);
 	igt_info("relocs: %p, num_relocs: %u, allocated_relocs: %u\n----\n",
@@ -1638,85 +1645,44 @@ void intel_bb_set_dump_base64(struct intel_bb *ibb, bool dump)
 	ibb->dump_base64 = dump;
 }
 
-static int __compare_objects(const void *p1, const void *p2)
-{
-	const struct drm_i915_gem_exec_object2 *o1 = p1, *o2 = p2;
-
-	return (int) ((int64_t) o1->handle - (int64_t) o2->handle);
-}
-
 static struct drm_i915_gem_exec_object2 *
 __add_to_cache(struct intel_bb *ibb, uint32_t handle)
 {
-	struct drm_i915_gem_exec_object2 **found, *object;
-
-	object = malloc(sizeof(*object));
-	igt_assert(object);
-
-	object->handle = handle;
-	object->alignment = 0;
-	found = tsearch((void *) object, &ibb->root, __compare_objects);
+	struct drm_i915_gem_exec_object2 *object;
+	bool added;
 
-	if (*found == object) {
-		memset(object, 0, sizeof(*object));
-		object->handle = handle;
+	object = intel_bb_object_table_add(&ibb->cache, handle, &added);
+	if (added)
 		object->offset = INTEL_BUF_INVALID_ADDRESS;
-	} else {
-		free(object);
-		object = *found;
-	}
 
 	return object;
 }
 
 static bool __remove_from_cache(struct intel_bb *ibb, uint32_t handle)
 {
-	struct drm_i915_gem_exec_object2 **found, *object;
-
-	object = intel_bb_find_object(ibb, handle);
-	if (!object) {
+	if (!intel_bb_object_table_remove(&ibb->cache, handle)) {
 		igt_warn("Object: handle: %u not found\n", handle);
 		return false;
 	}
 
-	found = tdelete((void *) object, &ibb->root, __compare_objects);
-	if (!found)
-		return false;
-
-	free(object);
-
 	return true;
 }
 
-static int __compare_handles(const void *p1, const void *p2)
-{
-	return (int) (*(int32_t *) p1 - *(int32_t *) p2);
-}
-
 static void __add_to_objects(struct intel_bb *ibb,
 			     struct drm_i915_gem_exec_object2 *object)
 {
-	uint32_t **found, *handle;
-
-	handle = malloc(sizeof(*handle));
-	igt_assert(handle);
-
-	*handle = object->handle;
-	found = tsearch((void *) handle, &ibb->current, __compare_handles);
+	if (!intel_bb_object_table_use(&ibb->cache, object->handle))
+		return;
 
-	if (*found == handle) {
-		__reallocate_objects(ibb);
-		igt_assert(ibb->num_objects < ibb->allocated_objects);
-		ibb->objects[ibb->num_objects++] = object;
-	} else {
-		free(handle);
-	}
+	__reallocate_objects(ibb);
+	igt_assert(ibb->num_objects < ibb->allocated_objects);
+	ibb->objects[ibb->num_objects++] = object;
 }
 
 static void __remove_from_objects(struct intel_bb *ibb,
 				  struct drm_i915_gem_exec_object2 *object)
 {
-	uint32_t i, **handle, *to_free;
+	uint32_t i;
 	bool found = false;
 
 	for (i = 0; i < ibb->num_objects; i++) {
@@ -1741,17 +1707,9 @@ static void __remove_from_objects(struct intel_bb *ibb,
 		memmove(&ibb->objects[i], &ibb->objects[i + 1],
 			sizeof(object) * (ibb->num_objects - i));
 
-	handle = tfind((void *) &object->handle,
-		       &ibb->current, __compare_handles);
-	if (!handle) {
-		igt_warn("Object %u doesn't exist in the tree, can't remove",
+	if (!intel_bb_object_table_unuse(&ibb->cache, object->handle))
+		igt_warn("Object %u isn't used by the execbuf, can't remove",
 			 object->handle);
-		return;
-	}
-
-	to_free = *handle;
-	tdelete((void *) &object->handle, &ibb->current, __compare_handles);
-	free(to_free);
 }
 
 /**
@@ -2005,32 +1963,24 @@ void intel_bb_print_intel_bufs(struct intel_bb *ibb)
 struct drm_i915_gem_exec_object2 *
 intel_bb_find_object(struct intel_bb *ibb, uint32_t handle)
 {
-	struct drm_i915_gem_exec_object2 object = { .handle = handle };
-	struct drm_i915_gem_exec_object2 **found;
-
-	found = tfind((void *) &object, &ibb->root, __compare_objects);
-	if (!found)
-		return NULL;
-
-	return *found;
+	return intel_bb_object_table_find(&ibb->cache, handle);
 }
 
 bool
 intel_bb_object_set_flag(struct intel_bb *ibb, uint32_t handle, uint64_t flag)
 {
-	struct drm_i915_gem_exec_object2 object = { .handle = handle };
-	struct drm_i915_gem_exec_object2 **found;
+	struct drm_i915_gem_exec_object2 *found;
 
-	igt_assert_f(ibb->root, "Trying to search in null tree\n");
+	igt_assert_f(ibb->cache.count, "Trying to search in empty cache\n");
 
-	found = tfind((void *) &object, &ibb->root, __compare_objects);
+	found = intel_bb_find_object(ibb, handle);
 	if (!found) {
 		igt_warn("Trying to set fence on not found handle: %u\n",
 			 handle);
 		return false;
 	}
 
-	(*found)->flags |= flag;
+	found->flags |= flag;
 
 	return true;
 }
@@ -2038,17 +1988,16 @@ intel_bb_object_set_flag(struct intel_bb *ibb, uint32_t handle, uint64_t flag)
 bool
 intel_bb_object_clear_flag(struct intel_bb *ibb, uint32_t handle, uint64_t flag)
 {
-	struct drm_i915_gem_exec_object2 object = { .handle = handle };
-	struct drm_i915_gem_exec_object2 **found;
+	struct drm_i915_gem_exec_object2 *found;
 
-	found = tfind((void *) &object, &ibb->root, __compare_objects);
+	found = intel_bb_find_object(ibb, handle);
 	if (!found) {
 		igt_warn("Trying to set fence on not found handle: %u\n",
 			 handle);
 		return false;
 	}
 
-	(*found)->flags &= ~flag;
+	found->flags &= ~flag;
 
 	return true;
 }
@@ -2368,39 +2317,27 @@ static void intel_bb_dump_base64(struct intel_bb *ibb, int linelen)
 	free(str);
 }
 
-static void print_node(const void *node, VISIT which, int depth)
+static void print_object(struct drm_i915_gem_exec_object2 *object, void *data)
 {
-	const struct drm_i915_gem_exec_object2 *object =
-		*(const struct drm_i915_gem_exec_object2 **) node;
-	(void) depth;
-
-	switch (which) {
-	case preorder:
-	case endorder:
-		break;
-
-	case postorder:
-	case leaf:
-		igt_info("\t handle: %u, offset: 0x%" PRIx64 "\n",
-			 object->handle, (uint64_t) object->offset);
-		break;
-	}
+	igt_info("\t handle: %u, offset: 0x%" PRIx64 "\n",
+		 object->handle, (uint64_t) object->offset);
 }
 
 void intel_bb_dump_cache(struct intel_bb *ibb)
 {
 	igt_info("[pid: %ld] dump cache\n", (long) getpid());
-	twalk(ibb->root, print_node);
+	intel_bb_object_table_for_each(&ibb->cache, print_object, NULL);
 }
 
+/* The objects array for execbuf, valid until the next reset of the scratch */
 static struct drm_i915_gem_exec_object2 *
 create_objects_array(struct intel_bb *ibb)
 {
 	struct drm_i915_gem_exec_object2 *objects;
 	uint32_t i;
 
-	objects = malloc(sizeof(*objects) * ibb->num_objects);
-	igt_assert(objects);
+	objects = intel_bb_arena_alloc(&ibb->scratch,
+				       sizeof(*objects) * ibb->num_objects);
 
 	for (i = 0; i < ibb->num_objects; i++) {
 		objects[i] = *(ibb->objects[i]);
@@ -2417,10 +2354,9 @@ static void update_offsets(struct intel_bb *ibb,
 	struct intel_buf *entry;
 	uint32_t i;
 
+	/* @objects was copied from ibb->objects, in the same order */
 	for (i = 0; i < ibb->num_objects; i++) {
-		object = intel_bb_find_object(ibb, objects[i].handle);
-		igt_assert(object);
-
+		object = ibb->objects[i];
 		object->offset = DECANONICAL(objects[i].offset);
 
 		if (i == 0)
@@ -2520,10 +2456,10 @@ int __xe_bb_exec(struct intel_bb *ibb, uint64_t flags, bool sync)
 
 	syncs[0].handle = syncobj_create(ibb->fd, 0);
 	if (ibb->num_objects > 1) {
+		intel_bb_arena_reset(&ibb->scratch);
 		bind_ops = xe_alloc_bind_ops(ibb, DRM_XE_VM_BIND_OP_MAP, 0, 0);
 		xe_vm_bind_array(ibb->fd, ibb->vm_id, 0, bind_ops,
 				 ibb->num_objects, syncs, 1);
-		free(bind_ops);
 	} else {
 		igt_debug("bind: MAP\n");
 		igt_debug("  handle: %u, offset: %llx, size: %llx\n",
@@ -2636,10 +2572,10 @@ __xe_lr_bb_exec(struct intel_bb *ibb, uint64_t flags, bool sync)
 	syncs[1].addr = exec_sync_addr;
 
 	if (ibb->num_objects > 1) {
+		intel_bb_arena_reset(&ibb->scratch);
 		bind_ops = xe_alloc_bind_ops(ibb, DRM_XE_VM_BIND_OP_MAP, 0, 0);
 		xe_vm_bind_array(ibb->fd, ibb->vm_id, 0, bind_ops,
 				 ibb->num_objects, syncs, 1);
-		free(bind_ops);
 	} else {
 		igt_debug("bind: MAP\n");
 		igt_debug("  handle: %u, offset: %llx, size: %llx\n",
@@ -2693,6 +2629,7 @@ int __intel_bb_exec(struct intel_bb *ibb, uint32_t end_offset,
 	gem_write(ibb->fd, ibb->handle, 0, ibb->batch, ibb->size);
 
 	memset(&execbuf, 0, sizeof(execbuf));
+	intel_bb_arena_reset(&ibb->scratch);
 	objects = create_objects_array(ibb);
 	execbuf.buffers_ptr = to_user_pointer(objects);
 	execbuf.buffer_count = ibb->num_objects;
@@ -2712,7 +2649,6 @@ int __intel_bb_exec(struct intel_bb *ibb, uint32_t end_offset,
 	ret = __gem_execbuf_wr(ibb->fd, &execbuf);
 	if (ret) {
 		intel_bb_dump_execbuf(ibb, &execbuf);
-		free(objects);
 		return ret;
 	}
 
@@ -2738,12 +2674,11 @@ int __intel_bb_exec(struct intel_bb *ibb, uint32_t end_offset,
 		intel_bb_dump_execbuf(ibb, &execbuf);
 		if (intel_bb_debug_tree) {
 			igt_info("\nTree:\n");
-			twalk(ibb->root, print_node);
+			intel_bb_object_table_for_each(&ibb->cache,
+						       print_object, NULL);
 		}
 	}
 
-	free(objects);
-
 	return 0;
 }
 
@@ -2783,16 +2718,15 @@ void intel_bb_exec(struct intel_bb *ibb, uint32_t end_offset,
  */
 uint64_t intel_bb_get_object_offset(struct intel_bb *ibb, uint32_t handle)
 {
-	struct drm_i915_gem_exec_object2 object = { .handle = handle };
-	struct drm_i915_gem_exec_object2 **found;
+	struct drm_i915_gem_exec_object2 *found;
 
 	igt_assert(ibb);
 
-	found = tfind((void *)&object, &ibb->root, __compare_objects);
+	found = intel_bb_find_object(ibb, handle);
 	if (!found)
 		return INTEL_BUF_INVALID_ADDRESS;
 
-	return (*found)->offset;
+	return found->offset;
 }
 
 /*
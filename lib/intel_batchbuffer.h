@@ -9,6 +9,7 @@
 #include "intel_reg.h"
 #include "drmtest.h"
 #include "intel_allocator.h"
+#include "intel_bb_objects.h"
 
 #define BATCH_SZ 4096
 
@@ -278,11 +279,11 @@ struct intel_bb {
 	/* Context configuration */
 	intel_ctx_cfg_t *cfg;
 
-	/* Cache */
-	void *root;
+	/* Cache, also tracking the objects of the current execbuf */
+	struct intel_bb_object_table cache;
 
-	/* Current objects for execbuf */
-	void *current;
+	/* Scratch memory of the current execbuf */
+	struct intel_bb_arena scratch;
 
 	/* Objects for current execbuf */
 	struct drm_i915_gem_exec_object2 **objects;
@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+/**
+ * SECTION:intel_bb_objects
+ * @short_description: Exec object bookkeeping of intel_bb
+ * @title: intel_bb objects
+ * @include: intel_bb_objects.h
+ *
+ * intel_bb keeps every object it has seen in a cache, to reuse its offset
+ * and flags on later execbufs, and the objects of the current execbuf in
+ * an array. The cache is a flat table keyed by GEM handle, which also tells
+ * whether an object is already part of the current execbuf through an exec
+ * counter: starting a new execbuf is a counter increment rather than the
+ * teardown of a set.
+ *
+ * The arena hands out the scratch memory an execbuf needs, like the array
+ * passed to the ioctl, from blocks kept across execbufs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "igt_core.h"
+#include "intel_bb_objects.h"
+
+#define TABLE_MIN_SIZE 64
+
+struct intel_bb_arena_chunk {
+	struct intel_bb_arena_chunk *next;
+	size_t size;
+	char data[] __attribute__((aligned(16)));
+};
+
+static uint32_t handle_hash(uint32_t handle)
+{
+	handle ^= handle >> 16;
+	handle *= 0x85ebca6b;
+	handle ^= handle >> 13;
+
+	return handle;
+}
+
+static struct intel_bb_object_slot *
+find_slot(const struct intel_bb_object_table *table, uint32_t handle)
+{
+	uint32_t i = handle_hash(handle) & table->mask;
+
+	while (table->slots[i].object && table->slots[i].handle != handle)
+		i = (i + 1) & table->mask;
+
+	return &table->slots[i];
+}
+
+static void alloc_slots(struct intel_bb_object_table *table, uint32_t size)
+{
+	table->slots = calloc(size, sizeof(*table->slots));
+	igt_assert(table->slots);
+	table->mask = size - 1;
+}
+
+static void grow(struct intel_bb_object_table *table)
+{
+	struct intel_bb_object_slot *old = table->slots;
+	uint32_t size = table->mask + 1;
+
+	alloc_slots(table, 2 * size);
+	for (uint32_t i = 0; i < size; i++)
+		if (old[i].object)
+			*find_slot(table, old[i].handle) = old[i];
+	free(old);
+}
+
+/**
+ * intel_bb_object_table_init:
+ * @table: table to initialize
+ */
+void intel_bb_object_table_init(struct intel_bb_object_table *table)
+{
+	alloc_slots(table, TABLE_MIN_SIZE);
+	table->count = 0;
+	table->exec = 1;
+}
+
+/**
+ * intel_bb_object_table_fini:
+ * @table: table to release, with all its objects
+ */
+void intel_bb_object_table_fini(struct intel_bb_object_table *table)
+{
+	if (!table->slots)
+		return;
+
+	for (uint32_t i = 0; i <= table->mask; i++)
+		free(table->slots[i].object);
+	free(table->slots);
+	memset(table, 0, sizeof(*table));
+}
+
+/**
+ * intel_bb_object_table_find:
+ * @table: object table
+ * @handle: GEM handle
+ *
+ * Returns: the object of @handle, NULL if there is none.
+ */
+struct drm_i915_gem_exec_object2 *
+intel_bb_object_table_find(const struct intel_bb_object_table *table,
+			   uint32_t handle)
+{
+	return find_slot(table, handle)->object;
+}
+
+/**
+ * intel_bb_object_table_add:
+ * @table: object table
+ * @handle: GEM handle
+ * @added: set to true if the object was created
+ *
+ * Returns: the object of @handle, created zeroed but for its handle if
+ * there was none.
+ */
+struct drm_i915_gem_exec_object2 *
+intel_bb_object_table_add(struct intel_bb_object_table *table,
+			  uint32_t handle, bool *added)
+{
+	struct intel_bb_object_slot *slot = find_slot(table, handle);
+
+	*added = !slot->object;
+	if (slot->object)
+		return slot->object;
+
+	/* Keep the load below 3/4 */
+	if (4 * (table->count + 1) > 3 * (table->mask + 1)) {
+		grow(table);
+		slot = find_slot(table, handle);
+	}
+
+	slot->object = calloc(1, sizeof(*slot->object));
+	igt_assert(slot->object);
+	slot->object->handle = handle;
+	slot->handle = handle;
+	slot->exec = 0;
+	table->count++;
+
+	return slot->object;
+}
+
+/**
+ * intel_bb_object_table_remove:
+ * @table: object table
+ * @handle: GEM handle
+ *
+ * Removes and frees the object of @handle.
+ *
+ * Returns: false if there was no object for @handle.
+ */
+bool intel_bb_object_table_remove(struct intel_bb_object_table *table,
+				  uint32_t handle)
+{
+	struct intel_bb_object_slot *slot = find_slot(table, handle);
+	uint32_t i = slot - table->slots, j = i;
+
+	if (!slot->object)
+		return false;
+
+	free(slot->object);
+	table->count--;
+
+	/* Shift back the following entries which may not be found otherwise */
+	for (;;) {
+		uint32_t home;
+
+		j = (j + 1) & table->mask;
+		if (!table->slots[j].object)
+			break;
+
+		home = handle_hash(table->slots[j].handle) & table->mask;
+		if (((j - home) & table->mask) >= ((j - i) & table->mask)) {
+			table->slots[i] = table->slots[j];
+			i = j;
+		}
+	}
+	memset(&table->slots[i], 0, sizeof(table->slots[i]));
+
+	return true;
+}
+
+/**
+ * intel_bb_object_table_use:
+ * @table: object table
+ * @handle: GEM handle of an object of @table
+ *
+ * Marks the object of @handle as used by the current execbuf.
+ *
+ * Returns: true if it was not used yet.
+ */
+bool intel_bb_object_table_use(struct intel_bb_object_table *table,
+			       uint32_t handle)
+{
+	struct intel_bb_object_slot *slot = find_slot(table, handle);
+
+	igt_assert(slot->object);
+	if (slot->exec == table->exec)
+		return false;
+
+	slot->exec = table->exec;
+
+	return true;
+}
+
+/**
+ * intel_bb_object_table_unuse:
+ * @table: object table
+ * @handle: GEM handle
+ *
+ * Returns: true if the object of @handle was used by the current execbuf
+ * and no longer is.
+ */
+bool intel_bb_object_table_unuse(struct intel_bb_object_table *table,
+				 uint32_t handle)
+{
+	struct intel_bb_object_slot *slot = find_slot(table, handle);
+
+	if (!slot->object || slot->exec != table->exec)
+		return false;
+
+	slot->exec = 0;
+
+	return true;
+}
+
+/**
+ * intel_bb_object_table_new_exec:
+ * @table: object table
+ *
+ * Marks all the objects as unused, for the next execbuf.
+ */
+void intel_bb_object_table_new_exec(struct intel_bb_object_table *table)
+{
+	if (++table->exec)
+		return;
+
+	for (uint32_t i = 0; i <= table->mask; i++)
+		table->slots[i].exec = 0;
+	table->exec = 1;
+}
+
+/**
+ * intel_bb_object_table_for_each:
+ * @table: object table
+ * @fn: function to call
+ * @data: passed to @fn
+ *
+ * Calls @fn on every object of @table, in no particular order. @fn must
+ * not add nor remove objects.
+ */
+void intel_bb_object_table_for_each(const struct intel_bb_object_table *table,
+				    void (*fn)(struct drm_i915_gem_exec_object2 *object,
+					       void *data),
+				    void *data)
+{
+	for (uint32_t i = 0; i <= table->mask; i++)
+		if (table->slots[i].object)
+			fn(table->slots[i].object, data);
+}
+
+/**
+ * intel_bb_arena_alloc:
+ * @arena: scratch arena, zero initialized before first use
+ * @size: bytes needed
+ *
+ * Returns: @size bytes, aligned to 16 and not initialized, valid until the
+ * next intel_bb_arena_reset().
+ */
+void *intel_bb_arena_alloc(struct intel_bb_arena *arena, size_t size)
+{
+	struct intel_bb_arena_chunk *chunk = arena->chunk;
+	void *ptr;
+
+	size = (size + 15) & ~(size_t)15;
+	if (!chunk || arena->used + size > chunk->size) {
+		size_t chunk_size = chunk ? 2 * chunk->size : 4096;
+
+		while (chunk_size < size)
+			chunk_size *= 2;
+
+		/* Older chunks stay until the reset, their memory is in use */
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		igt_assert(chunk);
+		chunk->next = arena->chunk;
+		chunk->size = chunk_size;
+		arena->chunk = chunk;
+		arena->used = 0;
+	}
+
+	ptr = chunk->data + arena->used;
+	arena->used += size;
+
+	return ptr;
+}
+
+/**
+ * intel_bb_arena_reset:
+ * @arena: scratch arena
+ *
+ * Releases everything allocated from @arena. Only the biggest chunk is
+ * kept, so that once it has grown enough the arena no longer allocates.
+ */
+void intel_bb_arena_reset(struct intel_bb_arena *arena)
+{
+	struct intel_bb_arena_chunk *chunk = arena->chunk;
+
+	if (!chunk)
+		return;
+
+	while (chunk->next) {
+		struct intel_bb_arena_chunk *next = chunk->next;
+
+		chunk->next = next->next;
+		free(next);
+	}
+	arena->used = 0;
+}
+
+/**
+ * intel_bb_arena_fini:
+ * @arena: scratch arena to release
+ */
+void intel_bb_arena_fini(struct intel_bb_arena *arena)
+{
+	intel_bb_arena_reset(arena);
+	free(arena->chunk);
+	arena->chunk = NULL;
+}
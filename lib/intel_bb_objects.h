@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#ifndef INTEL_BB_OBJECTS_H
+#define INTEL_BB_OBJECTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <i915_drm.h>
+
+struct intel_bb_object_slot {
+	uint32_t handle;
+	uint32_t exec;		/* intel_bb_object_table.exec when in use */
+	struct drm_i915_gem_exec_object2 *object;	/* NULL for free slots */
+};
+
+/*
+ * Exec objects by GEM handle, open addressed with linear probing. The
+ * objects themselves are allocated once per handle so that pointers to them
+ * stay valid until they are removed.
+ */
+struct intel_bb_object_table {
+	struct intel_bb_object_slot *slots;
+	uint32_t mask;
+	uint32_t count;
+	uint32_t exec;
+};
+
+struct intel_bb_arena_chunk;
+
+/* Bump allocator for the scratch memory of one execbuf */
+struct intel_bb_arena {
+	struct intel_bb_arena_chunk *chunk;
+	size_t used;
+};
+
+void intel_bb_object_table_init(struct intel_bb_object_table *table);
+void intel_bb_object_table_fini(struct intel_bb_object_table *table);
+
+struct drm_i915_gem_exec_object2 *
+intel_bb_object_table_find(const struct intel_bb_object_table *table,
+			   uint32_t handle);
+struct drm_i915_gem_exec_object2 *
+intel_bb_object_table_add(struct intel_bb_object_table *table,
+			  uint32_t handle, bool *added);
+bool intel_bb_object_table_remove(struct intel_bb_object_table *table,
+				  uint32_t handle);
+
+bool intel_bb_object_table_use(struct intel_bb_object_table *table,
+			       uint32_t handle);
+bool intel_bb_object_table_unuse(struct intel_bb_object_table *table,
+				 uint32_t handle);
+void intel_bb_object_table_new_exec(struct intel_bb_object_table *table);
+
+void intel_bb_object_table_for_each(const struct intel_bb_object_table *table,
+				    void (*fn)(struct drm_i915_gem_exec_object2 *object,
+					       void *data),
+				    void *data);
+
+void *intel_bb_arena_alloc(struct intel_bb_arena *arena, size_t size);
+void intel_bb_arena_reset(struct intel_bb_arena *arena);
+void intel_bb_arena_fini(struct intel_bb_arena *arena);
+
+#endif /* INTEL_BB_OBJECTS_H */
@@ -29,6 +29,7 @@
 #include "igt.h"
 #include "igt_x86.h"
 #include "intel_bufops.h"
+#include "intel_detile.h"
 #include "intel_mocs.h"
 #include "intel_pat.h"
 #include "xe/xe_ioctl.h"
@@ -671,11 +672,38 @@ static void munmap_read(void *map, int fd, const struct intel_buf *buf, bool mal
 		munmap(map, buf->surface[0].size);
 }
 
+/*
+ * The tile row copies of intel_detile match the gen4+ layouts, older
+ * platforms and swizzled surfaces still go through the per pixel path.
+ */
+static bool use_detile(int fd, const struct intel_buf *buf,
+		       int tiling, uint32_t swizzle)
+{
+	const struct intel_device_info *info =
+		intel_get_device_info(intel_get_drm_devid(fd));
+
+	return !swizzle && buf->bpp == 32 && info->graphics_ver >= 4 &&
+	       intel_detile_supported(tiling, buf->bpp / 8);
+}
+
+static void detile_surface(const struct intel_buf *buf, void *map, int tiling,
+			   struct intel_detile_surface *surf)
+{
+	*surf = (struct intel_detile_surface) {
+		.ptr = map,
+		.stride = buf->surface[0].stride,
+		.width = intel_buf_width(buf),
+		.height = intel_buf_height(buf),
+		.cpp = buf->bpp / 8,
+		.tiling = tiling,
+	};
+}
+
 static void __copy_linear_to(int fd, struct intel_buf *buf,
 			     const uint32_t *linear,
 			     int tiling, uint32_t swizzle)
 {
-	const tile_fn fn = __get_tile_fn_ptr(fd, tiling);
+	tile_fn fn;
 	int height = intel_buf_height(buf);
 	int width = intel_buf_width(buf);
 	bool malloced;
@@ -683,6 +711,16 @@ static void __copy_linear_to(int fd, struct intel_buf *buf,
 
 	map = mmap_write(fd, buf, &malloced);
 
+	if (use_detile(fd, buf, tiling, swizzle)) {
+		struct intel_detile_surface surf;
+
+		detile_surface(buf, map, tiling, &surf);
+		intel_detile_from_linear(&surf, linear, width * sizeof(*linear));
+		munmap_write(map, fd, buf, malloced);
+		return;
+	}
+
+	fn = __get_tile_fn_ptr(fd, tiling);
 	for (int y = 0; y < height; y++) {
 		for (int x = 0; x < width; x++) {
 			uint32_t *ptr = fn(map, x, y, buf->surface[0].stride, buf->bpp/8);
@@ -742,7 +780,7 @@ static void copy_linear_to_tile4(struct buf_ops *bops, struct intel_buf *buf,
 static void __copy_to_linear(int fd, struct intel_buf *buf,
 			     uint32_t *linear, int tiling, uint32_t swizzle)
 {
-	const tile_fn fn = __get_tile_fn_ptr(fd, tiling);
+	tile_fn fn;
 	int height = intel_buf_height(buf);
 	int width = intel_buf_width(buf);
 	bool malloced;
@@ -750,6 +788,16 @@ static void __copy_to_linear(int fd, struct intel_buf *buf,
 
 	map = mmap_write(fd, buf, &malloced);
 
+	if (use_detile(fd, buf, tiling, swizzle)) {
+		struct intel_detile_surface surf;
+
+		detile_surface(buf, map, tiling, &surf);
+		intel_detile_to_linear(&surf, linear, width * sizeof(*linear));
+		munmap_write(map, fd, buf, malloced);
+		return;
+	}
+
+	fn = __get_tile_fn_ptr(fd, tiling);
 	for (int y = 0; y < height; y++) {
 		for (int x = 0; x < width; x++) {
 			uint32_t *ptr = fn(map, x, y, buf->surface[0].stride, buf->bpp/8);
@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+/**
+ * SECTION:intel_detile
+ * @short_description: CPU (de)tiling of Intel surfaces
+ * @title: Intel detile
+ * @include: intel_detile.h
+ *
+ * Converts between tiled surfaces and linear memory on the CPU. Instead
+ * of computing the address of every pixel, each tile row is copied in
+ * the largest chunks which are contiguous in both layouts: a whole
+ * 512 byte row for X tiling and 16 byte owords for the Y family, Ys and
+ * Tile64 included. Large surfaces are split into bands of tile rows
+ * processed in parallel.
+ *
+ * Only the main surface is touched. For compressed modifiers the caller
+ * points the surface at the plane offset and the CCS data is ignored.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drm_fourcc.h"
+#include "igt_aux.h"
+#include "igt_core.h"
+#include "intel_batchbuffer.h"
+#include "intel_detile.h"
+
+#define OWORD 16
+#define MAX_CHUNKS (64 * 1024 / OWORD)
+#define MAX_THREADS 32
+#define PARALLEL_THRESHOLD (4 << 20)
+
+struct tile_layout {
+	uint32_t width;		/* bytes */
+	uint32_t height;	/* rows */
+	uint32_t chunk;		/* bytes contiguous in both layouts */
+	const char *swizzle;
+	uint16_t offset[MAX_CHUNKS]; /* [row][chunk] offset in the tile */
+};
+
+struct detile_work {
+	const struct intel_detile_surface *surf;
+	const struct tile_layout *layout;
+	uint8_t *linear;
+	uint32_t linear_stride;
+	uint32_t first_row, last_row; /* tile rows, last excluded */
+	bool to_linear;
+};
+
+/*
+ * Byte address within a tile, msb to lsb: each x takes the next bit of the
+ * byte column and each y the next bit of the row.
+ *
+ * Yf and Ys use the standard swizzle, which depends on the pixel size: a Ys
+ * tile extends the 4k Yf tile of the same bpp to 64k. Tile64 is made of 16
+ * 4k Tile4 blocks, laid out in x first Z order within the limits of the
+ * tile size of each bpp.
+ */
+static const char *get_swizzle(uint32_t tiling, uint32_t cpp)
+{
+	switch (tiling) {
+	case I915_TILING_X:
+		return "yyyxxxxxxxxx";
+	case I915_TILING_Y:
+		return "xxxyyyyyxxxx";
+	case I915_TILING_4:
+		return "yyxyxxyyxxxx";
+	case I915_TILING_Yf:
+		switch (cpp) {
+		case 1:
+			return "yxyxyyyyxxxx";
+		case 2:
+		case 4:
+			return "xyxyxyyyxxxx";
+		case 8:
+		case 16:
+			return "xyxyxxyyxxxx";
+		}
+		break;
+	case I915_TILING_Ys:
+		switch (cpp) {
+		case 1:
+			return "yxyxyxyxyyyyxxxx";
+		case 2:
+		case 4:
+			return "xyxyxyxyxyyyxxxx";
+		case 8:
+		case 16:
+			return "xyxyxyxyxxyyxxxx";
+		}
+		break;
+	case I915_TILING_64:
+		switch (cpp) {
+		case 1:
+			return "yyyxyyxyxxyyxxxx";
+		case 2:
+		case 4:
+			return "yxyxyyxyxxyyxxxx";
+		case 8:
+		case 16:
+			return "xxyxyyxyxxyyxxxx";
+		}
+		break;
+	}
+
+	return NULL;
+}
+
+/* Offset within the tile of byte column @x in row @r */
+static uint32_t swizzle_offset(const char *swizzle, uint32_t x, uint32_t r)
+{
+	uint32_t offset = 0;
+	int bit = 0, i;
+
+	for (i = strlen(swizzle) - 1; i >= 0; i--, bit++) {
+		if (swizzle[i] == 'x') {
+			offset |= (x & 1) << bit;
+			x >>= 1;
+		} else {
+			offset |= (r & 1) << bit;
+			r >>= 1;
+		}
+	}
+
+	return offset;
+}
+
+static bool get_geometry(uint32_t tiling, uint32_t cpp,
+			 struct tile_layout *layout)
+{
+	const char *c;
+
+	if (tiling == I915_TILING_NONE) {
+		/* A single row "tile", copied one line at a time */
+		layout->width = 0;
+		layout->height = 1;
+		layout->chunk = 0;
+		layout->swizzle = NULL;
+		return true;
+	}
+
+	layout->swizzle = get_swizzle(tiling, cpp);
+	if (!layout->swizzle)
+		return false;
+
+	layout->width = 1;
+	layout->height = 1;
+	for (c = layout->swizzle; *c; c++) {
+		if (*c == 'x')
+			layout->width <<= 1;
+		else
+			layout->height <<= 1;
+	}
+
+	/* The low x bits are contiguous in both layouts */
+	layout->chunk = 1;
+	while (c-- > layout->swizzle && *c == 'x')
+		layout->chunk <<= 1;
+
+	return true;
+}
+
+static bool get_layout(uint32_t tiling, uint32_t cpp,
+		       struct tile_layout *layout)
+{
+	uint32_t r, c, cpr;
+
+	if (!get_geometry(tiling, cpp, layout))
+		return false;
+
+	if (!layout->width)
+		return true;
+
+	cpr = layout->width / layout->chunk;
+	for (r = 0; r < layout->height; r++)
+		for (c = 0; c < cpr; c++)
+			layout->offset[r * cpr + c] =
+				swizzle_offset(layout->swizzle,
+					       c * layout->chunk, r);
+
+	return true;
+}
+
+/**
+ * intel_detile_supported:
+ * @tiling: I915_TILING_* value
+ * @cpp: bytes per pixel
+ *
+ * Returns: true if @tiling can be converted by this library. The Yf, Ys
+ * and Tile64 layouts depend on the pixel size and only exist for 1, 2, 4,
+ * 8 and 16 bytes per pixel.
+ */
+bool intel_detile_supported(uint32_t tiling, uint32_t cpp)
+{
+	struct tile_layout layout;
+
+	return get_geometry(tiling, cpp, &layout);
+}
+
+/**
+ * intel_detile_tiling_from_modifier:
+ * @modifier: framebuffer modifier
+ *
+ * Maps a framebuffer modifier to the tiling of its main surface, so
+ * compressed modifiers map to their uncompressed base layout.
+ *
+ * Returns: I915_TILING_* value, or -1 for unknown modifiers.
+ */
+uint32_t intel_detile_tiling_from_modifier(uint64_t modifier)
+{
+	switch (modifier) {
+	case DRM_FORMAT_MOD_LINEAR:
+		return I915_TILING_NONE;
+	case I915_FORMAT_MOD_X_TILED:
+		return I915_TILING_X;
+	case I915_FORMAT_MOD_Y_TILED:
+	case I915_FORMAT_MOD_Y_TILED_CCS:
+	case I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS:
+	case I915_FORMAT_MOD_Y_TILED_GEN12_MC_CCS:
+	case I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS_CC:
+		return I915_TILING_Y;
+	case I915_FORMAT_MOD_Yf_TILED:
+	case I915_FORMAT_MOD_Yf_TILED_CCS:
+		return I915_TILING_Yf;
+	case I915_FORMAT_MOD_4_TILED:
+	case I915_FORMAT_MOD_4_TILED_DG2_RC_CCS:
+	case I915_FORMAT_MOD_4_TILED_DG2_MC_CCS:
+	case I915_FORMAT_MOD_4_TILED_DG2_RC_CCS_CC:
+	case I915_FORMAT_MOD_4_TILED_MTL_RC_CCS:
+	case I915_FORMAT_MOD_4_TILED_MTL_MC_CCS:
+	case I915_FORMAT_MOD_4_TILED_MTL_RC_CCS_CC:
+	case I915_FORMAT_MOD_4_TILED_LNL_CCS:
+	case I915_FORMAT_MOD_4_TILED_BMG_CCS:
+		return I915_TILING_4;
+	}
+
+	return -1;
+}
+
+/**
+ * intel_detile_tile_size:
+ * @tiling: supported I915_TILING_* value
+ * @cpp: bytes per pixel
+ * @width_bytes: returns the tile width in bytes, 0 for linear
+ * @height: returns the tile height in rows
+ */
+void intel_detile_tile_size(uint32_t tiling, uint32_t cpp,
+			    uint32_t *width_bytes, uint32_t *height)
+{
+	struct tile_layout layout;
+
+	igt_assert(get_geometry(tiling, cpp, &layout));
+
+	*width_bytes = layout.width;
+	*height = layout.height;
+}
+
+/**
+ * intel_detile_offset:
+ * @surf: tiled surface
+ * @x: pixel column
+ * @y: pixel row
+ *
+ * Returns: byte offset of pixel (@x, @y) from the start of @surf.
+ */
+uint64_t intel_detile_offset(const struct intel_detile_surface *surf,
+			     uint32_t x, uint32_t y)
+{
+	struct tile_layout layout;
+	uint32_t xb = x * surf->cpp;
+	uint32_t tw, th;
+	uint64_t base;
+
+	igt_assert(get_geometry(surf->tiling, surf->cpp, &layout));
+
+	if (surf->tiling == I915_TILING_NONE)
+		return (uint64_t)y * surf->stride + xb;
+
+	tw = layout.width;
+	th = layout.height;
+	base = (uint64_t)(y / th) * surf->stride * th +
+	       (uint64_t)(xb / tw) * tw * th;
+
+	return base + swizzle_offset(layout.swizzle, xb % tw, y % th);
+}
+
+static void copy_tile_rows(const struct detile_work *work)
+{
+	const struct intel_detile_surface *surf = work->surf;
+	const struct tile_layout *layout = work->layout;
+	const uint32_t row_bytes = surf->width * surf->cpp;
+	const uint32_t th = layout->height;
+	uint32_t ty, r, tx, c;
+
+	for (ty = work->first_row; ty < work->last_row; ty++) {
+		uint8_t *tiled = (uint8_t *)surf->ptr + (uint64_t)ty * th * surf->stride;
+
+		for (r = 0; r < th && ty * th + r < surf->height; r++) {
+			uint8_t *linear = work->linear +
+				(uint64_t)(ty * th + r) * work->linear_stride;
+
+			if (!layout->width) {
+				if (work->to_linear)
+					memcpy(linear, tiled + (uint64_t)r * surf->stride, row_bytes);
+				else
+					memcpy(tiled + (uint64_t)r * surf->stride, linear, row_bytes);
+				continue;
+			}
+
+			for (tx = 0; tx * layout->width < row_bytes; tx++) {
+				uint8_t *tile = tiled + (uint64_t)tx * layout->width * th;
+				uint32_t cpr = layout->width / layout->chunk;
+				const uint16_t *offset = &layout->offset[r * cpr];
+
+				for (c = 0; c < cpr; c++) {
+					uint32_t lx = tx * layout->width + c * layout->chunk;
+					uint32_t len;
+
+					if (lx >= row_bytes)
+						break;
+
+					len = min(layout->chunk, row_bytes - lx);
+					if (work->to_linear)
+						memcpy(linear + lx, tile + offset[c], len);
+					else
+						memcpy(tile + offset[c], linear + lx, len);
+				}
+			}
+		}
+	}
+}
+
+static void *copy_tile_rows_thread(void *data)
+{
+	copy_tile_rows(data);
+
+	return NULL;
+}
+
+static void detile_copy(const struct intel_detile_surface *surf,
+			uint8_t *linear, uint32_t linear_stride, bool to_linear)
+{
+	struct detile_work work[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	struct tile_layout layout;
+	uint32_t tile_rows, nthreads, i;
+
+	igt_assert_f(get_layout(surf->tiling, surf->cpp, &layout),
+		     "Unsupported tiling %u at %u bytes per pixel\n",
+		     surf->tiling, surf->cpp);
+	igt_assert(!layout.width || surf->stride % layout.width == 0);
+	igt_assert(linear_stride >= surf->width * surf->cpp);
+
+	tile_rows = DIV_ROUND_UP(surf->height, layout.height);
+
+	nthreads = 1;
+	if ((uint64_t)surf->stride * surf->height >= PARALLEL_THRESHOLD)
+		nthreads = min_t(uint32_t, sysconf(_SC_NPROCESSORS_ONLN), MAX_THREADS);
+	nthreads = max(min(nthreads, tile_rows), 1u);
+
+	for (i = 0; i < nthreads; i++) {
+		work[i] = (struct detile_work) {
+			.surf = surf,
+			.layout = &layout,
+			.linear = linear,
+			.linear_stride = linear_stride,
+			.first_row = tile_rows * i / nthreads,
+			.last_row = tile_rows * (i + 1) / nthreads,
+			.to_linear = to_linear,
+		};
+	}
+
+	for (i = 1; i < nthreads; i++)
+		igt_assert_eq(pthread_create(&threads[i], NULL,
+					     copy_tile_rows_thread, &work[i]), 0);
+
+	copy_tile_rows(&work[0]);
+
+	for (i = 1; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/**
+ * intel_detile_to_linear:
+ * @surf: tiled source surface
+ * @linear: destination, @surf->height rows of @linear_stride bytes
+ * @linear_stride: destination stride in bytes
+ *
+ * Copies the visible area of @surf into linear memory.
+ */
+void intel_detile_to_linear(const struct intel_detile_surface *surf,
+			    void *linear, uint32_t linear_stride)
+{
+	detile_copy(surf, linear, linear_stride, true);
+}
+
+/**
+ * intel_detile_from_linear:
+ * @surf: tiled destination surface
+ * @linear: source, @surf->height rows of @linear_stride bytes
+ * @linear_stride: source stride in bytes
+ *
+ * Copies linear memory into the visible area of @surf. Padding
+ * outside of the visible area is left untouched.
+ */
+void intel_detile_from_linear(const struct intel_detile_surface *surf,
+			      const void *linear, uint32_t linear_stride)
+{
+	detile_copy(surf, (uint8_t *)linear, linear_stride, false);
+}
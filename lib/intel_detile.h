@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#ifndef __INTEL_DETILE_H__
+#define __INTEL_DETILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * struct intel_detile_surface - description of a CPU mapped tiled surface
+ * @ptr:     start of the main surface, i.e. the mapping plus the plane
+ *           offset. Auxiliary (CCS) data is never touched.
+ * @stride:  surface stride in bytes, a multiple of the tile width
+ * @width:   width in pixels
+ * @height:  height in pixels
+ * @cpp:     bytes per pixel
+ * @tiling:  one of I915_TILING_NONE, _X, _Y, _Yf, _Ys, _4 or _64
+ *
+ * Describes a surface laid out with the gen4+ tiling formats.
+ */
+struct intel_detile_surface {
+	void *ptr;
+	uint32_t stride;
+	uint32_t width;
+	uint32_t height;
+	uint32_t cpp;
+	uint32_t tiling;
+};
+
+bool intel_detile_supported(uint32_t tiling, uint32_t cpp);
+uint32_t intel_detile_tiling_from_modifier(uint64_t modifier);
+void intel_detile_tile_size(uint32_t tiling, uint32_t cpp,
+			    uint32_t *width_bytes, uint32_t *height);
+uint64_t intel_detile_offset(const struct intel_detile_surface *surf,
+			     uint32_t x, uint32_t y);
+
+void intel_detile_to_linear(const struct intel_detile_surface *surf,
+			    void *linear, uint32_t linear_stride);
+void intel_detile_from_linear(const struct intel_detile_surface *surf,
+			      const void *linear, uint32_t linear_stride);
+
+#endif /* __INTEL_DETILE_H__ */
@@ -1,6 +1,7 @@
 #include "intel_chipset.h"
 #include "pciids.h"
 #include "i915_pciids_local.h"
+#include "intel_device_info_table.h" /* generated by intel-device-info-codegen.py */
 
 #include <strings.h> /* ffs() */
 
@@ -715,35 +716,43 @@ static const struct pci_id_match intel_device_match[] = {
 
 #undef INTEL_PCI_ID_INIT
 
+_Static_assert(sizeof(intel_device_match) / sizeof(intel_device_match[0]) ==
+	       INTEL_DEVICE_MATCH_COUNT + 1,
+	       "intel_device_info_table.h is out of date with intel_device_match[]");
+
 /**
  * intel_get_device_info:
  * @devid: pci device id
  *
- * Looks up the Intel GFX device info for the given device id.
+ * Looks up the Intel GFX device info for the given device id, in constant
+ * time through a perfect hash table generated at build time.
  *
  * Returns:
  * The associated intel_get_device_info
  */
 const struct intel_device_info *intel_get_device_info(uint16_t devid)
 {
-	static __thread const struct intel_device_info *cache = &intel_generic_info;
-	static __thread uint16_t cached_devid;
-	int i;
+	const struct pci_id_match *match;
 
-	if (cached_devid == devid)
-		goto out;
+	match = &intel_device_match[intel_device_hash(devid)];
+	if (match->device_id != devid)
+		match = &intel_device_match[INTEL_DEVICE_MATCH_COUNT];
 
-	/* XXX Presort table and bsearch! */
-	for (i = 0; intel_device_match[i].device_id != PCI_MATCH_ANY; i++) {
-		if (devid == intel_device_match[i].device_id)
-			break;
-	}
+	return (void *)match->match_data;
+}
 
-	cached_devid = devid;
-	cache = (void *)intel_device_match[i].match_data;
+/**
+ * intel_get_device_ids:
+ * @count: returns the number of device ids
+ *
+ * Returns:
+ * The device ids with a known device info, in increasing order
+ */
+const uint16_t *intel_get_device_ids(unsigned int *count)
+{
+	*count = sizeof(intel_device_ids) / sizeof(intel_device_ids[0]);
 
-out:
-	return cache;
+	return intel_device_ids;
 }
 
 /**
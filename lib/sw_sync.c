@@ -148,6 +148,139 @@ int sync_fence_merge(int fd1, int fd2)
 	return data.fence;
 }
 
+/**
+ * __sw_sync_timeline_create_fences:
+ * @fd: the timeline
+ * @seqno: seqno of the first fence
+ * @count: number of fences to create
+ * @fences: array of @count, receives the fences
+ *
+ * Creates the fences @seqno, @seqno + 1, ... @seqno + @count - 1 on the
+ * timeline. On failure, none of the fences are left open.
+ *
+ * Returns: 0 on success, or a negative error code.
+ */
+int __sw_sync_timeline_create_fences(int fd, uint32_t seqno,
+				     unsigned int count, int *fences)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		fences[i] = __sw_sync_timeline_create_fence(fd, seqno + i);
+		if (fences[i] < 0) {
+			int err = fences[i];
+
+			while (i--)
+				close(fences[i]);
+
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * sw_sync_timeline_create_fences:
+ * @fd: the timeline
+ * @seqno: seqno of the first fence
+ * @count: number of fences to create
+ * @fences: array of @count, receives the fences
+ *
+ * Like __sw_sync_timeline_create_fences(), but asserts on failure.
+ */
+void sw_sync_timeline_create_fences(int fd, uint32_t seqno,
+				    unsigned int count, int *fences)
+{
+	igt_assert_eq(__sw_sync_timeline_create_fences(fd, seqno, count, fences), 0);
+}
+
+/**
+ * __sync_fence_merge_tree:
+ * @fences: the fences to merge
+ * @count: number of @fences
+ *
+ * Merges all of @fences into a single new fence. The fences are merged
+ * pairwise, then the results pairwise and so on, so each fence is copied
+ * about log2(@count) times instead of up to @count times when merging them
+ * one after the other into a chain. @fences are left open.
+ *
+ * Returns: the merged fence, or a negative error code.
+ */
+int __sync_fence_merge_tree(const int *fences, unsigned int count)
+{
+	const int *in = fences;
+	int *level;
+	int fence;
+
+	if (!count)
+		return -EINVAL;
+
+	if (count == 1) {
+		fence = dup(fences[0]);
+		return fence < 0 ? -errno : fence;
+	}
+
+	level = malloc(sizeof(*level) * ((count + 1) / 2));
+	if (!level)
+		return -ENOMEM;
+
+	while (count > 1) {
+		unsigned int i, n = 0;
+
+		for (i = 0; i < count; i += 2) {
+			/* An odd one out goes up a level as it is */
+			if (i + 1 == count) {
+				fence = in == fences ? dup(in[i]) : in[i];
+				if (fence < 0)
+					fence = -errno;
+			} else {
+				fence = sync_fence_merge(in[i], in[i + 1]);
+				if (in == level && fence >= 0) {
+					close(in[i]);
+					close(in[i + 1]);
+				}
+			}
+
+			if (fence < 0) {
+				while (in == level && i < count)
+					close(in[i++]);
+				while (n)
+					close(level[--n]);
+				free(level);
+
+				return fence;
+			}
+
+			level[n++] = fence;
+		}
+
+		in = level;
+		count = n;
+	}
+
+	fence = level[0];
+	free(level);
+
+	return fence;
+}
+
+/**
+ * sync_fence_merge_tree:
+ * @fences: the fences to merge
+ * @count: number of @fences
+ *
+ * Like __sync_fence_merge_tree(), but asserts on failure.
+ *
+ * Returns: the merged fence.
+ */
+int sync_fence_merge_tree(const int *fences, unsigned int count)
+{
+	int fence = __sync_fence_merge_tree(fences, count);
+
+	igt_assert_f(sw_sync_fd_is_valid(fence), "Failed to merge fences\n");
+
+	return fence;
+}
+
 int sync_fence_wait(int fd, int timeout)
 {
 	struct pollfd fds = { fd, POLLIN };
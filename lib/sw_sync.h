@@ -40,8 +40,14 @@ void sw_sync_timeline_inc(int timeline, uint32_t count);
 
 int __sw_sync_timeline_create_fence(int timeline, uint32_t seqno);
 int sw_sync_timeline_create_fence(int timeline, uint32_t seqno);
+int __sw_sync_timeline_create_fences(int timeline, uint32_t seqno,
+				     unsigned int count, int *fences);
+void sw_sync_timeline_create_fences(int timeline, uint32_t seqno,
+				    unsigned int count, int *fences);
 
 int sync_fence_merge(int fence1, int fence2);
+int __sync_fence_merge_tree(const int *fences, unsigned int count);
+int sync_fence_merge_tree(const int *fences, unsigned int count);
 int sync_fence_wait(int fence, int timeout);
 int sync_fence_status(int fence);
 int sync_fence_count(int fence);
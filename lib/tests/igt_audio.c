@@ -26,6 +26,8 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "igt_core.h"
 #include "igt_audio.h"
@@ -174,6 +176,172 @@ static void test_signal_detect_phaseshift(struct audio_signal *signal)
 	igt_assert(!ok);
 }
 
+#define ANALYZER_CHANNELS 8
+#define ANALYZER_RATE 48000
+
+static struct audio_signal *analyzer_signal(void)
+{
+	struct audio_signal *signal;
+	int i;
+
+	signal = audio_signal_init(ANALYZER_CHANNELS, ANALYZER_RATE);
+	audio_signal_add_frequency(signal, 5000, -1);
+	for (i = 0; i < ANALYZER_CHANNELS; i++)
+		igt_assert(audio_signal_add_frequency(signal, 300 + 400 * i, i) == 0);
+	audio_signal_synthesize(signal);
+
+	return signal;
+}
+
+static void test_analyzer_multichannel(void)
+{
+	struct audio_signal *signal = analyzer_signal();
+	struct audio_analyzer *analyzer;
+	double buf[ANALYZER_CHANNELS * BUFFER_LEN];
+	double channel[BUFFER_LEN];
+	uint32_t detected;
+	size_t i;
+	int c;
+
+	analyzer = audio_analyzer_init(signal, ANALYZER_RATE, BUFFER_LEN,
+				       BUFFER_LEN, ANALYZER_CHANNELS, NULL);
+
+	audio_signal_fill(signal, buf, BUFFER_LEN);
+	detected = audio_analyzer_detect(analyzer, buf);
+	igt_assert_eq_u32(detected, (1 << ANALYZER_CHANNELS) - 1);
+
+	/* Same verdict as one channel at a time */
+	for (c = 0; c < ANALYZER_CHANNELS; c++) {
+		for (i = 0; i < BUFFER_LEN; i++)
+			channel[i] = buf[i * ANALYZER_CHANNELS + c];
+		igt_assert(audio_signal_detect(signal, ANALYZER_RATE, c,
+					       channel, BUFFER_LEN));
+	}
+
+	/* A silent channel and two swapped ones are told apart */
+	for (i = 0; i < BUFFER_LEN; i++) {
+		double tmp = buf[i * ANALYZER_CHANNELS + 1];
+
+		buf[i * ANALYZER_CHANNELS + 1] = buf[i * ANALYZER_CHANNELS + 2];
+		buf[i * ANALYZER_CHANNELS + 2] = tmp;
+		buf[i * ANALYZER_CHANNELS + 5] = 0;
+	}
+	detected = audio_analyzer_detect(analyzer, buf);
+	igt_assert_eq_u32(detected, 0xff & ~(1 << 1 | 1 << 2 | 1 << 5));
+	igt_assert_eq(audio_analyzer_streak(analyzer), 0);
+
+	audio_analyzer_fini(analyzer);
+
+	/* Which is what a channel map is for */
+	analyzer = audio_analyzer_init(signal, ANALYZER_RATE, BUFFER_LEN,
+				       BUFFER_LEN, ANALYZER_CHANNELS,
+				       (const int[]){ 0, 2, 1, 3, 4, 5, 6, 7 });
+	detected = audio_analyzer_detect(analyzer, buf);
+	igt_assert_eq_u32(detected, 0xff & ~(1 << 5));
+	audio_analyzer_fini(analyzer);
+
+	audio_signal_fini(signal);
+}
+
+static void test_analyzer_streaming(void)
+{
+	const size_t hop = BUFFER_LEN / 4, frames = 10 * BUFFER_LEN;
+	struct audio_signal *signal = analyzer_signal();
+	struct audio_analyzer *analyzer, *analyzer_s32;
+	size_t windows = 0, windows_s32 = 0;
+	int32_t *buf_s32;
+	double *buf;
+	size_t i;
+
+	buf = malloc(frames * ANALYZER_CHANNELS * sizeof(*buf));
+	buf_s32 = malloc(frames * ANALYZER_CHANNELS * sizeof(*buf_s32));
+	igt_assert(buf && buf_s32);
+
+	audio_signal_fill(signal, buf, frames);
+	for (i = 0; i < frames * ANALYZER_CHANNELS; i++)
+		buf_s32[i] = buf[i] * INT32_MAX;
+
+	analyzer = audio_analyzer_init(signal, ANALYZER_RATE, BUFFER_LEN, hop,
+				       ANALYZER_CHANNELS, NULL);
+	analyzer_s32 = audio_analyzer_init(signal, ANALYZER_RATE, BUFFER_LEN, hop,
+					   ANALYZER_CHANNELS, NULL);
+
+	/* Chunks which never line up with the windows */
+	for (i = 0; i < frames; i += 317) {
+		size_t len = frames - i < 317 ? frames - i : 317;
+
+		windows += audio_analyzer_feed(analyzer, buf + i * ANALYZER_CHANNELS, len);
+		windows_s32 += audio_analyzer_feed_s32_le(analyzer_s32,
+							  buf_s32 + i * ANALYZER_CHANNELS,
+							  len);
+	}
+
+	igt_assert_eq(windows, 1 + (frames - BUFFER_LEN) / hop);
+	igt_assert_eq(audio_analyzer_windows(analyzer), windows);
+	igt_assert_eq(audio_analyzer_streak(analyzer), windows);
+	igt_assert_eq(windows_s32, windows);
+	igt_assert_eq(audio_analyzer_streak(analyzer_s32), windows);
+
+	/* A held sample breaks the streak of the windows covering it */
+	for (i = 0; i < 5; i++)
+		memcpy(&buf[(BUFFER_LEN / 2 + i) * ANALYZER_CHANNELS], buf,
+		       ANALYZER_CHANNELS * sizeof(*buf));
+	audio_analyzer_feed(analyzer, buf, BUFFER_LEN);
+	igt_assert_neq_u32(audio_analyzer_detected(analyzer), 0xff);
+
+	audio_analyzer_fini(analyzer_s32);
+	audio_analyzer_fini(analyzer);
+	free(buf_s32);
+	free(buf);
+	audio_signal_fini(signal);
+}
+
+static void test_analyzer_throughput(void)
+{
+	const size_t window = 2 * BUFFER_LEN, count = 64;
+	struct audio_signal *signal = analyzer_signal();
+	struct audio_analyzer *analyzer;
+	struct timespec start = {};
+	double *buf, *channel;
+	uint64_t batch_ns, single_ns;
+	size_t i, n;
+	int c;
+
+	buf = malloc(window * ANALYZER_CHANNELS * sizeof(*buf));
+	channel = malloc(window * sizeof(*channel));
+	igt_assert(buf && channel);
+	audio_signal_fill(signal, buf, window);
+
+	analyzer = audio_analyzer_init(signal, ANALYZER_RATE, window, window,
+				       ANALYZER_CHANNELS, NULL);
+
+	igt_nsec_elapsed(&start);
+	for (n = 0; n < count; n++)
+		igt_assert_eq_u32(audio_analyzer_detect(analyzer, buf), 0xff);
+	batch_ns = igt_nsec_elapsed(&start);
+
+	memset(&start, 0, sizeof(start));
+	igt_nsec_elapsed(&start);
+	for (n = 0; n < count; n++) {
+		for (c = 0; c < ANALYZER_CHANNELS; c++) {
+			for (i = 0; i < window; i++)
+				channel[i] = buf[i * ANALYZER_CHANNELS + c];
+			igt_assert(audio_signal_detect(signal, ANALYZER_RATE, c,
+						       channel, window));
+		}
+	}
+	single_ns = igt_nsec_elapsed(&start);
+
+	igt_info("%d channels of %zu samples: %.0f windows/s batched, %.0f windows/s one channel at a time\n",
+		 ANALYZER_CHANNELS, window, count * 1e9 / batch_ns,
+		 count * 1e9 / single_ns);
+
+	audio_analyzer_fini(analyzer);
+	free(channel);
+	free(buf);
+	audio_signal_fini(signal);
+}
+
 int igt_main()
 {
 	struct audio_signal *signal = NULL;
@@ -219,4 +387,13 @@ int igt_main()
 			audio_signal_fini(signal);
 		}
 	}
+
+	igt_subtest("analyzer-multichannel")
+		test_analyzer_multichannel();
+
+	igt_subtest("analyzer-streaming")
+		test_analyzer_streaming();
+
+	igt_subtest("analyzer-throughput")
+		test_analyzer_throughput();
 }
@@ -0,0 +1,370 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drmtest.h"
+#include "igt_chamelium_stream.h"
+#include "igt_core.h"
+
+/*
+ * A stand-in for the Chamelium stream server, speaking the same framed
+ * protocol: an 8 byte header (u16 kind << 8 | type, u16 error, u32
+ * length, all big endian) followed by the body.
+ */
+enum { KIND_REQUEST, KIND_RESPONSE, KIND_DATA };
+enum {
+	GET_VERSION = 1,
+	VIDEO_STREAM = 2,
+	VIDEO_FRAME = 4,
+	DUMP_REALTIME_VIDEO = 5,
+	STOP_DUMP_VIDEO = 6,
+};
+#define ERROR_COMMAND 1
+#define ERROR_VIDEO_MEM_OVERFLOW_DROP 5
+#define DROP_INTERVAL 16
+
+struct server {
+	int listen_fd;
+	int fd;
+	uint16_t port;
+	uint16_t width, height;
+	uint8_t *pixels;
+	bool late_responses;
+	pthread_t thread;
+};
+
+static bool server_write_header(struct server *srv, int kind, int type,
+				int err, size_t len)
+{
+	uint8_t buf[8];
+
+	*(uint16_t *)&buf[0] = htons(kind << 8 | type);
+	*(uint16_t *)&buf[2] = htons(err);
+	*(uint32_t *)&buf[4] = htonl(len);
+
+	return send(srv->fd, buf, sizeof(buf), MSG_NOSIGNAL) == sizeof(buf);
+}
+
+static bool server_write_all(struct server *srv, const void *buf, size_t len)
+{
+	while (len) {
+		ssize_t ret = send(srv->fd, buf, len, MSG_NOSIGNAL);
+
+		if (ret <= 0)
+			return false;
+		buf = (const uint8_t *)buf + ret;
+		len -= ret;
+	}
+
+	return true;
+}
+
+static bool server_read_all(struct server *srv, void *buf, size_t len)
+{
+	while (len) {
+		ssize_t ret = recv(srv->fd, buf, len, 0);
+
+		if (ret <= 0)
+			return false;
+		buf = (uint8_t *)buf + ret;
+		len -= ret;
+	}
+
+	return true;
+}
+
+/* Row y of frame n is filled with (n + y) & 0xff */
+static void fill_frame(uint8_t *pixels, uint32_t n, int width, int height)
+{
+	for (int y = 0; y < height; y++)
+		memset(pixels + (size_t)y * width * 3, (n + y) & 0xff, width * 3);
+}
+
+static bool server_send_frame(struct server *srv, int type, uint32_t n)
+{
+	size_t size = (size_t)srv->width * srv->height * 3;
+	uint8_t header[12] = {};
+
+	*(uint32_t *)&header[0] = htonl(n);
+	*(uint16_t *)&header[4] = htons(srv->width);
+	*(uint16_t *)&header[6] = htons(srv->height);
+
+	fill_frame(srv->pixels, n, srv->width, srv->height);
+
+	return server_write_header(srv, KIND_DATA, type, 0, sizeof(header) + size) &&
+	       server_write_all(srv, header, sizeof(header)) &&
+	       server_write_all(srv, srv->pixels, size);
+}
+
+static bool server_stream(struct server *srv)
+{
+	struct pollfd pfd = { .fd = srv->fd, .events = POLLIN };
+
+	for (uint32_t n = 0; !poll(&pfd, 1, 0); n++) {
+		/* Pretend to run out of memory now and then */
+		if (n % DROP_INTERVAL == DROP_INTERVAL - 1) {
+			if (!server_write_header(srv, KIND_DATA, DUMP_REALTIME_VIDEO,
+						 ERROR_VIDEO_MEM_OVERFLOW_DROP, 0))
+				return false;
+			continue;
+		}
+
+		if (!server_send_frame(srv, DUMP_REALTIME_VIDEO, n))
+			return false;
+	}
+
+	return true;
+}
+
+static void *server_thread(void *data)
+{
+	struct server *srv = data;
+	uint8_t header[8], body[16];
+
+	srv->fd = accept(srv->listen_fd, NULL, NULL);
+	igt_assert(srv->fd >= 0);
+
+	while (server_read_all(srv, header, sizeof(header))) {
+		int type = ntohs(*(uint16_t *)&header[0]) & 0xff;
+		size_t len = ntohl(*(uint32_t *)&header[4]);
+		bool ok = true;
+
+		igt_assert(len <= sizeof(body));
+		if (!server_read_all(srv, body, len))
+			break;
+
+		switch (type) {
+		case GET_VERSION:
+			ok = server_write_header(srv, KIND_RESPONSE, type, 0, 2) &&
+			     server_write_all(srv, (uint8_t[]){ 1, 0 }, 2);
+			break;
+		case VIDEO_STREAM:
+			srv->width = ntohs(*(uint16_t *)&body[0]);
+			srv->height = ntohs(*(uint16_t *)&body[2]);
+			free(srv->pixels);
+			srv->pixels = malloc((size_t)srv->width * srv->height * 3);
+			ok = server_write_header(srv, KIND_RESPONSE, type, 0, 0);
+			break;
+		case VIDEO_FRAME: {
+			uint32_t addr = ntohl(*(uint32_t *)&body[0]);
+			uint16_t count = ntohs(*(uint16_t *)&body[8]);
+
+			if (!srv->late_responses)
+				ok = server_write_header(srv, KIND_RESPONSE, type, 0, 0);
+			for (int i = 0; ok && i < count; i++)
+				ok = server_send_frame(srv, type, addr + i);
+			if (ok && srv->late_responses)
+				ok = server_write_header(srv, KIND_RESPONSE, type, 0, 0);
+			break;
+		}
+		case DUMP_REALTIME_VIDEO:
+			ok = server_write_header(srv, KIND_RESPONSE, type, 0, 0) &&
+			     server_stream(srv);
+			break;
+		case STOP_DUMP_VIDEO:
+			ok = server_write_header(srv, KIND_RESPONSE, type, 0, 0);
+			break;
+		default:
+			ok = server_write_header(srv, KIND_RESPONSE, type,
+						 ERROR_COMMAND, 0);
+			break;
+		}
+
+		if (!ok)
+			break;
+	}
+
+	close(srv->fd);
+	free(srv->pixels);
+
+	return NULL;
+}
+
+static struct chamelium_stream *server_start(struct server *srv)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t addr_len = sizeof(addr);
+	struct chamelium_stream *client;
+
+	memset(srv, 0, sizeof(*srv));
+	srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	igt_assert(srv->listen_fd >= 0);
+	igt_assert_eq(bind(srv->listen_fd, (void *)&addr, sizeof(addr)), 0);
+	igt_assert_eq(listen(srv->listen_fd, 1), 0);
+	igt_assert_eq(getsockname(srv->listen_fd, (void *)&addr, &addr_len), 0);
+	srv->port = ntohs(addr.sin_port);
+
+	igt_assert_eq(pthread_create(&srv->thread, NULL, server_thread, srv), 0);
+
+	client = chamelium_stream_init_with_address("127.0.0.1", srv->port);
+	igt_assert(client);
+
+	return client;
+}
+
+static void server_stop(struct server *srv, struct chamelium_stream *client)
+{
+	chamelium_stream_deinit(client);
+	pthread_join(srv->thread, NULL);
+	close(srv->listen_fd);
+}
+
+static bool frame_is_valid(const struct chamelium_stream_frame *frame,
+			   int width, int height)
+{
+	size_t stride = (size_t)width * 3;
+
+	if (frame->width != width || frame->height != height ||
+	    frame->size != stride * height)
+		return false;
+
+	for (int y = 0; y < height; y++) {
+		const uint8_t *row = frame->data + y * stride;
+
+		if (row[0] != ((frame->frame_number + y) & 0xff) ||
+		    memcmp(row, row + 1, stride - 1))
+			return false;
+	}
+
+	return true;
+}
+
+static void test_pipelined_frames(void)
+{
+	const uint32_t addrs[] = { 100, 200, 300 };
+	struct chamelium_stream_frame frame = {};
+	struct chamelium_stream *client;
+	struct server srv;
+	uint8_t *data = NULL;
+
+	client = server_start(&srv);
+	igt_assert(chamelium_stream_config_video(client, 64, 48));
+
+	/* All requests go out before the first frame is read */
+	for (int i = 0; i < ARRAY_SIZE(addrs); i++)
+		igt_assert(chamelium_stream_request_video_frames(client, addrs[i], 0, 2));
+
+	for (int i = 0; i < 2 * ARRAY_SIZE(addrs); i++) {
+		igt_assert(chamelium_stream_receive_video_frame(client, &frame));
+		igt_assert_eq_u32(frame.frame_number, addrs[i / 2] + i % 2);
+		igt_assert(frame_is_valid(&frame, 64, 48));
+
+		/* The buffer is reused once allocated */
+		if (data)
+			igt_assert(frame.data == data);
+		data = frame.data;
+	}
+
+	chamelium_stream_frame_fini(&frame);
+	server_stop(&srv, client);
+}
+
+struct capture_check {
+	int width, height;
+	uint32_t last;
+	int frames;
+	int stop_after;
+};
+
+static bool check_frame(const struct chamelium_stream_frame *frame, void *data)
+{
+	struct capture_check *check = data;
+
+	igt_assert(frame_is_valid(frame, check->width, check->height));
+	if (check->frames)
+		igt_assert_lt_u32(check->last, frame->frame_number);
+	check->last = frame->frame_number;
+
+	return ++check->frames != check->stop_after;
+}
+
+static void test_realtime_capture(void)
+{
+	struct capture_check check = { .width = 1920, .height = 1080 };
+	struct chamelium_stream *client;
+	struct timespec start = {};
+	struct server srv;
+	const int count = 60;
+	uint64_t elapsed;
+
+	client = server_start(&srv);
+	igt_assert(chamelium_stream_config_video(client, check.width, check.height));
+	igt_assert(chamelium_stream_dump_realtime_video(client, false,
+						CHAMELIUM_STREAM_REALTIME_BEST_EFFORT));
+
+	igt_nsec_elapsed(&start);
+	igt_assert_eq(chamelium_stream_capture_video(client, count,
+						     check_frame, &check), count);
+	elapsed = igt_nsec_elapsed(&start);
+
+	igt_info("Captured and compared %d 1080p frames at %.1f fps\n",
+		 count, count * 1e9 / elapsed);
+
+	/* Frame numbers skip the dropped ones */
+	igt_assert_eq(chamelium_stream_get_dropped_frames(client), check.last / DROP_INTERVAL);
+	igt_assert_eq_u32(check.last, count + (count - 1) / (DROP_INTERVAL - 1) - 1);
+
+	igt_assert(chamelium_stream_stop_realtime_video(client));
+	server_stop(&srv, client);
+}
+
+static void test_early_stop(void)
+{
+	struct capture_check check = { .width = 640, .height = 480, .stop_after = 5 };
+	struct chamelium_stream *client;
+	struct server srv;
+
+	client = server_start(&srv);
+	igt_assert(chamelium_stream_config_video(client, check.width, check.height));
+	igt_assert(chamelium_stream_dump_realtime_video(client, false,
+						CHAMELIUM_STREAM_REALTIME_BEST_EFFORT));
+
+	igt_assert_eq(chamelium_stream_capture_video(client, 100,
+						     check_frame, &check), 5);
+
+	/* Whatever is still in flight gets drained */
+	igt_assert(chamelium_stream_stop_realtime_video(client));
+	igt_assert(chamelium_stream_config_video(client, 32, 32));
+	server_stop(&srv, client);
+}
+
+static void test_late_response(void)
+{
+	struct capture_check check = { .width = 64, .height = 48 };
+	struct chamelium_stream *client;
+	struct server srv;
+
+	client = server_start(&srv);
+	srv.late_responses = true;
+	igt_assert(chamelium_stream_config_video(client, check.width, check.height));
+	igt_assert(chamelium_stream_request_video_frames(client, 100, 0, 3));
+
+	igt_assert_eq(chamelium_stream_capture_video(client, 3,
+						     check_frame, &check), 3);
+	igt_assert_eq_u32(check.last, 102);
+
+	/* The answer to the request trails its frames */
+	igt_assert(chamelium_stream_config_video(client, 32, 32));
+	server_stop(&srv, client);
+}
+
+int igt_simple_main()
+{
+	test_pipelined_frames();
+	test_realtime_capture();
+	test_early_stop();
+	test_late_response();
+}
@@ -0,0 +1,411 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <fcntl.h>
+#include <ftw.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "drmtest.h"
+#include "igt_core.h"
+#include "igt_device_scan.h"
+
+/* Values of the private device type enum */
+#define DEVTYPE_INTEGRATED 1
+#define DEVTYPE_DISCRETE 2
+
+/*
+ * The devices of the caches live in a fake sysfs tree, which also holds
+ * the uevent sequence number the caches are checked against.
+ */
+static char sysfs[] = "/tmp/igt_fake_sysfs.XXXXXX";
+static char seqnum_path[PATH_MAX];
+static uint64_t seqnum = 1000;
+
+static void write_file(const char *contents, const char *fmt, ...)
+{
+	char path[PATH_MAX];
+	va_list ap;
+	FILE *f;
+
+	va_start(ap, fmt);
+	vsnprintf(path, sizeof(path), fmt, ap);
+	va_end(ap);
+
+	f = fopen(path, "w");
+	igt_assert(f);
+	fputs(contents, f);
+	igt_assert_eq(fclose(f), 0);
+}
+
+static void set_seqnum(uint64_t value)
+{
+	char buf[32];
+
+	seqnum = value;
+	snprintf(buf, sizeof(buf), "%" PRIu64 "\n", seqnum);
+	write_file(buf, "%s", seqnum_path);
+}
+
+static void make_sysfs(void)
+{
+	char path[PATH_MAX];
+
+	igt_assert(mkdtemp(sysfs));
+	snprintf(path, sizeof(path), "%s/kernel", sysfs);
+	igt_assert_eq(mkdir(path, 0755), 0);
+	snprintf(path, sizeof(path), "%s/devices", sysfs);
+	igt_assert_eq(mkdir(path, 0755), 0);
+
+	snprintf(seqnum_path, sizeof(seqnum_path), "%s/kernel/uevent_seqnum", sysfs);
+	set_seqnum(seqnum);
+	igt_devices_set_uevent_seqnum_path(seqnum_path);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type,
+			struct FTW *ftw)
+{
+	return remove(path);
+}
+
+static void remove_sysfs(void)
+{
+	igt_devices_set_uevent_seqnum_path(NULL);
+	igt_assert_eq(nftw(sysfs, remove_entry, 16, FTW_DEPTH | FTW_PHYS), 0);
+}
+
+static void write_pci(FILE *f, const char *slot, const char *device,
+		      int dev_type, int gpu_index, bool attrs_loaded)
+{
+	fprintf(f,
+		"begin\n"
+		"subsystem pci\n"
+		"syspath %s/devices/%s\n"
+		"sysname %s\n"
+		"vendor 8086\n"
+		"device %s\n"
+		"pci_slot_name %s\n"
+		"driver xe\n"
+		"codename fake\n"
+		"gpu_index %d\n"
+		"dev_type %d\n"
+		"attrs_loaded %d\n"
+		"prop SUBSYSTEM pci\n"
+		"prop PCI_SLOT_NAME %s\n"
+		"prop PCI_ID 8086:%s\n",
+		sysfs, slot, slot, device, slot, gpu_index, dev_type,
+		attrs_loaded, slot, device);
+	if (attrs_loaded)
+		fprintf(f, "attr label line\\nwith \\\\escapes\n");
+	fprintf(f, "end\n");
+}
+
+static void write_drm(FILE *f, const char *slot, int minor)
+{
+	fprintf(f,
+		"begin\n"
+		"subsystem drm\n"
+		"syspath %s/devices/%s/drm/card%d\n"
+		"devnode /dev/dri/card%d\n"
+		"sysname card%d\n"
+		"drm_card /dev/dri/card%d\n"
+		"driver xe\n"
+		"parent %s/devices/%s\n"
+		"gpu_index -1\n"
+		"dev_type 0\n"
+		"attrs_loaded 1\n"
+		"prop SUBSYSTEM drm\n"
+		"end\n",
+		sysfs, slot, minor, minor, minor, minor, sysfs, slot);
+}
+
+static FILE *open_cache(char **path, uint64_t cache_seqnum)
+{
+	FILE *f;
+	int fd;
+
+	*path = strdup("/tmp/igt_device_scan_cache.XXXXXX");
+	igt_assert(*path);
+	fd = mkstemp(*path);
+	igt_assert(fd >= 0);
+	f = fdopen(fd, "w");
+	igt_assert(f);
+
+	fprintf(f, "IGT-DEVICE-SCAN-CACHE 2\nseqnum %" PRIu64 "\nlimit 1\n",
+		cache_seqnum);
+
+	return f;
+}
+
+static char *write_cache(uint64_t cache_seqnum, int nr_gpus)
+{
+	char *path;
+	FILE *f = open_cache(&path, cache_seqnum);
+
+	write_pci(f, "0000:00:02.0", "7d55", DEVTYPE_INTEGRATED, 0, true);
+	write_drm(f, "0000:00:02.0", 0);
+	for (int i = 1; i < nr_gpus; i++) {
+		char slot[16];
+
+		snprintf(slot, sizeof(slot), "0000:%02x:00.0", i);
+		write_pci(f, slot, "e20b", DEVTYPE_DISCRETE, i, true);
+		write_drm(f, slot, i);
+	}
+
+	igt_assert_eq(fclose(f), 0);
+
+	return path;
+}
+
+static void scan_from(const char *path)
+{
+	igt_assert_eq(setenv("IGT_DEVICE_SCAN_CACHE", path, 1), 0);
+	igt_devices_scan();
+}
+
+static void check_matches(int nr_gpus)
+{
+	struct igt_device_card card;
+	char filter[PATH_MAX];
+
+	igt_assert(igt_device_card_match("pci:vendor=8086,device=integrated", &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, "0000:00:02.0"), 0);
+	igt_assert_eq(card.pci_device, 0x7d55);
+
+	igt_assert(igt_device_card_match("pci:vendor=8086,device=discrete,card=1", &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, "0000:02:00.0"), 0);
+	igt_assert_eq(card.pci_device, 0xe20b);
+
+	snprintf(filter, sizeof(filter), "sys:%s/devices/0000:01:00.0/drm/card1", sysfs);
+	igt_assert(igt_device_card_match_pci(filter, &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, "0000:01:00.0"), 0);
+	igt_assert_eq(strcmp(card.card, ""), 0);
+
+	igt_assert(!igt_device_card_match("pci:vendor=8086,device=1234", &card));
+
+	snprintf(filter, sizeof(filter), "pci:vendor=8086,device=discrete,card=%d", nr_gpus - 2);
+	igt_assert(igt_device_card_match(filter, &card));
+	snprintf(filter, sizeof(filter), "pci:vendor=8086,device=discrete,card=%d", nr_gpus - 1);
+	igt_assert(!igt_device_card_match(filter, &card));
+}
+
+static void test_load(void)
+{
+	char *path = write_cache(seqnum, 4);
+
+	scan_from(path);
+	check_matches(4);
+
+	unlink(path);
+	free(path);
+}
+
+static void test_roundtrip(void)
+{
+	char *path = write_cache(seqnum, 3);
+	char saved[] = "/tmp/igt_device_scan_cache.XXXXXX";
+	int fd = mkstemp(saved);
+
+	igt_assert(fd >= 0);
+	close(fd);
+
+	scan_from(path);
+	igt_assert_eq(igt_devices_scan_cache_save(saved), 0);
+	unlink(path);
+	free(path);
+
+	/* Everything, escaped attributes included, must survive a reload */
+	scan_from(saved);
+	check_matches(3);
+	unlink(saved);
+}
+
+static void test_stale(void)
+{
+	char *path = write_cache(seqnum, 2);
+	struct igt_device_card card;
+	char filter[PATH_MAX];
+
+	snprintf(filter, sizeof(filter), "sys:%s/devices/0000:01:00.0/drm/card1", sysfs);
+	scan_from(path);
+	igt_assert(igt_device_card_match_pci(filter, &card));
+
+	/* A uevent since the cache was written means a real rescan */
+	set_seqnum(seqnum + 1);
+	igt_devices_scan();
+	igt_assert(!igt_device_card_match_pci(filter, &card));
+
+	unlink(path);
+	free(path);
+}
+
+/*
+ * Without attrs_loaded, attributes are read from the syspath of the
+ * devices when a filter first needs them. Here a PF with two VFs, which
+ * the sriov filters tell apart through sriov_numvfs and physfn.
+ */
+static void test_lazy_attrs(void)
+{
+	static const char * const slots[] = {
+		"0000:01:00.0", "0000:01:00.1", "0000:01:00.2",
+	};
+	struct igt_device_card card;
+	char dir[PATH_MAX], *path;
+	FILE *f;
+
+	for (int i = 0; i < ARRAY_SIZE(slots); i++) {
+		snprintf(dir, sizeof(dir), "%s/devices/%s", sysfs, slots[i]);
+		igt_assert_eq(mkdir(dir, 0755), 0);
+	}
+	write_file("2\n", "%s/devices/%s/sriov_numvfs", sysfs, slots[0]);
+	for (int i = 1; i < ARRAY_SIZE(slots); i++) {
+		snprintf(dir, sizeof(dir), "%s/devices/%s/physfn", sysfs, slots[i]);
+		igt_assert_eq(symlink("../0000:01:00.0", dir), 0);
+	}
+
+	f = open_cache(&path, seqnum);
+	write_pci(f, "0000:00:02.0", "7d55", DEVTYPE_INTEGRATED, 0, false);
+	for (int i = 0; i < ARRAY_SIZE(slots); i++)
+		write_pci(f, slots[i], "e20b", DEVTYPE_DISCRETE, i + 1, false);
+	igt_assert_eq(fclose(f), 0);
+
+	scan_from(path);
+
+	igt_assert(igt_device_card_match("sriov:vendor=8086,device=e20b,card=0", &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, slots[0]), 0);
+	igt_assert(igt_device_card_match("sriov:vendor=8086,device=e20b,card=0,vf=0", &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, slots[1]), 0);
+	igt_assert(igt_device_card_match("sriov:vendor=8086,device=e20b,card=0,vf=1", &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, slots[2]), 0);
+	igt_assert(!igt_device_card_match("sriov:vendor=8086,device=e20b,card=0,vf=2", &card));
+
+	/*
+	 * A VF found without sriov_numvfs must stay a VF: read again, the
+	 * attribute would make it the PF of the second VF lookup.
+	 */
+	write_file("0\n", "%s/devices/%s/sriov_numvfs", sysfs, slots[1]);
+	igt_assert(igt_device_card_match("sriov:vendor=8086,device=e20b,card=0,vf=1", &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, slots[2]), 0);
+
+	/* Loaded again, the devices see the attribute */
+	igt_devices_free();
+	scan_from(path);
+	igt_assert(!igt_device_card_match("sriov:vendor=8086,device=e20b,card=0,vf=1", &card));
+
+	unlink(path);
+	free(path);
+}
+
+/* The runner hands the cache over as an unlinked file */
+static void test_fd(void)
+{
+	char *path = write_cache(seqnum, 3);
+	char proc[32];
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	igt_assert(fd >= 0);
+	unlink(path);
+	free(path);
+
+	snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+	scan_from(proc);
+	check_matches(3);
+
+	close(fd);
+}
+
+static void test_reuse(void)
+{
+	char *path = write_cache(seqnum, 3);
+	char *other = write_cache(seqnum, 4);
+	struct igt_device_card card;
+	struct timespec times[2];
+	char buf[4096], *id;
+	struct stat st;
+	int fd, len;
+
+	scan_from(path);
+	check_matches(3);
+
+	/*
+	 * Changing the contents behind the back of the cache, keeping its
+	 * inode, size and modification time, still loads the devices again.
+	 */
+	igt_assert_eq(stat(path, &st), 0);
+	fd = open(path, O_RDWR);
+	igt_assert(fd >= 0);
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	igt_assert(len > 0);
+	buf[len] = '\0';
+	id = strstr(buf, "device e20b");
+	igt_assert(id);
+	igt_assert_eq(pwrite(fd, "c", 1, id - buf + strlen("device e20")), 1);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	igt_assert_eq(futimens(fd, times), 0);
+	close(fd);
+
+	igt_devices_scan();
+	igt_assert(igt_device_card_match("pci:vendor=8086,device=e20c", &card));
+	igt_assert_eq(strcmp(card.pci_slot_name, "0000:01:00.0"), 0);
+
+	/* A new cache is loaded, even through the same path */
+	igt_assert_eq(rename(other, path), 0);
+	igt_devices_scan();
+	check_matches(4);
+
+	unlink(path);
+	free(other);
+	free(path);
+}
+
+static void test_load_time(void)
+{
+	struct timespec start = {};
+	char *path = write_cache(seqnum, 256);
+	double load, reuse;
+
+	igt_assert_eq(setenv("IGT_DEVICE_SCAN_CACHE", path, 1), 0);
+	igt_devices_free();
+	igt_nsec_elapsed(&start);
+	igt_devices_scan();
+	load = igt_nsec_elapsed(&start) / 1e6;
+
+	memset(&start, 0, sizeof(start));
+	igt_nsec_elapsed(&start);
+	for (int i = 0; i < 100; i++)
+		igt_devices_scan();
+	reuse = igt_nsec_elapsed(&start) / 1e6 / 100;
+
+	igt_info("Loaded 512 devices in %.3fms, rescanned in %.3fms\n",
+		 load, reuse);
+	check_matches(256);
+
+	unlink(path);
+	free(path);
+}
+
+int igt_simple_main()
+{
+	make_sysfs();
+
+	test_load();
+	test_roundtrip();
+	test_stale();
+	test_lazy_attrs();
+	test_fd();
+	test_reuse();
+	test_load_time();
+
+	unsetenv("IGT_DEVICE_SCAN_CACHE");
+	igt_devices_free();
+	remove_sysfs();
+}
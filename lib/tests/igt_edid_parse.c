@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "drmtest.h"
+#include "igt_core.h"
+#include "igt_edid.h"
+#include "igt_kms.h"
+#include "igt_rand.h"
+
+static void check_desc(const struct edid_parsed *p, uint32_t index)
+{
+	struct edid_gen_desc desc;
+	const struct edid_parsed_dtd *dtd;
+
+	edid_gen_describe(index, &desc);
+
+	igt_assert_f(!p->errors, "EDID %u: errors 0x%x\n", index, p->errors);
+	igt_assert_eq(p->size, edid_gen_size(index));
+	igt_assert_eq(memcmp(p->mfg, "IGT", 3), 0);
+	igt_assert_eq_u32(p->serial, index);
+	igt_assert_eq(p->num_exts, 1 + desc.tiled);
+
+	/* Preferred mode in the base block and again in the CEA extension */
+	igt_assert_eq(p->num_dtds, 2);
+	for (int i = 0; i < p->num_dtds; i++) {
+		dtd = &p->dtds[i];
+		igt_assert_eq(dtd->clock, desc.mode.clock);
+		igt_assert_eq(dtd->hactive, desc.mode.hdisplay);
+		igt_assert_eq(dtd->hblank, desc.mode.htotal - desc.mode.hdisplay);
+		igt_assert_eq(dtd->vactive, desc.mode.vdisplay);
+		igt_assert_eq(dtd->vblank, desc.mode.vtotal - desc.mode.vdisplay);
+	}
+
+	igt_assert_eq(p->num_sads, desc.num_sads);
+	igt_assert_eq(p->num_svds, desc.num_svds);
+	igt_assert_eq(p->hdmi_vsdb, desc.hdmi_vsdb);
+	igt_assert_eq(p->deep_color, desc.deep_color);
+	igt_assert_eq(!!p->speakers, desc.speakers);
+	igt_assert_eq(p->num_blocks, !!desc.num_sads + !!desc.num_svds +
+				     desc.hdmi_vsdb + desc.speakers);
+	igt_assert_eq(p->first_block[EDID_CEA_DATA_VIDEO] >= 0, !!desc.num_svds);
+
+	igt_assert_eq(p->num_tiles, desc.tiled);
+	if (desc.tiled) {
+		igt_assert_eq(p->tiles[0].num_htiles, 2);
+		igt_assert_eq(p->tiles[0].num_vtiles, 1);
+		igt_assert_eq(p->tiles[0].htile, desc.htile);
+		igt_assert_eq(p->tiles[0].vtile, 0);
+		igt_assert_eq(p->tiles[0].hsize, desc.mode.hdisplay);
+		igt_assert_eq(p->tiles[0].vsize, desc.mode.vdisplay);
+	}
+}
+
+static void test_roundtrip(void)
+{
+	const uint32_t count = EDID_GEN_PERMUTATIONS;
+	size_t size = (size_t)count * EDID_GEN_MAX_SIZE;
+	struct edid_parsed *parsed;
+	void *arena;
+
+	arena = malloc(size);
+	parsed = calloc(count, sizeof(*parsed));
+	igt_assert(arena && parsed);
+
+	size = edid_gen_batch(arena, size, 0, count);
+	igt_assert_eq(edid_parse_stream(arena, size, parsed, count), count);
+
+	for (uint32_t i = 0; i < count; i++)
+		check_desc(&parsed[i], i);
+
+	free(parsed);
+	free(arena);
+}
+
+static void test_kms_edids(void)
+{
+	const struct edid *(*funcs[])(void) = {
+		igt_kms_get_base_edid,
+		igt_kms_get_alt_edid,
+		igt_kms_get_hdmi_audio_edid,
+		igt_kms_get_4k_edid,
+		igt_kms_get_3d_edid,
+	};
+	struct edid_parsed p;
+
+	for (int i = 0; i < ARRAY_SIZE(funcs); i++) {
+		const struct edid *edid = funcs[i]();
+		uint8_t deep_color;
+
+		igt_assert_eq(edid_parse(edid, edid_get_size(edid), &p), 0);
+		igt_assert_eq(p.errors, 0);
+		igt_assert_eq(p.num_exts, edid->extensions_len);
+		igt_assert_lte(1, p.num_dtds);
+
+		deep_color = p.deep_color & (7 << 4) ? p.deep_color : 0;
+		igt_assert_eq(deep_color, edid_get_deep_color_from_vsdb(edid));
+	}
+
+	igt_assert_eq(edid_parse(igt_kms_get_base_edid(), EDID_BLOCK_SIZE - 1, &p),
+		      -EINVAL);
+}
+
+static void fix_checksums(uint8_t *raw, size_t size)
+{
+	for (size_t b = 0; b < size; b += EDID_BLOCK_SIZE) {
+		uint8_t sum = 0;
+
+		for (int i = 0; i < EDID_BLOCK_SIZE - 1; i++)
+			sum += raw[b + i];
+		raw[b + EDID_BLOCK_SIZE - 1] = -sum;
+	}
+}
+
+static void check_bounds(const struct edid_parsed *p)
+{
+	igt_assert_lte(p->num_dtds, EDID_PARSED_MAX_DTDS);
+	igt_assert_lte(p->num_blocks, EDID_PARSED_MAX_BLOCKS);
+	igt_assert_lte(p->num_tiles, EDID_PARSED_MAX_TILES);
+
+	for (int i = 0; i < p->num_dtds; i++)
+		igt_assert_lte(p->dtds[i].offset + sizeof(struct detailed_timing),
+			       p->size);
+
+	for (int i = 0; i < p->num_blocks; i++) {
+		const struct edid_parsed_block *block = &p->blocks[i];
+
+		igt_assert_lt(block->ext, p->num_exts);
+		igt_assert_lte(block->offset + block->len,
+			       (block->ext + 2) * EDID_BLOCK_SIZE - 1);
+		igt_assert(edid_parsed_block_data(p, i) + block->len <=
+			   p->raw + p->size);
+	}
+}
+
+static void test_fuzz(void)
+{
+	uint8_t raw[EDID_GEN_MAX_SIZE];
+	struct edid_parsed p;
+	uint32_t seed = 0x5eed;
+
+	for (int iter = 0; iter < 20000; iter++) {
+		uint32_t index = hars_petruska_f54_1_random(&seed);
+		size_t size = edid_gen(raw, index);
+		int flips = 1 + hars_petruska_f54_1_random(&seed) % 8;
+
+		/* Keep the header and the extension count, corrupt the rest */
+		while (flips--) {
+			size_t byte = hars_petruska_f54_1_random(&seed) % size;
+
+			if (byte < 8 || byte == offsetof(struct edid, extensions_len))
+				continue;
+			raw[byte] ^= 1 << (hars_petruska_f54_1_random(&seed) % 8);
+		}
+
+		if (iter & 1) {
+			igt_assert_eq(edid_parse(raw, size, &p), 0);
+			check_bounds(&p);
+		} else {
+			/* Valid checksums get the garbage past the first checks */
+			fix_checksums(raw, size);
+			igt_assert_eq(edid_parse(raw, size, &p), 0);
+			igt_assert_eq(p.errors & EDID_PARSE_BAD_CHECKSUM, 0);
+			check_bounds(&p);
+		}
+	}
+}
+
+static void test_throughput(void)
+{
+	const uint32_t count = 32 * 1024;
+	size_t size = (size_t)count * EDID_GEN_MAX_SIZE;
+	struct edid_parsed *parsed;
+	struct timespec start = {};
+	uint64_t gen_ns, parse_ns;
+	void *arena;
+
+	arena = malloc(size);
+	parsed = malloc(count * sizeof(*parsed));
+	igt_assert(arena && parsed);
+
+	igt_nsec_elapsed(&start);
+	size = edid_gen_batch(arena, size, 0, count);
+	gen_ns = igt_nsec_elapsed(&start);
+
+	memset(&start, 0, sizeof(start));
+	igt_nsec_elapsed(&start);
+	igt_assert_eq(edid_parse_stream(arena, size, parsed, count), count);
+	parse_ns = igt_nsec_elapsed(&start);
+
+	igt_info("Generated %u EDIDs (%zu KiB) in %.1fms, %.0f EDIDs/s\n",
+		 count, size >> 10, gen_ns / 1e6, count * 1e9 / gen_ns);
+	igt_info("Parsed %u EDIDs in %.1fms, %.0f EDIDs/s\n",
+		 count, parse_ns / 1e6, count * 1e9 / parse_ns);
+
+	check_desc(&parsed[count - 1], count - 1);
+
+	free(parsed);
+	free(arena);
+}
+
+int igt_simple_main()
+{
+	test_roundtrip();
+	test_kms_edids();
+	test_fuzz();
+	test_throughput();
+}
@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "drm_fourcc.h"
+#include "drmtest.h"
+#include "igt_aux.h"
+#include "igt_core.h"
+#include "igt_format_mod_index.h"
+#include "igt_kms.h"
+#include "igt_rand.h"
+
+static bool linear_has(const uint32_t *formats, const uint64_t *modifiers,
+		       int count, uint32_t format, uint64_t modifier)
+{
+	for (int i = 0; i < count; i++)
+		if (formats[i] == format && modifiers[i] == modifier)
+			return true;
+
+	return false;
+}
+
+static bool test_bit(const uint64_t *set, int bit)
+{
+	return set[bit / 64] & (1ull << (bit % 64));
+}
+
+static void test_blob(void)
+{
+	static const uint32_t formats[] = {
+		DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888, DRM_FORMAT_NV12,
+	};
+	static const uint64_t modifiers[] = {
+		DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED,
+		I915_FORMAT_MOD_Y_TILED,
+	};
+	static const uint64_t support[] = { 0x7, 0x3, 0x4 };
+	struct drm_format_modifier_blob *blob;
+	struct igt_format_mod_index *index;
+	uint64_t *plane_modifiers;
+	uint32_t *plane_formats;
+	int count, plane;
+
+	blob = igt_format_mod_blob_build(formats, ARRAY_SIZE(formats),
+					 modifiers, ARRAY_SIZE(modifiers),
+					 support, 1);
+	igt_parse_format_mod_blob(blob, &plane_formats, &plane_modifiers, &count);
+	igt_assert_eq(count, 6);
+
+	index = igt_format_mod_index_create(3);
+	igt_format_mod_index_add(index, 1, plane_formats, plane_modifiers, count);
+
+	igt_assert(igt_format_mod_index_has(index, 1, DRM_FORMAT_XRGB8888,
+					    DRM_FORMAT_MOD_LINEAR));
+	igt_assert(igt_format_mod_index_has(index, 1, DRM_FORMAT_ARGB8888,
+					    I915_FORMAT_MOD_X_TILED));
+	igt_assert(igt_format_mod_index_has(index, 1, DRM_FORMAT_NV12,
+					    I915_FORMAT_MOD_Y_TILED));
+	igt_assert(!igt_format_mod_index_has(index, 1, DRM_FORMAT_NV12,
+					     I915_FORMAT_MOD_X_TILED));
+	igt_assert(!igt_format_mod_index_has(index, 0, DRM_FORMAT_XRGB8888,
+					     DRM_FORMAT_MOD_LINEAR));
+	igt_assert(!igt_format_mod_index_has(index, 1, DRM_FORMAT_RGB565,
+					     DRM_FORMAT_MOD_LINEAR));
+
+	igt_assert_eq(igt_format_mod_index_format_id(index, DRM_FORMAT_NV12), 2);
+	igt_assert_eq(igt_format_mod_index_modifier_id(index, I915_FORMAT_MOD_Y_TILED), 2);
+	igt_assert_eq(igt_format_mod_index_format_id(index, DRM_FORMAT_RGB565), -1);
+
+	for_each_format_mod_index_plane(index,
+					igt_format_mod_index_format_planes(index, DRM_FORMAT_NV12),
+					plane)
+		igt_assert_eq(plane, 1);
+	igt_assert_eq(igt_format_mod_index_next_plane(index,
+						      igt_format_mod_index_modifier_planes(index, 42),
+						      0), -1);
+
+	igt_format_mod_index_destroy(index);
+	free(plane_formats);
+	free(plane_modifiers);
+	free(blob);
+}
+
+#define NUM_PLANES 70
+#define NUM_FORMATS 100
+#define NUM_MODIFIERS 20
+#define FORMAT_WORDS DIV_ROUND_UP(NUM_FORMATS, 64)
+
+/*
+ * Random capabilities for more planes, formats and modifiers than the
+ * index starts with, checked against a linear search of the parsed blobs.
+ */
+static void test_random(void)
+{
+	uint32_t *plane_formats[NUM_PLANES];
+	uint64_t *plane_modifiers[NUM_PLANES];
+	int count[NUM_PLANES];
+	uint32_t formats[NUM_FORMATS];
+	uint64_t modifiers[NUM_MODIFIERS];
+	struct igt_format_mod_index *index;
+	uint32_t seed = 0x5eed;
+
+	for (int f = 0; f < NUM_FORMATS; f++)
+		formats[f] = hars_petruska_f54_1_random(&seed);
+	for (int m = 0; m < NUM_MODIFIERS; m++)
+		modifiers[m] = hars_petruska_f54_1_random64(&seed);
+	modifiers[0] = DRM_FORMAT_MOD_LINEAR;
+
+	index = igt_format_mod_index_create(NUM_PLANES);
+	igt_assert_eq(igt_format_mod_index_words(index), 2);
+
+	for (int p = 0; p < NUM_PLANES; p++) {
+		uint64_t support[NUM_MODIFIERS * FORMAT_WORDS];
+		struct drm_format_modifier_blob *blob;
+
+		/* Sparser planes at the end, down to none */
+		for (int i = 0; i < ARRAY_SIZE(support); i++)
+			support[i] = hars_petruska_f54_1_random64(&seed) &
+				hars_petruska_f54_1_random64(&seed) &
+				(p < NUM_PLANES - 1 ? ~0ull : 0) &
+				(i % FORMAT_WORDS ? (1ull << (NUM_FORMATS % 64)) - 1 : ~0ull);
+
+		blob = igt_format_mod_blob_build(formats, NUM_FORMATS,
+						 modifiers, NUM_MODIFIERS,
+						 support, FORMAT_WORDS);
+		plane_formats[p] = NULL;
+		plane_modifiers[p] = NULL;
+		igt_parse_format_mod_blob(blob, &plane_formats[p],
+					  &plane_modifiers[p], &count[p]);
+		free(blob);
+
+		igt_format_mod_index_add(index, p, plane_formats[p],
+					 plane_modifiers[p], count[p]);
+	}
+
+	for (int f = 0; f < NUM_FORMATS; f++) {
+		const uint64_t *format_planes =
+			igt_format_mod_index_format_planes(index, formats[f]);
+
+		for (int m = 0; m < NUM_MODIFIERS; m++) {
+			const uint64_t *planes =
+				igt_format_mod_index_planes(index, formats[f],
+							    modifiers[m]);
+			int next = 0, p;
+
+			for (p = 0; p < NUM_PLANES; p++) {
+				bool has = linear_has(plane_formats[p],
+						      plane_modifiers[p], count[p],
+						      formats[f], modifiers[m]);
+
+				igt_assert_eq(igt_format_mod_index_has(index, p,
+								       formats[f],
+								       modifiers[m]),
+					      has);
+				igt_assert_eq(test_bit(planes, p), has);
+				if (has)
+					igt_assert(test_bit(format_planes, p));
+			}
+
+			for_each_format_mod_index_plane(index, planes, p) {
+				for (; next < p; next++)
+					igt_assert(!test_bit(planes, next));
+				igt_assert(test_bit(planes, p));
+				next = p + 1;
+			}
+			for (; next < NUM_PLANES; next++)
+				igt_assert(!test_bit(planes, next));
+		}
+	}
+
+	igt_format_mod_index_destroy(index);
+	for (int p = 0; p < NUM_PLANES; p++) {
+		free(plane_formats[p]);
+		free(plane_modifiers[p]);
+	}
+}
+
+int igt_main()
+{
+	igt_subtest("blob")
+		test_blob();
+
+	igt_subtest("random")
+		test_random();
+}
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "drm_fourcc.h"
+#include "drmtest.h"
+#include "igt_aux.h"
+#include "igt_core.h"
+#include "igt_frame_compare.h"
+#include "igt_rand.h"
+
+struct frame {
+	struct igt_frame_buf buf;
+	uint8_t *data;
+};
+
+static uint32_t cpp(uint32_t format)
+{
+	return format == DRM_FORMAT_BGR888 ? 3 : 4;
+}
+
+static void frame_init(struct frame *f, uint32_t format,
+		       uint32_t width, uint32_t height)
+{
+	uint32_t stride = ALIGN(width * cpp(format) + 12, 4);
+
+	f->data = calloc(height, stride);
+	igt_assert(f->data);
+	f->buf = (struct igt_frame_buf) {
+		.data = f->data,
+		.stride = stride,
+		.width = width,
+		.height = height,
+		.format = format,
+	};
+}
+
+/* Components as 10 bit (or 8 bit) values, in R, G, B order */
+static void get_pixel(const struct frame *f, uint32_t x, uint32_t y, uint32_t c[3])
+{
+	const uint8_t *p = f->data + (size_t)y * f->buf.stride + x * cpp(f->buf.format);
+	uint32_t v;
+
+	switch (f->buf.format) {
+	case DRM_FORMAT_BGR888:
+		c[0] = p[0], c[1] = p[1], c[2] = p[2];
+		return;
+	case DRM_FORMAT_XRGB8888:
+		memcpy(&v, p, 4);
+		c[0] = v >> 16 & 0xff, c[1] = v >> 8 & 0xff, c[2] = v & 0xff;
+		return;
+	case DRM_FORMAT_XRGB2101010:
+		memcpy(&v, p, 4);
+		c[0] = v >> 20 & 0x3ff, c[1] = v >> 10 & 0x3ff, c[2] = v & 0x3ff;
+		return;
+	}
+}
+
+static void set_pixel(struct frame *f, uint32_t x, uint32_t y, const uint32_t c[3],
+		      uint32_t alpha)
+{
+	uint8_t *p = f->data + (size_t)y * f->buf.stride + x * cpp(f->buf.format);
+	uint32_t v;
+
+	switch (f->buf.format) {
+	case DRM_FORMAT_BGR888:
+		p[0] = c[0], p[1] = c[1], p[2] = c[2];
+		return;
+	case DRM_FORMAT_XRGB8888:
+		v = alpha << 24 | c[0] << 16 | c[1] << 8 | c[2];
+		memcpy(p, &v, 4);
+		return;
+	case DRM_FORMAT_XRGB2101010:
+		v = alpha << 30 | c[0] << 20 | c[1] << 10 | c[2];
+		memcpy(p, &v, 4);
+		return;
+	}
+}
+
+/* Fills @ref randomly and @cap with a copy where some pixels are off by up to @noise */
+static void fill_pair(struct frame *ref, struct frame *cap, uint32_t seed,
+		      uint32_t noise)
+{
+	uint32_t bits = ref->buf.format == DRM_FORMAT_XRGB2101010 ? 10 : 8;
+	uint32_t cmax = (1 << bits) - 1;
+
+	for (uint32_t y = 0; y < ref->buf.height; y++) {
+		for (uint32_t x = 0; x < ref->buf.width; x++) {
+			uint32_t c[3];
+
+			for (int i = 0; i < 3; i++)
+				c[i] = hars_petruska_f54_1_random(&seed) & cmax;
+			set_pixel(ref, x, y, c, hars_petruska_f54_1_random(&seed) & 3);
+
+			if (hars_petruska_f54_1_random(&seed) % 4 == 0) {
+				int i = hars_petruska_f54_1_random(&seed) % 3;
+				uint32_t d = hars_petruska_f54_1_random(&seed) % (noise + 1);
+
+				c[i] = c[i] >= d ? c[i] - d : c[i] + d;
+			}
+			/* The padding bits must never count */
+			set_pixel(cap, x, y, c, hars_petruska_f54_1_random(&seed) & 3);
+		}
+	}
+}
+
+static void reference_compare(const struct frame *ref, const struct frame *cap,
+			      const struct igt_frame_compare_params *params,
+			      struct igt_frame_compare_result *result)
+{
+	uint32_t w = params->width ?: ref->buf.width - params->x;
+	uint32_t h = params->height ?: ref->buf.height - params->y;
+
+	memset(result, 0, sizeof(*result));
+	for (uint32_t y = params->y; y < params->y + h; y++) {
+		for (uint32_t x = params->x; x < params->x + w; x++) {
+			uint32_t a[3], b[3], d = 0;
+
+			if (params->mask && !params->mask[y * params->mask_stride + x])
+				continue;
+
+			get_pixel(ref, x, y, a);
+			get_pixel(cap, x, y, b);
+			for (int i = 0; i < 3; i++)
+				d = max(d, (uint32_t)abs((int)a[i] - (int)b[i]));
+
+			result->compared++;
+			result->errors += d > params->threshold;
+			result->max_diff = max(result->max_diff, d);
+			result->histogram[d]++;
+		}
+	}
+	result->match = result->errors <= params->max_errors;
+}
+
+static void check_compare(const struct frame *ref, const struct frame *cap,
+			  const struct igt_frame_compare_params *params)
+{
+	struct igt_frame_compare_params p = *params;
+	struct igt_frame_compare_result expect, got;
+
+	p.histogram = true;
+	p.early_exit = false;
+	reference_compare(ref, cap, &p, &expect);
+
+	igt_assert_eq(igt_frame_compare(&ref->buf, &cap->buf, &p, &got), expect.match);
+	igt_assert(!got.aborted);
+	igt_assert_eq_u64(got.compared, expect.compared);
+	igt_assert_eq_u64(got.errors, expect.errors);
+	igt_assert_eq_u32(got.max_diff, expect.max_diff);
+	igt_assert(!memcmp(got.histogram, expect.histogram, sizeof(got.histogram)));
+
+	/* Stopping early must not change the verdict */
+	p.histogram = false;
+	p.early_exit = true;
+	igt_assert_eq(igt_frame_compare(&ref->buf, &cap->buf, &p, &got), expect.match);
+	if (expect.match)
+		igt_assert(!got.aborted);
+}
+
+static void check_formats(uint32_t ref_format, uint32_t cap_format,
+			  uint32_t width, uint32_t height)
+{
+	struct igt_frame_compare_params params = {};
+	struct frame ref, cap;
+	uint8_t *mask;
+
+	frame_init(&ref, ref_format, width, height);
+	frame_init(&cap, cap_format, width, height);
+	fill_pair(&ref, &cap, width * height + ref_format, 40);
+
+	/* Exact */
+	check_compare(&ref, &cap, &params);
+	igt_assert(igt_frame_compare(&ref.buf, &ref.buf, NULL, NULL));
+
+	/* Tolerances on either side of the noise */
+	for (uint32_t threshold = 0; threshold <= 48; threshold += 8) {
+		params.threshold = threshold;
+		params.max_errors = width * height / 16;
+		check_compare(&ref, &cap, &params);
+	}
+
+	/* A region of interest with a checkered mask */
+	mask = malloc(width * height);
+	igt_assert(mask);
+	for (uint32_t i = 0; i < width * height; i++)
+		mask[i] = (i / width + i % width) & 1;
+
+	params = (struct igt_frame_compare_params) {
+		.threshold = 16,
+		.x = width / 4,
+		.y = height / 3,
+		.width = width / 2,
+		.height = height / 2,
+	};
+	check_compare(&ref, &cap, &params);
+	params.mask = mask;
+	params.mask_stride = width;
+	check_compare(&ref, &cap, &params);
+
+	free(mask);
+	free(ref.data);
+	free(cap.data);
+}
+
+static void test_formats(void)
+{
+	static const uint32_t formats[][2] = {
+		{ DRM_FORMAT_XRGB8888, DRM_FORMAT_XRGB8888 },
+		{ DRM_FORMAT_XRGB8888, DRM_FORMAT_BGR888 },
+		{ DRM_FORMAT_BGR888, DRM_FORMAT_BGR888 },
+		{ DRM_FORMAT_XRGB2101010, DRM_FORMAT_XRGB2101010 },
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(formats); i++) {
+		check_formats(formats[i][0], formats[i][1], 1, 1);
+		check_formats(formats[i][0], formats[i][1], 37, 23);
+		check_formats(formats[i][0], formats[i][1], 128, 64);
+	}
+}
+
+static void test_parallel(void)
+{
+	/* 1080p is above the threshold for splitting the rows */
+	check_formats(DRM_FORMAT_XRGB8888, DRM_FORMAT_BGR888, 1920, 1080);
+	check_formats(DRM_FORMAT_XRGB2101010, DRM_FORMAT_XRGB2101010, 1920, 1081);
+}
+
+static void test_early_exit(void)
+{
+	struct igt_frame_compare_params params = { .early_exit = true };
+	struct igt_frame_compare_result result;
+	struct frame ref, cap;
+
+	frame_init(&ref, DRM_FORMAT_XRGB8888, 1920, 1080);
+	frame_init(&cap, DRM_FORMAT_XRGB8888, 1920, 1080);
+	fill_pair(&ref, &cap, 1, 255);
+
+	igt_assert(!igt_frame_compare(&ref.buf, &cap.buf, &params, &result));
+	igt_assert(result.aborted);
+	igt_assert_lt_u64(result.compared, 1920 * 1080);
+
+	free(ref.data);
+	free(cap.data);
+}
+
+int igt_simple_main()
+{
+	igt_assert(igt_frame_compare_supported(DRM_FORMAT_BGR888));
+	igt_assert(!igt_frame_compare_supported(DRM_FORMAT_NV12));
+
+	test_formats();
+	test_parallel();
+	test_early_exit();
+}
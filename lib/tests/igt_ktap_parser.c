@@ -7,7 +7,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
+#include "igt_aux.h"
 #include "igt_core.h"
 #include "igt_ktap.h"
 #include "igt_list.h"
@@ -230,6 +233,183 @@ static void ktap_top_version(void)
 	igt_ktap_free(&ktap);
 }
 
+static const char ktap_report[] =
+	"KTAP version 1\n"
+	"1..2\n"
+	"    KTAP version 1\n"
+	"    # Subtest: test_suite_1\n"
+	"    1..2\n"
+	"        KTAP version 1\n"
+	"        # Subtest: test_case_1\n"
+	"        ok 1 parameter 1\n"
+	"        not ok 2 parameter 2 # failure message\n"
+	"    not ok 1 test_case_1\n"
+	"    ok 2 test_case_2 # SKIP with a message\n"
+	"ok 1 test_suite_1\n"
+	"    KTAP version 1\n"
+	"    # Subtest: test_suite_2\n"
+	"    1..1\n"
+	"    ok 1 test_case_1 # a comment\n"
+	"ok 2 test_suite_2\n";
+
+static void results_free(struct igt_list_head *results)
+{
+	struct igt_ktap_result *result, *rn;
+	char *suite_name = NULL;
+
+	igt_list_for_each_entry_safe(result, rn, results, link) {
+		igt_list_del(&result->link);
+		if (result->suite_name != suite_name) {
+			free(suite_name);
+			suite_name = result->suite_name;
+		}
+		free(result->case_name);
+		free(result->msg);
+		free(result);
+	}
+	free(suite_name);
+}
+
+static void ktap_chunked(void)
+{
+	const size_t len = strlen(ktap_report);
+	struct igt_ktap_result *r, *e;
+	struct igt_ktap_results *ktap;
+	const char *line, *eol;
+	IGT_LIST_HEAD(expect);
+
+	/* line by line */
+	ktap = igt_ktap_alloc(&expect);
+	igt_require(ktap);
+	for (line = ktap_report; *line; line = eol + 1) {
+		char *buf;
+
+		eol = strchr(line, '\n');
+		buf = strndup(line, eol + 1 - line);
+		igt_assert_eq(igt_ktap_parse(buf, ktap), eol[1] ? -EINPROGRESS : 0);
+		free(buf);
+	}
+	igt_ktap_free(&ktap);
+	igt_assert_eq(igt_list_length(&expect), 4);
+
+	/* against every chunk size */
+	for (size_t chunk = 1; chunk <= len; chunk++) {
+		IGT_LIST_HEAD(results);
+		int err = -EINPROGRESS;
+
+		ktap = igt_ktap_alloc(&results);
+		igt_require(ktap);
+		for (size_t off = 0; off < len; off += chunk) {
+			igt_assert_eq(err, -EINPROGRESS);
+			err = igt_ktap_parse_buf(ktap, ktap_report + off,
+						 min(chunk, len - off));
+		}
+		igt_assert_eq(err, 0);
+		igt_ktap_free(&ktap);
+
+		igt_assert_eq(igt_list_length(&results), igt_list_length(&expect));
+		e = igt_list_first_entry(&expect, e, link);
+		igt_list_for_each_entry(r, &results, link) {
+			igt_assert_eq(strcmp(r->suite_name, e->suite_name), 0);
+			igt_assert_eq(strcmp(r->case_name, e->case_name), 0);
+			igt_assert_eq(!r->msg, !e->msg);
+			if (r->msg)
+				igt_assert_eq(strcmp(r->msg, e->msg), 0);
+			igt_assert_eq(r->code, e->code);
+			e = igt_container_of(e->link.next, e, link);
+		}
+		results_free(&results);
+	}
+
+	r = igt_list_last_entry(&expect, r, link);
+	igt_assert_eq(strcmp(r->msg, "a comment"), 0);
+	igt_assert_eq(r->code, IGT_EXIT_SUCCESS);
+
+	results_free(&expect);
+}
+
+struct ktap_count {
+	unsigned long results, names;
+	char *suite_name;
+};
+
+static void count_result(struct igt_ktap_result *result, void *data)
+{
+	struct ktap_count *count = data;
+
+	if (result->suite_name != count->suite_name) {
+		free(count->suite_name);
+		count->suite_name = result->suite_name;
+	}
+
+	if (result->code == IGT_EXIT_INVALID)
+		count->names++;
+	else
+		count->results++;
+
+	free(result->case_name);
+	free(result->msg);
+	free(result);
+}
+
+/* A report of a million lines, in the shape of drm_mm and drm_buddy ones */
+static void ktap_throughput(void)
+{
+	const unsigned int suites = 10, cases = 1000, params = 97;
+	struct ktap_count count = {};
+	struct igt_ktap_results *ktap;
+	unsigned long lines = 2;
+	struct timespec start = {};
+	double elapsed;
+	FILE *report;
+	int fd;
+
+	fd = memfd_create("ktap", 0);
+	igt_require(fd >= 0);
+	report = fdopen(fd, "w+");
+	igt_assert(report);
+
+	fprintf(report, "KTAP version 1\n1..%u\n", suites);
+	for (unsigned int s = 1; s <= suites; s++) {
+		fprintf(report, "    KTAP version 1\n"
+				"    # Subtest: drm_suite_%u\n"
+				"    1..%u\n", s, cases);
+		for (unsigned int c = 1; c <= cases; c++) {
+			fprintf(report, "        KTAP version 1\n"
+					"        # Subtest: drm_test_case_%u\n", c);
+			for (unsigned int p = 1; p <= params; p++)
+				fprintf(report, "        %sok %u size=%u, order=%u\n",
+					p % 13 ? "" : "not ", p, p << 12, p % 11);
+			fprintf(report, "    %sok %u drm_test_case_%u%s\n",
+				c % 7 ? "" : "not ", c, c,
+				c % 5 ? "" : " # SKIP not supported");
+		}
+		fprintf(report, "ok %u drm_suite_%u\n", s, s);
+		lines += 4 + cases * (params + 3);
+	}
+	igt_assert_eq(fflush(report), 0);
+	igt_assert_lte(1000000, lines);
+
+	ktap = igt_ktap_alloc(NULL);
+	igt_require(ktap);
+	igt_ktap_set_result_fn(ktap, count_result, &count);
+
+	igt_assert_eq(lseek(fd, 0, SEEK_SET), 0);
+	igt_nsec_elapsed(&start);
+	igt_assert_eq(igt_ktap_read(fd, ktap), 0);
+	elapsed = igt_nsec_elapsed(&start) / 1e9;
+
+	igt_ktap_free(&ktap);
+	fclose(report);
+	free(count.suite_name);
+
+	igt_info("%lu lines in %.3fs, %.1f Mlines/s\n",
+		 lines, elapsed, lines / elapsed / 1e6);
+
+	igt_assert_eq(count.names, suites * cases);
+	igt_assert_eq(count.results, suites * cases);
+}
+
 int igt_main()
 {
 	igt_subtest("list")
@@ -243,4 +423,10 @@ int igt_main()
 
 	igt_subtest("top-ktap-version")
 		ktap_top_version();
+
+	igt_subtest("chunked")
+		ktap_chunked();
+
+	igt_subtest("throughput")
+		ktap_throughput();
 }
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "igt_core.h"
+#include "igt_power_sampler.h"
+
+/* A fake hwmon directory, with counters the test sets */
+static char dir_path[] = "/tmp/igt_power_sampler.XXXXXX";
+static int dir = -1;
+
+static void set_counter(const char *attr, uint64_t value)
+{
+	int fd;
+
+	fd = openat(dir, attr, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	igt_assert(fd >= 0);
+	igt_assert(dprintf(fd, "%lu\n", (unsigned long)value) > 0);
+	close(fd);
+}
+
+/* Energy across counter wraparounds, for two domains sampled together */
+static void test_wraparound(void)
+{
+	struct igt_power_sampler *s = igt_power_sampler_create(1000, 16);
+	uint64_t gpu = 0xffffff00, card = 1000;
+	int d0, d1;
+
+	set_counter("energy1_input", gpu);
+	set_counter("energy2_input", card);
+	d0 = igt_power_sampler_add_hwmon(s, dir, "energy1_input", 32);
+	d1 = igt_power_sampler_add_hwmon(s, dir, "energy2_input", 64);
+	igt_assert(d0 == 0 && d1 == 1);
+
+	igt_power_sampler_sample(s);
+	for (int i = 0; i < 10; i++) {
+		gpu = (gpu + 100) & 0xffffffff;
+		card += 1000;
+		set_counter("energy1_input", gpu);
+		set_counter("energy2_input", card);
+		usleep(1000);
+		igt_power_sampler_sample(s);
+	}
+	igt_assert_eq(igt_power_sampler_update(s), 11);
+
+	igt_assert_eq_double(igt_power_sampler_get_mJ(s, d0), 1.0);
+	igt_assert_eq_double(igt_power_sampler_get_mJ(s, d1), 10.0);
+
+	/* 100uJ and 1000uJ over a bit more than 1ms each */
+	igt_assert_eq(igt_power_sampler_get_mW(s, d0)->n_values, 10);
+	igt_assert(igt_stats_get_percentile(igt_power_sampler_get_mW(s, d0), 99) < 100);
+	igt_assert(igt_stats_get_percentile(igt_power_sampler_get_mW(s, d1), 50) > 100);
+	igt_assert(igt_stats_get_percentile(igt_power_sampler_get_mW(s, d1), 99) < 1000);
+
+	igt_power_sampler_destroy(s);
+}
+
+/* Samples are dropped rather than overwritten when nobody consumes them */
+static void test_ring_full(void)
+{
+	struct igt_power_sampler *s = igt_power_sampler_create(1000, 4);
+	struct igt_power_sampler_sample samples[8];
+
+	set_counter("energy1_input", 0);
+	igt_assert_eq(igt_power_sampler_add_hwmon(s, dir, "energy1_input", 64), 0);
+
+	for (int i = 0; i < 10; i++) {
+		set_counter("energy1_input", i);
+		igt_power_sampler_sample(s);
+	}
+	igt_assert_eq(igt_power_sampler_dropped(s), 6);
+
+	igt_assert_eq(igt_power_sampler_read(s, samples, 8), 4);
+	for (int i = 0; i < 4; i++)
+		igt_assert_eq(samples[i].counter[0], i);
+
+	igt_power_sampler_sample(s);
+	igt_assert_eq(igt_power_sampler_read(s, samples, 8), 1);
+	igt_assert_eq(samples[0].counter[0], 9);
+
+	igt_power_sampler_destroy(s);
+}
+
+/* The thread keeps to its period */
+static void test_thread(void)
+{
+	struct igt_power_sampler *s = igt_power_sampler_create(1000, 1024);
+	struct igt_power_sampler_sample samples[1024];
+	unsigned int count;
+
+	set_counter("energy1_input", 42);
+	igt_assert_eq(igt_power_sampler_add_hwmon(s, dir, "energy1_input", 64), 0);
+
+	igt_power_sampler_start(s);
+	usleep(100 * 1000);
+	igt_power_sampler_stop(s);
+
+	count = igt_power_sampler_read(s, samples, 1024);
+	igt_assert_eq(igt_power_sampler_dropped(s), 0);
+	igt_assert_f(count >= 50 && count <= 110, "%u samples\n", count);
+
+	for (int i = 1; i < count; i++) {
+		igt_assert(samples[i].time > samples[i - 1].time);
+		igt_assert_eq(samples[i].counter[0], 42);
+	}
+
+	igt_power_sampler_destroy(s);
+}
+
+int igt_main()
+{
+	igt_fixture() {
+		igt_assert(mkdtemp(dir_path));
+		dir = open(dir_path, O_RDONLY | O_DIRECTORY);
+		igt_assert(dir >= 0);
+	}
+
+	igt_subtest("wraparound")
+		test_wraparound();
+
+	igt_subtest("ring-full")
+		test_ring_full();
+
+	igt_subtest("thread")
+		test_thread();
+
+	igt_fixture() {
+		unlinkat(dir, "energy1_input", 0);
+		unlinkat(dir, "energy2_input", 0);
+		close(dir);
+		rmdir(dir_path);
+	}
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "igt_core.h"
+#include "igt_rand.h"
+
+/* Byte @pos of the stream, one word at a time */
+static uint8_t stream_byte(uint64_t seed, uint64_t pos)
+{
+	uint32_t word = igt_rand_word(seed, pos / 4);
+
+	return ((uint8_t *)&word)[pos & 3];
+}
+
+/*
+ * Any length, alignment and offset in the stream, including offsets where
+ * the vectors straddle the wrap of the lower half of the word index.
+ */
+static void test_ranges(void)
+{
+	uint32_t state = 0x5eed;
+	uint8_t *buf = malloc(4096 + 1);
+
+	igt_assert(buf);
+
+	for (int i = 0; i < 10000; i++) {
+		uint64_t seed = hars_petruska_f54_1_random64(&state);
+		size_t len = hars_petruska_f54_1_random(&state) % 4096;
+		uint64_t offset = hars_petruska_f54_1_random(&state) % 256;
+		uint8_t *ptr = buf + (i & 1);
+
+		if (i & 2)
+			offset += (1ull << 34) - 128;
+
+		igt_rand_fill(ptr, len, seed, offset);
+		for (size_t j = 0; j < len; j++)
+			igt_assert_eq(ptr[j], stream_byte(seed, offset + j));
+		igt_assert_eq_s64(igt_rand_verify(ptr, len, seed, offset), -1);
+	}
+
+	free(buf);
+}
+
+/* The first mismatching byte is reported, wherever it is */
+static void test_mismatch(void)
+{
+	uint32_t state = 0x5eed;
+	size_t len = 1 << 16;
+	uint8_t *buf = malloc(len);
+
+	igt_assert(buf);
+	igt_rand_fill(buf, len, 1, 3);
+
+	for (int i = 0; i < 1000; i++) {
+		size_t first = hars_petruska_f54_1_random(&state) % len;
+		size_t second = first + hars_petruska_f54_1_random(&state) % (len - first);
+		uint8_t bit = 1 << (i & 7);
+
+		buf[second] ^= bit;
+		buf[first] ^= bit;
+		igt_assert_eq_s64(igt_rand_verify(buf, len, 1, 3), first);
+		buf[first] ^= bit;
+		if (second != first) {
+			igt_assert_eq_s64(igt_rand_verify(buf, len, 1, 3), second);
+			buf[second] ^= bit;
+		}
+	}
+	igt_assert_eq_s64(igt_rand_verify(buf, len, 1, 3), -1);
+	igt_assert(igt_rand_verify(buf, len, 2, 3) >= 0);
+
+	free(buf);
+}
+
+/*
+ * A buffer big enough to be split across threads, regenerated in parts at
+ * their offsets and checked in other parts.
+ */
+static void test_parts(void)
+{
+	size_t len = 64 << 20, part = 3 << 20;
+	uint8_t *buf = malloc(len), *copy = malloc(len);
+
+	igt_assert(buf && copy);
+
+	igt_rand_fill(buf, len, 42, 7);
+	for (size_t pos = 0; pos < len; pos += part) {
+		size_t count = len - pos < part ? len - pos : part;
+
+		igt_rand_fill(copy + pos, count, 42, 7 + pos);
+	}
+	igt_assert(!memcmp(buf, copy, len));
+
+	igt_assert_eq_s64(igt_rand_verify(buf + 12345, len - 12345, 42, 7 + 12345), -1);
+
+	buf[len - 1] ^= 1;
+	igt_assert_eq_s64(igt_rand_verify(buf, len, 42, 7), len - 1);
+	buf[len / 3] ^= 1;
+	igt_assert_eq_s64(igt_rand_verify(buf, len, 42, 7), len / 3);
+
+	free(copy);
+	free(buf);
+}
+
+int igt_main()
+{
+	igt_subtest("ranges")
+		test_ranges();
+
+	igt_subtest("mismatch")
+		test_mismatch();
+
+	igt_subtest("parts")
+		test_parts();
+}
@@ -120,6 +120,28 @@ static void test_quartiles(void)
 	igt_stats_fini(&stats);
 }
 
+static void test_percentiles(void)
+{
+	static const uint64_t s1[] = { 40, 10, 30, 20, 50 };
+	igt_stats_t stats;
+
+	igt_stats_init(&stats);
+	igt_assert_eq_double(igt_stats_get_percentile(&stats, 50), 0);
+
+	igt_stats_push_array(&stats, s1, ARRAY_SIZE(s1));
+	igt_assert_eq_double(igt_stats_get_percentile(&stats, 0), 10);
+	igt_assert_eq_double(igt_stats_get_percentile(&stats, 50),
+			     igt_stats_get_median(&stats));
+	igt_assert_eq_double(igt_stats_get_percentile(&stats, 90), 46);
+	igt_assert_eq_double(igt_stats_get_percentile(&stats, 100), 50);
+
+	/* Sorted again once more values come in */
+	igt_stats_push(&stats, 5);
+	igt_assert_eq_double(igt_stats_get_percentile(&stats, 0), 5);
+
+	igt_stats_fini(&stats);
+}
+
 static void test_invalidate_sorted(void)
 {
 	igt_stats_t stats;
@@ -235,6 +257,7 @@ int igt_simple_main()
 	test_min_max();
 	test_range();
 	test_quartiles();
+	test_percentiles();
 	test_invalidate_sorted();
 	test_mean();
 	test_invalidate_mean();
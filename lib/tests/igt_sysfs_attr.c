@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drmtest.h"
+#include "igt_core.h"
+#include "igt_sysfs.h"
+
+/* A fake sysfs directory, with attributes the test sets */
+static char dir_path[] = "/tmp/igt_sysfs_attr.XXXXXX";
+static int dir = -1;
+
+static void set_file(const char *name, const char *contents)
+{
+	int fd;
+
+	fd = openat(dir, name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	igt_assert(fd >= 0);
+	igt_assert_eq(write(fd, contents, strlen(contents)), strlen(contents));
+	close(fd);
+}
+
+static void test_parse(void)
+{
+	static const struct {
+		const char *contents;
+		bool ok;
+		uint64_t value;
+	} tests[] = {
+		{ "0\n", true, 0 },
+		{ "42\n", true, 42 },
+		{ "  1234 MHz\n", true, 1234 },
+		{ "18446744073709551615\n", true, UINT64_MAX },
+		{ "18446744073709551616\n", false, 0 },
+		{ "-1\n", false, 0 },
+		{ "\n", false, 0 },
+		{ "", false, 0 },
+		{ "enabled\n", false, 0 },
+	};
+	igt_sysfs_attr_t attr;
+
+	set_file("attr", "");
+	igt_assert_eq(igt_sysfs_attr_open(&attr, dir, "attr", O_RDONLY), 0);
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		uint64_t value = 0;
+
+		/* The same handle sees each new contents */
+		set_file("attr", tests[i].contents);
+		igt_assert_eq(__igt_sysfs_attr_get_u64(&attr, &value), tests[i].ok);
+		if (tests[i].ok)
+			igt_assert_eq_u64(value, tests[i].value);
+	}
+
+	igt_sysfs_attr_close(&attr);
+}
+
+static void test_u32(void)
+{
+	igt_sysfs_attr_t attr;
+	uint32_t value;
+
+	set_file("attr", "4294967295\n");
+	igt_assert_eq(igt_sysfs_attr_open(&attr, dir, "attr", O_RDONLY), 0);
+	igt_assert_eq_u32(igt_sysfs_attr_get_u32(&attr), UINT32_MAX);
+
+	set_file("attr", "4294967296\n");
+	igt_assert(!__igt_sysfs_attr_get_u32(&attr, &value));
+
+	igt_sysfs_attr_close(&attr);
+}
+
+static void test_write(void)
+{
+	igt_sysfs_attr_t attr;
+
+	set_file("attr", "");
+	igt_assert_eq(igt_sysfs_attr_open(&attr, dir, "attr", O_RDWR), 0);
+
+	/*
+	 * Each write goes at the start, as with a fresh open. Unlike sysfs a
+	 * plain file keeps what was beyond, so the values only get longer.
+	 */
+	igt_sysfs_attr_set_u64(&attr, 0);
+	igt_assert_eq_u64(igt_sysfs_attr_get_u64(&attr), 0);
+	igt_sysfs_attr_set_u64(&attr, 1);
+	igt_assert_eq_u64(igt_sysfs_attr_get_u64(&attr), 1);
+	igt_sysfs_attr_set_u32(&attr, 1234567890);
+	igt_assert_eq_u32(igt_sysfs_attr_get_u32(&attr), 1234567890);
+	igt_sysfs_attr_set_u64(&attr, UINT64_MAX);
+	igt_assert_eq_u64(igt_sysfs_attr_get_u64(&attr), UINT64_MAX);
+
+	igt_assert_eq(igt_sysfs_attr_write(&attr, "", 0), 0);
+	igt_sysfs_attr_close(&attr);
+	igt_assert_eq(attr.fd, -1);
+}
+
+static void test_snapshot(int count)
+{
+	igt_sysfs_attr_t *attrs = calloc(count, sizeof(*attrs));
+	uint64_t *values = calloc(count, sizeof(*values));
+	char *names = calloc(count, 16);
+
+	for (int i = 0; i < count; i++) {
+		char contents[32];
+
+		snprintf(names + 16 * i, 16, "attr%d", i);
+		snprintf(contents, sizeof(contents), "%d\n", 1000 + i);
+		set_file(names + 16 * i, contents);
+		igt_assert_eq(igt_sysfs_attr_open(&attrs[i], dir, names + 16 * i,
+						  O_RDONLY), 0);
+	}
+
+	igt_assert(igt_sysfs_attr_snapshot(attrs, count, values));
+	for (int i = 0; i < count; i++)
+		igt_assert_eq_u64(values[i], 1000 + i);
+
+	/* A bad attribute fails the snapshot, the others are still read */
+	set_file(names, "N\n");
+	set_file(names + 16 * (count - 1), "7\n");
+	igt_assert(!igt_sysfs_attr_snapshot(attrs, count, values));
+	igt_assert_eq_u64(values[0], 1000);
+	igt_assert_eq_u64(values[count - 1], 7);
+
+	for (int i = 0; i < count; i++) {
+		igt_sysfs_attr_close(&attrs[i]);
+		unlinkat(dir, names + 16 * i, 0);
+	}
+
+	free(names);
+	free(values);
+	free(attrs);
+}
+
+int igt_main()
+{
+	igt_fixture() {
+		igt_assert(mkdtemp(dir_path));
+		dir = open(dir_path, O_RDONLY | O_DIRECTORY);
+		igt_assert(dir >= 0);
+	}
+
+	igt_subtest("parse")
+		test_parse();
+
+	igt_subtest("u32")
+		test_u32();
+
+	igt_subtest("write")
+		test_write();
+
+	igt_subtest("snapshot")
+		test_snapshot(8);
+
+	igt_subtest("snapshot-large")
+		test_snapshot(100);
+
+	igt_fixture() {
+		unlinkat(dir, "attr", 0);
+		close(dir);
+		rmdir(dir_path);
+	}
+}
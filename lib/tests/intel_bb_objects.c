@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "drmtest.h"
+#include "igt_core.h"
+#include "igt_rand.h"
+#include "intel_bb_objects.h"
+
+#define NUM_HANDLES 5000
+
+/*
+ * Random adds, removes and uses, checked against arrays indexed by handle,
+ * enough of them for the table to grow and to shift entries back.
+ */
+static void test_table(void)
+{
+	static struct drm_i915_gem_exec_object2 *ref[NUM_HANDLES];
+	static uint32_t ref_exec[NUM_HANDLES];
+	struct intel_bb_object_table table;
+	uint32_t seed = 0x5eed, exec = 1, count = 0;
+
+	intel_bb_object_table_init(&table);
+
+	for (int i = 0; i < 1000000; i++) {
+		uint32_t handle = hars_petruska_f54_1_random(&seed) % NUM_HANDLES;
+		uint32_t op = hars_petruska_f54_1_random(&seed) % 10;
+		struct drm_i915_gem_exec_object2 *object;
+		bool added;
+
+		if (op < 4) {
+			object = intel_bb_object_table_add(&table, handle, &added);
+			igt_assert_eq(added, !ref[handle]);
+			if (added) {
+				igt_assert_eq(object->handle, handle);
+				igt_assert_eq_u64(object->offset, 0);
+				object->offset = handle;
+				ref[handle] = object;
+			}
+			igt_assert(object == ref[handle]);
+		} else if (op < 6) {
+			igt_assert_eq(intel_bb_object_table_remove(&table, handle),
+				      !!ref[handle]);
+			ref[handle] = NULL;
+			ref_exec[handle] = 0;
+		} else if (op < 8) {
+			if (ref[handle]) {
+				igt_assert_eq(intel_bb_object_table_use(&table, handle),
+					      ref_exec[handle] != exec);
+				ref_exec[handle] = exec;
+			}
+		} else if (op < 9) {
+			bool used = ref[handle] && ref_exec[handle] == exec;
+
+			igt_assert_eq(intel_bb_object_table_unuse(&table, handle),
+				      used);
+			if (used)
+				ref_exec[handle] = 0;
+		} else {
+			intel_bb_object_table_new_exec(&table);
+			exec++;
+		}
+
+		object = intel_bb_object_table_find(&table, handle);
+		igt_assert(object == ref[handle]);
+		if (object)
+			igt_assert_eq_u64(object->offset, handle);
+	}
+
+	for (int handle = 0; handle < NUM_HANDLES; handle++) {
+		igt_assert(intel_bb_object_table_find(&table, handle) == ref[handle]);
+		count += !!ref[handle];
+	}
+	igt_assert_eq(table.count, count);
+
+	intel_bb_object_table_fini(&table);
+}
+
+/* Starting a new execbuf when the counter wraps still unuses everything */
+static void test_exec_wrap(void)
+{
+	struct intel_bb_object_table table;
+	bool added;
+
+	intel_bb_object_table_init(&table);
+	intel_bb_object_table_add(&table, 1, &added);
+	intel_bb_object_table_add(&table, 2, &added);
+
+	table.exec = ~0u;
+	igt_assert(intel_bb_object_table_use(&table, 1));
+	igt_assert(!intel_bb_object_table_use(&table, 1));
+
+	intel_bb_object_table_new_exec(&table);
+	igt_assert(intel_bb_object_table_use(&table, 1));
+	igt_assert(intel_bb_object_table_use(&table, 2));
+
+	intel_bb_object_table_fini(&table);
+}
+
+static void test_arena(void)
+{
+	struct intel_bb_arena arena = {};
+	uint32_t seed = 0x5eed;
+
+	for (int round = 0; round < 100; round++) {
+		char *ptr[8];
+		size_t size[8];
+
+		intel_bb_arena_reset(&arena);
+		for (int i = 0; i < ARRAY_SIZE(ptr); i++) {
+			size[i] = hars_petruska_f54_1_random(&seed) % 20000;
+			ptr[i] = intel_bb_arena_alloc(&arena, size[i]);
+			igt_assert(!((uintptr_t)ptr[i] & 15));
+			memset(ptr[i], i, size[i]);
+		}
+
+		/* Growing does not move earlier allocations */
+		for (int i = 0; i < ARRAY_SIZE(ptr); i++)
+			for (size_t j = 0; j < size[i]; j++)
+				igt_assert_eq(ptr[i][j], i);
+	}
+
+	intel_bb_arena_fini(&arena);
+}
+
+int igt_main()
+{
+	igt_subtest("table")
+		test_table();
+
+	igt_subtest("exec-wrap")
+		test_exec_wrap();
+
+	igt_subtest("arena")
+		test_arena();
+}
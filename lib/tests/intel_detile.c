@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "drm_fourcc.h"
+#include "drmtest.h"
+#include "igt_core.h"
+#include "igt_rand.h"
+#include "intel_batchbuffer.h"
+#include "intel_detile.h"
+
+static const uint64_t modifiers[] = {
+	DRM_FORMAT_MOD_LINEAR,
+	I915_FORMAT_MOD_X_TILED,
+	I915_FORMAT_MOD_Y_TILED,
+	I915_FORMAT_MOD_Y_TILED_CCS,
+	I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS,
+	I915_FORMAT_MOD_Y_TILED_GEN12_MC_CCS,
+	I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS_CC,
+	I915_FORMAT_MOD_Yf_TILED,
+	I915_FORMAT_MOD_Yf_TILED_CCS,
+	I915_FORMAT_MOD_4_TILED,
+	I915_FORMAT_MOD_4_TILED_DG2_RC_CCS,
+	I915_FORMAT_MOD_4_TILED_DG2_MC_CCS,
+	I915_FORMAT_MOD_4_TILED_DG2_RC_CCS_CC,
+	I915_FORMAT_MOD_4_TILED_MTL_RC_CCS,
+	I915_FORMAT_MOD_4_TILED_MTL_MC_CCS,
+	I915_FORMAT_MOD_4_TILED_MTL_RC_CCS_CC,
+	I915_FORMAT_MOD_4_TILED_LNL_CCS,
+	I915_FORMAT_MOD_4_TILED_BMG_CCS,
+};
+
+/* Per byte reference layouts, written independently of the row kernels */
+static void ref_tile_size(uint32_t tiling, uint32_t cpp,
+			  uint32_t *width, uint32_t *height)
+{
+	/* Tile sizes in bytes of the 64k and 4k standard tiles for 1-16 cpp */
+	static const uint32_t tile64k[5][2] = {
+		{ 256, 256 }, { 512, 128 }, { 512, 128 }, { 1024, 64 }, { 1024, 64 },
+	};
+	static const uint32_t yf[5][2] = {
+		{ 64, 64 }, { 128, 32 }, { 128, 32 }, { 256, 16 }, { 256, 16 },
+	};
+	int bpp = __builtin_ctz(cpp);
+
+	switch (tiling) {
+	case I915_TILING_NONE:
+		*width = 0;
+		*height = 1;
+		return;
+	case I915_TILING_X:
+		*width = 512;
+		*height = 8;
+		return;
+	case I915_TILING_Y:
+	case I915_TILING_4:
+		*width = 128;
+		*height = 32;
+		return;
+	case I915_TILING_Yf:
+		*width = yf[bpp][0];
+		*height = yf[bpp][1];
+		return;
+	case I915_TILING_Ys:
+	case I915_TILING_64:
+		*width = tile64k[bpp][0];
+		*height = tile64k[bpp][1];
+		return;
+	}
+
+	igt_assert_f(0, "no reference for tiling %u\n", tiling);
+}
+
+static uint32_t yf_ref(uint32_t cpp, uint32_t tx, uint32_t ty)
+{
+	switch (cpp) {
+	case 1:
+		return (tx & 0xf) + (ty & 0xf) * 16 +
+		       ((tx & 0x10) >> 4) * 256 + ((ty & 0x10) >> 4) * 512 +
+		       ((tx & 0x20) >> 5) * 1024 + ((ty & 0x20) >> 5) * 2048;
+	case 2:
+	case 4:
+		return (tx & 0xf) + (ty & 3) * 16 + ((ty & 4) >> 2) * 64 +
+		       ((tx & 0x10) >> 4) * 128 + ((ty & 8) >> 3) * 256 +
+		       ((tx & 0x20) >> 5) * 512 + ((ty & 0x10) >> 4) * 1024 +
+		       ((tx & 0x40) >> 6) * 2048;
+	default:
+		return (tx & 0xf) + (ty & 3) * 16 +
+		       ((tx & 0x30) >> 4) * 64 + ((ty & 4) >> 2) * 256 +
+		       ((tx & 0x40) >> 6) * 512 + ((ty & 8) >> 3) * 1024 +
+		       ((tx & 0x80) >> 7) * 2048;
+	}
+}
+
+static uint32_t tile4_ref(uint32_t tx, uint32_t ty)
+{
+	uint32_t sx = tx / 16, sy = ty / 4;
+	uint32_t subtile = ((sy >> 1) << 4) + ((sy & 1) << 2) +
+			   (sx & 3) + ((sx & 4) << 1);
+
+	return subtile * 64 + (ty & 3) * 16 + tx % 16;
+}
+
+static uint64_t ref_offset(uint32_t tiling, uint32_t cpp, uint32_t stride,
+			   uint32_t x, uint32_t y)
+{
+	uint32_t tw, th, tx, ty, bx, by, block;
+	uint64_t base;
+
+	ref_tile_size(tiling, cpp, &tw, &th);
+	if (tiling == I915_TILING_NONE)
+		return (uint64_t)y * stride + x;
+
+	base = (uint64_t)(y / th) * stride * th + (uint64_t)(x / tw) * tw * th;
+	tx = x % tw;
+	ty = y % th;
+
+	switch (tiling) {
+	case I915_TILING_X:
+		return base + ty * 512 + tx;
+	case I915_TILING_Y:
+		return base + (tx / 16) * 512 + ty * 16 + tx % 16;
+	case I915_TILING_Yf:
+		return base + yf_ref(cpp, tx, ty);
+	case I915_TILING_Ys:
+		/* 4x4 Yf tiles, interleaved from y for all but 8bpp */
+		bx = tx / (tw / 4);
+		by = ty / (th / 4);
+		if (cpp == 1)
+			block = (bx & 1) | (by & 1) << 1 | (bx & 2) << 1 | (by & 2) << 2;
+		else
+			block = (by & 1) | (bx & 1) << 1 | (by & 2) << 1 | (bx & 2) << 2;
+		return base + block * 4096 + yf_ref(cpp, tx % (tw / 4), ty % (th / 4));
+	case I915_TILING_4:
+		return base + tile4_ref(tx, ty);
+	case I915_TILING_64:
+		/* Tile4 blocks in Z order, starting with x */
+		bx = tx / 128;
+		by = ty / 32;
+		if (cpp == 1)
+			block = bx | by << 1;
+		else if (cpp <= 4)
+			block = (bx & 1) | (by & 1) << 1 | (bx & 2) << 1 | (by & 2) << 2;
+		else
+			block = (bx & 1) | by << 1 | (bx & 6) << 1;
+		return base + block * 4096 + tile4_ref(tx % 128, ty % 32);
+	}
+
+	igt_assert_f(0, "no reference for tiling %u\n", tiling);
+	return 0;
+}
+
+static void check_roundtrip(uint32_t tiling, uint32_t width, uint32_t height,
+			    uint32_t cpp, uint32_t plane_offset)
+{
+	struct intel_detile_surface surf;
+	uint32_t tw, th, ref_tw, ref_th, stride, lstride, rows, x, y;
+	uint8_t *tiled, *linear, *out;
+	uint32_t seed = width * height + cpp;
+	size_t size;
+
+	igt_assert(intel_detile_supported(tiling, cpp));
+	intel_detile_tile_size(tiling, cpp, &tw, &th);
+	ref_tile_size(tiling, cpp, &ref_tw, &ref_th);
+	igt_assert_eq_u32(tw, ref_tw);
+	igt_assert_eq_u32(th, ref_th);
+
+	lstride = width * cpp;
+	stride = tw ? ALIGN(lstride, tw) : ALIGN(lstride, 64);
+	rows = ALIGN(height, th);
+	size = plane_offset + (size_t)stride * rows;
+
+	tiled = calloc(1, size);
+	linear = malloc((size_t)lstride * height);
+	out = calloc(1, (size_t)lstride * height);
+	igt_assert(tiled && linear && out);
+
+	for (y = 0; y < lstride * height; y++)
+		linear[y] = hars_petruska_f54_1_random(&seed);
+
+	surf = (struct intel_detile_surface) {
+		.ptr = tiled + plane_offset,
+		.stride = stride,
+		.width = width,
+		.height = height,
+		.cpp = cpp,
+		.tiling = tiling,
+	};
+
+	intel_detile_from_linear(&surf, linear, lstride);
+
+	/* Nothing may be written in front of the main surface */
+	for (x = 0; x < plane_offset; x++)
+		igt_assert_eq(tiled[x], 0);
+
+	/* Bytes within a pixel are never split, check the first of each */
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < lstride; x += cpp) {
+			uint64_t ref = ref_offset(tiling, cpp, stride, x, y);
+
+			igt_assert_f(tiled[plane_offset + ref] == linear[y * lstride + x],
+				     "tiling %u %ux%u cpp %u: pixel (%u, %u) misplaced\n",
+				     tiling, width, height, cpp, x / cpp, y);
+			igt_assert_eq_u64(intel_detile_offset(&surf, x / cpp, y), ref);
+		}
+	}
+
+	intel_detile_to_linear(&surf, out, lstride);
+	igt_assert(memcmp(linear, out, (size_t)lstride * height) == 0);
+
+	free(out);
+	free(linear);
+	free(tiled);
+}
+
+static const struct {
+	uint32_t width, height;
+} sizes[] = {
+	{ 1, 1 },
+	{ 33, 17 },
+	{ 128, 32 },
+	{ 301, 97 },
+	{ 700, 300 },
+};
+
+static const uint32_t cpps[] = { 1, 2, 4, 8, 16 };
+
+static void test_modifiers(void)
+{
+	for (int m = 0; m < ARRAY_SIZE(modifiers); m++) {
+		uint32_t tiling = intel_detile_tiling_from_modifier(modifiers[m]);
+
+		for (int s = 0; s < ARRAY_SIZE(sizes); s++)
+			for (int c = 0; c < ARRAY_SIZE(cpps); c++)
+				check_roundtrip(tiling,
+						sizes[s].width, sizes[s].height,
+						cpps[c], s * 4096);
+	}
+}
+
+static void test_64k_tilings(void)
+{
+	/* Ys and Tile64 have no framebuffer modifier */
+	static const uint32_t tilings[] = { I915_TILING_Ys, I915_TILING_64 };
+
+	for (int t = 0; t < ARRAY_SIZE(tilings); t++)
+		for (int s = 0; s < ARRAY_SIZE(sizes); s++)
+			for (int c = 0; c < ARRAY_SIZE(cpps); c++)
+				check_roundtrip(tilings[t],
+						sizes[s].width, sizes[s].height,
+						cpps[c], s * 4096);
+}
+
+static void test_parallel(void)
+{
+	/* 1080p at 32bpp is above the threshold for splitting the work */
+	check_roundtrip(I915_TILING_4, 1920, 1080, 4, 0);
+	check_roundtrip(I915_TILING_Y, 1920, 1081, 4, 0);
+	check_roundtrip(I915_TILING_X, 1921, 1080, 4, 0);
+	check_roundtrip(I915_TILING_Ys, 1920, 1080, 4, 0);
+	check_roundtrip(I915_TILING_64, 1921, 1081, 4, 0);
+}
+
+static void test_unsupported(void)
+{
+	/* The standard and 64k layouts only exist for power of two pixels */
+	igt_assert(!intel_detile_supported(I915_TILING_Yf, 3));
+	igt_assert(!intel_detile_supported(I915_TILING_Ys, 3));
+	igt_assert(!intel_detile_supported(I915_TILING_64, 3));
+	igt_assert(!intel_detile_supported(I915_TILING_64, 32));
+	igt_assert_eq_u32(intel_detile_tiling_from_modifier(DRM_FORMAT_MOD_INVALID), -1);
+}
+
+int igt_simple_main()
+{
+	test_modifiers();
+	test_64k_tilings();
+	test_parallel();
+	test_unsupported();
+}
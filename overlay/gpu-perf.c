@@ -34,6 +34,8 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <assert.h>
+#include <poll.h>
+#include <time.h>
 
 #include "igt_perf.h"
 
@@ -61,6 +63,12 @@ struct sample_event {
 	uint8_t tracepoint_data[0];
 };
 
+struct lost_event {
+	struct perf_event_header header;
+	uint64_t id;
+	uint64_t lost;
+};
+
 enum {
 	TP_GEM_REQUEST_ADD,
 	TP_GEM_REQUEST_WAIT_BEGIN,
@@ -100,6 +108,12 @@ struct tracepoint {
 	[TP_GEM_RING_SWITCH_CONTEXT] = { .name = "i915/gem_ring_switch_context", },
 };
 
+/* The fields the samples are read with, kept in captures */
+#define TP_FIELDS(X) \
+	X(device) X(ctx) X(class) X(instance) X(seqno) X(global_seqno) X(plane)
+#define COUNT_FIELD(name) + 1
+#define TP_NB_FIELDS (0 TP_FIELDS(COUNT_FIELD))
+
 union parser_value {
     char *string;
     int integer;
@@ -199,8 +213,9 @@ tracepoint_id(int tp_id)
 	ring; \
 })
 
-static int perf_tracepoint_open(struct gpu_perf *gp, int tp_id,
-				int (*func)(struct gpu_perf *, const void *))
+static int (* const tracepoint_funcs[TP_NB])(struct gpu_perf *, const void *);
+
+static int perf_tracepoint_open(struct gpu_perf *gp, int tp_id)
 {
 	struct perf_event_attr attr;
 	struct gpu_perf_sample *sample;
@@ -219,6 +234,10 @@ static int perf_tracepoint_open(struct gpu_perf *gp, int tp_id,
 
 	attr.exclude_guest = 1;
 
+	/* Only wake up pollers once there is a batch worth draining */
+	attr.watermark = 1;
+	attr.wakeup_watermark = N_PAGES * gp->page_size / 4;
+
 	n = gp->nr_cpus * (gp->nr_events+1);
 	fd = realloc(gp->fd, n*sizeof(int));
 	sample = realloc(gp->sample, n*sizeof(*gp->sample));
@@ -240,7 +259,8 @@ static int perf_tracepoint_open(struct gpu_perf *gp, int tp_id,
 		if (read(fd[n], track, sizeof(track)) < 0)
 			return errno;
 		sample[n].id = track[1];
-		sample[n].func = func;
+		sample[n].tp = tp_id;
+		sample[n].func = tracepoint_funcs[tp_id];
 	}
 
 	gp->nr_events++;
@@ -298,36 +318,176 @@ static int get_comm(pid_t pid, char *comm, int len)
 	return len;
 }
 
+static unsigned int comm_cache_set(pid_t pid)
+{
+	return ((uint32_t)pid * 0x9e3779b1u >> 16) % COMM_CACHE_SETS;
+}
+
+static struct gpu_perf_comm_cache *
+comm_cache_lookup(struct gpu_perf *gp, pid_t pid)
+{
+	struct gpu_perf_comm_cache *set = gp->comm_cache[comm_cache_set(pid)];
+
+	for (int i = 0; i < COMM_CACHE_WAYS; i++) {
+		if (set[i].pid == pid) {
+			set[i].used = ++gp->comm_clock;
+			return &set[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct gpu_perf_comm_cache *
+comm_cache_insert(struct gpu_perf *gp, pid_t pid, const char *name)
+{
+	struct gpu_perf_comm_cache *set = gp->comm_cache[comm_cache_set(pid)];
+	struct gpu_perf_comm_cache *cache = &set[0];
+
+	for (int i = 0; i < COMM_CACHE_WAYS; i++) {
+		if (set[i].pid == pid || set[i].pid == 0) {
+			cache = &set[i];
+			break;
+		}
+		if ((int32_t)(set[i].used - cache->used) < 0)
+			cache = &set[i];
+	}
+
+	if (cache->pid != pid)
+		cache->comm = NULL;
+	cache->pid = pid;
+	cache->used = ++gp->comm_clock;
+	snprintf(cache->name, sizeof(cache->name), "%s", name);
+
+	return cache;
+}
+
+struct capture_header {
+	char magic[8];
+	uint32_t nr_cpus;
+	uint32_t nr_events;
+	struct capture_tracepoint {
+		int32_t offset[TP_NB_FIELDS];
+	} tp[TP_NB];
+};
+
+struct capture_sample {
+	uint64_t id;
+	int32_t tp;
+	int32_t pad;
+};
+
+enum {
+	CAPTURE_SAMPLES = 1,
+	CAPTURE_COMM,
+};
+
+struct capture_chunk {
+	uint32_t type;
+	uint32_t arg;		/* cpu of the ring, or pid */
+	uint64_t time;
+	uint64_t len;
+};
+
+#define CAPTURE_MAGIC "i915perf"
+#define CAPTURE_MAX_CHUNK (64 << 20)
+
+static void capture_chunk(struct gpu_perf *gp, uint32_t type, uint32_t arg,
+			  const void *data, uint64_t len)
+{
+	struct capture_chunk chunk = { .type = type, .arg = arg, .len = len };
+	struct timespec ts;
+
+	if (gp->capture == NULL)
+		return;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	chunk.time = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+	if (fwrite(&chunk, sizeof(chunk), 1, gp->capture) != 1 ||
+	    (len && fwrite(data, len, 1, gp->capture) != 1)) {
+		gp->error = "Failed to write the perf capture";
+		gp->capture = NULL;
+	}
+}
+
 static struct gpu_perf_comm *
 lookup_comm(struct gpu_perf *gp, pid_t pid)
 {
+	struct gpu_perf_comm_cache *cache;
 	struct gpu_perf_comm *comm;
+	char name[256];
 
 	if (pid == 0)
 		return NULL;
 
-	for (comm = gp->comm; comm != NULL; comm = comm->next) {
-		if (comm->pid == pid)
-			break;
-	}
-	if (comm == NULL) {
-		comm = calloc(1, sizeof(*comm));
-		if (comm == NULL)
-			return NULL;
+	cache = comm_cache_lookup(gp, pid);
+	if (cache == NULL) {
+		/* Evicted from the cache, but maybe still tracked */
+		for (comm = gp->comm; comm != NULL; comm = comm->next) {
+			if (comm->pid == pid) {
+				cache = comm_cache_insert(gp, pid, comm->name);
+				cache->comm = comm;
+				return comm;
+			}
+		}
 
-		if (get_comm(pid, comm->name, sizeof(comm->name)) < 0) {
-			free(comm);
+		/* Replayed names all come from the capture */
+		if (gp->replay)
 			return NULL;
-		}
 
-		comm->pid = pid;
-		comm->next = gp->comm;
-		gp->comm = comm;
+		/* Remember the processes gone before we could name them too */
+		if (get_comm(pid, name, sizeof(name)) < 0)
+			name[0] = '\0';
+
+		cache = comm_cache_insert(gp, pid, name);
+		capture_chunk(gp, CAPTURE_COMM, pid, name, strlen(name));
 	}
 
+	if (cache->comm)
+		return cache->comm;
+
+	if (cache->name[0] == '\0')
+		return NULL;
+
+	comm = calloc(1, sizeof(*comm));
+	if (comm == NULL)
+		return NULL;
+
+	strcpy(comm->name, cache->name);
+	comm->pid = pid;
+	comm->next = gp->comm;
+	gp->comm = comm;
+	cache->comm = comm;
+
 	return comm;
 }
 
+/**
+ * gpu_perf_release_comm:
+ * @gp: gpu_perf
+ * @comm: comm the caller has unlinked from gp->comm
+ *
+ * Frees @comm. Its name is read again from /proc if the pid shows up
+ * later, in case it was reused.
+ */
+void gpu_perf_release_comm(struct gpu_perf *gp, struct gpu_perf_comm *comm)
+{
+	struct gpu_perf_comm_cache *set = gp->comm_cache[comm_cache_set(comm->pid)];
+
+	for (int i = 0; i < COMM_CACHE_WAYS; i++) {
+		if (set[i].comm != comm)
+			continue;
+
+		if (gp->replay)
+			set[i].comm = NULL;
+		else
+			memset(&set[i], 0, sizeof(set[i]));
+	}
+
+	free(comm);
+}
+
 static int request_add(struct gpu_perf *gp, const void *event)
 {
 	const struct sample_event *sample = event;
@@ -420,18 +580,27 @@ static int wait_end(struct gpu_perf *gp, const void *event)
 	return 0;
 }
 
+static int (* const tracepoint_funcs[TP_NB])(struct gpu_perf *, const void *) = {
+	[TP_GEM_REQUEST_ADD]         = request_add,
+	[TP_GEM_REQUEST_WAIT_BEGIN]  = wait_begin,
+	[TP_GEM_REQUEST_WAIT_END]    = wait_end,
+	[TP_FLIP_COMPLETE]           = flip_complete,
+	[TP_GEM_RING_SYNC_TO]        = ring_sync,
+	[TP_GEM_RING_SWITCH_CONTEXT] = ctx_switch,
+};
+
 void gpu_perf_init(struct gpu_perf *gp, unsigned flags)
 {
 	memset(gp, 0, sizeof(*gp));
 	gp->nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
 	gp->page_size = getpagesize();
 
-	perf_tracepoint_open(gp, TP_GEM_REQUEST_ADD, request_add);
-	if (perf_tracepoint_open(gp, TP_GEM_REQUEST_WAIT_BEGIN, wait_begin) == 0)
-		perf_tracepoint_open(gp, TP_GEM_REQUEST_WAIT_END, wait_end);
-	perf_tracepoint_open(gp, TP_FLIP_COMPLETE, flip_complete);
-	perf_tracepoint_open(gp, TP_GEM_RING_SYNC_TO, ring_sync);
-	perf_tracepoint_open(gp, TP_GEM_RING_SWITCH_CONTEXT, ctx_switch);
+	perf_tracepoint_open(gp, TP_GEM_REQUEST_ADD);
+	if (perf_tracepoint_open(gp, TP_GEM_REQUEST_WAIT_BEGIN) == 0)
+		perf_tracepoint_open(gp, TP_GEM_REQUEST_WAIT_END);
+	perf_tracepoint_open(gp, TP_FLIP_COMPLETE);
+	perf_tracepoint_open(gp, TP_GEM_RING_SYNC_TO);
+	perf_tracepoint_open(gp, TP_GEM_RING_SWITCH_CONTEXT);
 
 	if (gp->nr_events == 0) {
 		gp->error = "i915.ko tracepoints not available";
@@ -461,74 +630,270 @@ static int process_sample(struct gpu_perf *gp, int cpu,
 	return update;
 }
 
+/**
+ * gpu_perf_process:
+ * @gp: gpu_perf
+ * @cpu: cpu of the ring the records come from
+ * @data: records, as copied out of the ring
+ * @len: size of @data
+ *
+ * Returns: the number of samples which updated @gp.
+ */
+int gpu_perf_process(struct gpu_perf *gp, int cpu, const void *data, size_t len)
+{
+	const uint8_t *ptr = data, *end = ptr + len;
+	int update = 0;
+
+	while (end - ptr >= sizeof(struct perf_event_header)) {
+		const struct perf_event_header *header = (const void *)ptr;
+
+		if (header->size < sizeof(*header) || header->size > end - ptr)
+			break;
+
+		if (header->type == PERF_RECORD_SAMPLE &&
+		    header->size >= sizeof(struct sample_event))
+			update += process_sample(gp, cpu, header);
+		else if (header->type == PERF_RECORD_LOST &&
+			 header->size >= sizeof(struct lost_event))
+			gp->lost += ((const struct lost_event *)header)->lost;
+
+		ptr += header->size;
+	}
+
+	return update;
+}
+
 int gpu_perf_update(struct gpu_perf *gp)
 {
-	const int size = N_PAGES * gp->page_size;
-	const int mask = size - 1;
-	uint8_t *buffer = NULL;
-	int buffer_size = 0;
+	const uint64_t size = N_PAGES * gp->page_size;
 	int n, update = 0;
 
 	if (gp->map == NULL)
 		return 0;
 
+	if (gp->batch_size < size) {
+		uint8_t *b = realloc(gp->batch, size);
+		if (b == NULL)
+			return 0;
+
+		gp->batch = b;
+		gp->batch_size = size;
+	}
+
 	for (n = 0; n < gp->nr_cpus; n++) {
 		struct perf_event_mmap_page *mmap = gp->map[n];
-		const uint8_t *data;
-		uint64_t head, tail;
-		int wrap = 0;
+		const uint8_t *data = (uint8_t *)mmap + gp->page_size;
+		uint64_t head, tail, len, offset;
 
 		tail = mmap->data_tail;
 		head = mmap->data_head;
 		rmb();
 
-		if (head < tail) {
-			wrap = 1;
-			tail &= mask;
-			head &= mask;
-			head += size;
+		len = head - tail;
+		if (len == 0)
+			continue;
+
+		/*
+		 * Copy out everything at once, with records split by the end
+		 * of the ring made whole again, and hand the ring back to the
+		 * kernel before processing the batch.
+		 */
+		offset = tail & (size - 1);
+		if (offset + len > size) {
+			memcpy(gp->batch, data + offset, size - offset);
+			memcpy(gp->batch + size - offset, data, len - (size - offset));
+		} else {
+			memcpy(gp->batch, data + offset, len);
 		}
 
-		data = (uint8_t *)mmap + gp->page_size;
-		while (head - tail >= sizeof (struct perf_event_header)) {
-			const struct perf_event_header *header;
+		rmb();
+		mmap->data_tail = head;
+		wmb();
+
+		update += gpu_perf_process(gp, n, gp->batch, len);
 
-			header = (const struct perf_event_header *)(data + (tail & mask));
-			assert(header->size > 0);
-			if (header->size > head - tail)
-				break;
+		/* After the names the samples needed */
+		capture_chunk(gp, CAPTURE_SAMPLES, n, gp->batch, len);
+	}
+
+	return update;
+}
+
+/**
+ * gpu_perf_wait:
+ * @gp: gpu_perf
+ * @timeout_ms: poll() timeout
+ *
+ * Waits for a ring to fill up to its wakeup watermark.
+ *
+ * Returns: the poll() result.
+ */
+int gpu_perf_wait(struct gpu_perf *gp, int timeout_ms)
+{
+	struct pollfd *pfd;
+	int n, ret;
 
-			if ((const uint8_t *)header + header->size > data + size) {
-				int before;
+	if (gp->map == NULL)
+		return poll(NULL, 0, timeout_ms);
 
-				if (header->size > buffer_size) {
-					uint8_t *b = realloc(buffer, header->size);
-					if (b == NULL)
-						break;
+	pfd = calloc(gp->nr_cpus, sizeof(*pfd));
+	if (pfd == NULL)
+		return -1;
 
-					buffer = b;
-					buffer_size = header->size;
-				}
+	/* The other events of a cpu are redirected to the first one's ring */
+	for (n = 0; n < gp->nr_cpus; n++) {
+		pfd[n].fd = gp->fd[n];
+		pfd[n].events = POLLIN;
+	}
 
-				before = data + size - (const uint8_t *)header;
+	ret = poll(pfd, gp->nr_cpus, timeout_ms);
+	free(pfd);
 
-				memcpy(buffer, header, before);
-				memcpy(buffer + before, data, header->size - before);
+	return ret;
+}
 
-				header = (struct perf_event_header *)buffer;
-			}
+/**
+ * gpu_perf_capture:
+ * @gp: initialized gpu_perf
+ * @file: file to write to
+ *
+ * Writes the tracepoint layouts, then from now on the records drained by
+ * gpu_perf_update() and the names of the processes they refer to, for
+ * gpu_perf_replay().
+ *
+ * Returns: 0 or an errno.
+ */
+int gpu_perf_capture(struct gpu_perf *gp, FILE *file)
+{
+	struct capture_header header;
+
+	if (gp->nr_events == 0)
+		return ENOENT;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+	header.nr_cpus = gp->nr_cpus;
+	header.nr_events = gp->nr_events;
+	for (int t = 0; t < TP_NB; t++) {
+		const struct tracepoint *tp = &tracepoints[t];
+		int32_t *offset = header.tp[t].offset;
+		int i = 0;
+
+#define SAVE_FIELD(name) offset[i++] = tp->fields[tp->name##_field].offset;
+		TP_FIELDS(SAVE_FIELD)
+#undef SAVE_FIELD
+	}
+
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+		return EIO;
+
+	for (int n = 0; n < gp->nr_events * gp->nr_cpus; n++) {
+		struct capture_sample sample = {
+			.id = gp->sample[n].id,
+			.tp = gp->sample[n].tp,
+		};
+
+		if (fwrite(&sample, sizeof(sample), 1, file) != 1)
+			return EIO;
+	}
+
+	gp->capture = file;
+	return 0;
+}
+
+/**
+ * gpu_perf_replay:
+ * @gp: zeroed gpu_perf
+ * @file: file written by gpu_perf_capture()
+ * @tick: called with the capture time of each batch, before processing it
+ * @data: passed to @tick
+ *
+ * Feeds the captured records to @gp as gpu_perf_update() would have.
+ *
+ * Returns: 0 once all of @file is processed, or an errno.
+ */
+int gpu_perf_replay(struct gpu_perf *gp, FILE *file,
+		    void (*tick)(struct gpu_perf *gp, uint64_t time, void *data),
+		    void *data)
+{
+	struct capture_header header;
+	struct capture_chunk chunk;
+	int n;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) ||
+	    header.nr_cpus == 0 || header.nr_cpus > 4096 ||
+	    header.nr_events == 0 || header.nr_events > TP_NB)
+		return EINVAL;
+
+	gp->sample = calloc(header.nr_cpus * header.nr_events, sizeof(*gp->sample));
+	if (gp->sample == NULL)
+		return ENOMEM;
+
+	for (n = 0; n < header.nr_cpus * header.nr_events; n++) {
+		struct capture_sample sample;
+
+		if (fread(&sample, sizeof(sample), 1, file) != 1 ||
+		    sample.tp < 0 || sample.tp >= TP_NB)
+			return EINVAL;
+
+		gp->sample[n].id = sample.id;
+		gp->sample[n].tp = sample.tp;
+		gp->sample[n].func = tracepoint_funcs[sample.tp];
+	}
+	gp->nr_cpus = header.nr_cpus;
+	gp->nr_events = header.nr_events;
+
+	for (int t = 0; t < TP_NB; t++) {
+		struct tracepoint *tp = &tracepoints[t];
+		const int32_t *offset = header.tp[t].offset;
+		int i = 0;
+
+#define LOAD_FIELD(name) tp->fields[i].offset = offset[i]; tp->name##_field = i++;
+		TP_FIELDS(LOAD_FIELD)
+#undef LOAD_FIELD
+		tp->n_fields = i;
+	}
+
+	gp->replay = true;
+
+	while (fread(&chunk, sizeof(chunk), 1, file) == 1) {
+		if (chunk.len > CAPTURE_MAX_CHUNK)
+			return EINVAL;
+
+		if (chunk.len > gp->batch_size) {
+			uint8_t *b = realloc(gp->batch, chunk.len);
+			if (b == NULL)
+				return ENOMEM;
 
-			if (header->type == PERF_RECORD_SAMPLE)
-				update += process_sample(gp, n, header);
-			tail += header->size;
+			gp->batch = b;
+			gp->batch_size = chunk.len;
 		}
 
-		if (wrap)
-			tail &= mask;
-		mmap->data_tail = tail;
-		wmb();
+		if (chunk.len && fread(gp->batch, chunk.len, 1, file) != 1)
+			return EINVAL;
+
+		switch (chunk.type) {
+		case CAPTURE_COMM: {
+			char name[16] = {};
+
+			memcpy(name, gp->batch,
+			       chunk.len < sizeof(name) ? chunk.len : sizeof(name) - 1);
+			comm_cache_insert(gp, chunk.arg, name);
+			break;
+		}
+		case CAPTURE_SAMPLES:
+			if (chunk.arg >= gp->nr_cpus)
+				return EINVAL;
+
+			if (tick)
+				tick(gp, chunk.time, data);
+			gpu_perf_process(gp, chunk.arg, gp->batch, chunk.len);
+			break;
+		default:
+			return EINVAL;
+		}
 	}
 
-	free(buffer);
-	return update;
+	return ferror(file) ? EIO : 0;
 }
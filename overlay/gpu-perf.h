@@ -27,9 +27,14 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
 
 #define MAX_RINGS 16
 
+#define COMM_CACHE_SETS 64
+#define COMM_CACHE_WAYS 4
+
 struct gpu_perf {
 	const char *error;
 	int page_size;
@@ -39,11 +44,20 @@ struct gpu_perf {
 	void **map;
 	struct gpu_perf_sample {
 		uint64_t id;
+		int tp;
 		int (*func)(struct gpu_perf *, const void *);
 	} *sample;
 
+	/* Records drained from a ring, processed once it is released */
+	uint8_t *batch;
+	size_t batch_size;
+
+	FILE *capture;
+	bool replay;
+
 	unsigned flip_complete[MAX_RINGS];
 	unsigned ctx_switch[MAX_RINGS];
+	uint64_t lost;
 
 	struct gpu_perf_comm {
 		struct gpu_perf_comm *next;
@@ -65,9 +79,29 @@ struct gpu_perf {
 		uint32_t seqno;
 		uint64_t time;
 	} *wait[MAX_RINGS];
+
+	/*
+	 * Names of the pids seen recently, least recently used first out of
+	 * each set, so that /proc is only read for new processes.
+	 */
+	struct gpu_perf_comm_cache {
+		pid_t pid;
+		uint32_t used;
+		struct gpu_perf_comm *comm;
+		char name[16];
+	} comm_cache[COMM_CACHE_SETS][COMM_CACHE_WAYS];
+	uint32_t comm_clock;
 };
 
 void gpu_perf_init(struct gpu_perf *gp, unsigned flags);
 int gpu_perf_update(struct gpu_perf *gp);
+int gpu_perf_wait(struct gpu_perf *gp, int timeout_ms);
+int gpu_perf_process(struct gpu_perf *gp, int cpu, const void *data, size_t len);
+void gpu_perf_release_comm(struct gpu_perf *gp, struct gpu_perf_comm *comm);
+
+int gpu_perf_capture(struct gpu_perf *gp, FILE *file);
+int gpu_perf_replay(struct gpu_perf *gp, FILE *file,
+		    void (*tick)(struct gpu_perf *gp, uint64_t time, void *data),
+		    void *data);
 
 #endif /* GPU_PERF_H */
@@ -0,0 +1,391 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "overlay.h"
+#include "debugfs.h"
+#include "gem-interrupts.h"
+#include "gpu-freq.h"
+#include "gpu-perf.h"
+#include "power.h"
+#include "rc6.h"
+
+/*
+ * Without a window, the collectors run as a daemon writing one record per
+ * sampling period to a CSV or binary file. A thread drains the perf rings
+ * whenever they fill up to their watermark, so that they do not overflow
+ * between two records, and the main thread only sums up what it counted.
+ *
+ * The perf records can be captured to a file along with the process names
+ * they need, and replayed into the same records later on.
+ */
+
+#define IDLE_TIME 30
+#define NR_CLASSES 4
+
+static const char *class_name[NR_CLASSES] = { "rcs", "bcs", "vcs", "vecs" };
+
+struct headless_record {
+	uint64_t time;			/* ns since the epoch */
+	uint32_t freq_current;		/* MHz */
+	uint32_t freq_request;
+	uint32_t power_gpu;		/* mW */
+	uint32_t power_pkg;
+	uint32_t irqs;
+	uint8_t rc6, rc6p, rc6pp;	/* % of the period */
+	uint8_t pad;
+	uint32_t requests[NR_CLASSES];
+	uint32_t ctx_switches[NR_CLASSES];
+	uint32_t flips;
+	uint32_t semaphores;
+	uint64_t wait_ns;
+	uint64_t lost;
+};
+
+struct headless_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+};
+
+#define HEADLESS_MAGIC "igtovrl"
+
+struct headless {
+	struct gpu_perf gpu_perf;
+	struct gpu_freq gpu_freq;
+	struct rc6 rc6;
+	struct power power;
+	struct gem_interrupts irqs;
+
+	/* Held by whoever drains the rings or reads what they counted */
+	pthread_mutex_t lock;
+
+	FILE *out;
+	bool binary;
+	uint64_t period;
+	uint64_t next;
+};
+
+static volatile sig_atomic_t done;
+
+static void signal_done(int sig)
+{
+	done = 1;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Sums up and resets what the tracepoints counted, called with the lock */
+static void collect_perf(struct headless *h, struct headless_record *r)
+{
+	struct gpu_perf *gp = &h->gpu_perf;
+	struct gpu_perf_comm *comm, **prev;
+	time_t now = r->time / 1000000000;
+	int n;
+
+	for (n = 0; n < MAX_RINGS; n++) {
+		r->ctx_switches[n / 4] += gp->ctx_switch[n];
+		r->flips += gp->flip_complete[n];
+	}
+	memset(gp->ctx_switch, 0, sizeof(gp->ctx_switch));
+	memset(gp->flip_complete, 0, sizeof(gp->flip_complete));
+
+	r->lost = gp->lost;
+	gp->lost = 0;
+
+	for (prev = &gp->comm; (comm = *prev) != NULL; ) {
+		bool busy = comm->active || comm->wait_time || comm->nr_sema;
+
+		for (n = 0; n < MAX_RINGS; n++) {
+			r->requests[n / 4] += comm->nr_requests[n];
+			busy |= comm->nr_requests[n];
+		}
+		r->wait_ns += comm->wait_time;
+		r->semaphores += comm->nr_sema;
+
+		memset(comm->nr_requests, 0, sizeof(comm->nr_requests));
+		comm->wait_time = 0;
+		comm->nr_sema = 0;
+
+		if (busy)
+			comm->show = now;
+
+		/* Forget the processes idle for a while, as the overlay does */
+		if (!comm->active && comm->show < now - IDLE_TIME) {
+			*prev = comm->next;
+			gpu_perf_release_comm(gp, comm);
+		} else {
+			prev = &comm->next;
+		}
+	}
+}
+
+static void collect_freq(struct headless *h, struct headless_record *r)
+{
+	if (gpu_freq_update(&h->gpu_freq) == 0) {
+		r->freq_current = h->gpu_freq.current;
+		r->freq_request = h->gpu_freq.request;
+	}
+
+	if (rc6_update(&h->rc6) == 0) {
+		r->rc6 = h->rc6.rc6;
+		r->rc6p = h->rc6.rc6p;
+		r->rc6pp = h->rc6.rc6pp;
+	}
+
+	if (power_update(&h->power) == 0) {
+		r->power_gpu = h->power.gpu.power_mW;
+		r->power_pkg = h->power.pkg.power_mW;
+	}
+
+	if (gem_interrupts_update(&h->irqs) == 0)
+		r->irqs = h->irqs.delta;
+}
+
+static int write_header(struct headless *h)
+{
+	struct headless_file_header header = {
+		.version = 1,
+		.record_size = sizeof(struct headless_record),
+	};
+	int n;
+
+	if (h->binary) {
+		memcpy(header.magic, HEADLESS_MAGIC, sizeof(header.magic));
+		return fwrite(&header, sizeof(header), 1, h->out) == 1 ? 0 : EIO;
+	}
+
+	fprintf(h->out, "time,freq_current,freq_request,rc6,rc6p,rc6pp,"
+		"power_gpu,power_pkg,irqs");
+	for (n = 0; n < NR_CLASSES; n++)
+		fprintf(h->out, ",requests_%s", class_name[n]);
+	for (n = 0; n < NR_CLASSES; n++)
+		fprintf(h->out, ",ctx_switches_%s", class_name[n]);
+	fprintf(h->out, ",flips,semaphores,wait_ns,lost\n");
+
+	return ferror(h->out) ? EIO : 0;
+}
+
+static int write_record(struct headless *h, const struct headless_record *r)
+{
+	int n;
+
+	if (h->binary) {
+		fwrite(r, sizeof(*r), 1, h->out);
+	} else {
+		fprintf(h->out, "%" PRIu64 ".%09" PRIu64 ",%u,%u,%u,%u,%u,%u,%u,%u",
+			r->time / 1000000000, r->time % 1000000000,
+			r->freq_current, r->freq_request,
+			r->rc6, r->rc6p, r->rc6pp,
+			r->power_gpu, r->power_pkg, r->irqs);
+		for (n = 0; n < NR_CLASSES; n++)
+			fprintf(h->out, ",%u", r->requests[n]);
+		for (n = 0; n < NR_CLASSES; n++)
+			fprintf(h->out, ",%u", r->ctx_switches[n]);
+		fprintf(h->out, ",%u,%u,%" PRIu64 ",%" PRIu64 "\n",
+			r->flips, r->semaphores, r->wait_ns, r->lost);
+	}
+
+	fflush(h->out);
+	return ferror(h->out) ? EIO : 0;
+}
+
+static void *drain_thread(void *data)
+{
+	struct headless *h = data;
+
+	while (!done) {
+		gpu_perf_wait(&h->gpu_perf, 100);
+
+		pthread_mutex_lock(&h->lock);
+		gpu_perf_update(&h->gpu_perf);
+		pthread_mutex_unlock(&h->lock);
+	}
+
+	return NULL;
+}
+
+static int headless_live(struct headless *h, FILE *capture, int sample_period)
+{
+	pthread_t thread;
+	int err = 0;
+
+	debugfs_init();
+
+	gpu_perf_init(&h->gpu_perf, 0);
+	if (h->gpu_perf.error)
+		fprintf(stderr, "%s\n", h->gpu_perf.error);
+	else if (capture && gpu_perf_capture(&h->gpu_perf, capture))
+		fprintf(stderr, "Could not start the perf capture\n");
+
+	gpu_freq_init(&h->gpu_freq);
+	rc6_init(&h->rc6);
+	power_init(&h->power);
+	gem_interrupts_init(&h->irqs);
+
+	if (pthread_create(&thread, NULL, drain_thread, h))
+		return EAGAIN;
+
+	while (!done && !err) {
+		struct headless_record r = {};
+
+		usleep(sample_period);
+		r.time = now_ns();
+
+		pthread_mutex_lock(&h->lock);
+		gpu_perf_update(&h->gpu_perf);
+		collect_perf(h, &r);
+		pthread_mutex_unlock(&h->lock);
+
+		collect_freq(h, &r);
+		err = write_record(h, &r);
+	}
+
+	done = 1;
+	pthread_join(thread, NULL);
+
+	return err;
+}
+
+/* Writes the records of the periods which ended before the next batch */
+static void replay_tick(struct gpu_perf *gp, uint64_t time, void *data)
+{
+	struct headless *h = data;
+
+	if (h->next == 0)
+		h->next = time + h->period;
+
+	while (time > h->next) {
+		struct headless_record r = { .time = h->next };
+
+		collect_perf(h, &r);
+		write_record(h, &r);
+		h->next += h->period;
+	}
+}
+
+static int headless_replay(struct headless *h, const char *path)
+{
+	FILE *file;
+	int err;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return errno;
+
+	err = gpu_perf_replay(&h->gpu_perf, file, replay_tick, h);
+	fclose(file);
+
+	/* And the period the capture ended in */
+	if (!err && h->next) {
+		struct headless_record r = { .time = h->next };
+
+		collect_perf(h, &r);
+		err = write_record(h, &r);
+	}
+
+	return err;
+}
+
+/**
+ * headless_run:
+ * @config: overlay configuration, with a "headless" section
+ * @sample_period: period of the records, in us
+ * @daemonize: whether to detach once the files are open
+ *
+ * Runs the collectors without a window, until interrupted or, if
+ * headless.replay names a capture, until all of it is processed.
+ *
+ * Returns: 0 or an errno.
+ */
+int headless_run(struct config *config, int sample_period, int daemonize)
+{
+	const char *output = config_get_value(config, "headless", "output");
+	const char *format = config_get_value(config, "headless", "format");
+	const char *capture_path = config_get_value(config, "headless", "capture");
+	const char *replay = config_get_value(config, "headless", "replay");
+	struct headless *h;
+	FILE *capture = NULL;
+	int err;
+
+	h = calloc(1, sizeof(*h));
+	if (h == NULL)
+		return ENOMEM;
+
+	pthread_mutex_init(&h->lock, NULL);
+	h->period = sample_period * 1000ull;
+	h->binary = format && !strcmp(format, "binary");
+
+	if (output == NULL || !strcmp(output, "-")) {
+		h->out = stdout;
+		daemonize = 0;
+	} else {
+		h->out = fopen(output, "w");
+		if (h->out == NULL) {
+			err = errno;
+			fprintf(stderr, "Could not open %s: %s\n", output, strerror(err));
+			free(h);
+			return err;
+		}
+	}
+
+	if (capture_path && !replay) {
+		capture = fopen(capture_path, "w");
+		if (capture == NULL) {
+			err = errno;
+			fprintf(stderr, "Could not open %s: %s\n",
+				capture_path, strerror(err));
+			goto out;
+		}
+	}
+
+	err = write_header(h);
+	if (err)
+		goto out;
+
+	if (replay) {
+		err = headless_replay(h, replay);
+		if (err)
+			fprintf(stderr, "Could not replay %s: %s\n",
+				replay, strerror(err));
+		goto out;
+	}
+
+	if (daemonize && daemon(0, 0)) {
+		err = EINVAL;
+		goto out;
+	}
+
+	signal(SIGINT, signal_done);
+	signal(SIGTERM, signal_done);
+
+	err = headless_live(h, capture, sample_period);
+
+out:
+	if (capture)
+		fclose(capture);
+	if (h->out != stdout)
+		fclose(h->out);
+	free(h);
+
+	return err;
+}
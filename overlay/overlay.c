@@ -491,7 +491,7 @@ skip_comm:
 				chart_fini(comm->user_data);
 				free(comm->user_data);
 			}
-			free(comm);
+			gpu_perf_release_comm(&gp->gpu_perf, comm);
 		} else
 			prev = &comm->next;
 	}
@@ -846,6 +846,10 @@ static void usage(const char *progname)
 	printf("\t--position|-P (top|middle|bottom)-(left|centre|right)\tPlace the window in a particular corner\n");
 	printf("\t--size|-S <width>x<height> | <scale>%%\t\t\tWindow size\n");
 	printf("\t--foreground|-f\t\t\t\t\t\tKeep the application in foreground\n");
+	printf("\t--headless|-H <filename> | -\t\t\t\tWrite the statistics to a file instead of a window\n");
+	printf("\t--format (csv|binary)\t\t\t\t\tFormat of the headless statistics\n");
+	printf("\t--capture <filename>\t\t\t\t\tAlso save the perf records of a headless run\n");
+	printf("\t--replay <filename>\t\t\t\t\tWrite the statistics of a capture\n");
 	printf("\t--help|-h\t\t\t\t\t\tThis help message\n");
 }
 
@@ -857,6 +861,10 @@ int main(int argc, char **argv)
 		{"position", 1, 0, 'P'},
 		{"size", 1, 0, 'S'},
 		{"foreground", 0, 0, 'f'},
+		{"headless", 1, 0, 'H'},
+		{"format", 1, 0, 'F'},
+		{"capture", 1, 0, 'C'},
+		{"replay", 1, 0, 'R'},
 		{"help", 0, 0, 'h'},
 		{NULL, 0, 0, 0,}
 	};
@@ -870,7 +878,7 @@ int main(int argc, char **argv)
 	config_init(&config);
 
 	opterr = 0;
-	while ((i = getopt_long(argc, argv, "c:G:fhn?", long_options, &index)) != -1) {
+	while ((i = getopt_long(argc, argv, "c:G:H:fhn?", long_options, &index)) != -1) {
 		switch (i) {
 		case 'c':
 			config_parse_string(&config, optarg);
@@ -887,6 +895,18 @@ int main(int argc, char **argv)
 		case 'f':
 			daemonize = 0;
 			break;
+		case 'H':
+			config_set_value(&config, "headless", "output", optarg);
+			break;
+		case 'F':
+			config_set_value(&config, "headless", "format", optarg);
+			break;
+		case 'C':
+			config_set_value(&config, "headless", "capture", optarg);
+			break;
+		case 'R':
+			config_set_value(&config, "headless", "replay", optarg);
+			break;
 		case 'n':
 			renice = -20;
 			if (optarg)
@@ -903,6 +923,10 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
+	if (config_get_value(&config, "headless", "output") ||
+	    config_get_value(&config, "headless", "replay"))
+		return headless_run(&config, get_sample_period(&config), daemonize);
+
 	ctx.width = 640;
 	ctx.height = 236;
 	ctx.surface = NULL;
@@ -99,4 +99,6 @@ static inline cairo_surface_t *x11_window_create(struct config *config, int *wid
 
 cairo_surface_t *kms_overlay_create(struct config *config, int *width, int *height);
 
+int headless_run(struct config *config, int sample_period, int daemonize);
+
 #endif /* OVERLAY_H */
@@ -34,11 +34,15 @@
 
 #include "igt_aux.h"
 #include "igt_core.h"
+#include "igt_device_scan.h"
 #include "igt_facts.h"
 #include "igt_taints.h"
 #include "igt_vec.h"
 #include "executor.h"
+#include "resultgen.h"
+#include "results_index.h"
 #include "kmemleak.h"
+#include "output_capture.h"
 #include "output_strings.h"
 #include "runnercomms.h"
 
@@ -545,6 +549,13 @@ static const char *filenames[_F_LAST] = {
 	[_F_SOCKET] = "comms",
 };
 
+/* Where the output left out by --output-budget is compressed to */
+static const char *overflow_filenames[_F_LAST] = {
+	[_F_OUT] = "out-overflow.txt.gz",
+	[_F_ERR] = "err-overflow.txt.gz",
+	[_F_SOCKET] = "comms-overflow.txt.gz",
+};
+
 static int open_at_end(int dirfd, const char *name)
 {
 	int fd = openat(dirfd, name, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
@@ -948,6 +959,57 @@ static size_t calc_last_dmesg_chunk(size_t limit, size_t disk_usage)
 	return dt != 0 ? dt : -1;
 }
 
+static bool is_subtest_boundary(const char *line, size_t linelen)
+{
+	static const char * const boundaries[] = {
+		STARTING_SUBTEST,
+		SUBTEST_RESULT,
+		STARTING_DYNAMIC_SUBTEST,
+		DYNAMIC_SUBTEST_RESULT,
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(boundaries) / sizeof(boundaries[0]); i++)
+		if (linelen > strlen(boundaries[i]) &&
+		    !memcmp(line, boundaries[i], strlen(boundaries[i])))
+			return true;
+
+	return false;
+}
+
+static size_t flush_capture(struct output_capture *captures, int i,
+			    int *outputs, struct settings *settings)
+{
+	size_t written = output_capture_flush(&captures[i], outputs[i]);
+
+	if (written && settings->sync)
+		fdatasync(outputs[i]);
+
+	return written;
+}
+
+static size_t flush_captures(struct output_capture *captures,
+			     int *outputs, struct settings *settings)
+{
+	size_t written = 0;
+	int i;
+
+	for (i = 0; i < _F_LAST; i++)
+		written += flush_capture(captures, i, outputs, settings);
+
+	return written;
+}
+
+static void end_captures(struct output_capture *captures,
+			 int *outputs, struct settings *settings)
+{
+	int i;
+
+	flush_captures(captures, outputs, settings);
+	for (i = 0; i < _F_LAST; i++)
+		output_capture_fini(&captures[i]);
+}
+
 /*
  * Returns:
  *  =0 - Success
@@ -957,7 +1019,7 @@ static size_t calc_last_dmesg_chunk(size_t limit, size_t disk_usage)
 static int monitor_output(pid_t child,
 			  int outfd, int errfd, int socketfd,
 			  int kmsgfd, int sigfd,
-			  int *outputs,
+			  int dirfd, int *outputs,
 			  double *time_spent,
 			  struct settings *settings,
 			  char **abortreason,
@@ -968,10 +1030,11 @@ static int monitor_output(pid_t child,
 	size_t bufsize;
 	char *outbuf = NULL;
 	size_t outbufsize = 0;
+	struct output_capture captures[_F_LAST];
 	char current_subtest[256] = {};
 	struct signalfd_siginfo siginfo;
 	ssize_t s;
-	int n, status;
+	int i, n, status;
 	int nfds = outfd;
 	const int interval_length = 1;
 	int wd_timeout;
@@ -1024,6 +1087,16 @@ static int monitor_output(pid_t child,
 	bufsize = KB(256);
 	buf = malloc(bufsize);
 
+	/*
+	 * With an output budget, the output of the test is captured
+	 * between subtest boundaries, keeping only its head and tail.
+	 */
+	for (i = 0; i < _F_LAST; i++)
+		output_capture_init(&captures[i],
+				    overflow_filenames[i] ? settings->output_budget : 0,
+				    i == _F_SOCKET, i == _F_ERR ? STDERR_FILENO : STDOUT_FILENO,
+				    dirfd, overflow_filenames[i]);
+
 	while (outfd >= 0 || errfd >= 0 || sigfd >= 0) {
 		const char *timeout_reason;
 		struct timeval tv = { .tv_sec = interval_length };
@@ -1045,6 +1118,7 @@ static int monitor_output(pid_t child,
 
 		if (n < 0) {
 			/* TODO */
+			end_captures(captures, outputs, settings);
 			return -1;
 		}
 
@@ -1052,6 +1126,7 @@ static int monitor_output(pid_t child,
 
 		/* TODO: Refactor these handlers to their own functions */
 		if (outfd >= 0 && FD_ISSET(outfd, &set)) {
+			size_t consumed = 0, captured = 0;
 			char *newline;
 
 			time_last_activity = time_now;
@@ -1062,32 +1137,59 @@ static int monitor_output(pid_t child,
 					errf("Error reading test's stdout: %m\n");
 				}
 
+				/* The last line of the test, if it has no newline */
+				if (settings->output_budget && outbufsize) {
+					disk_usage += output_capture_write(&captures[_F_OUT],
+									   outputs[_F_OUT],
+									   outbuf, outbufsize);
+					outbufsize = 0;
+				}
+
 				close(outfd);
 				outfd = -1;
 				goto out_end;
 			}
 
-			write(outputs[_F_OUT], buf, s);
-			disk_usage += s;
-			if (settings->sync) {
-				fdatasync(outputs[_F_OUT]);
+			if (!settings->output_budget) {
+				write(outputs[_F_OUT], buf, s);
+				disk_usage += s;
+				if (settings->sync) {
+					fdatasync(outputs[_F_OUT]);
+				}
 			}
 
 			outbuf = realloc(outbuf, outbufsize + s);
 			memcpy(outbuf + outbufsize, buf, s);
 			outbufsize += s;
 
-			while ((newline = memchr(outbuf, '\n', outbufsize)) != NULL) {
-				size_t linelen = newline - outbuf + 1;
+			while ((newline = memchr(outbuf + consumed, '\n', outbufsize - consumed)) != NULL) {
+				char *line = outbuf + consumed;
+				size_t linelen = newline - line + 1;
+
+				if (settings->output_budget &&
+				    is_subtest_boundary(line, linelen)) {
+					/* End the segment, the boundary itself is always kept */
+					disk_usage += output_capture_write(&captures[_F_OUT],
+									   outputs[_F_OUT],
+									   outbuf + captured,
+									   consumed - captured);
+					disk_usage += flush_captures(captures, outputs, settings);
+					write(outputs[_F_OUT], line, linelen);
+					disk_usage += linelen;
+					if (settings->sync) {
+						fdatasync(outputs[_F_OUT]);
+					}
+					captured = consumed + linelen;
+				}
 
 				if (linelen > strlen(STARTING_SUBTEST) &&
-				    !memcmp(outbuf, STARTING_SUBTEST, strlen(STARTING_SUBTEST))) {
-					write(outputs[_F_JOURNAL], outbuf + strlen(STARTING_SUBTEST),
+				    !memcmp(line, STARTING_SUBTEST, strlen(STARTING_SUBTEST))) {
+					write(outputs[_F_JOURNAL], line + strlen(STARTING_SUBTEST),
 					      linelen - strlen(STARTING_SUBTEST));
 					if (settings->sync) {
 						fdatasync(outputs[_F_JOURNAL]);
 					}
-					memcpy(current_subtest, outbuf + strlen(STARTING_SUBTEST),
+					memcpy(current_subtest, line + strlen(STARTING_SUBTEST),
 					       linelen - strlen(STARTING_SUBTEST));
 					current_subtest[linelen - strlen(STARTING_SUBTEST)] = '\0';
 
@@ -1095,20 +1197,20 @@ static int monitor_output(pid_t child,
 					disk_usage = s;
 
 					if (settings->log_level >= LOG_LEVEL_VERBOSE) {
-						fwrite(outbuf, 1, linelen, stdout);
+						fwrite(line, 1, linelen, stdout);
 					}
 				}
 				if (linelen > strlen(SUBTEST_RESULT) &&
-				    !memcmp(outbuf, SUBTEST_RESULT, strlen(SUBTEST_RESULT))) {
-					char *delim = memchr(outbuf, ':', linelen);
+				    !memcmp(line, SUBTEST_RESULT, strlen(SUBTEST_RESULT))) {
+					char *delim = memchr(line, ':', linelen);
 
 					if (delim != NULL) {
-						size_t subtestlen = delim - outbuf - strlen(SUBTEST_RESULT);
-						if (memcmp(current_subtest, outbuf + strlen(SUBTEST_RESULT),
+						size_t subtestlen = delim - line - strlen(SUBTEST_RESULT);
+						if (memcmp(current_subtest, line + strlen(SUBTEST_RESULT),
 							   subtestlen)) {
 							/* Result for a test that didn't ever start */
 							write(outputs[_F_JOURNAL],
-							      outbuf + strlen(SUBTEST_RESULT),
+							      line + strlen(SUBTEST_RESULT),
 							      subtestlen);
 							write(outputs[_F_JOURNAL], "\n", 1);
 							if (settings->sync) {
@@ -1118,40 +1220,59 @@ static int monitor_output(pid_t child,
 						}
 
 						if (settings->log_level >= LOG_LEVEL_VERBOSE) {
-							fwrite(outbuf, 1, linelen, stdout);
+							fwrite(line, 1, linelen, stdout);
 						}
 					}
 				}
 				if (linelen > strlen(STARTING_DYNAMIC_SUBTEST) &&
-				    !memcmp(outbuf, STARTING_DYNAMIC_SUBTEST, strlen(STARTING_DYNAMIC_SUBTEST))) {
+				    !memcmp(line, STARTING_DYNAMIC_SUBTEST, strlen(STARTING_DYNAMIC_SUBTEST))) {
 					time_last_subtest = time_now;
 					disk_usage = s;
 
 					if (settings->log_level >= LOG_LEVEL_VERBOSE) {
-						fwrite(outbuf, 1, linelen, stdout);
+						fwrite(line, 1, linelen, stdout);
 					}
 				}
 				if (linelen > strlen(DYNAMIC_SUBTEST_RESULT) &&
-				    !memcmp(outbuf, DYNAMIC_SUBTEST_RESULT, strlen(DYNAMIC_SUBTEST_RESULT))) {
-					char *delim = memchr(outbuf, ':', linelen);
+				    !memcmp(line, DYNAMIC_SUBTEST_RESULT, strlen(DYNAMIC_SUBTEST_RESULT))) {
+					char *delim = memchr(line, ':', linelen);
 
 					if (delim != NULL) {
 						if (settings->log_level >= LOG_LEVEL_VERBOSE) {
-							fwrite(outbuf, 1, linelen, stdout);
+							fwrite(line, 1, linelen, stdout);
 						}
 					}
 				}
 
-				memmove(outbuf, newline + 1, outbufsize - linelen);
-				outbufsize -= linelen;
+				consumed += linelen;
 			}
+
+			if (settings->output_budget) {
+				/* Do not wait for the end of a line this long */
+				if (outbufsize - consumed > KB(64))
+					consumed = outbufsize;
+
+				disk_usage += output_capture_write(&captures[_F_OUT],
+								   outputs[_F_OUT],
+								   outbuf + captured,
+								   consumed - captured);
+				if (settings->sync) {
+					fdatasync(outputs[_F_OUT]);
+				}
+			}
+
+			memmove(outbuf, outbuf + consumed, outbufsize - consumed);
+			outbufsize -= consumed;
 		}
 	out_end:
 
 		if (errfd >= 0 && FD_ISSET(errfd, &set)) {
+			size_t written;
+
 			time_last_activity = time_now;
 
-			s = read(errfd, buf, bufsize);
+			s = output_capture_read(&captures[_F_ERR], errfd, outputs[_F_ERR],
+						buf, bufsize, &written);
 			if (s <= 0) {
 				if (s < 0) {
 					errf("Error reading test's stderr: %m\n");
@@ -1159,8 +1280,7 @@ static int monitor_output(pid_t child,
 				close(errfd);
 				errfd = -1;
 			} else {
-				write(outputs[_F_ERR], buf, s);
-				disk_usage += s;
+				disk_usage += written;
 				if (settings->sync) {
 					fdatasync(outputs[_F_ERR]);
 				}
@@ -1215,6 +1335,15 @@ static int monitor_output(pid_t child,
 				if (packet->type != PACKETTYPE_EXEC)
 					socket_comms_used = true;
 
+				/* What was logged so far goes out before anything else */
+				if (packet->type == PACKETTYPE_SUBTEST_START ||
+				    packet->type == PACKETTYPE_SUBTEST_RESULT ||
+				    packet->type == PACKETTYPE_DYNAMIC_SUBTEST_START ||
+				    packet->type == PACKETTYPE_DYNAMIC_SUBTEST_RESULT)
+					disk_usage += flush_captures(captures, outputs, settings);
+				else if (packet->type != PACKETTYPE_LOG)
+					disk_usage += flush_capture(captures, _F_SOCKET, outputs, settings);
+
 				if (packet->type == PACKETTYPE_SUBTEST_START ||
 				    packet->type == PACKETTYPE_DYNAMIC_SUBTEST_START) {
 					time_last_subtest = time_now;
@@ -1250,8 +1379,16 @@ static int monitor_output(pid_t child,
 					}
 				}
 
-				write_packet_with_canary(outputs[_F_SOCKET], packet, settings->sync);
-				disk_usage += packet->size;
+				if (settings->output_budget && packet->type == PACKETTYPE_LOG) {
+					disk_usage += output_capture_write(&captures[_F_SOCKET],
+									   outputs[_F_SOCKET],
+									   packet, packet->size);
+					if (settings->sync)
+						fdatasync(outputs[_F_SOCKET]);
+				} else {
+					write_packet_with_canary(outputs[_F_SOCKET], packet, settings->sync);
+					disk_usage += packet->size;
+				}
 
 				if (packet->type == PACKETTYPE_SUBTEST_RESULT ||
 				    packet->type == PACKETTYPE_DYNAMIC_SUBTEST_RESULT)
@@ -1343,6 +1480,8 @@ static int monitor_output(pid_t child,
 					status = 9999;
 				}
 			} else {
+				disk_usage += flush_captures(captures, outputs, settings);
+
 				/* We're dying, so we're taking them with us */
 				if (settings->log_level >= LOG_LEVEL_NORMAL) {
 					char comm[120];
@@ -1398,6 +1537,7 @@ static int monitor_output(pid_t child,
 					errf("Error terminating child with %s, errno=%d\n",
 					     killed == SIGQUIT ? "SIGQUIT" : "SIGKILL", errno);
 
+					end_captures(captures, outputs, settings);
 					return -1;
 				}
 				time_killed = time_now;
@@ -1405,6 +1545,9 @@ static int monitor_output(pid_t child,
 				continue;
 			}
 
+			/* The test's output goes before its exit */
+			disk_usage += flush_captures(captures, outputs, settings);
+
 			time = igt_time_elapsed(&time_beg, &time_now);
 			if (time < 0.0)
 				time = 0.0;
@@ -1558,6 +1701,7 @@ static int monitor_output(pid_t child,
 					fdatasync(outputs[_F_DMESG]);
 
 				close_watchdogs(settings);
+				end_captures(captures, outputs, settings);
 				free(buf);
 				free(outbuf);
 				close(outfd);
@@ -1583,6 +1727,8 @@ static int monitor_output(pid_t child,
 		}
 	}
 
+	disk_usage += flush_captures(captures, outputs, settings);
+
 	dmsg_chunk_size = calc_last_dmesg_chunk(settings->disk_usage_limit, disk_usage);
 	dmesgwritten = dump_dmesg(kmsgfd, outputs[_F_DMESG], dmsg_chunk_size);
 	if (settings->sync)
@@ -1602,6 +1748,7 @@ static int monitor_output(pid_t child,
 		}
 	}
 
+	end_captures(captures, outputs, settings);
 	free(buf);
 	free(outbuf);
 	close(outfd);
@@ -1885,7 +2032,7 @@ static int execute_next_entry(struct execute_state *state,
 
 	result = monitor_output(child, outfd, errfd, socketfd,
 				kmsgfd, sigfd,
-				outputs, time_spent, settings,
+				dirfd, outputs, time_spent, settings,
 				abortreason, abort_already_written);
 
 out_kmsgfd:
@@ -1958,6 +2105,13 @@ static bool clear_test_result_directory(int dirfd)
 			     filenames[i]);
 			return false;
 		}
+
+		if (overflow_filenames[i] &&
+		    remove_file(dirfd, overflow_filenames[i])) {
+			errf("Error deleting %s from test result directory: %m\n",
+			     overflow_filenames[i]);
+			return false;
+		}
 	}
 
 	return true;
@@ -1984,7 +2138,9 @@ static bool clear_old_results(char *path)
 	if (remove_file(dirfd, "uname.txt") ||
 	    remove_file(dirfd, "starttime.txt") ||
 	    remove_file(dirfd, "endtime.txt") ||
-	    remove_file(dirfd, "aborted.txt")) {
+	    remove_file(dirfd, "aborted.txt") ||
+	    remove_file(dirfd, RESULTS_INDEX_FILENAME) ||
+	    remove_file(dirfd, RESULTS_INDEX_STRINGS_FILENAME)) {
 		close(dirfd);
 		errf("Error clearing old results: %m\n");
 		return false;
@@ -2063,6 +2219,7 @@ bool initialize_execute_state_from_resume(int dirfd,
 					  struct job_list *list)
 {
 	struct job_list_entry *entry;
+	struct results_index index;
 	int resdirfd, fd, i;
 
 	clear_settings(settings);
@@ -2083,7 +2240,27 @@ bool initialize_execute_state_from_resume(int dirfd,
 
 	init_time_left(state, settings);
 
-	for (i = list->size; i >= 0; i--) {
+	i = list->size;
+	if (results_index_open(&index, dirfd)) {
+		/*
+		 * The entry being executed when the run stopped is the
+		 * one after the last indexed, unless the run stopped
+		 * while catching up with the index. Result directories
+		 * are created in order, so that is the case if the
+		 * directory after it exists.
+		 */
+		if (index.count) {
+			size_t next = index.records[index.count - 1].entry + 1;
+			char name[32];
+
+			snprintf(name, sizeof(name), "%zu", next + 1);
+			if (next < list->size && faccessat(dirfd, name, F_OK, 0))
+				i = next;
+		}
+		results_index_close(&index);
+	}
+
+	for (; i >= 0; i--) {
 		char name[32];
 
 		snprintf(name, sizeof(name), "%d", i);
@@ -2389,6 +2566,107 @@ static void code_coverage_stop(struct settings *settings, const char *job_name,
 	run_as_root(argv, sigfd, abortreason);
 }
 
+/*
+ * Every test scans udev and sysfs again to resolve its device filters,
+ * often many times over. Scan once here instead and hand the result to
+ * the tests through IGT_DEVICE_SCAN_CACHE, pointing at an unlinked file
+ * they inherit. The tests ignore it once a uevent happened, so it is
+ * rescanned whenever the uevent sequence number moves on.
+ */
+static struct {
+	int fd;
+	uint64_t seqnum;
+	bool disabled;
+} device_scan = { .fd = -1 };
+
+static void share_device_scan(void)
+{
+	char dir[] = "/tmp/igt_runner.XXXXXX";
+	char path[sizeof(dir) + 16], envstring[32];
+	uint64_t seqnum;
+	int fd, err;
+
+	/* Leave a cache set up by the user alone */
+	if (device_scan.fd < 0 && getenv("IGT_DEVICE_SCAN_CACHE"))
+		device_scan.disabled = true;
+
+	if (device_scan.disabled)
+		return;
+
+	seqnum = igt_devices_uevent_seqnum();
+	if (!seqnum || seqnum == device_scan.seqnum)
+		return;
+
+	if (!mkdtemp(dir)) {
+		device_scan.disabled = true;
+		return;
+	}
+	snprintf(path, sizeof(path), "%s/devices", dir);
+
+	igt_devices_scan();
+	err = igt_devices_scan_cache_save(path);
+	igt_devices_free();
+
+	fd = err ? -1 : open(path, O_RDONLY);
+	unlink(path);
+	rmdir(dir);
+
+	if (fd < 0) {
+		errf("Cannot share the device scan: %s\n",
+		     strerror(err ? -err : errno));
+		device_scan.disabled = true;
+		return;
+	}
+
+	/* Keep the same fd, the tests find it through the environment */
+	if (device_scan.fd < 0) {
+		device_scan.fd = fd;
+		snprintf(envstring, sizeof(envstring), "/proc/self/fd/%d", fd);
+		setenv("IGT_DEVICE_SCAN_CACHE", envstring, 1);
+	} else {
+		dup2(fd, device_scan.fd);
+		close(fd);
+	}
+
+	/* The seqnum the cache was written with, a uevent since invalidates it */
+	device_scan.seqnum = seqnum;
+}
+
+/*
+ * The results index is appended to with the entries of the job list as
+ * serialized in the results directory, so that an entry pruned on
+ * resume still gets indexed with all of its subtests.
+ */
+static bool open_results_index(int resdirfd, struct settings *settings,
+			       struct job_list *index_list,
+			       struct results_index_writer *w)
+{
+	init_job_list(index_list);
+	w->fd = w->strfd = -1;
+
+	if (!read_job_list(index_list, resdirfd))
+		return false;
+
+	return results_index_writer_open(w, resdirfd, settings->sync);
+}
+
+static void close_results_index(struct job_list *index_list,
+				struct results_index_writer *w)
+{
+	results_index_writer_close(w);
+	free_job_list(index_list);
+}
+
+static void index_entry(int resdirfd, size_t idx, struct settings *settings,
+			struct job_list *index_list,
+			struct results_index_writer *w)
+{
+	if (w->fd < 0 || idx >= index_list->size)
+		return;
+
+	index_results(resdirfd, idx, &index_list->entries[idx], settings, w);
+}
+
 /* Open the comms file if the test used socket comms */
 static int open_comms_if_valid(int resdirfd, size_t testidx)
 {
@@ -2419,6 +2697,8 @@ bool execute(struct execute_state *state,
 	     struct job_list *job_list)
 {
 	int resdirfd, testdirfd, unamefd, timefd, sigfd;
+	struct results_index_writer index_writer;
+	struct job_list index_list;
 	struct environment_variable *env_var;
 	struct utsname unamebuf;
 	sigset_t sigmask;
@@ -2450,6 +2730,8 @@ bool execute(struct execute_state *state,
 		setenv(env_var->key, env_var->value, 1);
 	}
 
+	share_device_scan();
+
 	if ((resdirfd = open(settings->results_path, O_DIRECTORY | O_RDONLY)) < 0) {
 		/* Initialize state should have done this */
 		errf("Error: Failure opening results path %s\n",
@@ -2498,6 +2780,14 @@ bool execute(struct execute_state *state,
 		close(timefd);
 	}
 
+	/* Catch up with the entries a previous run did not get to index */
+	if (open_results_index(resdirfd, settings, &index_list, &index_writer)) {
+		size_t i;
+
+		for (i = index_writer.next_entry; i < state->next; i++)
+			index_entry(resdirfd, i, settings, &index_list, &index_writer);
+	}
+
 	oom_immortal();
 
 	sigemptyset(&sigmask);
@@ -2586,6 +2876,8 @@ bool execute(struct execute_state *state,
 			goto end;
 		}
 
+		share_device_scan();
+
 		if (settings->cov_results_per_test) {
 			code_coverage_start(settings, sigfd, &reason);
 			job_name = entry_display_name(&job_list->entries[state->next]);
@@ -2629,6 +2921,9 @@ bool execute(struct execute_state *state,
 				}
 			}
 
+			index_entry(resdirfd, state->next, settings,
+				    &index_list, &index_writer);
+
 			free(prev);
 			free(next);
 			free(reason);
@@ -2641,6 +2936,9 @@ bool execute(struct execute_state *state,
 			break;
 		}
 
+		index_entry(resdirfd, state->next, settings,
+			    &index_list, &index_writer);
+
 		reduce_time_left(settings, state, time_spent);
 
 		if (overall_timeout_exceeded(state)) {
@@ -2663,6 +2961,7 @@ bool execute(struct execute_state *state,
 			}
 			close(sigfd);
 			close(testdirfd);
+			close_results_index(&index_list, &index_writer);
 			if (!initialize_execute_state_from_resume(resdirfd, state, settings, job_list))
 				return false;
 			state->time_left = time_left;
@@ -2702,6 +3001,7 @@ bool execute(struct execute_state *state,
 	if (should_die_because_signal(sigfd))
 		status = false;
  end_post_signal_restore:
+	close_results_index(&index_list, &index_writer);
 	close(sigfd);
 	close(testdirfd);
 	close(resdirfd);
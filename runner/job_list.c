@@ -1,25 +1,115 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <link.h>
 #ifdef __linux__
 #include <linux/limits.h>
 #endif
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "job_list.h"
+#include "igt_aux.h"
 #include "igt_core.h"
 
+#define MAX_LIST_THREADS 32
+
+/*
+ * Whether @pattern matches the same strings inside a (?:...) alternation
+ * with other patterns. It doesn't with backreferences and recursion, which
+ * count groups from the start of the whole pattern, with \Q quoting up to
+ * the end of the whole pattern, or with verbs only valid at its start.
+ */
+static bool combinable_regex(const char *pattern)
+{
+	const char *p;
+
+	for (p = pattern; *p; p++) {
+		if (p[0] == '\\') {
+			if (!p[1] || isdigit(p[1]) || strchr("gkQ", p[1]))
+				return false;
+			p++;
+		} else if (p[0] == '(' && p[1] == '*') {
+			return false;
+		} else if (p[0] == '(' && p[1] == '?' && p[2] &&
+			   (strchr("PR&+|", p[2]) || isdigit(p[2]) ||
+			    (p[2] == '-' && isdigit(p[3])))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Compiles the regexes of @list into a single alternation, so that a name
+ * is matched once instead of once per regex. The regexes which can't be
+ * combined, or all of them if the alternation doesn't compile, are still
+ * matched one at a time.
+ */
+static void combine_regexes(struct regex_list *list)
+{
+	GError *error = NULL;
+	size_t len = 0, count = 0, i;
+	char *pattern, *p;
+
+	list->uncombined = calloc(list->size, sizeof(*list->uncombined));
+	list->uncombined_size = 0;
+	list->combined_built = true;
+
+	for (i = 0; i < list->size; i++)
+		len += strlen(list->regex_strings[i]) + strlen("|(?:)");
+
+	p = pattern = malloc(len + 1);
+	*p = '\0';
+
+	for (i = 0; i < list->size; i++) {
+		if (!combinable_regex(list->regex_strings[i])) {
+			list->uncombined[list->uncombined_size++] = i;
+			continue;
+		}
+
+		p += sprintf(p, "%s(?:%s)", count++ ? "|" : "",
+			     list->regex_strings[i]);
+	}
+
+	if (count > 1) {
+		list->combined = g_regex_new(pattern,
+					     G_REGEX_CASELESS | G_REGEX_OPTIMIZE,
+					     0, &error);
+		if (error) {
+			g_error_free(error);
+			list->combined = NULL;
+		}
+	}
+
+	if (!list->combined) {
+		for (i = 0; i < list->size; i++)
+			list->uncombined[i] = i;
+		list->uncombined_size = list->size;
+	}
+
+	free(pattern);
+}
+
 static bool matches_any(const char *str, struct regex_list *list)
 {
 	size_t i;
 
-	for (i = 0; i < list->size; i++) {
-		if (g_regex_match(list->regexes[i], str, 0, NULL))
+	if (!list->combined_built)
+		combine_regexes(list);
+
+	if (list->combined && g_regex_match(list->combined, str, 0, NULL))
+		return true;
+
+	for (i = 0; i < list->uncombined_size; i++) {
+		if (g_regex_match(list->regexes[list->uncombined[i]], str, 0, NULL))
 			return true;
 	}
 
@@ -42,30 +132,233 @@ static void add_job_list_entry(struct job_list *job_list,
 	entry->subtest_count = subtest_count;
 }
 
-static void add_subtests(struct job_list *job_list, struct settings *settings,
-			 char *binary,
-			 struct regex_list *include, struct regex_list *exclude)
+/* Output of a test binary run with --list-subtests */
+struct subtest_list {
+	const char *binary;
+	char **subtests;
+	size_t size;
+	/* As returned by pclose(), -1 if the binary couldn't be run */
+	int status;
+};
+
+struct subtest_lister {
+	struct settings *settings;
+	struct subtest_list *lists;
+	size_t size;
+	size_t next;
+};
+
+static void subtest_list_push(struct subtest_list *list, char *subtest)
 {
-	FILE *p;
-	char cmd[256] = {};
+	list->size++;
+	list->subtests = realloc(list->subtests,
+				 list->size * sizeof(*list->subtests));
+	list->subtests[list->size - 1] = subtest;
+}
+
+/* Hex GNU build-id of the ELF file @fd, if it has one */
+static bool read_build_id(int fd, char *buf, size_t buf_size)
+{
+	ElfW(Ehdr) ehdr;
+	ElfW(Phdr) phdr;
+	char notes[4096];
+
+	if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr) ||
+	    memcmp(ehdr.e_ident, ELFMAG, SELFMAG) ||
+	    ehdr.e_ident[EI_CLASS] != __ELF_NATIVE_CLASS / 32 ||
+	    ehdr.e_phentsize != sizeof(phdr))
+		return false;
+
+	for (int i = 0; i < ehdr.e_phnum; i++) {
+		ssize_t len;
+		size_t off;
+
+		if (pread(fd, &phdr, sizeof(phdr),
+			  ehdr.e_phoff + i * sizeof(phdr)) != sizeof(phdr))
+			return false;
+
+		if (phdr.p_type != PT_NOTE)
+			continue;
+
+		len = pread(fd, notes, min_t(size_t, phdr.p_filesz, sizeof(notes)),
+			    phdr.p_offset);
+		for (off = 0; len > 0 && off + sizeof(ElfW(Nhdr)) <= (size_t)len;) {
+			const ElfW(Nhdr) *nhdr = (const void *)(notes + off);
+			size_t name = off + sizeof(*nhdr);
+			size_t desc = name + ((nhdr->n_namesz + 3) & ~3u);
+
+			if (desc + nhdr->n_descsz > (size_t)len)
+				break;
+
+			if (nhdr->n_type == NT_GNU_BUILD_ID &&
+			    nhdr->n_namesz == sizeof(ELF_NOTE_GNU) &&
+			    !memcmp(notes + name, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) &&
+			    2 * nhdr->n_descsz < buf_size) {
+				for (size_t j = 0; j < nhdr->n_descsz; j++)
+					sprintf(buf + 2 * j, "%02x",
+						(unsigned char)notes[desc + j]);
+				return true;
+			}
+
+			off = desc + ((nhdr->n_descsz + 3) & ~3u);
+		}
+	}
+
+	return false;
+}
+
+/*
+ * The first line of the cache file of a binary, which must match for the
+ * cached list to be used.
+ */
+static bool list_cache_key(const char *path, char *key, size_t key_size)
+{
+	char build_id[129] = "-";
+	struct stat st;
+	int fd, s;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &st)) {
+		close(fd);
+		return false;
+	}
+
+	read_build_id(fd, build_id, sizeof(build_id));
+	close(fd);
+
+	s = snprintf(key, key_size,
+		     "igt_runner subtest list 1 size %lld mtime %lld.%09ld build-id %s\n",
+		     (long long)st.st_size, (long long)st.st_mtim.tv_sec,
+		     st.st_mtim.tv_nsec, build_id);
+
+	return s > 0 && s < key_size;
+}
+
+/* One cache file per binary and test root */
+static bool list_cache_path(struct settings *settings, const char *binary,
+			    char *path, size_t path_size)
+{
+	uint32_t hash = 2166136261u;
+	char *p;
+	int s;
+
+	for (p = settings->test_root; *p; p++)
+		hash = (hash ^ (unsigned char)*p) * 16777619u;
+
+	s = snprintf(path, path_size, "%s/%s-%08x",
+		     settings->list_cache, binary, hash);
+	if (s < 0 || s >= path_size)
+		return false;
+
+	for (p = path + strlen(settings->list_cache) + 1; *p; p++)
+		if (*p == '/')
+			*p = '_';
+
+	return true;
+}
+
+static bool read_list_cache(const char *path, const char *key,
+			    struct subtest_list *list)
+{
+	char *line = NULL, *subtest;
+	size_t line_len = 0;
+	bool ok = false;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return false;
+
+	if (getline(&line, &line_len, f) < 0 || strcmp(line, key) ||
+	    fscanf(f, "status %d", &list->status) != 1)
+		goto out;
+
+	while (fscanf(f, "%ms", &subtest) == 1)
+		subtest_list_push(list, subtest);
+
+	ok = true;
+out:
+	free(line);
+	fclose(f);
+
+	return ok;
+}
+
+/* Written to a temporary file and renamed, concurrent runners can share it */
+static void write_list_cache(const char *path, const char *key,
+			     const struct subtest_list *list)
+{
+	char tmp[PATH_MAX];
+	FILE *f;
+	int fd;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= sizeof(tmp))
+		return;
+
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		return;
+
+	f = fdopen(fd, "w");
+	if (!f) {
+		close(fd);
+		unlink(tmp);
+		return;
+	}
+
+	fprintf(f, "%sstatus %d\n", key, list->status);
+	for (size_t i = 0; i < list->size; i++)
+		fprintf(f, "%s\n", list->subtests[i]);
+
+	if (fclose(f) || rename(tmp, path))
+		unlink(tmp);
+}
+
+static void list_subtests(struct settings *settings, struct subtest_list *list)
+{
+	char path[PATH_MAX], cache[PATH_MAX], key[256];
+	bool use_cache = false;
+	char cmd[PATH_MAX + 32];
 	char *subtestname;
-	char **subtests = NULL;
-	size_t num_subtests = 0;
+	FILE *p;
 	int s;
 
-	s = snprintf(cmd, sizeof(cmd), "%s/%s --list-subtests",
-		     settings->test_root, binary);
+	list->status = -1;
+
+	s = snprintf(path, sizeof(path), "%s/%s", settings->test_root,
+		     list->binary);
 	if (s < 0) {
 		fprintf(stderr, "Failure generating command string, this shouldn't happen.\n");
 		return;
 	}
 
-	if (s >= sizeof(cmd)) {
+	if (s >= sizeof(path) || s + strlen(" --list-subtests") >= 256) {
 		fprintf(stderr, "Path to binary too long, ignoring: %s/%s\n",
-			settings->test_root, binary);
+			settings->test_root, list->binary);
 		return;
 	}
 
+	if (settings->list_cache &&
+	    list_cache_path(settings, list->binary, cache, sizeof(cache)) &&
+	    list_cache_key(path, key, sizeof(key))) {
+		if (read_list_cache(cache, key, list))
+			return;
+
+		/* Drop whatever a stale cache file left */
+		for (size_t i = 0; i < list->size; i++)
+			free(list->subtests[i]);
+		free(list->subtests);
+		list->subtests = NULL;
+		list->size = 0;
+		list->status = -1;
+		use_cache = true;
+	}
+
+	snprintf(cmd, sizeof(cmd), "%s --list-subtests", path);
+
 	p = popen(cmd, "r");
 	if (!p) {
 		fprintf(stderr, "popen failed when executing %s: %s\n",
@@ -74,20 +367,103 @@ static void add_subtests(struct job_list *job_list, struct settings *settings,
 		return;
 	}
 
-	while (fscanf(p, "%ms", &subtestname) == 1) {
+	while (fscanf(p, "%ms", &subtestname) == 1)
+		subtest_list_push(list, subtestname);
+
+	list->status = pclose(p);
+	if (list->status == -1)
+		fprintf(stderr, "popen error when executing %s: %s\n",
+			list->binary, strerror(errno));
+
+	/* Only a clean listing, or a binary without subtests, is cached */
+	if (use_cache &&
+	    (list->status == 0 ||
+	     (WIFEXITED(list->status) &&
+	      WEXITSTATUS(list->status) == IGT_EXIT_INVALID)))
+		write_list_cache(cache, key, list);
+}
+
+static void *list_subtests_thread(void *data)
+{
+	struct subtest_lister *lister = data;
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&lister->next, 1, __ATOMIC_RELAXED)) <
+	       lister->size)
+		list_subtests(lister->settings, &lister->lists[i]);
+
+	return NULL;
+}
+
+/*
+ * Lists the subtests of @binaries, spread over one thread per CPU. The
+ * lists are returned in the order of @binaries, whichever finished first.
+ */
+static struct subtest_list *list_all_subtests(struct settings *settings,
+					      char **binaries, size_t count)
+{
+	pthread_t threads[MAX_LIST_THREADS];
+	struct subtest_lister lister = {
+		.settings = settings,
+		.size = count,
+	};
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	long n;
+
+	lister.lists = calloc(count ?: 1, sizeof(*lister.lists));
+	for (size_t i = 0; i < count; i++)
+		lister.lists[i].binary = binaries[i];
+
+	if (settings->list_cache &&
+	    mkdir(settings->list_cache, 0777) && errno != EEXIST)
+		fprintf(stderr, "Cannot create the list cache %s: %s\n",
+			settings->list_cache, strerror(errno));
+
+	nthreads = clamp(nthreads, 1L, min_t(long, count, MAX_LIST_THREADS));
+	for (n = 1; n < nthreads; n++) {
+		if (pthread_create(&threads[n], NULL, list_subtests_thread,
+				   &lister))
+			break;
+	}
+
+	list_subtests_thread(&lister);
+
+	while (--n > 0)
+		pthread_join(threads[n], NULL);
+
+	return lister.lists;
+}
+
+static void free_subtest_lists(struct subtest_list *lists, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		for (size_t k = 0; k < lists[i].size; k++)
+			free(lists[i].subtests[k]);
+		free(lists[i].subtests);
+	}
+	free(lists);
+}
+
+static void add_subtests(struct job_list *job_list, struct settings *settings,
+			 const struct subtest_list *list,
+			 struct regex_list *include, struct regex_list *exclude)
+{
+	const char *binary = list->binary;
+	char **subtests = NULL;
+	size_t num_subtests = 0;
+	int s;
+
+	for (size_t i = 0; i < list->size; i++) {
+		char *subtestname = list->subtests[i];
 		char piglitname[256];
 
 		generate_piglit_name(binary, subtestname, piglitname, sizeof(piglitname));
 
-		if (exclude && exclude->size && matches_any(piglitname, exclude)) {
-			free(subtestname);
+		if (exclude && exclude->size && matches_any(piglitname, exclude))
 			continue;
-		}
 
-		if (include && include->size && !matches_any(piglitname, include)) {
-			free(subtestname);
+		if (include && include->size && !matches_any(piglitname, include))
 			continue;
-		}
 
 		if (settings->multiple_mode) {
 			num_subtests++;
@@ -99,18 +475,15 @@ static void add_subtests(struct job_list *job_list, struct settings *settings,
 			add_job_list_entry(job_list, strdup(binary), subtests, 1);
 			subtests = NULL;
 		}
-
-		free(subtestname);
 	}
 
 	if (num_subtests)
 		add_job_list_entry(job_list, strdup(binary), subtests, num_subtests);
 
-	s = pclose(p);
-	if (s == 0) {
+	s = list->status;
+	if (s == 0 || s == -1) {
+		/* Errors running the binary were reported when listing */
 		return;
-	} else if (s == -1) {
-		fprintf(stderr, "popen error when executing %s: %s\n", binary, strerror(errno));
 	} else if (WIFEXITED(s)) {
 		if (WEXITSTATUS(s) == IGT_EXIT_INVALID) {
 			char piglitname[256];
@@ -134,10 +507,21 @@ static void add_subtests(struct job_list *job_list, struct settings *settings,
 	}
 }
 
+/* A binary from test-list.txt and how its subtests are filtered */
+struct filtered_binary {
+	char *binary;
+	struct regex_list *include, *exclude;
+	bool list_subtests;
+};
+
 static bool filtered_job_list(struct job_list *job_list,
 			      struct settings *settings,
 			      int fd)
 {
+	struct filtered_binary *binaries = NULL;
+	struct subtest_list *lists;
+	size_t num_binaries = 0, num_lists = 0, i;
+	char **to_list;
 	FILE *f;
 	char buf[128];
 	bool ok;
@@ -150,6 +534,8 @@ static bool filtered_job_list(struct job_list *job_list,
 	f = fdopen(fd, "r");
 
 	while (fscanf(f, "%127s", buf) == 1) {
+		struct filtered_binary b = { .list_subtests = true };
+
 		if (!strcmp(buf, "TESTLIST") || !(strcmp(buf, "END")))
 			continue;
 
@@ -172,21 +558,49 @@ static bool filtered_job_list(struct job_list *job_list,
 				 * get to omit executing
 				 * --list-subtests.
 				 */
-				add_job_list_entry(job_list, strdup(buf), NULL, 0);
+				b.list_subtests = false;
 			else
-				add_subtests(job_list, settings, buf,
-					     NULL, &settings->exclude_regexes);
+				b.exclude = &settings->exclude_regexes;
+		} else {
+			/*
+			 * Binary name doesn't match exclude or include filters.
+			 */
+			b.include = &settings->include_regexes;
+			b.exclude = &settings->exclude_regexes;
+		}
+
+		b.binary = strdup(buf);
+		num_binaries++;
+		binaries = realloc(binaries, num_binaries * sizeof(*binaries));
+		binaries[num_binaries - 1] = b;
+	}
+
+	/* List the subtests of all the binaries at once, then add them in order */
+	to_list = calloc(num_binaries ?: 1, sizeof(*to_list));
+	for (i = 0; i < num_binaries; i++)
+		if (binaries[i].list_subtests)
+			to_list[num_lists++] = binaries[i].binary;
+	lists = list_all_subtests(settings, to_list, num_lists);
+
+	for (i = 0, num_lists = 0; i < num_binaries; i++) {
+		struct filtered_binary *b = &binaries[i];
+
+		if (!b->list_subtests) {
+			add_job_list_entry(job_list, b->binary, NULL, 0);
 			continue;
 		}
 
-		/*
-		 * Binary name doesn't match exclude or include filters.
-		 */
-		add_subtests(job_list, settings, buf,
-			     &settings->include_regexes,
-			     &settings->exclude_regexes);
+		add_subtests(job_list, settings, &lists[num_lists++],
+			     b->include, b->exclude);
 	}
 
+	free_subtest_lists(lists, num_lists);
+	for (i = 0; i < num_binaries; i++)
+		if (binaries[i].list_subtests)
+			free(binaries[i].binary);
+	free(binaries);
+	free(to_list);
+
 	ok = job_list->size != 0;
 	if (!ok)
 		fprintf(stderr, "Filter didn't match any job name\n");
@@ -194,6 +608,70 @@ static bool filtered_job_list(struct job_list *job_list,
 	return ok;
 }
 
+/*
+ * The next line of the test list which passes the filters, with its
+ * comment stripped, or NULL at the end of the list.
+ */
+static char *next_test_list_line(FILE *f, char **line, size_t *line_len,
+				 struct settings *settings)
+{
+	char *delim;
+
+	while (1) {
+		if (getline(line, line_len, f) == -1) {
+			if (errno == EINTR)
+				continue;
+			else
+				return NULL;
+		}
+
+		/* # starts a comment */
+		if ((delim = strchr(*line, '#')) != NULL)
+			*delim = '\0';
+
+		if (settings->exclude_regexes.size && matches_any(*line, &settings->exclude_regexes))
+			continue;
+
+		if (settings->include_regexes.size && !matches_any(*line, &settings->include_regexes))
+			continue;
+
+		return *line;
+	}
+}
+
+/*
+ * The binaries named without a subtest in the test list, in order, whose
+ * subtests have to be listed.
+ */
+static char **test_list_whole_binaries(FILE *f, struct settings *settings,
+				       size_t *count)
+{
+	char **binaries = NULL;
+	char *line = NULL;
+	size_t line_len = 0;
+	char *binary;
+
+	*count = 0;
+	while (next_test_list_line(f, &line, &line_len, settings)) {
+		if (sscanf(line, "igt@%ms", &binary) != 1)
+			continue;
+
+		if (strchr(binary, '@')) {
+			free(binary);
+			continue;
+		}
+
+		(*count)++;
+		binaries = realloc(binaries, *count * sizeof(*binaries));
+		binaries[*count - 1] = binary;
+	}
+
+	free(line);
+	rewind(f);
+
+	return binaries;
+}
+
 static bool job_list_from_test_list(struct job_list *job_list,
 				    struct settings *settings)
 {
@@ -201,6 +679,9 @@ static bool job_list_from_test_list(struct job_list *job_list,
 	char *line = NULL;
 	size_t line_len = 0;
 	struct job_list_entry entry = {};
+	struct subtest_list *lists;
+	char **whole_binaries;
+	size_t num_whole, next_whole = 0;
 	bool any = false;
 
 	if ((f = fopen(settings->test_list, "r")) == NULL) {
@@ -208,27 +689,14 @@ static bool job_list_from_test_list(struct job_list *job_list,
 		return false;
 	}
 
-	while (1) {
+	/* List the subtests of all the whole binaries at once */
+	whole_binaries = test_list_whole_binaries(f, settings, &num_whole);
+	lists = list_all_subtests(settings, whole_binaries, num_whole);
+
+	while (next_test_list_line(f, &line, &line_len, settings)) {
 		char *binary;
 		char *delim;
 
-		if (getline(&line, &line_len, f) == -1) {
-			if (errno == EINTR)
-				continue;
-			else
-				break;
-		}
-
-		/* # starts a comment */
-		if ((delim = strchr(line, '#')) != NULL)
-			*delim = '\0';
-
-		if (settings->exclude_regexes.size && matches_any(line, &settings->exclude_regexes))
-			continue;
-
-		if (settings->include_regexes.size && !matches_any(line, &settings->include_regexes))
-			continue;
-
 		if (sscanf(line, "igt@%ms", &binary) == 1) {
 			if ((delim = strchr(binary, '@')) != NULL) {
 				*delim++ = '\0';
@@ -246,10 +714,12 @@ static bool job_list_from_test_list(struct job_list *job_list,
 					any = true;
 				}
 
-				add_subtests(job_list, settings, binary,
+				add_subtests(job_list, settings,
+					     &lists[next_whole++],
 					     &settings->include_regexes,
 					     &settings->exclude_regexes);
 				any = true;
+				free(binary);
 				continue;
 			}
 
@@ -320,6 +790,11 @@ static bool job_list_from_test_list(struct job_list *job_list,
 		any = true;
 	}
 
+	free_subtest_lists(lists, num_whole);
+	for (size_t i = 0; i < num_whole; i++)
+		free(whole_binaries[i]);
+	free(whole_binaries);
+
 	free(line);
 	fclose(f);
 	return any;
@@ -0,0 +1,380 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "output_capture.h"
+#include "output_strings.h"
+#include "runnercomms.h"
+
+static size_t write_out(int fd, const void *data, size_t len)
+{
+	size_t written = 0;
+
+	while (written < len) {
+		ssize_t ret = write(fd, (const char *)data + written, len - written);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		written += ret;
+	}
+
+	return written;
+}
+
+static size_t write_packet(int fd, const struct runnerpacket *packet)
+{
+	uint32_t canary = socket_dump_canary();
+
+	return write_out(fd, &canary, sizeof(canary)) +
+		write_out(fd, packet, packet->size);
+}
+
+static int stream_index(int stream)
+{
+	return stream == STDERR_FILENO;
+}
+
+static size_t log_text_length(const struct runnerpacket *packet)
+{
+	if (packet->size <= sizeof(*packet) + 1)
+		return 0;
+
+	return strnlen(packet->data + 1, packet->size - sizeof(*packet) - 1);
+}
+
+void output_capture_init(struct output_capture *c, size_t budget,
+			 bool packets, int stream,
+			 int dirfd, const char *overflow_name)
+{
+	memset(c, 0, sizeof(*c));
+	c->packets = packets;
+	c->stream = stream;
+	c->dirfd = dirfd;
+	c->overflow_name = overflow_name;
+
+	if (!budget)
+		return;
+
+	c->tail_size = budget - budget / 2;
+	c->tail = malloc(c->tail_size);
+	if (!c->tail)
+		return;
+
+	c->budget = budget;
+	c->head = budget / 2;
+}
+
+void output_capture_fini(struct output_capture *c)
+{
+	if (c->overflow)
+		gzclose(c->overflow);
+	free(c->tail);
+	free(c->scratch);
+
+	memset(c, 0, sizeof(*c));
+}
+
+/* Compress what is left out, until the overflow file is over the budget */
+static void overflow(struct output_capture *c, int stream,
+		     const void *data, size_t len)
+{
+	int i = stream_index(stream);
+
+	c->dropped[i] += len;
+
+	if (!len || c->overflow_failed)
+		return;
+
+	if (!c->overflow) {
+		int fd = openat(c->dirfd, c->overflow_name,
+				O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+
+		if (fd >= 0 && !(c->overflow = gzdopen(fd, "wb1")))
+			close(fd);
+		if (!c->overflow) {
+			c->overflow_failed = true;
+			return;
+		}
+	}
+
+	if (gzoffset(c->overflow) >= (z_off_t)c->budget ||
+	    gzwrite(c->overflow, data, len) != len) {
+		c->overflow_failed = true;
+		return;
+	}
+
+	c->compressed[i] += len;
+	c->overflow_written = true;
+}
+
+static void tail_peek(struct output_capture *c, void *dst, size_t len)
+{
+	size_t first = c->tail_size - c->tail_start;
+
+	if (first > len)
+		first = len;
+
+	memcpy(dst, c->tail + c->tail_start, first);
+	memcpy((char *)dst + first, c->tail, len - first);
+}
+
+static void tail_append(struct output_capture *c, const void *data, size_t len)
+{
+	size_t end = (c->tail_start + c->tail_len) % c->tail_size;
+	size_t first = c->tail_size - end;
+
+	if (first > len)
+		first = len;
+
+	memcpy(c->tail + end, data, first);
+	memcpy(c->tail, (const char *)data + first, len - first);
+	c->tail_len += len;
+}
+
+static void tail_consume(struct output_capture *c, size_t len)
+{
+	c->tail_start = (c->tail_start + len) % c->tail_size;
+	c->tail_len -= len;
+}
+
+static void tail_evict_bytes(struct output_capture *c, size_t len)
+{
+	size_t first = c->tail_size - c->tail_start;
+
+	if (first > len)
+		first = len;
+
+	overflow(c, c->stream, c->tail + c->tail_start, first);
+	overflow(c, c->stream, c->tail, len - first);
+	tail_consume(c, len);
+}
+
+/* Copy out the packet at the start of the tail, into the scratch buffer */
+static const struct runnerpacket *tail_peek_packet(struct output_capture *c)
+{
+	uint32_t size;
+
+	tail_peek(c, &size, sizeof(size));
+
+	if (size > c->scratch_size) {
+		char *scratch = realloc(c->scratch, size);
+
+		if (!scratch)
+			return NULL;
+
+		c->scratch = scratch;
+		c->scratch_size = size;
+	}
+
+	tail_peek(c, c->scratch, size);
+
+	return (const struct runnerpacket *)c->scratch;
+}
+
+static void overflow_packet(struct output_capture *c,
+			    const struct runnerpacket *packet)
+{
+	overflow(c, packet->data[0], packet->data + 1, log_text_length(packet));
+}
+
+static void tail_evict_packet(struct output_capture *c)
+{
+	const struct runnerpacket *packet = tail_peek_packet(c);
+	uint32_t size;
+
+	if (packet) {
+		size = packet->size;
+		overflow_packet(c, packet);
+	} else {
+		tail_peek(c, &size, sizeof(size));
+	}
+
+	tail_consume(c, size);
+}
+
+static size_t capture_packet(struct output_capture *c, int fd,
+			     const struct runnerpacket *packet)
+{
+	size_t len = log_text_length(packet);
+
+	if (c->head && len <= c->head) {
+		c->head -= len;
+		return write_packet(fd, packet);
+	}
+
+	/* Keep the order, nothing more goes out before the tail */
+	c->head = 0;
+
+	if (packet->size > c->tail_size) {
+		overflow_packet(c, packet);
+		return 0;
+	}
+
+	while (c->tail_len + packet->size > c->tail_size)
+		tail_evict_packet(c);
+	tail_append(c, packet, packet->size);
+
+	return 0;
+}
+
+size_t output_capture_write(struct output_capture *c, int fd,
+			    const void *data, size_t len)
+{
+	const char *ptr = data;
+	size_t written = 0;
+
+	if (!c->budget) {
+		if (c->packets)
+			return write_packet(fd, data);
+		return write_out(fd, data, len);
+	}
+
+	if (c->packets)
+		return capture_packet(c, fd, data);
+
+	if (c->head) {
+		size_t n = len < c->head ? len : c->head;
+
+		written = write_out(fd, ptr, n);
+		c->head -= n;
+		ptr += n;
+		len -= n;
+	}
+
+	if (len > c->tail_size) {
+		if (c->tail_len)
+			tail_evict_bytes(c, c->tail_len);
+		overflow(c, c->stream, ptr, len - c->tail_size);
+		ptr += len - c->tail_size;
+		len = c->tail_size;
+	} else if (c->tail_len + len > c->tail_size) {
+		tail_evict_bytes(c, c->tail_len + len - c->tail_size);
+	}
+
+	if (len)
+		tail_append(c, ptr, len);
+
+	return written;
+}
+
+ssize_t output_capture_read(struct output_capture *c, int infd, int fd,
+			    char *buf, size_t bufsize, size_t *written)
+{
+	ssize_t s;
+
+	*written = 0;
+
+	/* Pipe to file without a copy, if the kernel can */
+	if (c->budget && c->head && !c->no_splice) {
+		s = splice(infd, NULL, fd, NULL, c->head, SPLICE_F_MOVE);
+		if (s >= 0 || errno != EINVAL) {
+			if (s > 0) {
+				c->head -= s;
+				*written = s;
+			}
+			return s;
+		}
+
+		c->no_splice = true;
+	}
+
+	s = read(infd, buf, bufsize);
+	if (s > 0)
+		*written = output_capture_write(c, fd, buf, s);
+
+	return s;
+}
+
+static bool at_line_start(int fd)
+{
+	off_t offset = lseek(fd, 0, SEEK_CUR);
+	char last;
+
+	return offset <= 0 ||
+		pread(fd, &last, 1, offset - 1) != 1 ||
+		last == '\n';
+}
+
+size_t output_capture_flush(struct output_capture *c, int fd)
+{
+	size_t written = 0;
+	int i;
+
+	if (!c->budget)
+		return 0;
+
+	for (i = 0; i < 2; i++) {
+		char marker[256];
+
+		if (!c->dropped[i])
+			continue;
+
+		snprintf(marker, sizeof(marker),
+			 "%s%" PRIu64 " bytes, %" PRIu64 " of them kept compressed in %s\n",
+			 OUTPUT_DROPPED, c->dropped[i], c->compressed[i],
+			 c->overflow_name);
+
+		if (c->packets) {
+			struct runnerpacket *packet;
+
+			packet = runnerpacket_log(i ? STDERR_FILENO : STDOUT_FILENO, marker);
+			written += write_packet(fd, packet);
+			free(packet);
+		} else {
+			if (!at_line_start(fd))
+				written += write_out(fd, "\n", 1);
+			written += write_out(fd, marker, strlen(marker));
+		}
+
+		c->dropped[i] = 0;
+		c->compressed[i] = 0;
+	}
+
+	if (c->packets) {
+		while (c->tail_len) {
+			const struct runnerpacket *packet = tail_peek_packet(c);
+			uint32_t size;
+
+			if (packet) {
+				size = packet->size;
+				written += write_packet(fd, packet);
+			} else {
+				tail_peek(c, &size, sizeof(size));
+			}
+
+			tail_consume(c, size);
+		}
+	} else if (c->tail_len) {
+		size_t first = c->tail_size - c->tail_start;
+
+		if (first > c->tail_len)
+			first = c->tail_len;
+
+		written += write_out(fd, c->tail + c->tail_start, first);
+		written += write_out(fd, c->tail, c->tail_len - first);
+	}
+
+	c->tail_start = 0;
+	c->tail_len = 0;
+	c->head = c->budget / 2;
+
+	if (c->overflow_written) {
+		gzflush(c->overflow, Z_SYNC_FLUSH);
+		c->overflow_written = false;
+	}
+
+	return written;
+}
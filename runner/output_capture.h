@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: MIT
+ * Copyright © 2026 Intel Corporation
+ */
+
+#ifndef RUNNER_OUTPUT_CAPTURE_H
+#define RUNNER_OUTPUT_CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+/*
+ * Output capture keeps the output of a test within a budget, per
+ * segment of it between two subtest boundaries. The first half of the
+ * budget is written as it comes, the last half is kept in a ring and
+ * written when the segment ends, and the output in between is
+ * compressed to an overflow file, up to the budget, or dropped. Where
+ * anything was left out, a line starting with OUTPUT_DROPPED says how
+ * much.
+ *
+ * A capture either takes the bytes of stdout or stderr, or the log
+ * packets of socket comms, whole.
+ */
+struct output_capture {
+	size_t budget;		/* 0 to keep all of the output */
+	bool packets;
+	int stream;		/* STDOUT_FILENO or STDERR_FILENO, for bytes */
+
+	size_t head;		/* still written as it comes */
+	char *tail;
+	size_t tail_size, tail_start, tail_len;
+
+	/* Per stream, since the segment started */
+	uint64_t dropped[2];
+	uint64_t compressed[2];
+
+	int dirfd;
+	const char *overflow_name;
+	gzFile overflow;
+	bool overflow_failed;
+	bool overflow_written;
+	bool no_splice;
+
+	char *scratch;
+	size_t scratch_size;
+};
+
+void output_capture_init(struct output_capture *c, size_t budget,
+			 bool packets, int stream,
+			 int dirfd, const char *overflow_name);
+void output_capture_fini(struct output_capture *c);
+
+/*
+ * Capture len bytes of output, or one log packet. Returns the number of
+ * bytes written to fd.
+ */
+size_t output_capture_write(struct output_capture *c, int fd,
+			    const void *data, size_t len);
+
+/*
+ * Read from the pipe infd into the capture, splicing straight to fd
+ * while the head of the segment lasts. Returns what read() would, and
+ * the number of bytes written to fd in written.
+ */
+ssize_t output_capture_read(struct output_capture *c, int infd, int fd,
+			    char *buf, size_t bufsize, size_t *written);
+
+/*
+ * End the current segment: write out what was left out, if anything,
+ * and the tail. Returns the number of bytes written to fd.
+ */
+size_t output_capture_flush(struct output_capture *c, int fd);
+
+#endif
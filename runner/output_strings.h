@@ -87,4 +87,13 @@ static const char EXECUTOR_EXIT[] = "exit:";
  */
 static const char EXECUTOR_TIMEOUT[] = "timeout:";
 
+/*
+ * Output by the executor where the output of a test went over the
+ * output budget and a part of it was left out.
+ *
+ * Example:
+ * runner: Output over budget, dropped 103616 bytes, 103616 of them kept compressed in out-overflow.txt.gz
+ */
+static const char OUTPUT_DROPPED[] = "runner: Output over budget, dropped ";
+
 #endif
@@ -17,6 +17,7 @@
 #include "settings.h"
 #include "executor.h"
 #include "output_strings.h"
+#include "results_index.h"
 
 #define INCOMPLETE_EXITCODE -1234
 #define GRACEFUL_EXITCODE -SIGHUP
@@ -2158,6 +2159,64 @@ static void add_to_totals(const char *binary,
 	}
 }
 
+/*
+ * Sum up what the executor reported as left out of the output of a
+ * test, on lines starting with OUTPUT_DROPPED.
+ */
+static uint64_t count_dropped(struct json_t *test, const char *key)
+{
+	const char *text = json_string_value(json_object_get(test, key));
+	const char *p = text;
+	uint64_t dropped = 0;
+
+	while (p && (p = strstr(p, OUTPUT_DROPPED)) != NULL) {
+		if (p == text || p[-1] == '\n')
+			dropped += strtoull(p + strlen(OUTPUT_DROPPED), NULL, 10);
+		p += strlen(OUTPUT_DROPPED);
+	}
+
+	return dropped;
+}
+
+static void add_dropped_to_test(struct json_t *test)
+{
+	uint64_t dropped;
+
+	if (!test)
+		return;
+
+	if ((dropped = count_dropped(test, "out")) != 0)
+		json_object_set_new(test, "out-dropped", json_integer(dropped));
+	if ((dropped = count_dropped(test, "err")) != 0)
+		json_object_set_new(test, "err-dropped", json_integer(dropped));
+}
+
+static void add_dropped_output(const char *binary,
+			       struct subtest_list *subtests,
+			       struct json_t *tests)
+{
+	char piglit_name[256];
+	char dynamic_piglit_name[256];
+	size_t i, k;
+
+	if (subtests->size == 0) {
+		generate_piglit_name(binary, NULL, piglit_name, sizeof(piglit_name));
+		add_dropped_to_test(json_object_get(tests, piglit_name));
+		return;
+	}
+
+	for (i = 0; i < subtests->size; i++) {
+		generate_piglit_name(binary, subtests->subs[i].name, piglit_name, sizeof(piglit_name));
+		add_dropped_to_test(json_object_get(tests, piglit_name));
+
+		for (k = 0; k < subtests->subs[i].dynamic_size; k++) {
+			generate_piglit_name_for_dynamic(piglit_name, subtests->subs[i].dynamic_names[k],
+							 dynamic_piglit_name, sizeof(dynamic_piglit_name));
+			add_dropped_to_test(json_object_get(tests, dynamic_piglit_name));
+		}
+	}
+}
+
 static bool parse_test_directory(int dirfd,
 				 struct job_list_entry *entry,
 				 struct settings *settings,
@@ -2233,6 +2292,9 @@ static bool parse_test_directory(int dirfd,
 	override_results(entry->binary, &subtests, results->tests);
 	prune_subtests(settings, entry, &subtests, results->tests);
 
+	if (settings->output_budget)
+		add_dropped_output(entry->binary, &subtests, results->tests);
+
 	add_to_totals(entry->binary, &subtests, results);
 
 	close_outputs(fds);
@@ -2426,6 +2488,57 @@ struct json_t *generate_results_json(int dirfd)
 	return obj;
 }
 
+bool index_results(int dirfd, size_t idx,
+		   struct job_list_entry *entry,
+		   struct settings *settings,
+		   struct results_index_writer *w)
+{
+	uint64_t output_size[_F_LAST] = {};
+	struct results_index_test *tests;
+	struct json_t *root, *test;
+	struct results results;
+	const char *piglit_name;
+	char name[16];
+	int testdirfd;
+	size_t i = 0;
+	bool ret;
+
+	snprintf(name, sizeof(name), "%zu", idx);
+	if ((testdirfd = openat(dirfd, name, O_DIRECTORY | O_RDONLY)) < 0)
+		return false;
+
+	for (int fid = 0; fid < _F_LAST; fid++) {
+		struct stat st;
+
+		if (!fstatat(testdirfd, get_out_filename(fid), &st, 0))
+			output_size[fid] = st.st_size;
+	}
+
+	root = json_object();
+	create_result_root_nodes(root, &results);
+
+	if (!parse_test_directory(testdirfd, entry, settings, &results))
+		try_add_notrun_results(entry, settings, &results);
+	close(testdirfd);
+
+	tests = calloc(json_object_size(results.tests) + 1, sizeof(*tests));
+	json_object_foreach(results.tests, piglit_name, test) {
+		struct json_t *end = json_object_get(json_object_get(test, "time"), "end");
+
+		tests[i].name = piglit_name;
+		tests[i].result = json_string_value(json_object_get(test, "result"));
+		tests[i].runtime = end ? json_real_value(end) : 0.0;
+		i++;
+	}
+
+	ret = results_index_append(w, idx, tests, i, output_size);
+
+	free(tests);
+	json_decref(root);
+
+	return ret;
+}
+
 bool generate_results(int dirfd)
 {
 	struct json_t *obj = generate_results_json(dirfd);
@@ -2,10 +2,26 @@
 #define RUNNER_RESULTGEN_H
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "job_list.h"
+#include "settings.h"
+
+struct results_index_writer;
 
 bool generate_results(int dirfd);
 bool generate_results_path(char *resultspath);
 
 struct json_t *generate_results_json(int dirfd);
 
+/*
+ * Parse the results of the job list entry idx from the results
+ * directory dirfd and append them to the results index. Returns false
+ * if the entry has not been executed or the index cannot be written.
+ */
+bool index_results(int dirfd, size_t idx,
+		   struct job_list_entry *entry,
+		   struct settings *settings,
+		   struct results_index_writer *w);
+
 #endif
@@ -0,0 +1,376 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "results_index.h"
+
+static const char *result_strings[_RESULT_LAST] = {
+	[RESULT_PASS] = "pass",
+	[RESULT_SKIP] = "skip",
+	[RESULT_FAIL] = "fail",
+	[RESULT_CRASH] = "crash",
+	[RESULT_TIMEOUT] = "timeout",
+	[RESULT_INCOMPLETE] = "incomplete",
+	[RESULT_ABORT] = "abort",
+	[RESULT_NOTRUN] = "notrun",
+	[RESULT_DMESG_WARN] = "dmesg-warn",
+	[RESULT_DMESG_FAIL] = "dmesg-fail",
+	[RESULT_WARN] = "warn",
+	[RESULT_UNKNOWN] = "unknown",
+};
+
+enum results_index_result results_index_result_from_string(const char *result)
+{
+	int i;
+
+	for (i = 0; i < RESULT_UNKNOWN; i++)
+		if (result && !strcmp(result, result_strings[i]))
+			return i;
+
+	return RESULT_UNKNOWN;
+}
+
+const char *results_index_result_string(enum results_index_result result)
+{
+	if (result >= _RESULT_LAST)
+		result = RESULT_UNKNOWN;
+
+	return result_strings[result];
+}
+
+static bool header_valid(const struct results_index_header *header)
+{
+	return !memcmp(header->magic, RESULTS_INDEX_MAGIC, sizeof(header->magic)) &&
+		header->version == RESULTS_INDEX_VERSION &&
+		header->record_size == sizeof(struct results_index_record);
+}
+
+/*
+ * Number of records at the end of the first count which belong to the
+ * same batch as the last one, or 0 if that batch is complete.
+ */
+static size_t incomplete_batch(const struct results_index_record *records,
+			       size_t count)
+{
+	const struct results_index_record *last = &records[count - 1];
+	size_t n = 1;
+
+	while (n < count && records[count - 1 - n].batch == last->batch)
+		n++;
+
+	return n < last->batch_size ? n : 0;
+}
+
+bool results_index_open(struct results_index *index, int dirfd)
+{
+	const struct results_index_header *header;
+	struct stat st;
+	size_t i, n;
+	int fd;
+
+	memset(index, 0, sizeof(*index));
+
+	if ((fd = openat(dirfd, RESULTS_INDEX_FILENAME, O_RDONLY)) < 0)
+		return false;
+
+	if (fstat(fd, &st) || st.st_size < sizeof(*header)) {
+		close(fd);
+		return false;
+	}
+
+	index->map_size = st.st_size;
+	index->map = mmap(NULL, index->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (index->map == MAP_FAILED) {
+		index->map = NULL;
+		return false;
+	}
+
+	header = index->map;
+	if (!header_valid(header)) {
+		results_index_close(index);
+		return false;
+	}
+
+	index->records = (const void *)(header + 1);
+	index->count = (index->map_size - sizeof(*header)) / sizeof(*index->records);
+	while (index->count && (n = incomplete_batch(index->records, index->count)))
+		index->count -= n;
+
+	if ((fd = openat(dirfd, RESULTS_INDEX_STRINGS_FILENAME, O_RDONLY)) >= 0) {
+		if (!fstat(fd, &st) && st.st_size > 0) {
+			void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+			if (ptr != MAP_FAILED) {
+				index->strings = ptr;
+				index->strings_size = st.st_size;
+			}
+		}
+		close(fd);
+	}
+
+	for (i = 0; i < index->count; i++)
+		if (index->records[i].entry >= index->num_entries)
+			index->num_entries = index->records[i].entry + 1;
+
+	if (index->num_entries) {
+		index->latest = malloc(index->num_entries * sizeof(*index->latest));
+		if (!index->latest) {
+			results_index_close(index);
+			return false;
+		}
+		memset(index->latest, 0xff, index->num_entries * sizeof(*index->latest));
+	}
+
+	/* Batches are numbered in the order they are appended */
+	for (i = 0; i < index->count; i++)
+		index->latest[index->records[i].entry] = index->records[i].batch;
+
+	return true;
+}
+
+void results_index_close(struct results_index *index)
+{
+	if (index->map)
+		munmap(index->map, index->map_size);
+	if (index->strings)
+		munmap((void *)index->strings, index->strings_size);
+	free(index->latest);
+
+	memset(index, 0, sizeof(*index));
+}
+
+bool results_index_is_current(const struct results_index *index,
+			      const struct results_index_record *record)
+{
+	return record->entry < index->num_entries &&
+		index->latest[record->entry] == record->batch;
+}
+
+const char *results_index_name(const struct results_index *index,
+			       const struct results_index_record *record)
+{
+	const char *name;
+
+	if (record->name >= index->strings_size)
+		return NULL;
+
+	name = index->strings + record->name;
+	if (!memchr(name, '\0', index->strings_size - record->name))
+		return NULL;
+
+	return name;
+}
+
+static bool write_all(int fd, const void *buf, size_t len)
+{
+	while (len) {
+		ssize_t ret = write(fd, buf, len);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		buf = (const char *)buf + ret;
+		len -= ret;
+	}
+
+	return true;
+}
+
+static bool read_record(int fd, size_t i, struct results_index_record *record)
+{
+	off_t offset = sizeof(struct results_index_header) + i * sizeof(*record);
+
+	return pread(fd, record, sizeof(*record), offset) == sizeof(*record);
+}
+
+/* Number of records left once a trailing incomplete batch is dropped */
+static size_t complete_records(int fd, size_t count)
+{
+	struct results_index_record last, record;
+
+	while (count) {
+		size_t n = 1;
+
+		if (!read_record(fd, count - 1, &last))
+			return 0;
+
+		while (n < count && read_record(fd, count - 1 - n, &record) &&
+		       record.batch == last.batch)
+			n++;
+
+		if (n >= last.batch_size)
+			break;
+
+		count -= n;
+	}
+
+	return count;
+}
+
+static bool reset_index(struct results_index_writer *w)
+{
+	struct results_index_header header = {
+		.version = RESULTS_INDEX_VERSION,
+		.record_size = sizeof(struct results_index_record),
+	};
+
+	memcpy(header.magic, RESULTS_INDEX_MAGIC, sizeof(header.magic));
+
+	return !ftruncate(w->fd, 0) && !ftruncate(w->strfd, 0) &&
+		write_all(w->fd, &header, sizeof(header));
+}
+
+bool results_index_writer_open(struct results_index_writer *w, int dirfd,
+			       bool sync)
+{
+	struct results_index_header header;
+	struct results_index_record last;
+	struct stat st;
+	size_t count;
+
+	memset(w, 0, sizeof(*w));
+	w->sync = sync;
+
+	w->fd = openat(dirfd, RESULTS_INDEX_FILENAME,
+		       O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+	w->strfd = openat(dirfd, RESULTS_INDEX_STRINGS_FILENAME,
+			  O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+	if (w->fd < 0 || w->strfd < 0)
+		goto err;
+
+	if (fstat(w->fd, &st))
+		goto err;
+
+	if (st.st_size < sizeof(header) ||
+	    pread(w->fd, &header, sizeof(header), 0) != sizeof(header) ||
+	    !header_valid(&header)) {
+		if (!reset_index(w))
+			goto err;
+		return true;
+	}
+
+	count = complete_records(w->fd, (st.st_size - sizeof(header)) / sizeof(last));
+	if (ftruncate(w->fd, sizeof(header) + count * sizeof(last)))
+		goto err;
+
+	if (count && read_record(w->fd, count - 1, &last)) {
+		w->batch = last.batch + 1;
+		w->next_entry = last.entry + 1;
+	}
+
+	return true;
+
+err:
+	fprintf(stderr, "Cannot open the results index: %s\n", strerror(errno));
+	results_index_writer_close(w);
+	return false;
+}
+
+void results_index_writer_close(struct results_index_writer *w)
+{
+	if (w->fd >= 0)
+		close(w->fd);
+	if (w->strfd >= 0)
+		close(w->strfd);
+
+	w->fd = -1;
+	w->strfd = -1;
+}
+
+bool results_index_append(struct results_index_writer *w, size_t entry,
+			  const struct results_index_test *tests, size_t count,
+			  const uint64_t *output_size)
+{
+	struct results_index_record *records;
+	struct timespec now;
+	off_t base, size;
+	size_t len = 0, i;
+	char *strings;
+	bool ret;
+
+	if (w->fd < 0)
+		return false;
+
+	if (entry >= w->next_entry)
+		w->next_entry = entry + 1;
+
+	if (count == 0)
+		return true;
+
+	for (i = 0; i < count; i++)
+		len += strlen(tests[i].name) + 1;
+
+	records = calloc(count, sizeof(*records));
+	strings = malloc(len);
+	if (!records || !strings) {
+		free(records);
+		free(strings);
+		return false;
+	}
+
+	base = lseek(w->strfd, 0, SEEK_END);
+	size = lseek(w->fd, 0, SEEK_END);
+	if (base < 0 || size < 0) {
+		free(records);
+		free(strings);
+		return false;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	len = 0;
+	for (i = 0; i < count; i++) {
+		struct results_index_record *r = &records[i];
+
+		r->entry = entry;
+		r->batch = w->batch;
+		r->batch_size = count;
+		r->result = results_index_result_from_string(tests[i].result);
+		r->name = base + len;
+		r->runtime = tests[i].runtime;
+		r->end = now.tv_sec + now.tv_nsec / 1000000000.0;
+		memcpy(r->output_size, output_size, sizeof(r->output_size));
+
+		strcpy(strings + len, tests[i].name);
+		len += strlen(tests[i].name) + 1;
+	}
+
+	/* The names go first, so that a record never points past them */
+	ret = write_all(w->strfd, strings, len);
+	if (ret && w->sync)
+		ret = !fdatasync(w->strfd);
+	if (ret)
+		ret = write_all(w->fd, records, count * sizeof(*records));
+	if (ret && w->sync)
+		ret = !fdatasync(w->fd);
+
+	if (ret) {
+		w->batch++;
+	} else {
+		fprintf(stderr, "Cannot append to the results index: %s\n",
+			strerror(errno));
+		/* Do not leave a partial record for the next batch to follow */
+		if (ftruncate(w->fd, size))
+			results_index_writer_close(w);
+	}
+
+	free(records);
+	free(strings);
+
+	return ret;
+}
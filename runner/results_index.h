@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: MIT
+ * Copyright © 2026 Intel Corporation
+ */
+
+#ifndef RUNNER_RESULTS_INDEX_H
+#define RUNNER_RESULTS_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "executor.h"
+
+/*
+ * The results index lets the results of a run be looked up without
+ * parsing the output of every test. It is a pair of append-only files
+ * in the results directory: index.bin holds a header followed by
+ * fixed-size records, one per test name, and index.str holds the
+ * NUL-terminated names the records point to.
+ *
+ * The executor appends the records of a job list entry in one batch
+ * once the entry finishes. When an entry is executed again on resume,
+ * its latest batch replaces the previous ones.
+ */
+
+#define RESULTS_INDEX_FILENAME "index.bin"
+#define RESULTS_INDEX_STRINGS_FILENAME "index.str"
+
+#define RESULTS_INDEX_MAGIC "igtrsidx"
+#define RESULTS_INDEX_VERSION 1
+
+enum results_index_result {
+	RESULT_PASS,
+	RESULT_SKIP,
+	RESULT_FAIL,
+	RESULT_CRASH,
+	RESULT_TIMEOUT,
+	RESULT_INCOMPLETE,
+	RESULT_ABORT,
+	RESULT_NOTRUN,
+	RESULT_DMESG_WARN,
+	RESULT_DMESG_FAIL,
+	RESULT_WARN,
+	RESULT_UNKNOWN,
+	_RESULT_LAST,
+};
+
+struct results_index_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+};
+
+struct results_index_record {
+	uint32_t entry;		/* in the job list */
+	uint32_t batch;		/* shared by the records appended together */
+	uint32_t batch_size;
+	uint32_t result;	/* enum results_index_result */
+	uint64_t name;		/* offset in index.str */
+	double runtime;		/* in seconds, 0.0 if unknown */
+	double end;		/* time of day when the entry was indexed */
+	uint64_t output_size[_F_LAST];	/* of the entry's output files */
+};
+
+struct results_index {
+	void *map;
+	size_t map_size;
+	const char *strings;
+	size_t strings_size;
+
+	const struct results_index_record *records;
+	size_t count;
+	/* Per entry, the batch its current records belong to, or ~0u */
+	uint32_t *latest;
+	size_t num_entries;
+};
+
+struct results_index_writer {
+	int fd;
+	int strfd;
+	uint32_t batch;
+	/* The entry after the last one indexed */
+	size_t next_entry;
+	bool sync;
+};
+
+struct results_index_test {
+	const char *name;
+	const char *result;
+	double runtime;
+};
+
+enum results_index_result results_index_result_from_string(const char *result);
+const char *results_index_result_string(enum results_index_result result);
+
+/*
+ * Map the index of the results directory dirfd, ignoring any batch left
+ * incomplete at the end. Returns false if there is no usable index.
+ */
+bool results_index_open(struct results_index *index, int dirfd);
+void results_index_close(struct results_index *index);
+
+/* Whether the record is not replaced by a later batch of its entry */
+bool results_index_is_current(const struct results_index *index,
+			      const struct results_index_record *record);
+const char *results_index_name(const struct results_index *index,
+			       const struct results_index_record *record);
+
+/*
+ * Open the index of the results directory dirfd for appending, creating
+ * it if needed. A batch left incomplete at the end, or an index of
+ * another version, is dropped.
+ */
+bool results_index_writer_open(struct results_index_writer *w, int dirfd,
+			       bool sync);
+void results_index_writer_close(struct results_index_writer *w);
+
+/* Append the results of the tests of a job list entry in one batch */
+bool results_index_append(struct results_index_writer *w, size_t entry,
+			  const struct results_index_test *tests, size_t count,
+			  const uint64_t *output_size);
+
+#endif
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "results_index.h"
+
+static const char *usage_str =
+	"usage: igt_results_query [options] results-directory\n\n"
+	"Lists the results of the tests executed so far, as recorded in the\n"
+	"results index, without parsing their output.\n\n"
+	"Options:\n"
+	"  -r, --result RESULT   Only list tests with this result, can be given\n"
+	"                        more than once\n"
+	"  -n, --name PATTERN    Only list tests whose name matches this glob\n"
+	"                        pattern, can be given more than once\n"
+	"  -t, --time            Also list the runtime of the tests\n"
+	"  -c, --count           Only print the number of tests of each result\n"
+	"  -h, --help            Print this help\n";
+
+static void usage(FILE *f)
+{
+	fprintf(f, "%s", usage_str);
+}
+
+static bool name_matches(const char *name, char **patterns, int count)
+{
+	int i;
+
+	if (count == 0)
+		return true;
+
+	for (i = 0; i < count; i++)
+		if (!fnmatch(patterns[i], name, 0))
+			return true;
+
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[] = {
+		{ "result", required_argument, NULL, 'r' },
+		{ "name", required_argument, NULL, 'n' },
+		{ "time", no_argument, NULL, 't' },
+		{ "count", no_argument, NULL, 'c' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	size_t totals[_RESULT_LAST] = {};
+	bool results[_RESULT_LAST] = {};
+	bool any_result = false, time = false, count = false;
+	struct results_index index;
+	char **patterns;
+	int num_patterns = 0;
+	int c, dirfd;
+	size_t i;
+
+	patterns = calloc(argc, sizeof(*patterns));
+	if (!patterns)
+		return 1;
+
+	while ((c = getopt_long(argc, argv, "r:n:tch", long_options, NULL)) != -1) {
+		enum results_index_result result;
+
+		switch (c) {
+		case 'r':
+			result = results_index_result_from_string(optarg);
+			if (result == RESULT_UNKNOWN && strcmp(optarg, "unknown")) {
+				fprintf(stderr, "Unknown result %s\n", optarg);
+				return 1;
+			}
+			results[result] = true;
+			any_result = true;
+			break;
+		case 'n':
+			patterns[num_patterns++] = optarg;
+			break;
+		case 't':
+			time = true;
+			break;
+		case 'c':
+			count = true;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 1;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage(stderr);
+		return 1;
+	}
+
+	if ((dirfd = open(argv[optind], O_DIRECTORY | O_RDONLY)) < 0) {
+		fprintf(stderr, "Failure opening %s: %s\n", argv[optind], strerror(errno));
+		return 1;
+	}
+
+	if (!results_index_open(&index, dirfd)) {
+		fprintf(stderr, "No results index in %s\n", argv[optind]);
+		close(dirfd);
+		return 1;
+	}
+	close(dirfd);
+
+	for (i = 0; i < index.count; i++) {
+		const struct results_index_record *record = &index.records[i];
+		enum results_index_result result = record->result;
+		const char *name;
+
+		if (result >= _RESULT_LAST)
+			result = RESULT_UNKNOWN;
+
+		if (!results_index_is_current(&index, record) ||
+		    (any_result && !results[result]))
+			continue;
+
+		name = results_index_name(&index, record);
+		if (!name || !name_matches(name, patterns, num_patterns))
+			continue;
+
+		if (count) {
+			totals[result]++;
+		} else if (time) {
+			printf("%s: %s (%.3fs)\n", name,
+			       results_index_result_string(result), record->runtime);
+		} else {
+			printf("%s: %s\n", name, results_index_result_string(result));
+		}
+	}
+
+	if (count)
+		for (i = 0; i < _RESULT_LAST; i++)
+			if (totals[i])
+				printf("%s: %zu\n", results_index_result_string(i), totals[i]);
+
+	results_index_close(&index);
+	free(patterns);
+
+	return 0;
+}
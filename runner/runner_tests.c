@@ -13,6 +13,7 @@
 #include "job_list.h"
 #include "executor.h"
 #include "resultgen.h"
+#include "results_index.h"
 
 /*
  * NOTE: this test is using a lot of variables that are changed in igt_fixture(),
@@ -29,10 +30,10 @@ static const char testdatadir[] = TESTDATA_DIRECTORY;
  * that test binaries without subtests should still be counted as one
  * for this macro.
  */
-#define NUM_TESTDATA_SUBTESTS 15
+#define NUM_TESTDATA_SUBTESTS 16
 #define NUM_TESTDATA_ABORT_SUBTESTS 9
 /* The total number of test binaries in runner/testdata/ */
-#define NUM_TESTDATA_BINARIES 8
+#define NUM_TESTDATA_BINARIES 9
 
 static const char *igt_get_result(struct json_t *tests, const char *testname)
 {
@@ -62,6 +63,38 @@ static void igt_assert_eqstr(const char *one, const char *two)
 	igt_assert_f(!strcmp(one, two), "Strings differ: '%s' vs '%s'\n", one, two);
 }
 
+/* Check that the results index agrees with the results in the json */
+static void assert_results_index_matches(int dirfd, struct json_t *tests)
+{
+	struct results_index index;
+	size_t i, current = 0;
+
+	igt_assert_f(results_index_open(&index, dirfd),
+		     "Execute didn't create the results index\n");
+
+	for (i = 0; i < index.count; i++) {
+		const struct results_index_record *record = &index.records[i];
+		const char *name = results_index_name(&index, record);
+		struct json_t *end;
+
+		if (!results_index_is_current(&index, record))
+			continue;
+
+		igt_assert(name);
+		igt_assert_eqstr(results_index_result_string(record->result),
+				 igt_get_result(tests, name));
+
+		end = json_object_get(json_object_get(json_object_get(tests, name), "time"), "end");
+		igt_assert(record->runtime == (end ? json_real_value(end) : 0.0));
+
+		current++;
+	}
+
+	igt_assert_eq(current, json_object_size(tests));
+
+	results_index_close(&index);
+}
+
 static void debug_print_executions(struct job_list *list)
 {
 	size_t i;
@@ -187,6 +220,7 @@ static void assert_settings_equal(struct settings *one, struct settings *two)
 	 */
 	igt_assert_eq(one->abort_mask, two->abort_mask);
 	igt_assert_eq_u64(one->disk_usage_limit, two->disk_usage_limit);
+	igt_assert_eq_u64(one->output_budget, two->output_budget);
 	igt_assert_eqstr(one->test_list, two->test_list);
 	igt_assert_eqstr(one->name, two->name);
 	igt_assert_eq(one->dry_run, two->dry_run);
@@ -235,6 +269,25 @@ static void assert_job_list_equal(struct job_list *one, struct job_list *two)
 	}
 }
 
+static bool job_list_has_subtest(struct job_list *list, const char *binary,
+				 const char *subtest)
+{
+	size_t i, k;
+
+	for (i = 0; i < list->size; i++) {
+		struct job_list_entry *entry = &list->entries[i];
+
+		if (strcmp(entry->binary, binary))
+			continue;
+
+		for (k = 0; k < entry->subtest_count; k++)
+			if (!strcmp(entry->subtests[k], subtest))
+				return true;
+	}
+
+	return false;
+}
+
 static void assert_execution_created(int dirfd, const char *name)
 {
 	int fd;
@@ -299,6 +352,7 @@ int igt_main()
 
 		igt_assert_eq(settings->abort_mask, 0);
 		igt_assert_eq_u64(settings->disk_usage_limit, 0UL);
+		igt_assert_eq_u64(settings->output_budget, 0UL);
 		igt_assert(!settings->test_list);
 		igt_assert_eqstr(settings->name, "path-to-results");
 		igt_assert(!settings->dry_run);
@@ -457,6 +511,7 @@ int igt_main()
 				       "-n", "foo",
 				       "--abort-on-monitored-error=taint,lockdep",
 				       "--disk-usage-limit=4096",
+				       "--output-budget=64k",
 				       "--test-list", "path-to-test-list",
 				       "--ignore-missing",
 				       "--dry-run",
@@ -499,6 +554,7 @@ int igt_main()
 
 		igt_assert_eq(settings->abort_mask, ABORT_TAINT | ABORT_LOCKDEP);
 		igt_assert_eq_u64(settings->disk_usage_limit, 4096UL);
+		igt_assert_eq_u64(settings->output_budget, 65536UL);
 		igt_assert(strstr(settings->test_list, "path-to-test-list") != NULL);
 		igt_assert_eqstr(settings->name, "foo");
 		igt_assert(settings->dry_run);
@@ -980,6 +1036,7 @@ int igt_main()
 					       "-n", "foo",
 					       "--abort-on-monitored-error",
 					       "--disk-usage-limit=4k",
+					       "--output-budget=1M",
 					       "--test-list", "path-to-test-list",
 					       "--ignore-missing",
 					       "--dry-run",
@@ -1087,6 +1144,85 @@ int igt_main()
 		}
 	}
 
+	igt_subtest_group() {
+		char cachedir[] = "tmpdirXXXXXX";
+		struct job_list *list, *cmp_list;
+		int multiple;
+
+		list = malloc(sizeof(*list));
+		cmp_list = malloc(sizeof(*cmp_list));
+
+		igt_fixture() {
+			init_job_list(list);
+			init_job_list(cmp_list);
+			igt_require(mkdtemp(cachedir) != NULL);
+			rmdir(cachedir);
+		}
+
+		for (multiple = 0; multiple < 2; multiple++) {
+			igt_subtest_f("job-list-cache-%s", multiple ? "multiple" : "normal") {
+				const char *argv[] = { "runner",
+						       "--list-cache", cachedir,
+						       "-x", "^igt@successtest@second-subtest$",
+						       /* Ugly */
+						       multiple ? "--multiple-mode" : "--sync",
+						       testdatadir,
+						       "path-to-results",
+				};
+				char cached[PATH_MAX] = "";
+				struct dirent *dirent;
+				int entries = 0;
+				FILE *f;
+				DIR *d;
+
+				igt_assert(parse_options(ARRAY_SIZE(argv), (char**)argv, settings));
+				igt_assert(settings->list_cache);
+
+				/* The first run fills the cache */
+				igt_assert(create_job_list(list, settings));
+				igt_assert((d = opendir(settings->list_cache)) != NULL);
+				while ((dirent = readdir(d)) != NULL) {
+					if (dirent->d_type != DT_REG)
+						continue;
+
+					entries++;
+					if (!strncmp(dirent->d_name, "successtest-",
+						     strlen("successtest-")))
+						snprintf(cached, sizeof(cached), "%s/%s",
+							 settings->list_cache, dirent->d_name);
+				}
+				closedir(d);
+				igt_assert_lt(0, entries);
+				igt_assert_f(cached[0], "No cache entry for successtest\n");
+
+				/* The second run reads back the same lists */
+				igt_assert(create_job_list(cmp_list, settings));
+				assert_job_list_equal(list, cmp_list);
+
+				/* A subtest only the cache knows of must show up */
+				igt_assert((f = fopen(cached, "a")) != NULL);
+				fprintf(f, "cache-only-subtest\n");
+				fclose(f);
+
+				free_job_list(cmp_list);
+				igt_assert(create_job_list(cmp_list, settings));
+				igt_assert(job_list_has_subtest(cmp_list, "successtest",
+								"cache-only-subtest"));
+			}
+
+			igt_fixture() {
+				clear_directory(cachedir);
+				free_job_list(cmp_list);
+				free_job_list(list);
+			}
+		}
+
+		igt_fixture() {
+			free(cmp_list);
+			free(list);
+		}
+	}
+
 	igt_subtest_group() {
 		char dirname[] = "tmpdirXXXXXX";
 		struct job_list *list = malloc(sizeof(*list));
@@ -2274,6 +2410,149 @@ int igt_main()
 		}
 	}
 
+	igt_subtest_group() {
+		struct job_list *list = malloc(sizeof(*list));
+		volatile int dirfd = -1;
+
+		for (int comms = 0; comms <= 1; ++comms) {
+			char dirname[] = "tmpdirXXXXXX";
+
+			igt_fixture() {
+				if (!comms)
+					setenv("IGT_RUNNER_DISABLE_SOCKET_COMMUNICATION", "1", 1);
+				igt_require(mkdtemp(dirname) != NULL);
+				rmdir(dirname);
+
+				init_job_list(list);
+			}
+
+			igt_subtest_f("output-budget%s", comms ? "-comms" : "") {
+				struct execute_state state;
+				struct json_t *results, *tests, *test, *dropped;
+				const char *out, *p;
+				size_t kept = 0;
+				const char *argv[] = { "runner",
+						       "--allow-non-root",
+						       "--output-budget=16k",
+						       "-t", "^spammer$",
+						       testdatadir,
+						       dirname,
+				};
+
+				igt_assert(parse_options(ARRAY_SIZE(argv), (char**)argv, settings));
+				igt_assert(create_job_list(list, settings));
+				igt_assert(initialize_execute_state(&state, settings, list));
+				igt_assert(execute(&state, settings, list));
+
+				igt_assert_f((dirfd = open(dirname, O_DIRECTORY | O_RDONLY)) >= 0,
+					     "Execute didn't create the results directory\n");
+				igt_assert_f((results = generate_results_json(dirfd)) != NULL,
+					     "Results parsing failed\n");
+
+				igt_assert(tests = json_object_get(results, "tests"));
+				igt_assert_eqstr(igt_get_result(tests, "igt@spammer@spam"), "pass");
+				igt_assert(test = json_object_get(tests, "igt@spammer@spam"));
+
+				/* Both ends of the output are kept */
+				igt_assert(out = json_string_value(json_object_get(test, "out")));
+				igt_assert(strstr(out, "spam line 00000"));
+				igt_assert(strstr(out, "spam line 01999"));
+
+				/* 2000 lines of 60 bytes, all kept or counted as dropped */
+				igt_assert(dropped = json_object_get(test, "out-dropped"));
+				for (p = out; (p = strstr(p, "spam line ")) != NULL; p++)
+					kept++;
+				if (!comms)
+					igt_assert_eq(json_integer_value(dropped), 2000 * 60 - 16384);
+				else
+					igt_assert_eq(json_integer_value(dropped) + kept * 60, 2000 * 60);
+
+				json_decref(results);
+			}
+
+			igt_fixture() {
+				close(dirfd);
+				clear_directory(dirname);
+				free_job_list(list);
+				unsetenv("IGT_RUNNER_DISABLE_SOCKET_COMMUNICATION");
+			}
+		}
+
+		igt_fixture()
+			free(list);
+	}
+
+	igt_subtest_group() {
+		struct job_list *list = malloc(sizeof(*list));
+		volatile int dirfd = -1;
+		char dirname[] = "tmpdirXXXXXX";
+
+		igt_fixture() {
+			igt_require(mkdtemp(dirname) != NULL);
+			rmdir(dirname);
+
+			init_job_list(list);
+		}
+
+		igt_subtest("results-index") {
+			struct results_index_writer w;
+			struct execute_state state;
+			struct json_t *results, *tests;
+			struct job_list *last_list;
+			struct stat st;
+			size_t last;
+			int fd;
+			const char *argv[] = { "runner",
+					       "--allow-non-root",
+					       "-x", "abort",
+					       testdatadir,
+					       dirname,
+			};
+
+			igt_assert(parse_options(ARRAY_SIZE(argv), (char**)argv, settings));
+			igt_assert(create_job_list(list, settings));
+			igt_assert(initialize_execute_state(&state, settings, list));
+			igt_assert(execute(&state, settings, list));
+
+			igt_assert_f((dirfd = open(dirname, O_DIRECTORY | O_RDONLY)) >= 0,
+				     "Execute didn't create the results directory\n");
+			igt_assert_f((results = generate_results_json(dirfd)) != NULL,
+				     "Results parsing failed\n");
+			igt_assert(tests = json_object_get(results, "tests"));
+
+			assert_results_index_matches(dirfd, tests);
+
+			/* A partially written batch is dropped, and can be redone */
+			igt_assert((fd = openat(dirfd, RESULTS_INDEX_FILENAME, O_WRONLY)) >= 0);
+			igt_assert_eq(fstat(fd, &st), 0);
+			igt_assert_eq(ftruncate(fd, st.st_size - 1), 0);
+			close(fd);
+
+			igt_assert(results_index_writer_open(&w, dirfd, false));
+			last = list->size - 1;
+			igt_assert_eq(w.next_entry, last);
+
+			last_list = malloc(sizeof(*last_list));
+			init_job_list(last_list);
+			igt_assert(read_job_list(last_list, dirfd));
+			igt_assert(index_results(dirfd, last, &last_list->entries[last], settings, &w));
+			results_index_writer_close(&w);
+			free_job_list(last_list);
+			free(last_list);
+
+			assert_results_index_matches(dirfd, tests);
+
+			json_decref(results);
+		}
+
+		igt_fixture() {
+			close(dirfd);
+			clear_directory(dirname);
+			free_job_list(list);
+			free(list);
+		}
+	}
+
 	igt_subtest("file-descriptor-leakage") {
 		int i;
 
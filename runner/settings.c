@@ -21,6 +21,7 @@
 enum {
 	OPT_ABORT_ON_ERROR,
 	OPT_DISK_USAGE_LIMIT,
+	OPT_OUTPUT_BUDGET,
 	OPT_TEST_LIST,
 	OPT_IGNORE_MISSING,
 	OPT_PIGLIT_DMESG,
@@ -35,6 +36,7 @@ enum {
 	OPT_HELP_HOOK,
 	OPT_VERSION,
 	OPT_PRUNE_MODE,
+	OPT_LIST_CACHE,
 	OPT_HELP = 'h',
 	OPT_NAME = 'n',
 	OPT_DRY_RUN = 'd',
@@ -185,7 +187,7 @@ static size_t char_to_multiplier(char c)
 	return 0;
 }
 
-static bool parse_usage_limit(struct settings *settings, const char *optarg)
+static bool parse_size(const char *optarg, size_t *size)
 {
 	size_t value;
 	char *endptr = NULL;
@@ -204,7 +206,7 @@ static bool parse_usage_limit(struct settings *settings, const char *optarg)
 		value *= multiplier;
 	}
 
-	settings->disk_usage_limit = value;
+	*size = value;
 	return true;
 }
 
@@ -274,6 +276,14 @@ static const char *usage_str =
 	"                        kernel logs, exceed the given limit in bytes. The limit\n"
 	"                        parameter can use suffixes k, M and G for kilo/mega/gigabytes,\n"
 	"                        respectively. Limit of 0 (default) disables the limit.\n"
+	"  --output-budget <size>\n"
+	"                        Keep only the first and last <size>/2 bytes of each of\n"
+	"                        stdout, stderr and the logs of every subtest, and store\n"
+	"                        the output in between compressed, up to <size> bytes,\n"
+	"                        in *-overflow.txt.gz next to it. The number of bytes\n"
+	"                        left out is recorded in the results. Accepts the same\n"
+	"                        suffixes as --disk-usage-limit. Budget of 0 (default)\n"
+	"                        keeps all of the output.\n"
 	"  --use-watchdog        Use hardware watchdog for lethal enforcement of the\n"
 	"                        above timeout. Killing the test process is still\n"
 	"                        attempted at timeout trigger.\n"
@@ -310,6 +320,11 @@ static const char *usage_str =
 	"                        If only the key is provided, the current value is read\n"
 	"                        from the runner's environment (and saved for resumes).\n"
 	"  -L, --list-all        List all matching subtests instead of running\n"
+	"  --list-cache DIRECTORY\n"
+	"                        Cache the subtest lists of the test binaries in\n"
+	"                        DIRECTORY, keyed by the size, modification time and\n"
+	"                        build-id of the binaries, to skip running them with\n"
+	"                        --list-subtests when building the next job lists\n"
 	"  --collect-code-cov    Enables gcov-based collect of code coverage for tests.\n"
 	"                        Requires --collect-script FILENAME\n"
 	"  --coverage-per-test   Stores code coverage results per each test.\n"
@@ -361,6 +376,15 @@ static bool add_regex(struct regex_list *list, char *new)
 	list->regex_strings[list->size] = new;
 	list->size++;
 
+	/* Rebuilt with the new regex on next use */
+	if (list->combined)
+		g_regex_unref(list->combined);
+	list->combined = NULL;
+	free(list->uncombined);
+	list->uncombined = NULL;
+	list->uncombined_size = 0;
+	list->combined_built = false;
+
 	return true;
 }
 
@@ -419,6 +443,9 @@ static void free_regexes(struct regex_list *regexes)
 	}
 	free(regexes->regex_strings);
 	free(regexes->regexes);
+	if (regexes->combined)
+		g_regex_unref(regexes->combined);
+	free(regexes->uncombined);
 }
 
 /**
@@ -664,6 +691,7 @@ void clear_settings(struct settings *settings)
 	free(settings->test_root);
 	free(settings->results_path);
 	free(settings->code_coverage_script);
+	free(settings->list_cache);
 
 	free_regexes(&settings->include_regexes);
 	free_regexes(&settings->exclude_regexes);
@@ -692,6 +720,7 @@ bool parse_options(int argc, char **argv,
 		{"environment", required_argument, NULL, OPT_ENVIRONMENT},
 		{"abort-on-monitored-error", optional_argument, NULL, OPT_ABORT_ON_ERROR},
 		{"disk-usage-limit", required_argument, NULL, OPT_DISK_USAGE_LIMIT},
+		{"output-budget", required_argument, NULL, OPT_OUTPUT_BUDGET},
 		{"facts", no_argument, NULL, OPT_FACTS},
 		{"kmemleak", optional_argument, NULL, OPT_KMEMLEAK},
 		{"sync", no_argument, NULL, OPT_SYNC},
@@ -714,6 +743,7 @@ bool parse_options(int argc, char **argv,
 		{"prune-mode", required_argument, NULL, OPT_PRUNE_MODE},
 		{"blacklist", required_argument, NULL, OPT_BLACKLIST},
 		{"list-all", no_argument, NULL, OPT_LIST_ALL},
+		{"list-cache", required_argument, NULL, OPT_LIST_CACHE},
 		{ 0, 0, 0, 0},
 	};
 
@@ -760,11 +790,17 @@ bool parse_options(int argc, char **argv,
 				goto error;
 			break;
 		case OPT_DISK_USAGE_LIMIT:
-			if (!parse_usage_limit(settings, optarg)) {
+			if (!parse_size(optarg, &settings->disk_usage_limit)) {
 				usage(stderr, "Cannot parse disk usage limit");
 				goto error;
 			}
 			break;
+		case OPT_OUTPUT_BUDGET:
+			if (!parse_size(optarg, &settings->output_budget)) {
+				usage(stderr, "Cannot parse output budget");
+				goto error;
+			}
+			break;
 		case OPT_FACTS:
 			settings->facts = true;
 			break;
@@ -852,6 +888,10 @@ bool parse_options(int argc, char **argv,
 		case OPT_LIST_ALL:
 			settings->list_all = true;
 			break;
+		case OPT_LIST_CACHE:
+			free(settings->list_cache);
+			settings->list_cache = absolute_path(optarg);
+			break;
 		case '?':
 			usage(stderr, NULL);
 			goto error;
@@ -1228,6 +1268,7 @@ bool serialize_settings(struct settings *settings)
 
 	SERIALIZE_INT(f, settings, abort_mask);
 	SERIALIZE_UL(f, settings, disk_usage_limit);
+	SERIALIZE_UL(f, settings, output_budget);
 	if (settings->test_list)
 		SERIALIZE_STR(f, settings, test_list);
 	if (settings->name)
@@ -1348,6 +1389,7 @@ bool read_settings_from_file(struct settings *settings, FILE *f)
 	while (fscanf(f, "%ms : %m[^\n]", &name, &val) == 2) {
 		PARSE_INT(settings, name, val, abort_mask);
 		PARSE_UL(settings, name, val, disk_usage_limit);
+		PARSE_UL(settings, name, val, output_budget);
 		PARSE_STR(settings, name, val, test_list);
 		PARSE_STR(settings, name, val, name);
 		PARSE_INT(settings, name, val, dry_run);
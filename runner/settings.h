@@ -42,6 +42,15 @@ struct regex_list {
 	char **regex_strings;
 	GRegex **regexes;
 	size_t size;
+
+	/*
+	 * All the regexes which can be combined into one alternation,
+	 * built on first use, and the indices of the others.
+	 */
+	GRegex *combined;
+	size_t *uncombined;
+	size_t uncombined_size;
+	bool combined_built;
 };
 
 struct environment_variable {
@@ -53,6 +62,7 @@ struct environment_variable {
 struct settings {
 	int abort_mask;
 	size_t disk_usage_limit;
+	size_t output_budget;
 	char *test_list;
 	char *name;
 	bool dry_run;
@@ -78,6 +88,7 @@ struct settings {
 	int dmesg_warn_level;
 	int prune_mode;
 	bool list_all;
+	char *list_cache;
 	char *code_coverage_script;
 	bool enable_code_coverage;
 	bool cov_results_per_test;
@@ -0,0 +1,11 @@
+#include "igt.h"
+
+int igt_main()
+{
+	igt_subtest("spam") {
+		/* 2000 lines of 60 bytes each */
+		for (int i = 0; i < 2000; i++)
+			igt_info("spam line %05d: %s\n", i,
+				 "..........................................");
+	}
+}
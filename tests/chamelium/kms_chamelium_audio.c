@@ -388,13 +388,12 @@ static int audio_output_frequencies_callback(void *data, void *buffer,
 
 static bool test_audio_frequencies(struct audio_state *state)
 {
+	struct audio_analyzer *analyzer;
 	int freq, step;
-	int32_t *recv, *buf;
-	double *channel;
-	size_t i, j, streak;
-	size_t recv_len, buf_len, buf_cap, channel_len;
+	int32_t *recv;
+	size_t i, j;
+	size_t recv_len;
 	bool success;
-	int capture_chan;
 
 	state->signal = audio_signal_init(state->playback.channels,
 					  state->playback.rate);
@@ -440,60 +439,38 @@ static bool test_audio_frequencies(struct audio_state *state)
 	 * sines. For lower sampling rates, the capture duration will be
 	 * longer.
 	 */
-	channel_len = CAPTURE_SAMPLES;
-	channel = malloc(sizeof(double) * channel_len);
+	for (j = 0; j < state->playback.channels; j++)
+		igt_assert(state->channel_mapping[j] >= 0);
 
-	buf_cap = state->capture.channels * channel_len;
-	buf = malloc(sizeof(int32_t) * buf_cap);
-	buf_len = 0;
+	/* All playback channels are analyzed together, each window of
+	 * CAPTURE_SAMPLES samples as soon as it has been received. */
+	analyzer = audio_analyzer_init(state->signal, state->capture.rate,
+				       CAPTURE_SAMPLES, CAPTURE_SAMPLES,
+				       state->capture.channels,
+				       state->channel_mapping);
 
 	recv = NULL;
 	recv_len = 0;
 
 	success = false;
-	streak = 0;
 	while (!success && state->msec < AUDIO_TIMEOUT) {
 		audio_state_receive(state, &recv, &recv_len);
 
-		memcpy(&buf[buf_len], recv, recv_len * sizeof(int32_t));
-		buf_len += recv_len;
-
-		if (buf_len < buf_cap)
+		igt_assert(recv_len % state->capture.channels == 0);
+		if (!audio_analyzer_feed_s32_le(analyzer, recv,
+						recv_len / state->capture.channels))
 			continue;
-		igt_assert(buf_len == buf_cap);
-
-		igt_debug("Detecting audio signal, t=%d msec\n", state->msec);
-
-		for (j = 0; j < state->playback.channels; j++) {
-			capture_chan = state->channel_mapping[j];
-			igt_assert(capture_chan >= 0);
-			igt_debug("Processing channel %zu (captured as "
-				  "channel %d)\n",
-				  j, capture_chan);
-
-			audio_extract_channel_s32_le(channel, channel_len, buf,
-						     buf_len,
-						     state->capture.channels,
-						     capture_chan);
-
-			if (audio_signal_detect(state->signal,
-						state->capture.rate, j, channel,
-						channel_len))
-				streak++;
-			else
-				streak = 0;
-		}
 
-		buf_len = 0;
+		igt_debug("Audio signal detected on channels 0x%x, t=%d msec\n",
+			  audio_analyzer_detected(analyzer), state->msec);
 
-		success = streak == MIN_STREAK * state->playback.channels;
+		success = audio_analyzer_streak(analyzer) >= MIN_STREAK;
 	}
 
 	audio_state_stop(state, success);
 
+	audio_analyzer_fini(analyzer);
 	free(recv);
-	free(buf);
-	free(channel);
 	audio_signal_fini(state->signal);
 
 	check_audio_infoframe(state);
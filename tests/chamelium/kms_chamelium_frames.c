@@ -699,6 +699,21 @@ static void test_display_all_modes(chamelium_data_t *data,
 	} while (++i < count_modes);
 }
 
+struct frame_dump_check {
+	struct chamelium *chamelium;
+	struct igt_fb *fb;
+};
+
+static bool assert_frame_dump_eq(const struct chamelium_frame_dump *frame,
+				 void *data)
+{
+	struct frame_dump_check *check = data;
+
+	chamelium_assert_frame_eq(check->chamelium, frame, check->fb);
+
+	return true;
+}
+
 static const char test_display_frame_dump_desc[] =
 	"For each mode of the IGT base EDID, display and capture a few "
 	"frames, then download the captured frames and compare them "
@@ -713,10 +728,10 @@ static void test_display_frame_dump(chamelium_data_t *data,
 		igt_output_t *output;
 		igt_plane_t *primary;
 		struct igt_fb fb;
-		struct chamelium_frame_dump *frame;
+		struct frame_dump_check frame_dump;
 		drmModeModeInfo *mode;
 		drmModeConnector *connector;
-		int fb_id, j;
+		int fb_id;
 
 		/*
 		 * let's reset state each mode so we will get the
@@ -755,12 +770,11 @@ static void test_display_frame_dump(chamelium_data_t *data,
 
 		igt_debug("Reading frame dumps from Chamelium...\n");
 		chamelium_capture(data->chamelium, port, 0, 0, 0, 0, 5);
-		for (j = 0; j < 5; j++) {
-			frame = chamelium_read_captured_frame(data->chamelium,
-							      j);
-			chamelium_assert_frame_eq(data->chamelium, frame, &fb);
-			chamelium_destroy_frame_dump(frame);
-		}
+		frame_dump.chamelium = data->chamelium;
+		frame_dump.fb = &fb;
+		igt_assert_eq(chamelium_read_captured_frames(data->chamelium, 5,
+							     assert_frame_dump_eq,
+							     &frame_dump), 5);
 
 		igt_remove_fb(data->drm_fd, &fb);
 		drmModeFreeConnector(connector);
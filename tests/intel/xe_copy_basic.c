@@ -7,6 +7,7 @@
  */
 
 #include "igt.h"
+#include "igt_rand.h"
 #include "lib/igt_syncobj.h"
 #include "intel_blt.h"
 #include "lib/intel_cmds_info.h"
@@ -92,7 +93,9 @@ mem_copy(int fd, uint32_t src_handle, uint32_t dst_handle, const intel_ctx_t *ct
 	uint8_t src_mocs = intel_get_uc_mocs_index(fd);
 	uint8_t dst_mocs = src_mocs;
 	uint32_t bb;
+	uint64_t seed = time(NULL);
 	uint8_t *psrc, *pdst;
+	ssize_t mismatch;
 	int result, i;
 
 	igt_debug("size: %u, pitch: %u, width: %u, height: %u (type: %d, mode: %d)\n",
@@ -113,11 +116,9 @@ mem_copy(int fd, uint32_t src_handle, uint32_t dst_handle, const intel_ctx_t *ct
 	psrc = (uint8_t *) mem.src.ptr;
 	pdst = (uint8_t *) mem.dst.ptr;
 
-	srand(time(NULL));
-
 	/* Randomize whole src */
-	for (i = 0; i < size; i++)
-		psrc[i] = rand();
+	igt_debug("seed: %"PRIu64"\n", seed);
+	igt_rand_fill(psrc, size, seed, 0);
 
 	blt_set_batch(&mem.bb, bb, bb_size, region);
 	igt_assert(mem.src.width == mem.dst.width);
@@ -125,7 +126,10 @@ mem_copy(int fd, uint32_t src_handle, uint32_t dst_handle, const intel_ctx_t *ct
 	blt_mem_copy(fd, ctx, NULL, ahnd, &mem);
 
 	if (type == TYPE_LINEAR && mode == MODE_BYTE) {
-		result = memcmp(psrc, pdst, width);
+		mismatch = igt_rand_verify(pdst, width, seed, 0);
+		result = mismatch >= 0;
+		if (result)
+			igt_debug("first mismatch at byte %zd\n", mismatch);
 
 		/* Rest of dst must contain 0 */
 		for (i = width; i < size; i++) {
@@ -135,7 +139,10 @@ mem_copy(int fd, uint32_t src_handle, uint32_t dst_handle, const intel_ctx_t *ct
 			}
 		}
 	} else if (type == TYPE_LINEAR && mode == MODE_PAGE) {
-		result = memcmp(psrc, pdst, pitch << 8);
+		mismatch = igt_rand_verify(pdst, pitch << 8, seed, 0);
+		result = mismatch >= 0;
+		if (result)
+			igt_debug("first mismatch at byte %zd\n", mismatch);
 	} else {
 		result = 0;
 
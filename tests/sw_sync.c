@@ -70,6 +70,8 @@
  *
  * SUBTEST: sync_merge_same
  *
+ * SUBTEST: sync_merge_tree
+ *
  * SUBTEST: sync_multi_consumer
  *
  * SUBTEST: sync_multi_consumer_producer
@@ -441,6 +443,60 @@ static void test_sync_merge_same(void)
 	close(timeline);
 }
 
+static void test_sync_merge_tree(void)
+{
+	const int nbr_timeline = 67;
+	int timeline[nbr_timeline];
+	int fences[nbr_timeline];
+	int seqnos[16];
+	int merged;
+	int i;
+
+	/* All the seqnos of one timeline merge into its latest */
+	timeline[0] = sw_sync_timeline_create();
+	sw_sync_timeline_create_fences(timeline[0], 1, ARRAY_SIZE(seqnos), seqnos);
+	merged = sync_fence_merge_tree(seqnos, ARRAY_SIZE(seqnos));
+	igt_assert_eq(sync_fence_count(merged), 1);
+
+	sw_sync_timeline_inc(timeline[0], ARRAY_SIZE(seqnos) - 1);
+	igt_assert_eq(sync_fence_wait(merged, 0), -ETIME);
+	sw_sync_timeline_inc(timeline[0], 1);
+	igt_assert_eq(sync_fence_wait(merged, 0), 0);
+
+	close(merged);
+	for (i = 0; i < ARRAY_SIZE(seqnos); i++)
+		close(seqnos[i]);
+	close(timeline[0]);
+
+	/* And fences from different timelines are all kept */
+	for (i = 0; i < nbr_timeline; i++) {
+		timeline[i] = sw_sync_timeline_create();
+		fences[i] = sw_sync_timeline_create_fence(timeline[i], 1);
+	}
+
+	for (i = 1; i <= nbr_timeline; i++) {
+		merged = sync_fence_merge_tree(fences, i);
+		igt_assert_eq(sync_fence_count(merged), i);
+		close(merged);
+	}
+
+	merged = sync_fence_merge_tree(fences, nbr_timeline);
+	for (i = 0; i < nbr_timeline; i++) {
+		igt_assert_f(sync_fence_wait(merged, 0) == -ETIME,
+			     "Merged fence signaled early\n");
+		sw_sync_timeline_inc(timeline[i], 1);
+		/* the inputs are left alone */
+		igt_assert_eq(sync_fence_status(fences[i]), 1);
+	}
+	igt_assert_eq(sync_fence_wait(merged, 0), 0);
+
+	close(merged);
+	for (i = 0; i < nbr_timeline; i++) {
+		close(fences[i]);
+		close(timeline[i]);
+	}
+}
+
 static void test_sync_multi_timeline_wait(void)
 {
 	int timeline[3];
@@ -924,6 +980,9 @@ int igt_main()
 	igt_subtest("sync_merge_same")
 		test_sync_merge_same();
 
+	igt_subtest("sync_merge_tree")
+		test_sync_merge_tree();
+
 	igt_subtest("sync_multi_timeline_wait")
 		test_sync_multi_timeline_wait();
 
@@ -31,6 +31,8 @@
 #include <string.h>
 #include <math.h>
 
+#include "wrpll_sweep.h"
+
 #define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
 
 static inline uint64_t div_u64(uint64_t dividend, uint32_t divisor)
@@ -194,7 +196,7 @@ static bool
 cnl_ddi_calculate_wrpll2(int clock,
 			 struct skl_wrpll_params *params)
 {
-	int afe_clock = clock * 5 / 1000; /* clock in kHz */
+	int afe_clock = (int64_t)clock * 5 / 1000; /* clock in kHz */
 	int dco_min = 7998000;
 	int dco_max = 10000000;
 	int dco_mid = (dco_min + dco_max) / 2;
@@ -508,11 +510,80 @@ static void test_run(unsigned int ref_clock)
 	}
 }
 
+static bool sweep_compute1(uint32_t clock, uint32_t ref_clock, void *params)
+{
+	((struct skl_wrpll_params *)params)->ref_clock = ref_clock;
+
+	return cnl_ddi_calculate_wrpll1(clock, params);
+}
+
+static bool sweep_compute2(uint32_t clock, uint32_t ref_clock, void *params)
+{
+	((struct skl_wrpll_params *)params)->ref_clock = ref_clock;
+
+	return cnl_ddi_calculate_wrpll2(clock, params);
+}
+
+/* The DCO fraction is left out, its rounding shows in the deviation */
+static uint32_t sweep_pack(const void *data)
+{
+	const struct skl_wrpll_params *params = data;
+
+	return params->pdiv | params->kdiv << 4 | params->qdiv_ratio << 8 |
+		params->dco_integer << 16;
+}
+
+/* Error of the output clock in ppm */
+static double sweep_deviation(uint32_t clock, uint32_t ref_clock,
+			      const void *data)
+{
+	const struct skl_wrpll_params *params = data;
+	double dco = ref_clock * 1000.0 *
+		     (params->dco_integer + params->dco_fraction / 32768.0);
+	double output = dco / (5 * params->pdiv * params->qdiv_ratio *
+			       params->kdiv);
+
+	return 1e6 * fabs(output - clock) / clock;
+}
+
+static const struct wrpll_sweep_ops sweep_ops[] = {
+	{
+		.name = "Reference",
+		.params_size = sizeof(struct skl_wrpll_params),
+		.compute = sweep_compute1,
+		.pack = sweep_pack,
+		.deviation = sweep_deviation,
+	},
+	{
+		.name = "i915 implementation",
+		.params_size = sizeof(struct skl_wrpll_params),
+		.compute = sweep_compute2,
+		.pack = sweep_pack,
+		.deviation = sweep_deviation,
+	},
+};
+
 int main(int argc, char **argv)
 {
+	static const uint32_t sweep_ref_clocks[] = { 19200, 24000, 38400 };
+	struct wrpll_sweep sweep = {
+		.name = "cnl_compute_wrpll",
+		.ops = { &sweep_ops[0], &sweep_ops[1] },
+		.pack_desc = "pdiv | kdiv << 4 | qdiv << 8 | dco_integer << 16",
+		.deviation_unit = "ppm",
+		.ref_clocks = sweep_ref_clocks,
+		.num_ref_clocks = ARRAY_SIZE(sweep_ref_clocks),
+	};
 	unsigned int m;
 	unsigned int f;
 	unsigned int ref_clocks[] = {19200, 24000}; /* in kHz */
+	int ret;
+
+	ret = wrpll_sweep_parse_args(&sweep, argc, argv);
+	if (ret < 0)
+		return 1;
+	if (ret)
+		return wrpll_sweep_run(&sweep) != 0;
 
 	for (m = 0; m < ARRAY_SIZE(modes); m++)
 		test_multipliers(modes[m].clock);
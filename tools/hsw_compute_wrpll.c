@@ -29,6 +29,7 @@
 
 #include "intel_io.h"
 #include "drmtest.h"
+#include "wrpll_sweep.h"
 
 #define LC_FREQ 2700
 #define LC_FREQ_2K (LC_FREQ * 2000)
@@ -247,6 +248,160 @@ wrpll_compute_rnp(int clock /* in Hz */,
 	*r2_out = best.r2;
 }
 
+/*
+ * Whether (r2, n2, p) beats @best in the order wrpll_update_rnp() builds up:
+ * being within the budget beats being outside of it, within the budget the
+ * higher n2 / r2^2 wins, outside of it the smaller relative error, and
+ * a tie goes to what wrpll_compute_rnp() visits first, the lower (r2, n2, p).
+ */
+static bool wrpll_rnp_better(uint64_t freq2k, unsigned budget,
+			     unsigned r2, unsigned n2, unsigned p,
+			     const struct wrpll_rnp *best)
+{
+	uint64_t diff, diff_best, x, y;
+	bool in, in_best;
+
+	if (best->p == 0)
+		return true;
+
+	diff = ABS_DIFF((freq2k * p * r2), (LC_FREQ_2K * n2));
+	diff_best = ABS_DIFF((freq2k * best->p * best->r2),
+			     (LC_FREQ_2K * best->n2));
+	in = freq2k * budget * p * r2 >= 1000000 * diff;
+	in_best = freq2k * budget * best->p * best->r2 >= 1000000 * diff_best;
+
+	if (in != in_best)
+		return in;
+
+	if (in) {
+		x = (uint64_t)n2 * best->r2 * best->r2;
+		y = (uint64_t)best->n2 * r2 * r2;
+	} else {
+		x = p * r2 * diff_best;
+		y = best->p * best->r2 * diff;
+	}
+
+	if (x != y)
+		return x > y;
+
+	if (r2 != best->r2)
+		return r2 < best->r2;
+	if (n2 != best->n2)
+		return n2 < best->n2;
+	return p < best->p;
+}
+
+/*
+ * Same result as wrpll_compute_rnp(), without trying every n2. For a given
+ * (r2, p) only the n2 on either side of the exact one can have the
+ * smallest error, and only the highest n2 within the budget can have the
+ * highest n2 / r2^2, so those are the only candidates.
+ */
+static void
+wrpll_compute_rnp_pruned(int clock /* in Hz */,
+			 unsigned *r2_out, unsigned *n2_out, unsigned *p_out)
+{
+	struct wrpll_rnp best = { 0, 0, 0 };
+	uint64_t freq2k = clock / 100;
+	unsigned budget = wrpll_get_budget_for_freq(clock);
+	unsigned p, r2;
+
+	if (freq2k == 5400000) {
+		*n2_out = 2;
+		*p_out = 1;
+		*r2_out = 2;
+		return;
+	}
+
+	for (r2 = LC_FREQ * 2 / REF_MAX + 1;
+	     r2 <= LC_FREQ * 2 / REF_MIN;
+	     r2++) {
+		unsigned n2_min = VCO_MIN * r2 / LC_FREQ + 1;
+		unsigned n2_max = VCO_MAX * r2 / LC_FREQ;
+
+		for (p = P_MIN; p <= P_MAX; p += P_INC) {
+			uint64_t target = freq2k * p * r2;
+			uint64_t n2[3] = {
+				target / LC_FREQ_2K,
+				(target + LC_FREQ_2K - 1) / LC_FREQ_2K,
+				target * (1000000 + budget) /
+				(1000000ull * LC_FREQ_2K),
+			};
+			int i;
+
+			for (i = 0; i < 3; i++) {
+				unsigned n = n2[i] < n2_min ? n2_min :
+					     n2[i] > n2_max ? n2_max : n2[i];
+
+				if (wrpll_rnp_better(freq2k, budget,
+						     r2, n, p, &best)) {
+					best.p = p;
+					best.n2 = n;
+					best.r2 = r2;
+				}
+			}
+		}
+	}
+
+	*n2_out = best.n2;
+	*p_out = best.p;
+	*r2_out = best.r2;
+}
+
+static bool sweep_compute(uint32_t clock, uint32_t ref_clock, void *params)
+{
+	struct wrpll_rnp *rnp = params;
+
+	wrpll_compute_rnp(clock, &rnp->r2, &rnp->n2, &rnp->p);
+
+	return true;
+}
+
+static bool sweep_compute_pruned(uint32_t clock, uint32_t ref_clock,
+				 void *params)
+{
+	struct wrpll_rnp *rnp = params;
+
+	wrpll_compute_rnp_pruned(clock, &rnp->r2, &rnp->n2, &rnp->p);
+
+	return true;
+}
+
+static uint32_t sweep_pack(const void *params)
+{
+	const struct wrpll_rnp *rnp = params;
+
+	return rnp->r2 | rnp->n2 << 8 | rnp->p << 16;
+}
+
+/* Error of the output clock in ppm */
+static double sweep_deviation(uint32_t clock, uint32_t ref_clock,
+			      const void *params)
+{
+	const struct wrpll_rnp *rnp = params;
+	uint64_t freq2k = clock / 100;
+	uint64_t target = freq2k * rnp->p * rnp->r2;
+
+	return 1e6 * ABS_DIFF(target, (uint64_t)LC_FREQ_2K * rnp->n2) / target;
+}
+
+static const struct wrpll_sweep_ops sweep_ops[] = {
+	{
+		.name = "Exhaustive",
+		.params_size = sizeof(struct wrpll_rnp),
+		.compute = sweep_compute,
+		.pack = sweep_pack,
+		.deviation = sweep_deviation,
+	},
+	{
+		.name = "Pruned",
+		.params_size = sizeof(struct wrpll_rnp),
+		.compute = sweep_compute_pruned,
+		.pack = sweep_pack,
+		.deviation = sweep_deviation,
+	},
+};
+
 /* WRPLL clock dividers */
 struct wrpll_tmds_clock {
 	uint32_t clock;
@@ -633,9 +788,22 @@ static const struct wrpll_tmds_clock wrpll_tmds_clock_table[] = {
 	{298000000,	2,	21,	19},
 };
 
-int main(void)
+int main(int argc, char **argv)
 {
-	int i;
+	static const uint32_t lc_clocks[] = { LC_FREQ * 1000 };
+	struct wrpll_sweep sweep = {
+		.name = "hsw_compute_wrpll",
+		.ops = { &sweep_ops[0], &sweep_ops[1] },
+		.pack_desc = "r2 | n2 << 8 | p << 16",
+		.deviation_unit = "ppm",
+		.ref_clocks = lc_clocks,
+		.num_ref_clocks = ARRAY_SIZE(lc_clocks),
+	};
+	int i, ret;
+
+	ret = wrpll_sweep_parse_args(&sweep, argc, argv);
+	if (ret)
+		return ret < 0 || wrpll_sweep_run(&sweep);
 
 	for (i = 0; i < ARRAY_SIZE(wrpll_tmds_clock_table); i++) {
 		const struct wrpll_tmds_clock *ref = &wrpll_tmds_clock_table[i];
@@ -644,6 +812,10 @@ int main(void)
 		wrpll_compute_rnp(ref->clock, &r2, &n2, &p);
 		igt_fail_on_f(ref->r2 != r2 || ref->n2 != n2 || ref->p != p,
 			      "Computed value differs for %"PRId64" Hz:\n""  Reference: (%u,%u,%u)\n""  Computed:  (%u,%u,%u)\n", (int64_t)ref->clock * 1000, ref->r2, ref->n2, ref->p, r2, n2, p);
+
+		wrpll_compute_rnp_pruned(ref->clock, &r2, &n2, &p);
+		igt_fail_on_f(ref->r2 != r2 || ref->n2 != n2 || ref->p != p,
+			      "Pruned value differs for %"PRId64" Hz:\n""  Reference: (%u,%u,%u)\n""  Computed:  (%u,%u,%u)\n", (int64_t)ref->clock * 1000, ref->r2, ref->n2, ref->p, r2, n2, p);
 	}
 
 	return 0;
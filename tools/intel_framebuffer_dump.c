@@ -27,6 +27,7 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <errno.h>
@@ -34,9 +35,65 @@
 #include <i915_drm.h>
 #include <cairo.h>
 
+#include "intel_batchbuffer.h"
+#include "intel_detile.h"
 #include "intel_io.h"
 #include "drmtest.h"
 
+/*
+ * A GTT mmap through a fence is already linear. Framebuffers using
+ * modifiers without a fence (Y, Yf, Tile4 and their CCS variants) are
+ * mapped raw and have to be detiled on the CPU.
+ *
+ * Returns a linear copy of the main surface, or NULL if @ptr can be used
+ * as is.
+ */
+static void *detile_fb(int fd, uint32_t handle, void *ptr, drmModeFBPtr fb)
+{
+	struct drm_i915_gem_get_tiling get_tiling = { .handle = handle };
+	struct drm_mode_fb_cmd2 fb2 = { .fb_id = fb->fb_id };
+	struct intel_detile_surface surf;
+	void *linear = NULL;
+	uint32_t tiling;
+	int i;
+
+	if (drmIoctl(fd, DRM_IOCTL_MODE_GETFB2, &fb2))
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(fb2.handles); i++) {
+		if (fb2.handles[i] && (!i || fb2.handles[i] != fb2.handles[i - 1]))
+			drmIoctl(fd, DRM_IOCTL_GEM_CLOSE, &fb2.handles[i]);
+	}
+
+	if (!(fb2.flags & DRM_MODE_FB_MODIFIERS))
+		return NULL;
+
+	tiling = intel_detile_tiling_from_modifier(fb2.modifier[0]);
+	if (tiling == I915_TILING_NONE ||
+	    !intel_detile_supported(tiling, fb->bpp / 8))
+		return NULL;
+
+	if (drmIoctl(fd, DRM_IOCTL_I915_GEM_GET_TILING, &get_tiling) == 0 &&
+	    get_tiling.tiling_mode != I915_TILING_NONE)
+		return NULL;
+
+	linear = malloc((size_t)fb2.pitches[0] * fb->height);
+	if (!linear)
+		return NULL;
+
+	surf = (struct intel_detile_surface) {
+		.ptr = ptr + fb2.offsets[0],
+		.stride = fb2.pitches[0],
+		.width = fb->width,
+		.height = fb->height,
+		.cpp = fb->bpp / 8,
+		.tiling = tiling,
+	};
+	intel_detile_to_linear(&surf, linear, fb2.pitches[0]);
+
+	return linear;
+}
+
 int main(int argc, char **argv)
 {
 	drmModeResPtr res;
@@ -82,6 +139,7 @@ int main(int argc, char **argv)
 				cairo_surface_t *surface;
 				cairo_format_t format;
 				char name[80];
+				void *linear;
 
 				snprintf(name, sizeof(name), "fb-%d.png",  fb->fb_id);
 
@@ -93,10 +151,13 @@ int main(int argc, char **argv)
 				default: format = CAIRO_FORMAT_INVALID; break;
 				}
 
-				surface = cairo_image_surface_create_for_data(ptr, format,
+				linear = detile_fb(fd, open_arg.handle, ptr, fb);
+
+				surface = cairo_image_surface_create_for_data(linear ?: ptr, format,
 									      fb->width, fb->height, fb->pitch);
 				cairo_surface_write_to_png(surface, name);
 				cairo_surface_destroy(surface);
+				free(linear);
 
 				munmap(ptr, open_arg.size);
 			}
@@ -37,6 +37,8 @@
 #include <sys/types.h>
 #include <sys/syscall.h>
 #include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/socket.h>
 #include <assert.h>
 #include <pthread.h>
 
@@ -62,18 +64,34 @@
 
 char *read_buffer;
 char *out_filename;
+char *relay_filename;
+uint32_t standin_subbufs;
+pid_t standin_pid;
+struct standin_counts {
+	bool stop;
+	uint32_t sent, dropped;
+} *standin;
 int poll_timeout = 2; /* by default 2ms timeout */
 pthread_mutex_t mutex;
 pthread_t flush_thread;
 int verbosity_level = 3; /* by default capture logs at max verbosity */
 uint32_t produced, consumed;
 uint64_t total_bytes_written;
+uint32_t overflow_stalls;
 int num_buffers = NUM_SUBBUFS;
 int relay_fd, outfile_fd = -1;
+int splice_pipe[2] = { -1, -1 };
+bool use_splice;
 uint32_t test_duration, max_filesize;
 pthread_cond_t underflow_cond, overflow_cond;
 bool stop_logging, discard_oldlogs, capturing_stopped;
 
+/* Data comes from a stand-in instead of the GuC relay and ends at EOF */
+static bool standin_relay(void)
+{
+	return relay_filename || standin_subbufs;
+}
+
 static void guc_log_control(bool enable, uint32_t log_level)
 {
 	int control_fd;
@@ -83,6 +101,10 @@ static void guc_log_control(bool enable, uint32_t log_level)
 
 	igt_assert_lte(log_level, 3);
 
+	/* A stand-in relay has no GuC behind it to control */
+	if (standin_relay())
+		return;
+
 	control_fd = igt_debugfs_open(-1, CONTROL_FILE_NAME, O_WRONLY);
 	igt_assert_f(control_fd >= 0, "couldn't open the guc log control file\n");
 
@@ -112,11 +134,57 @@ static void int_sig_handler(int sig)
 	stop_logging = true;
 }
 
+static void check_max_filesize(void)
+{
+	if (max_filesize && (total_bytes_written > MB(max_filesize))) {
+		igt_debug("reached the target of %" PRIu64 " bytes\n", MB(max_filesize));
+		stop_logging = true;
+	}
+}
+
+/*
+ * Move one relay subbuffer to the output file through a pipe, without
+ * copying the data through userspace. Returns the number of bytes moved,
+ * 0 when the relay file had no data.
+ */
+static ssize_t splice_data(void)
+{
+	ssize_t len, ret;
+
+	len = splice(relay_fd, NULL, splice_pipe[1], NULL, SUBBUF_SIZE,
+		     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	if (len < 0 && errno == EAGAIN)
+		return 0;
+	igt_assert_f(len >= 0, "failed to splice from the guc log file\n");
+
+	for (ret = 0; ret < len; ) {
+		ssize_t n;
+
+		n = splice(splice_pipe[0], NULL, outfile_fd, NULL, len - ret,
+			   SPLICE_F_MOVE);
+		igt_assert_f(n > 0, "couldn't splice the logs to the output file\n");
+		ret += n;
+	}
+
+	total_bytes_written += len;
+	check_max_filesize();
+
+	return len;
+}
+
 static void pull_leftover_data(void)
 {
 	unsigned int bytes_read = 0;
 	int ret;
 
+	if (use_splice) {
+		while ((ret = splice_data()) > 0)
+			bytes_read += ret;
+
+		igt_debug("%u bytes flushed\n", bytes_read);
+		return;
+	}
+
 	do {
 		/* Read the logs from relay buffer */
 		ret = read(relay_fd, read_buffer, SUBBUF_SIZE);
@@ -149,6 +217,8 @@ static void pull_data(void)
 	int ret;
 
 	pthread_mutex_lock(&mutex);
+	if (num_filled_bufs() >= num_buffers)
+		overflow_stalls++;
 	while (num_filled_bufs() >= num_buffers) {
 		igt_debug("overflow, will wait, produced %u, consumed %u\n", produced, consumed);
 		/* Stall the main thread in case of overflow, as there are no
@@ -171,6 +241,9 @@ static void pull_data(void)
 		produced++;
 		pthread_cond_signal(&underflow_cond);
 		pthread_mutex_unlock(&mutex);
+	} else if (standin_relay()) {
+		/* A stand-in relay is done once it has been consumed */
+		stop_logging = true;
 	} else {
 		/* Occasionally (very rare) read from the relay file returns no
 		 * data, albeit the polling done prior to read call indicated
@@ -210,10 +283,7 @@ static void *flusher(void *arg)
 		igt_assert_f(ret == SUBBUF_SIZE, "couldn't dump the logs in a file\n");
 
 		total_bytes_written += ret;
-		if (max_filesize && (total_bytes_written > MB(max_filesize))) {
-			igt_debug("reached the target of %" PRIu64 " bytes\n", MB(max_filesize));
-			stop_logging = true;
-		}
+		check_max_filesize();
 
 		pthread_mutex_lock(&mutex);
 		consumed++;
@@ -258,9 +328,124 @@ static void init_flusher_thread(void)
 	igt_assert_f(ret == 0, "error destroying thread attributes\n");
 }
 
+/*
+ * Generate the stand-in subbuffers as fast as possible, each one stamped
+ * with its sequence number. Like relay in no-overwrite mode, a subbuffer
+ * is dropped when the logger has left no room for it.
+ */
+static void standin_producer(int fd)
+{
+	struct sched_param param = {};
+	uint64_t seq;
+	char *buf;
+
+	/* Don't compete at rt priority with the logger being fed */
+	sched_setscheduler(0, SCHED_OTHER, &param);
+
+	buf = calloc(1, SUBBUF_SIZE);
+	if (!buf)
+		_exit(1);
+
+	for (seq = 0; seq < standin_subbufs && !READ_ONCE(standin->stop); seq++) {
+		memcpy(buf, &seq, sizeof(seq));
+
+		if (send(fd, buf, SUBBUF_SIZE, MSG_DONTWAIT) == SUBBUF_SIZE)
+			standin->sent++;
+		else if (errno == EAGAIN || errno == ENOBUFS)
+			standin->dropped++;
+		else
+			_exit(1);
+	}
+
+	_exit(0);
+}
+
+static void start_standin_producer(void)
+{
+	int sv[2], size = 8 * SUBBUF_SIZE;
+	int ret;
+
+	standin = mmap(NULL, sizeof(*standin), PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	igt_assert_f(standin != MAP_FAILED, "couldn't map the stand-in counters\n");
+
+	/* A seqpacket socket hands out whole subbuffers like a relay read,
+	 * its send buffer stands in for the few relay subbuffers.
+	 */
+	ret = socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv);
+	igt_assert_f(ret == 0, "couldn't create the stand-in relay socket\n");
+	setsockopt(sv[1], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+	standin_pid = fork();
+	igt_assert_f(standin_pid >= 0, "couldn't fork the stand-in producer\n");
+	if (!standin_pid) {
+		close(sv[0]);
+		standin_producer(sv[1]);
+	}
+
+	close(sv[1]);
+	relay_fd = sv[0];
+}
+
+static void stop_standin_producer(void)
+{
+	int status;
+
+	WRITE_ONCE(standin->stop, true);
+	igt_assert(waitpid(standin_pid, &status, 0) == standin_pid);
+	igt_assert_f(WIFEXITED(status) && !WEXITSTATUS(status),
+		     "stand-in producer failed\n");
+}
+
+/*
+ * Read the sequence numbers back from the output file, every gap is a
+ * subbuffer that was dropped, and check the capture accounted for all
+ * the stand-in producer generated.
+ */
+static void check_standin_capture(double elapsed)
+{
+	uint32_t generated = standin->sent + standin->dropped;
+	uint32_t captured = 0, dropped = 0;
+	uint64_t seq, expected = 0;
+	off_t offset;
+	int fd;
+
+	fd = open(out_filename ? : DEFAULT_OUTPUT_FILE_NAME, O_RDONLY);
+	igt_assert_f(fd >= 0, "couldn't reopen the output file\n");
+
+	for (offset = 0;
+	     pread(fd, &seq, sizeof(seq), offset) == sizeof(seq);
+	     offset += SUBBUF_SIZE) {
+		igt_assert_f(seq >= expected && seq < generated,
+			     "unexpected subbuffer %" PRIu64 " captured\n", seq);
+		dropped += seq - expected;
+		expected = seq + 1;
+		captured++;
+	}
+	dropped += generated - expected;
+	close(fd);
+
+	igt_info("stand-in offered %.1f MB/s, %u subbuffers generated, %u captured, %u dropped\n",
+		 elapsed > 0 ? generated * (double)SUBBUF_SIZE / elapsed / MB(1) : 0.,
+		 generated, captured, dropped);
+
+	igt_assert_eq_u64(total_bytes_written, (uint64_t)captured * SUBBUF_SIZE);
+	igt_assert_eq(captured, standin->sent);
+	igt_assert_eq(dropped, standin->dropped);
+}
+
 static void open_relay_file(void)
 {
-	relay_fd = igt_debugfs_open(-1, RELAY_FILE_NAME, O_RDONLY);
+	/* The stand-in producer has no old logs to discard */
+	if (standin_subbufs) {
+		start_standin_producer();
+		return;
+	}
+
+	if (relay_filename)
+		relay_fd = open(relay_filename, O_RDONLY);
+	else
+		relay_fd = igt_debugfs_open(-1, RELAY_FILE_NAME, O_RDONLY);
 	igt_assert_f(relay_fd >= 0, "couldn't open the guc log file\n");
 
 	/* Purge the old/boot-time logs from the relay buffer.
@@ -283,11 +468,31 @@ static void open_output_file(void)
 	 * done on the logger side to hide the disk IO latency.
 	 */
 	outfile_fd = open(out_filename ? : DEFAULT_OUTPUT_FILE_NAME,
-			  O_CREAT | O_WRONLY | O_TRUNC | O_DIRECT,
+			  O_CREAT | O_WRONLY | O_TRUNC |
+			  (use_splice ? 0 : O_DIRECT),
 			  0440);
 	igt_assert_f(outfile_fd >= 0, "couldn't open the output file\n");
 
-	free(out_filename);
+	/* Reserve the blocks upfront so the capture loop never waits on
+	 * block allocation. Filesystems without fallocate support just
+	 * allocate on demand.
+	 */
+	if (max_filesize &&
+	    fallocate(outfile_fd, FALLOC_FL_KEEP_SIZE, 0, MB(max_filesize)) &&
+	    errno != EOPNOTSUPP)
+		igt_warn("couldn't preallocate the output file: %m\n");
+}
+
+static void open_splice_pipe(void)
+{
+	int ret;
+
+	ret = pipe(splice_pipe);
+	igt_assert_f(ret == 0, "couldn't create the splice pipe\n");
+
+	/* The pipe must be able to hold a complete relay subbuffer */
+	ret = fcntl(splice_pipe[1], F_SETPIPE_SZ, SUBBUF_SIZE);
+	igt_assert_f(ret >= SUBBUF_SIZE, "couldn't resize the splice pipe\n");
 }
 
 static void init_main_thread(void)
@@ -310,13 +515,19 @@ static void init_main_thread(void)
 	if (signal(SIGALRM, int_sig_handler) == SIG_ERR)
 		igt_assert_f(0, "SIGALRM handler registration failed\n");
 
-	/* Need an aligned pointer for direct IO */
-	ret = posix_memalign((void **)&read_buffer, PAGE_SIZE, num_buffers * SUBBUF_SIZE);
-	igt_assert_f(ret == 0, "couldn't allocate the read buffer\n");
-
-	/* Keep the pages locked in RAM, avoid page fault overhead */
-	ret = mlock(read_buffer, num_buffers * SUBBUF_SIZE);
-	igt_assert_f(ret == 0, "failed to lock memory\n");
+	if (use_splice) {
+		/* Relay pages are moved straight to the output file */
+		open_splice_pipe();
+	} else {
+		/* Need an aligned pointer for direct IO */
+		ret = posix_memalign((void **)&read_buffer, PAGE_SIZE,
+				     num_buffers * SUBBUF_SIZE);
+		igt_assert_f(ret == 0, "couldn't allocate the read buffer\n");
+
+		/* Keep the pages locked in RAM, avoid page fault overhead */
+		ret = mlock(read_buffer, num_buffers * SUBBUF_SIZE);
+		igt_assert_f(ret == 0, "failed to lock memory\n");
+	}
 
 	/* Enable the logging, it may not have been enabled from boot and so
 	 * the relay file also wouldn't have been created.
@@ -367,6 +578,20 @@ static int parse_options(int opt, int opt_index, void *data)
 		discard_oldlogs = true;
 		igt_debug("old/boot-time logs will be discarded\n");
 		break;
+	case 'z':
+		use_splice = true;
+		igt_debug("logs will be spliced to the output file\n");
+		break;
+	case 'r':
+		relay_filename = strdup(optarg);
+		igt_assert_f(relay_filename, "Couldn't allocate the relay filename\n");
+		igt_debug("logs to be read from stand-in file %s\n", relay_filename);
+		break;
+	case 'g':
+		standin_subbufs = atoi(optarg);
+		igt_assert_f(standin_subbufs > 0, "invalid input for -g option\n");
+		igt_debug("stand-in producer to generate %u subbuffers\n", standin_subbufs);
+		break;
 	}
 
 	return 0;
@@ -382,6 +607,9 @@ static void process_command_line(int argc, char **argv)
 		{"polltimeout", required_argument, 0, 'p'},
 		{"size", required_argument, 0, 's'},
 		{"discard", no_argument, 0, 'd'},
+		{"splice", no_argument, 0, 'z'},
+		{"relayfile", required_argument, 0, 'r'},
+		{"generate", required_argument, 0, 'g'},
 		{ 0, 0, 0, 0 }
 	};
 
@@ -392,21 +620,30 @@ static void process_command_line(int argc, char **argv)
 		"  -t --testduration=sec  max duration in seconds for which the logger should run\n"
 		"  -p --polltimeout=ms    polling timeout in ms, -1 == indefinite wait for the new data\n"
 		"  -s --size=MB           max size of output file in MBs after which logging will be stopped\n"
-		"  -d --discard           discard the old/boot-time logs before entering into the capture loop\n";
+		"  -d --discard           discard the old/boot-time logs before entering into the capture loop\n"
+		"  -z --splice            move the logs to the output file with splice(), without the buffer pool\n"
+		"  -r --relayfile=name    read from a stand-in relay file instead of the GuC one, stop at its end\n"
+		"  -g --generate=num      read num subbuffers from a local stand-in producer, check the drops at the end\n";
 
-	igt_simple_init_parse_opts(&argc, argv, "v:o:b:t:p:s:d", long_options,
+	igt_simple_init_parse_opts(&argc, argv, "v:o:b:t:p:s:dzr:g:", long_options,
 				   help, parse_options, NULL);
+
+	igt_assert_f(!(relay_filename && standin_subbufs),
+		     "-r and -g options are exclusive\n");
 }
 
 int main(int argc, char **argv)
 {
 	struct pollfd relay_poll_fd;
+	struct timespec start, end;
+	double elapsed;
 	int nfds;
 	int ret;
 
 	process_command_line(argc, argv);
 
 	init_main_thread();
+	clock_gettime(CLOCK_MONOTONIC, &start);
 
 	/* Use a separate thread for flushing the logs to a file on disk.
 	 * Main thread will buffer the data from relay file in its pool of
@@ -415,8 +652,11 @@ int main(int argc, char **argv)
 	 * async mode, as when there are too many dirty pages in the RAM,
 	 * (/proc/sys/vm/dirty_ratio), kernel starts blocking the processes
 	 * doing the file writes.
+	 * In splice mode no data passes through userspace, so there is
+	 * nothing to hand over to a flusher.
 	 */
-	init_flusher_thread();
+	if (!use_splice)
+		init_flusher_thread();
 
 	relay_poll_fd.fd = relay_fd;
 	relay_poll_fd.events = POLLIN;
@@ -449,22 +689,49 @@ int main(int argc, char **argv)
 		if (!relay_poll_fd.revents)
 			continue;
 
-		pull_data();
+		if (!use_splice)
+			pull_data();
+		else if (!splice_data() && standin_relay())
+			stop_logging = true;
 	} while (!stop_logging);
 
 	/* Pause logging on the GuC side */
 	guc_log_control(false, 0);
 
-	/* Signal flusher thread to make an exit */
-	capturing_stopped = 1;
-	pthread_cond_signal(&underflow_cond);
-	pthread_join(flush_thread, NULL);
+	/* Stop the producer so that the leftover data ends with EOF */
+	if (standin_subbufs)
+		stop_standin_producer();
+
+	if (!use_splice) {
+		/* Signal flusher thread to make an exit */
+		capturing_stopped = 1;
+		pthread_cond_signal(&underflow_cond);
+		pthread_join(flush_thread, NULL);
+	}
 
 	pull_leftover_data();
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
 	igt_info("total bytes written %" PRIu64 "\n", total_bytes_written);
+	igt_info("throughput %.1f MB/s, %u overflow stalls\n",
+		 elapsed > 0 ? total_bytes_written / elapsed / MB(1) : 0.,
+		 overflow_stalls);
+
+	if (standin_subbufs) {
+		check_standin_capture(elapsed);
+		munmap(standin, sizeof(*standin));
+	}
 
 	free(read_buffer);
+	free(out_filename);
+	free(relay_filename);
 	close(relay_fd);
 	close(outfile_fd);
+	if (use_splice) {
+		close(splice_pipe[0]);
+		close(splice_pipe[1]);
+	}
 	igt_exit();
 }
@@ -37,6 +37,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
 #include "igt_aux.h"
 #include "igt_halffloat.h"
@@ -70,7 +71,9 @@ struct bdb_legacy_child_devices {
 struct bdb_block {
 	uint8_t id;
 	uint32_t size;
-	uint8_t data[];
+	/* block header and data, in the VBT image unless it had to be copied */
+	const uint8_t *data;
+	uint8_t copy[];
 };
 
 struct context {
@@ -78,6 +81,10 @@ struct context {
 	const struct bdb_header *bdb;
 	int size;
 
+	/* the first block of each ID, see index_sections() */
+	const uint8_t *raw_sections[256];
+	struct bdb_block *sections[256];
+
 	uint32_t devid;
 	int panel_type, panel_type2;
 	int sdvo_panel_type;
@@ -158,7 +165,8 @@ static u32 get_blocksize(const void *block_data)
 	return _get_blocksize(block_data - 3);
 }
 
-static const void *find_raw_section(const struct context *context, int section_id)
+/* Walk the sections once, recording where the first one of each ID starts */
+static void index_raw_sections(struct context *context)
 {
 	const struct bdb_header *bdb = context->bdb;
 	int length = context->size;
@@ -167,28 +175,36 @@ static const void *find_raw_section(const struct context *context, int section_i
 	uint32_t total, current_size;
 	unsigned char current_id;
 
+	memset(context->raw_sections, 0, sizeof(context->raw_sections));
+
 	/* skip to first section */
 	index += bdb->header_size;
 	total = bdb->bdb_size;
 	if (total > length)
 		total = length;
 
-	/* walk the sections looking for section_id */
 	while (index + 3 < total) {
 		current_id = *(base + index);
 		current_size = _get_blocksize(base + index);
 		index += 3;
 
+		/* nothing past a truncated section can be trusted */
 		if (index + current_size > total)
-			return NULL;
+			break;
 
-		if (current_id == section_id)
-			return base + index;
+		if (!context->raw_sections[current_id])
+			context->raw_sections[current_id] = base + index;
 
 		index += current_size;
 	}
+}
 
-	return NULL;
+static const void *find_raw_section(const struct context *context, int section_id)
+{
+	if (section_id < 0 || section_id >= ARRAY_SIZE(context->raw_sections))
+		return NULL;
+
+	return context->raw_sections[section_id];
 }
 
 /*
@@ -211,12 +227,13 @@ static const void *block_data(const struct bdb_block *block)
 	return block->data + 3;
 }
 
-static struct bdb_block *find_section(const struct context *context, int section_id);
+static const struct bdb_block *find_section(const struct context *context,
+					    int section_id);
 
 static size_t lfp_data_min_size(const struct context *context)
 {
 	const struct bdb_lfp_data_ptrs *ptrs;
-	struct bdb_block *ptrs_block;
+	const struct bdb_block *ptrs_block;
 	size_t size;
 
 	ptrs_block = find_section(context, BDB_LFP_DATA_PTRS);
@@ -230,8 +247,6 @@ static size_t lfp_data_min_size(const struct context *context)
 		size = max(size, ptrs->panel_name.offset +
 			   sizeof(struct bdb_lfp_data_tail));
 
-	free(ptrs_block);
-
 	return size;
 }
 
@@ -563,7 +578,11 @@ static bool fixup_lfp_data_ptrs(const struct context *context,
 	return validate_lfp_data_ptrs(context, ptrs);
 }
 
-static struct bdb_block *find_section(const struct context *context, int section_id)
+/*
+ * Blocks are views into the VBT image, only the ones which are shorter than
+ * their definition or need their LFP data pointers fixed up are copied.
+ */
+static struct bdb_block *make_section(const struct context *context, int section_id)
 {
 	size_t min_size = block_min_size(context, section_id);
 	struct bdb_block *block;
@@ -599,20 +618,27 @@ static struct bdb_block *find_section(const struct context *context, int section
 		fprintf(stderr, "Block %d min size %zu less than block size %zu\n",
 			section_id, min_size, size);
 
-	block = calloc(1, sizeof(*block) + 3 + max(size, min_size));
-	if (!block) {
-		free(temp_block);
-		return NULL;
+	if (section_id == BDB_LFP_DATA_PTRS || size < min_size) {
+		block = calloc(1, sizeof(*block) + 3 + max(size, min_size));
+		if (block) {
+			memcpy(block->copy, data - 3, 3 + size);
+			block->data = block->copy;
+		}
+	} else {
+		block = calloc(1, sizeof(*block));
+		if (block)
+			block->data = data - 3;
 	}
 
+	free(temp_block);
+	if (!block)
+		return NULL;
+
 	block->id = section_id;
 	block->size = size;
-	memcpy(block->data, data - 3, 3 + size);
-
-	free(temp_block);
 
 	if (section_id == BDB_LFP_DATA_PTRS &&
-	    !fixup_lfp_data_ptrs(context, 3 + block->data)) {
+	    !fixup_lfp_data_ptrs(context, 3 + block->copy)) {
 		fprintf(stderr, "VBT has malformed LFP data table pointers\n");
 		free(block);
 		return NULL;
@@ -621,6 +647,47 @@ static struct bdb_block *find_section(const struct context *context, int section
 	return block;
 }
 
+/*
+ * Build the block directory. The LFP data pointers go first, the minimum
+ * size of the LFP data block depends on them.
+ */
+static void index_sections(struct context *context)
+{
+	int i;
+
+	index_raw_sections(context);
+
+	memset(context->sections, 0, sizeof(context->sections));
+	context->sections[BDB_LFP_DATA_PTRS] =
+		make_section(context, BDB_LFP_DATA_PTRS);
+
+	for (i = 0; i < ARRAY_SIZE(context->sections); i++) {
+		if (i == BDB_LFP_DATA_PTRS || !context->raw_sections[i])
+			continue;
+
+		context->sections[i] = make_section(context, i);
+	}
+}
+
+static void free_sections(struct context *context)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(context->sections); i++) {
+		free(context->sections[i]);
+		context->sections[i] = NULL;
+	}
+}
+
+static const struct bdb_block *find_section(const struct context *context,
+					    int section_id)
+{
+	if (section_id < 0 || section_id >= ARRAY_SIZE(context->sections))
+		return NULL;
+
+	return context->sections[section_id];
+}
+
 static unsigned int panel_bits(unsigned int value, int panel_type, int num_bits)
 {
 	return (value >> (panel_type * num_bits)) & (BIT(num_bits) - 1);
@@ -1731,7 +1798,7 @@ static void dump_pnp_id(const struct bdb_edid_pnp_id *pnp_id)
 static void dump_lfp_data(struct context *context,
 			  const struct bdb_block *block)
 {
-	struct bdb_block *ptrs_block;
+	const struct bdb_block *ptrs_block;
 	const struct bdb_lfp_data_ptrs *ptrs;
 	int i;
 
@@ -1820,8 +1887,6 @@ static void dump_lfp_data(struct context *context,
 		printf("\t\tGPU dithering for banding artifacts: %s\n",
 		       YESNO(panel_bool(tail->gpu_dithering_for_banding_artifacts, i)));
 	}
-
-	free(ptrs_block);
 }
 
 static const char * const lvds_config_str[] = {
@@ -3554,7 +3619,7 @@ static void dump_prd_table(struct context *context,
 static int get_panel_type_pnpid(const struct context *context,
 				const char *edid_file)
 {
-	struct bdb_block *ptrs_block, *data_block;
+	const struct bdb_block *ptrs_block, *data_block;
 	const struct bdb_lfp_data *data;
 	const struct bdb_lfp_data_ptrs *ptrs;
 	struct bdb_edid_pnp_id edid_id, edid_id_nodate;
@@ -3614,7 +3679,7 @@ static int get_panel_type_pnpid(const struct context *context,
 /* get panel type from lfp options block, or -1 if block not found */
 static int get_panel_type(struct context *context, bool is_panel_type2)
 {
-	struct bdb_block *block;
+	const struct bdb_block *block;
 	const struct bdb_lfp_options *options;
 	int panel_type = -1;
 
@@ -3628,8 +3693,6 @@ static int get_panel_type(struct context *context, bool is_panel_type2)
 	else if (context->bdb->version >= 212)
 		panel_type = options->panel_type2;
 
-	free(block);
-
 	return panel_type;
 }
 
@@ -3637,7 +3700,7 @@ static int get_panel_type(struct context *context, bool is_panel_type2)
 static int get_sdvo_panel_type(struct context *context)
 {
 	const struct bdb_sdvo_lvds_options *options;
-	struct bdb_block *block;
+	const struct bdb_block *block;
 	int panel_type = -1;
 
 	block = find_section(context, BDB_SDVO_LVDS_OPTIONS);
@@ -3647,8 +3710,6 @@ static int get_sdvo_panel_type(struct context *context)
 	options = block_data(block);
 	panel_type = options->panel_type;
 
-	free(block);
-
 	return panel_type;
 }
 
@@ -3941,16 +4002,11 @@ static void hex_dump_block(const struct bdb_block *block)
 	hex_dump(block->data, 3 + block->size);
 }
 
-static bool dump_section(struct context *context, int section_id)
+static const struct dumper *find_dumper(const struct context *context,
+					int section_id)
 {
-	struct dumper *dumper = NULL;
-	struct bdb_block *block;
 	int i;
 
-	block = find_section(context, section_id);
-	if (!block)
-		return false;
-
 	for (i = 0; i < ARRAY_SIZE(dumpers); i++) {
 		if (dumpers[i].min_bdb_version &&
 		    context->bdb->version < dumpers[i].min_bdb_version)
@@ -3960,12 +4016,24 @@ static bool dump_section(struct context *context, int section_id)
 		    context->bdb->version > dumpers[i].max_bdb_version)
 			continue;
 
-		if (block->id == dumpers[i].id) {
-			dumper = &dumpers[i];
-			break;
-		}
+		if (section_id == dumpers[i].id)
+			return &dumpers[i];
 	}
 
+	return NULL;
+}
+
+static bool dump_section(struct context *context, int section_id)
+{
+	const struct dumper *dumper;
+	const struct bdb_block *block;
+
+	block = find_section(context, section_id);
+	if (!block)
+		return false;
+
+	dumper = find_dumper(context, block->id);
+
 	printf("BDB block %d (%d bytes, min %zu bytes) - %s%s:\n",
 	       block->id, block->size, block_min_size(context, block->id),
 	       dumper ? dumper->name : "Unknown",
@@ -3977,8 +4045,6 @@ static bool dump_section(struct context *context, int section_id)
 		dumper->dump(context, block);
 	printf("\n");
 
-	free(block);
-
 	return true;
 }
 
@@ -4058,6 +4124,378 @@ static void dump_headers(struct context *context)
 	printf("\n\n");
 }
 
+struct vbt_image {
+	uint8_t *data;
+	int size;
+	bool mapped;
+};
+
+static void unload_vbt(struct vbt_image *image)
+{
+	if (image->mapped)
+		munmap(image->data, image->size);
+	else
+		free(image->data);
+	image->data = NULL;
+}
+
+/*
+ * Map (or read, for files without a size such as the debugfs one) @filename
+ * and point @context at the VBT in it. On failure the reason is left in @err.
+ */
+static bool load_vbt(struct context *context, struct vbt_image *image,
+		     const char *filename, char *err, size_t err_size)
+{
+	struct vbt_header *vbt = NULL;
+	struct stat finfo;
+	int vbt_off, bdb_off, i;
+	int fd, size;
+
+	memset(image, 0, sizeof(*image));
+
+	fd = open(filename, O_RDONLY);
+	if (fd == -1) {
+		snprintf(err, err_size, "Couldn't open \"%s\": %s",
+			 filename, strerror(errno));
+		return false;
+	}
+
+	if (fstat(fd, &finfo)) {
+		snprintf(err, err_size, "Failed to stat \"%s\": %s",
+			 filename, strerror(errno));
+		close(fd);
+		return false;
+	}
+	size = finfo.st_size;
+
+	if (size == 0) {
+		int len = 0, ret;
+		size = 8192;
+		image->data = malloc (size);
+		while ((ret = read(fd, image->data + len, size - len))) {
+			if (ret < 0) {
+				snprintf(err, err_size, "Failed to read \"%s\": %s",
+					 filename, strerror(errno));
+				close(fd);
+				unload_vbt(image);
+				return false;
+			}
+
+			len += ret;
+			if (len == size) {
+				size *= 2;
+				image->data = realloc(image->data, size);
+			}
+		}
+	} else {
+		image->data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (image->data == MAP_FAILED) {
+			snprintf(err, err_size, "Failed to map \"%s\": %s",
+				 filename, strerror(errno));
+			image->data = NULL;
+			close(fd);
+			return false;
+		}
+		image->mapped = true;
+	}
+	image->size = size;
+	close(fd);
+
+	/* Scour memory looking for the VBT signature */
+	for (i = 0; i + 4 < size; i++) {
+		if (!memcmp(image->data + i, "$VBT", 4)) {
+			vbt_off = i;
+			vbt = (struct vbt_header *)(image->data + i);
+			break;
+		}
+	}
+
+	if (!vbt) {
+		snprintf(err, err_size, "VBT signature missing");
+		unload_vbt(image);
+		return false;
+	}
+
+	bdb_off = vbt_off + vbt->bdb_offset;
+	if (bdb_off >= size - sizeof(struct bdb_header)) {
+		snprintf(err, err_size, "Invalid VBT found, BDB points beyond end of data block");
+		unload_vbt(image);
+		return false;
+	}
+
+	context->vbt = vbt;
+	context->bdb = (const struct bdb_header *)(image->data + bdb_off);
+	context->size = size;
+
+	index_sections(context);
+
+	if (!context->devid) {
+		const char *devid_string = getenv("DEVICE");
+		if (devid_string)
+			context->devid = strtoul(devid_string, NULL, 16);
+	}
+	if (!context->devid)
+		context->devid = get_device_id(image->data, size);
+	if (!context->devid)
+		fprintf(stderr, "Warning: could not find PCI device ID!\n");
+
+	return true;
+}
+
+static void setup_panel_types(struct context *context,
+			      const char *panel_edid, const char *panel_edid2)
+{
+	if (context->panel_type == -1)
+		context->panel_type = get_panel_type(context, false);
+	if (context->panel_type == 255 && !panel_edid) {
+		fprintf(stderr, "Warning: panel type depends on EDID (use --panel-edid), ignoring\n");
+		context->panel_type = -1;
+	} else if (context->panel_type == 255) {
+		context->panel_type = get_panel_type_pnpid(context, panel_edid);
+	}
+	if (context->panel_type == -1) {
+		fprintf(stderr, "Warning: panel type not set, using 0\n");
+		context->panel_type = 0;
+	}
+
+	if (context->panel_type2 == -1)
+		context->panel_type2 = get_panel_type(context, true);
+	if (context->panel_type2 == 255 && !panel_edid2) {
+		fprintf(stderr, "Warning: panel type2 depends on EDID (use --panel-edid2), ignoring\n");
+		context->panel_type2 = -1;
+	} else if (context->panel_type2 == 255) {
+		context->panel_type2 = get_panel_type_pnpid(context, panel_edid2);
+	}
+	if (context->panel_type2 != -1 && context->bdb->version < 212) {
+		fprintf(stderr, "Warning: panel type2 not valid for BDB version %d\n",
+			context->bdb->version);
+		context->panel_type2 = -1;
+	}
+
+	if (context->sdvo_panel_type == -1)
+		context->sdvo_panel_type = get_sdvo_panel_type(context);
+}
+
+static void json_string(FILE *out, const char *str, size_t len)
+{
+	fputc('"', out);
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = str[i];
+
+		if (c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if (c == '\n')
+			fputs("\\n", out);
+		else if (c == '\t')
+			fputs("\\t", out);
+		else if (c < 0x20 || c >= 0x7f)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+/* The output of the block's dumper, as an array of lines */
+static void json_decoded(FILE *out, struct context *context,
+			 const struct dumper *dumper,
+			 const struct bdb_block *block)
+{
+	FILE *saved = stdout;
+	char *text = NULL;
+	size_t len = 0;
+	const char *line, *end;
+
+	stdout = open_memstream(&text, &len);
+	if (!stdout) {
+		stdout = saved;
+		return;
+	}
+	dumper->dump(context, block);
+	fclose(stdout);
+	stdout = saved;
+
+	fputs(",\"decoded\":[", out);
+	for (line = text; line < text + len; line = end + 1) {
+		end = memchr(line, '\n', text + len - line) ?: text + len;
+		if (line != text)
+			fputc(',', out);
+		json_string(out, line, end - line);
+	}
+	fputc(']', out);
+
+	free(text);
+}
+
+static void json_block(FILE *out, struct context *context,
+		       const struct bdb_block *block)
+{
+	const struct dumper *dumper = find_dumper(context, block->id);
+	const uint8_t *data = block->data + 3;
+
+	fprintf(out, "{\"id\":%d,\"name\":", block->id);
+	if (dumper)
+		json_string(out, dumper->name, strlen(dumper->name));
+	else
+		fputs("null", out);
+	fprintf(out, ",\"size\":%u,\"min_size\":%zu,\"data\":\"",
+		block->size, block_min_size(context, block->id));
+	for (uint32_t i = 0; i < block->size; i++)
+		fprintf(out, "%02x", data[i]);
+	fputc('"', out);
+
+	if (dumper)
+		json_decoded(out, context, dumper, block);
+
+	fputc('}', out);
+}
+
+struct json_batch {
+	const struct context *defaults;
+	const char *panel_edid, *panel_edid2;
+	const bool *blocks;
+	char **files;
+	int num_files;
+	int jobs;
+};
+
+/* Decodes @filename into a single line of JSON, returns false on failure */
+static bool json_file(const struct json_batch *batch, const char *filename,
+		      FILE *out)
+{
+	struct context context = *batch->defaults;
+	struct vbt_image image;
+	char err[256];
+	bool first = true;
+	int i;
+
+	fputs("{\"file\":", out);
+	json_string(out, filename, strlen(filename));
+
+	if (!load_vbt(&context, &image, filename, err, sizeof(err))) {
+		fputs(",\"error\":", out);
+		json_string(out, err, strlen(err));
+		fputs("}\n", out);
+		return false;
+	}
+
+	setup_panel_types(&context, batch->panel_edid, batch->panel_edid2);
+
+	fputs(",\"signature\":", out);
+	json_string(out, (const char *)context.vbt->signature,
+		    strnlen((const char *)context.vbt->signature,
+			    sizeof(context.vbt->signature)));
+	fprintf(out, ",\"bdb_version\":%d,\"devid\":\"0x%04x\",\"blocks\":[",
+		context.bdb->version, context.devid);
+
+	for (i = 0; i < ARRAY_SIZE(context.sections); i++) {
+		const struct bdb_block *block = find_section(&context, i);
+
+		if (!block || (batch->blocks && !batch->blocks[i]))
+			continue;
+
+		if (!first)
+			fputc(',', out);
+		first = false;
+		json_block(out, &context, block);
+	}
+	fputs("]}\n", out);
+
+	free_sections(&context);
+	unload_vbt(&image);
+
+	return true;
+}
+
+/*
+ * Worker @job decodes the files @job, @job + jobs, ... and writes them to
+ * @fd, one line each, so the parent can put the output back in order by
+ * reading a line at a time from each worker in turn.
+ */
+static int json_worker(const struct json_batch *batch, int job, int fd)
+{
+	FILE *out = fdopen(fd, "w");
+	bool ok = true;
+
+	if (!out)
+		return EXIT_FAILURE;
+
+	for (int i = job; i < batch->num_files; i += batch->jobs) {
+		ok &= json_file(batch, batch->files[i], out);
+		fflush(out);
+	}
+	fclose(out);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int json_batch(struct json_batch *batch)
+{
+	FILE *in[64];
+	pid_t pids[64];
+	char *line = NULL;
+	size_t line_size = 0;
+	int ret = EXIT_SUCCESS;
+	int i;
+
+	if (!batch->jobs)
+		batch->jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	batch->jobs = min(batch->jobs, batch->num_files);
+	batch->jobs = max(1, min(batch->jobs, (int)ARRAY_SIZE(pids)));
+
+	fflush(stdout);
+	for (i = 0; i < batch->jobs; i++) {
+		int fds[2];
+
+		if (pipe(fds)) {
+			fprintf(stderr, "Failed to create pipe: %s\n",
+				strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			fprintf(stderr, "Failed to fork: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		if (pids[i] == 0) {
+			/* don't keep the earlier workers' pipes open */
+			for (int j = 0; j < i; j++)
+				fclose(in[j]);
+			close(fds[0]);
+			exit(json_worker(batch, i, fds[1]));
+		}
+
+		close(fds[1]);
+		in[i] = fdopen(fds[0], "r");
+		if (!in[i])
+			exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < batch->num_files; i++) {
+		if (getline(&line, &line_size, in[i % batch->jobs]) <= 0) {
+			fprintf(stderr, "Lost the output of \"%s\"\n",
+				batch->files[i]);
+			ret = EXIT_FAILURE;
+			continue;
+		}
+		fputs(line, stdout);
+	}
+	free(line);
+
+	for (i = 0; i < batch->jobs; i++) {
+		int status;
+
+		fclose(in[i]);
+		if (waitpid(pids[i], &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status))
+			ret = EXIT_FAILURE;
+	}
+
+	return ret;
+}
+
 enum opt {
 	OPT_UNKNOWN = '?',
 	OPT_END = -1,
@@ -4073,6 +4511,8 @@ enum opt {
 	OPT_USAGE,
 	OPT_HEADER,
 	OPT_DESCRIBE,
+	OPT_JSON,
+	OPT_JOBS,
 };
 
 static void usage(const char *toolname)
@@ -4090,20 +4530,18 @@ static void usage(const char *toolname)
 			" [--header]"
 			" [--describe]"
 			" [--help]\n");
+	fprintf(stderr, "       %s --json [--jobs=<n>] [--block=<block_no> ...]"
+			" [--devid=<device_id>] <rom_file>...\n", toolname);
 }
 
 int main(int argc, char **argv)
 {
-	uint8_t *VBIOS;
+	struct vbt_image image;
 	int index;
 	enum opt opt;
-	int fd;
-	struct vbt_header *vbt = NULL;
-	int vbt_off, bdb_off, i;
+	int i;
 	const char *filename = NULL;
 	const char *toolname = argv[0];
-	struct stat finfo;
-	int size;
 	struct context context = {
 		.panel_type = -1,
 		.panel_type2 = -1,
@@ -4111,8 +4549,11 @@ int main(int argc, char **argv)
 	};
 	const char *panel_edid = NULL, *panel_edid2 = NULL;
 	char *endp;
+	char err[256];
 	int block_number = -1;
-	bool header_only = false, describe = false;
+	bool blocks[256] = {};
+	bool header_only = false, describe = false, json = false;
+	int jobs = 0;
 
 	static struct option options[] = {
 		{ "file",	required_argument,	NULL,	OPT_FILE },
@@ -4126,6 +4567,8 @@ int main(int argc, char **argv)
 		{ "block",	required_argument,	NULL,	OPT_BLOCK },
 		{ "header",	no_argument,		NULL,	OPT_HEADER },
 		{ "describe",	no_argument,		NULL,	OPT_DESCRIBE },
+		{ "json",	no_argument,		NULL,	OPT_JSON },
+		{ "jobs",	required_argument,	NULL,	OPT_JOBS },
 		{ "help",	no_argument,		NULL,	OPT_USAGE },
 		{ 0 }
 	};
@@ -4179,6 +4622,8 @@ int main(int argc, char **argv)
 					optarg);
 				return EXIT_FAILURE;
 			}
+			if (block_number >= 0 && block_number < ARRAY_SIZE(blocks))
+				blocks[block_number] = true;
 			break;
 		case OPT_HEADER:
 			header_only = true;
@@ -4186,6 +4631,17 @@ int main(int argc, char **argv)
 		case OPT_DESCRIBE:
 			describe = true;
 			break;
+		case OPT_JSON:
+			json = true;
+			break;
+		case OPT_JOBS:
+			jobs = strtoul(optarg, &endp, 0);
+			if (*endp || jobs < 1) {
+				fprintf(stderr, "invalid number of jobs '%s'\n",
+					optarg);
+				return EXIT_FAILURE;
+			}
+			break;
 		case OPT_END:
 			break;
 		case OPT_USAGE: /* fall-through */
@@ -4198,119 +4654,52 @@ int main(int argc, char **argv)
 	argc -= optind;
 	argv += optind;
 
-	if (!filename) {
-		if (argc == 1) {
-			/* for backwards compatibility */
-			filename = argv[0];
-		} else {
+	if (json) {
+		struct json_batch batch = {
+			.defaults = &context,
+			.panel_edid = panel_edid,
+			.panel_edid2 = panel_edid2,
+			.blocks = block_number != -1 ? blocks : NULL,
+			.jobs = jobs,
+		};
+
+		int ret;
+
+		batch.files = calloc(argc + 1, sizeof(*batch.files));
+		if (!batch.files)
+			return EXIT_FAILURE;
+		if (filename)
+			batch.files[batch.num_files++] = (char *)filename;
+		for (i = 0; i < argc; i++)
+			batch.files[batch.num_files++] = argv[i];
+
+		if (!batch.num_files) {
 			usage(toolname);
 			return EXIT_FAILURE;
 		}
-	}
 
-	fd = open(filename, O_RDONLY);
-	if (fd == -1) {
-		fprintf(stderr, "Couldn't open \"%s\": %s\n",
-			filename, strerror(errno));
-		return EXIT_FAILURE;
-	}
+		ret = json_batch(&batch);
+		free(batch.files);
 
-	if (stat(filename, &finfo)) {
-		fprintf(stderr, "Failed to stat \"%s\": %s\n",
-			filename, strerror(errno));
-		return EXIT_FAILURE;
+		return ret;
 	}
-	size = finfo.st_size;
 
-	if (size == 0) {
-		int len = 0, ret;
-		size = 8192;
-		VBIOS = malloc (size);
-		while ((ret = read(fd, VBIOS + len, size - len))) {
-			if (ret < 0) {
-				fprintf(stderr, "Failed to read \"%s\": %s\n",
-					filename, strerror(errno));
-				return EXIT_FAILURE;
-			}
-
-			len += ret;
-			if (len == size) {
-				size *= 2;
-				VBIOS = realloc(VBIOS, size);
-			}
-		}
-	} else {
-		VBIOS = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
-		if (VBIOS == MAP_FAILED) {
-			fprintf(stderr, "Failed to map \"%s\": %s\n",
-				filename, strerror(errno));
+	if (!filename) {
+		if (argc == 1) {
+			/* for backwards compatibility */
+			filename = argv[0];
+		} else {
+			usage(toolname);
 			return EXIT_FAILURE;
 		}
 	}
 
-	/* Scour memory looking for the VBT signature */
-	for (i = 0; i + 4 < size; i++) {
-		if (!memcmp(VBIOS + i, "$VBT", 4)) {
-			vbt_off = i;
-			vbt = (struct vbt_header *)(VBIOS + i);
-			break;
-		}
-	}
-
-	if (!vbt) {
-		fprintf(stderr, "VBT signature missing\n");
+	if (!load_vbt(&context, &image, filename, err, sizeof(err))) {
+		fprintf(stderr, "%s\n", err);
 		return EXIT_FAILURE;
 	}
 
-	bdb_off = vbt_off + vbt->bdb_offset;
-	if (bdb_off >= size - sizeof(struct bdb_header)) {
-		fprintf(stderr, "Invalid VBT found, BDB points beyond end of data block\n");
-		return EXIT_FAILURE;
-	}
-
-	context.vbt = vbt;
-	context.bdb = (const struct bdb_header *)(VBIOS + bdb_off);
-	context.size = size;
-
-	if (!context.devid) {
-		const char *devid_string = getenv("DEVICE");
-		if (devid_string)
-			context.devid = strtoul(devid_string, NULL, 16);
-	}
-	if (!context.devid)
-		context.devid = get_device_id(VBIOS, size);
-	if (!context.devid)
-		fprintf(stderr, "Warning: could not find PCI device ID!\n");
-
-	if (context.panel_type == -1)
-		context.panel_type = get_panel_type(&context, false);
-	if (context.panel_type == 255 && !panel_edid) {
-		fprintf(stderr, "Warning: panel type depends on EDID (use --panel-edid), ignoring\n");
-		context.panel_type = -1;
-	} else if (context.panel_type == 255) {
-		context.panel_type = get_panel_type_pnpid(&context, panel_edid);
-	}
-	if (context.panel_type == -1) {
-		fprintf(stderr, "Warning: panel type not set, using 0\n");
-		context.panel_type = 0;
-	}
-
-	if (context.panel_type2 == -1)
-		context.panel_type2 = get_panel_type(&context, true);
-	if (context.panel_type2 == 255 && !panel_edid2) {
-		fprintf(stderr, "Warning: panel type2 depends on EDID (use --panel-edid2), ignoring\n");
-		context.panel_type2 = -1;
-	} else if (context.panel_type2 == 255) {
-		context.panel_type2 = get_panel_type_pnpid(&context, panel_edid2);
-	}
-	if (context.panel_type2 != -1 && context.bdb->version < 212) {
-		fprintf(stderr, "Warning: panel type2 not valid for BDB version %d\n",
-			context.bdb->version);
-		context.panel_type2 = -1;
-	}
-
-	if (context.sdvo_panel_type == -1)
-		context.sdvo_panel_type = get_sdvo_panel_type(&context);
+	setup_panel_types(&context, panel_edid, panel_edid2);
 
 	if (describe) {
 		print_description(&context);
@@ -4330,5 +4719,8 @@ int main(int argc, char **argv)
 			dump_section(&context, i);
 	}
 
+	free_sections(&context);
+	unload_vbt(&image);
+
 	return 0;
 }
@@ -31,11 +31,14 @@
 #include <string.h>
 
 #include "igt_stats.h"
+#include "wrpll_sweep.h"
 
 #define U64_MAX         ((uint64_t)~0ULL)
 #define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
 
-#define WARN(cond, msg)	printf(msg)
+/* Not worth a line per pixel clock of a sweep */
+static bool sweeping;
+#define WARN(cond, msg)	do { if (!sweeping) printf(msg); } while (0)
 
 #define KHz(x) (1000 * (x))
 #define MHz(x) KHz(1000 * (x))
@@ -74,7 +77,7 @@ static bool
 skl_ddi_calculate_wrpll1(int clock /* in Hz */,
 			 struct skl_wrpll_params *wrpll_params)
 {
-	uint64_t afe_clock = clock * 5; /* AFE Clock is 5x Pixel clock */
+	uint64_t afe_clock = (uint64_t)clock * 5; /* AFE Clock is 5x Pixel clock */
 	uint64_t dco_central_freq[3] = {8400000000ULL,
 					9000000000ULL,
 					9600000000ULL};
@@ -415,7 +418,7 @@ static bool
 skl_ddi_calculate_wrpll2(int clock /* in Hz */,
 			 struct skl_wrpll_params *wrpll_params)
 {
-	uint64_t afe_clock = clock * 5; /* AFE Clock is 5x Pixel clock */
+	uint64_t afe_clock = (uint64_t)clock * 5; /* AFE Clock is 5x Pixel clock */
 	uint64_t dco_central_freq[3] = {8400000000ULL,
 					9000000000ULL,
 					9600000000ULL};
@@ -924,9 +927,74 @@ static void test_run(struct test_ops *test)
 	igt_stats_fini(&stats);
 }
 
+static bool sweep_compute1(uint32_t clock, uint32_t ref_clock, void *params)
+{
+	return skl_ddi_calculate_wrpll1(clock, params);
+}
+
+static bool sweep_compute2(uint32_t clock, uint32_t ref_clock, void *params)
+{
+	return skl_ddi_calculate_wrpll2(clock, params);
+}
+
+static uint32_t sweep_pack(const void *data)
+{
+	const struct skl_wrpll_params *params = data;
+
+	return params->p0 | params->p1 << 8 | params->p2 << 16 |
+		div64_u64(params->central_freq_hz, MHz(100)) << 24;
+}
+
+/* Distance of the DCO from its central frequency, in 0.01% */
+static double sweep_deviation(uint32_t clock, uint32_t ref_clock,
+			      const void *data)
+{
+	const struct skl_wrpll_params *params = data;
+	uint64_t dco_freq = (uint64_t)params->p0 * params->p1 * params->p2 *
+			    clock * 5;
+
+	return 10000.0 * abs_diff(dco_freq, params->central_freq_hz) /
+	       params->central_freq_hz;
+}
+
+static const struct wrpll_sweep_ops sweep_ops[] = {
+	{
+		.name = "Algorithm #1",
+		.params_size = sizeof(struct skl_wrpll_params),
+		.compute = sweep_compute1,
+		.pack = sweep_pack,
+		.deviation = sweep_deviation,
+	},
+	{
+		.name = "Algorithm #2",
+		.params_size = sizeof(struct skl_wrpll_params),
+		.compute = sweep_compute2,
+		.pack = sweep_pack,
+		.deviation = sweep_deviation,
+	},
+};
+
 int main(int argc, char **argv)
 {
+	static const uint32_t ref_clocks[] = { 24000 }; /* in kHz */
+	struct wrpll_sweep sweep = {
+		.name = "skl_compute_wrpll",
+		.ops = { &sweep_ops[0], &sweep_ops[1] },
+		.pack_desc = "p0 | p1 << 8 | p2 << 16 | central MHz / 100 << 24",
+		.deviation_unit = "0.01%",
+		.ref_clocks = ref_clocks,
+		.num_ref_clocks = ARRAY_SIZE(ref_clocks),
+	};
 	unsigned int t;
+	int ret;
+
+	ret = wrpll_sweep_parse_args(&sweep, argc, argv);
+	if (ret < 0)
+		return 1;
+	if (ret) {
+		sweeping = true;
+		return wrpll_sweep_run(&sweep) != 0;
+	}
 
 	test_multipliers();
 
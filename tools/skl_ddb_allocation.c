@@ -21,11 +21,17 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include <time.h>
+
+#include "igt_collection.h"
+#include "igt_core.h"
 
 /**
  * container_of - cast a member of a structure out to the containing structure
@@ -39,6 +45,7 @@
 	(type *)( (char *)__mptr - offsetof(type,member) );})
 
 #define div_u64(a, b)	((a) / (b))
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
 
 /*
  * Stub a few defines/structures
@@ -99,7 +106,8 @@ static int intel_num_planes(struct intel_crtc *crtc)
 	return 3;
 }
 
-struct intel_crtc crtcs[I915_MAX_PIPES];
+/* Per thread, the simulation evaluates configurations in parallel */
+static __thread struct intel_crtc crtcs[I915_MAX_PIPES];
 
 #define to_intel_crtc(x) container_of(x, struct intel_crtc, base)
 
@@ -125,6 +133,9 @@ struct skl_pipe_wm_parameters {
 	uint32_t pixel_rate; /* in KHz */
 	struct intel_plane_wm_parameters plane[I915_MAX_PLANES];
 	struct intel_plane_wm_parameters cursor;
+
+	/* for this tool only, 0 if not cached */
+	unsigned int total_data_rate;
 };
 
 struct skl_ddb_entry {
@@ -275,7 +286,8 @@ skl_allocate_pipe_ddb(struct drm_crtc *crtc,
 	 *
 	 * FIXME: we may not allocate every single block here.
 	 */
-	total_data_rate = skl_get_total_relative_data_rate(intel_crtc, params);
+	total_data_rate = params->total_data_rate ?:
+		skl_get_total_relative_data_rate(intel_crtc, params);
 
 	start = alloc.start;
 	for (plane = 0; plane < intel_num_planes(intel_crtc); plane++) {
@@ -305,6 +317,62 @@ skl_allocate_pipe_ddb(struct drm_crtc *crtc,
 
 }
 
+/*
+ * WM code, latencies are in us
+ */
+
+#define SKL_MAX_WM_LEVELS	8
+
+static uint32_t skl_wm_method1(uint32_t pixel_rate, uint8_t bytes_per_pixel,
+			       uint32_t latency)
+{
+	uint64_t ret;
+
+	ret = (uint64_t)pixel_rate * bytes_per_pixel * latency;
+	ret = DIV_ROUND_UP(ret, 1000);
+
+	return ret;
+}
+
+static uint32_t skl_wm_method2(uint32_t pixel_rate, uint32_t pipe_htotal,
+			       uint32_t horiz_pixels, uint8_t bytes_per_pixel,
+			       uint32_t latency)
+{
+	uint32_t plane_bytes_per_line, wm_intermediate_val;
+
+	plane_bytes_per_line = horiz_pixels * bytes_per_pixel;
+	wm_intermediate_val = latency * pixel_rate;
+
+	return DIV_ROUND_UP(wm_intermediate_val, pipe_htotal * 1000) *
+		plane_bytes_per_line;
+}
+
+struct skl_wm_methods {
+	uint32_t method1, method2;
+};
+
+/*
+ * The check of skl_compute_plane_wm(), with both methods computed up front
+ * as they don't depend on the DDB allocation.
+ */
+static bool skl_plane_wm_fits(const struct skl_wm_methods *methods,
+			      uint32_t plane_bytes_per_line,
+			      uint16_t ddb_allocation)
+{
+	uint32_t result_bytes, res_blocks, res_lines;
+
+	if (((ddb_allocation * 512) / plane_bytes_per_line) >= 1)
+		result_bytes = methods->method1 < methods->method2 ?
+			       methods->method1 : methods->method2;
+	else
+		result_bytes = methods->method1;
+
+	res_blocks = DIV_ROUND_UP(result_bytes, 512) + 1;
+	res_lines = DIV_ROUND_UP(result_bytes, plane_bytes_per_line);
+
+	return res_blocks <= ddb_allocation && res_lines <= 31;
+}
+
 static void skl_ddb_check_entry(struct skl_ddb_entry *entry, int16_t *cursor)
 {
 
@@ -366,19 +434,24 @@ static void skl_ddb_print(struct skl_ddb_allocation *ddb)
 static struct drm_device drm_device;
 static struct drm_i915_private drm_i915_private;
 
-static void init_stub(void)
+static void init_crtcs(void)
 {
 	int i;
 
-	drm_device.dev_private = &drm_i915_private;
-	drm_i915_private.dev = &drm_device;
-
 	for (i = 0; i < I915_MAX_PIPES; i++) {
 		crtcs[i].base.dev = &drm_device;
 		crtcs[i].pipe = i;
 	}
 }
 
+static void init_stub(void)
+{
+	drm_device.dev_private = &drm_i915_private;
+	drm_i915_private.dev = &drm_device;
+
+	init_crtcs();
+}
+
 struct wm_input {
 	struct intel_wm_config config;
 	struct skl_pipe_wm_parameters params[I915_MAX_PIPES];
@@ -413,6 +486,9 @@ static void skl_ddb_allocate(struct wm_input *in,
 {
 	struct drm_crtc *crtc;
 
+	for_each_crtc(, crtc)
+		crtc->active = in->params[to_intel_crtc(crtc)->pipe].active;
+
 	for_each_crtc(, crtc) {
 		enum pipe pipe = to_intel_crtc(crtc)->pipe;
 
@@ -421,13 +497,498 @@ static void skl_ddb_allocate(struct wm_input *in,
 	}
 }
 
+/*
+ * Simulation of every combination of modes and plane layouts on the pipes,
+ * each allocated and checked against the latency of the WM levels.
+ */
+
+#define SIM_MAX_THREADS	64
+
+static const struct sim_mode {
+	const char *name;
+	uint32_t hdisplay, vdisplay, htotal;
+	uint32_t clock; /* in KHz */
+} sim_modes[] = {
+	{ "1080p60", 1920, 1080, 2200, 148500 },
+	{ "1440p60", 2560, 1440, 2720, 241500 },
+	{ "2160p30", 3840, 2160, 4400, 297000 },
+	{ "2160p60", 3840, 2160, 4400, 594000 },
+};
+
+/* What a plane scans out, the first entry is a disabled plane */
+static const struct sim_plane {
+	const char *name;
+	uint8_t bytes_per_pixel;
+	uint8_t shift; /* width and height of the mode >> shift */
+} sim_planes[] = {
+	{ "-", 0, 0 },
+	{ "16bpp", 2, 0 },
+	{ "32bpp", 4, 0 },
+	{ "64bpp", 8, 0 },
+	{ "32bpp/4", 4, 1 },
+};
+
+/* A grid of latencies, use -l for the ones of a real part */
+static const uint32_t sim_default_latency[] = { 2, 5, 10, 20, 30, 50, 70, 100 };
+
+/*
+ * A mode and a layout of planes on one pipe. The data rates and the WM
+ * methods of each level only depend on those, so they are computed once
+ * and shared by all the configurations the pipe setup is part of.
+ */
+struct sim_pipe {
+	struct skl_pipe_wm_parameters params;
+	struct skl_wm_methods methods[I915_MAX_PLANES][SKL_MAX_WM_LEVELS];
+	uint32_t bytes_per_line[I915_MAX_PLANES];
+	uint64_t bandwidth; /* in bytes/s */
+	int mode;
+	int planes[I915_MAX_PLANES];
+};
+
+struct sim_config {
+	const struct sim_pipe *pipe[I915_MAX_PIPES]; /* NULL when off */
+	uint64_t bandwidth;
+	int level; /* highest level met by all the planes, -1 for none */
+};
+
+struct sim {
+	uint32_t latency[SKL_MAX_WM_LEVELS];
+	int num_levels;
+
+	struct sim_pipe *pipes; /* by mode, then layout */
+	int num_layouts;
+
+	int (*modes)[I915_MAX_PIPES]; /* mode of each pipe, -1 when off */
+	int num_modes;
+
+	unsigned int next;
+};
+
+struct sim_thread {
+	pthread_t thread;
+	struct sim *sim;
+	uint64_t configs;
+	uint64_t failures;
+	uint64_t levels[SKL_MAX_WM_LEVELS];
+	struct sim_config best[SKL_MAX_WM_LEVELS]; /* most bandwidth by level */
+	struct sim_config smallest_failure;
+};
+
+static void sim_pipe_init(struct sim_pipe *sp, const struct sim *sim,
+			  int mode, const int *planes)
+{
+	const struct sim_mode *m = &sim_modes[mode];
+	int plane, level;
+
+	memset(sp, 0, sizeof(*sp));
+	sp->mode = mode;
+	sp->params.active = true;
+	sp->params.pipe_htotal = m->htotal;
+	sp->params.pixel_rate = m->clock;
+
+	for (plane = 0; plane < I915_MAX_PLANES; plane++) {
+		const struct sim_plane *p = &sim_planes[planes[plane]];
+		struct intel_plane_wm_parameters *pp = &sp->params.plane[plane];
+
+		sp->planes[plane] = planes[plane];
+		if (!p->bytes_per_pixel)
+			continue;
+
+		pp->horiz_pixels = m->hdisplay >> p->shift;
+		pp->vert_pixels = m->vdisplay >> p->shift;
+		pp->bytes_per_pixel = p->bytes_per_pixel;
+		pp->enabled = true;
+
+		sp->bytes_per_line[plane] = pp->horiz_pixels *
+					    pp->bytes_per_pixel;
+		sp->bandwidth += ((uint64_t)m->clock * 1000 *
+				  p->bytes_per_pixel) >> (2 * p->shift);
+
+		for (level = 0; level < sim->num_levels; level++) {
+			struct skl_wm_methods *methods = &sp->methods[plane][level];
+
+			methods->method1 = skl_wm_method1(m->clock,
+							  pp->bytes_per_pixel,
+							  sim->latency[level]);
+			methods->method2 = skl_wm_method2(m->clock, m->htotal,
+							  pp->horiz_pixels,
+							  pp->bytes_per_pixel,
+							  sim->latency[level]);
+		}
+	}
+
+	sp->params.total_data_rate =
+		skl_get_total_relative_data_rate(&crtcs[0], &sp->params);
+}
+
+static void sim_init(struct sim *sim)
+{
+	struct igt_collection *set, *result;
+	int (*layouts)[I915_MAX_PLANES];
+	int i, mode, layout;
+
+	/* Plane layouts, the first plane always scans out something */
+	set = igt_collection_create(ARRAY_SIZE(sim_planes));
+	for (i = 0; i < ARRAY_SIZE(sim_planes); i++)
+		igt_collection_set_value(set, i, i);
+
+	layouts = calloc(ARRAY_SIZE(sim_planes) * ARRAY_SIZE(sim_planes) *
+			 ARRAY_SIZE(sim_planes), sizeof(*layouts));
+	igt_assert(layouts);
+
+	sim->num_layouts = 0;
+	for_each_variation_r(result, I915_MAX_PLANES, set) {
+		if (!igt_collection_get_value(result, 0))
+			continue;
+
+		for (i = 0; i < I915_MAX_PLANES; i++)
+			layouts[sim->num_layouts][i] =
+				igt_collection_get_value(result, i);
+		sim->num_layouts++;
+	}
+	igt_collection_destroy(set);
+
+	sim->pipes = calloc(ARRAY_SIZE(sim_modes) * sim->num_layouts,
+			    sizeof(*sim->pipes));
+	igt_assert(sim->pipes);
+
+	for (mode = 0; mode < ARRAY_SIZE(sim_modes); mode++)
+		for (layout = 0; layout < sim->num_layouts; layout++)
+			sim_pipe_init(&sim->pipes[mode * sim->num_layouts + layout],
+				      sim, mode, layouts[layout]);
+	free(layouts);
+
+	/* Modes of the pipes, with at least one of them on */
+	set = igt_collection_create(ARRAY_SIZE(sim_modes) + 1);
+	for (i = 0; i <= ARRAY_SIZE(sim_modes); i++)
+		igt_collection_set_value(set, i, i - 1);
+
+	sim->modes = calloc(set->size * set->size * set->size,
+			    sizeof(*sim->modes));
+	igt_assert(sim->modes);
+
+	sim->num_modes = 0;
+	for_each_variation_r(result, I915_MAX_PIPES, set) {
+		bool on = false;
+
+		for (i = 0; i < I915_MAX_PIPES; i++) {
+			sim->modes[sim->num_modes][i] =
+				igt_collection_get_value(result, i);
+			on |= sim->modes[sim->num_modes][i] >= 0;
+		}
+
+		sim->num_modes += on;
+	}
+	igt_collection_destroy(set);
+
+	sim->next = 0;
+}
+
+static void sim_fini(struct sim *sim)
+{
+	free(sim->pipes);
+	free(sim->modes);
+}
+
+static const struct sim_pipe *sim_pipe(const struct sim *sim,
+				       int mode, int layout)
+{
+	if (mode < 0)
+		return NULL;
+
+	return &sim->pipes[mode * sim->num_layouts + layout];
+}
+
+/*
+ * The WM of a plane only grows with the latency, so the highest level met
+ * by all the planes is found walking down from the level the previous
+ * planes met.
+ */
+static void sim_eval(const struct sim *sim, struct sim_config *config)
+{
+	struct intel_wm_config wm_config = {};
+	struct skl_ddb_allocation ddb;
+	int level = sim->num_levels - 1;
+	enum pipe pipe;
+	int plane;
+
+	config->bandwidth = 0;
+	for_each_pipe(pipe) {
+		crtcs[pipe].base.active = config->pipe[pipe];
+		if (config->pipe[pipe]) {
+			wm_config.num_pipes_active++;
+			config->bandwidth += config->pipe[pipe]->bandwidth;
+		}
+	}
+
+	for_each_pipe(pipe) {
+		const struct sim_pipe *sp = config->pipe[pipe];
+
+		if (!sp)
+			continue;
+
+		skl_allocate_pipe_ddb(&crtcs[pipe].base, &wm_config,
+				      &sp->params, &ddb);
+
+		for_each_plane(pipe, plane) {
+			uint16_t size;
+
+			if (!sp->params.plane[plane].enabled)
+				continue;
+
+			size = skl_ddb_entry_size(&ddb.plane[pipe][plane]);
+			while (level >= 0 &&
+			       !skl_plane_wm_fits(&sp->methods[plane][level],
+						  sp->bytes_per_line[plane],
+						  size))
+				level--;
+
+			if (level < 0)
+				goto out;
+		}
+	}
+
+out:
+	config->level = level;
+}
+
+static void sim_record(struct sim_thread *t, const struct sim_config *config)
+{
+	t->configs++;
+
+	if (config->level < 0) {
+		if (!t->failures++ ||
+		    config->bandwidth < t->smallest_failure.bandwidth)
+			t->smallest_failure = *config;
+		return;
+	}
+
+	if (!t->levels[config->level]++ ||
+	    config->bandwidth > t->best[config->level].bandwidth)
+		t->best[config->level] = *config;
+}
+
+static void *sim_thread(void *data)
+{
+	struct sim_thread *t = data;
+	struct sim *sim = t->sim;
+	unsigned int total = sim->num_modes * sim->num_layouts;
+	unsigned int item;
+
+	init_crtcs();
+
+	while ((item = __sync_fetch_and_add(&sim->next, 1)) < total) {
+		const int *modes = sim->modes[item / sim->num_layouts];
+		int layout_a = item % sim->num_layouts;
+		int num_b = modes[PIPE_B] < 0 ? 1 : sim->num_layouts;
+		int num_c = modes[PIPE_C] < 0 ? 1 : sim->num_layouts;
+		struct sim_config config;
+
+		/* A pipe which is off has a single layout */
+		if (modes[PIPE_A] < 0 && layout_a)
+			continue;
+
+		config.pipe[PIPE_A] = sim_pipe(sim, modes[PIPE_A], layout_a);
+		for (int b = 0; b < num_b; b++) {
+			config.pipe[PIPE_B] = sim_pipe(sim, modes[PIPE_B], b);
+
+			for (int c = 0; c < num_c; c++) {
+				config.pipe[PIPE_C] = sim_pipe(sim, modes[PIPE_C], c);
+
+				sim_eval(sim, &config);
+				sim_record(t, &config);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void sim_print_config(const struct sim_config *config)
+{
+	enum pipe pipe;
+	int plane;
+
+	for_each_pipe(pipe) {
+		const struct sim_pipe *sp = config->pipe[pipe];
+
+		printf("%s%c ", pipe ? " | " : "    ", pipe_name(pipe));
+		if (!sp) {
+			printf("off");
+			continue;
+		}
+
+		printf("%s", sim_modes[sp->mode].name);
+		for_each_plane(pipe, plane)
+			printf("%c%s", plane ? ',' : ' ',
+			       sim_planes[sp->planes[plane]].name);
+	}
+	printf("\n");
+}
+
+static void sim_report(const struct sim *sim, struct sim_thread *threads,
+		       int nthreads, double elapsed)
+{
+	struct sim_thread total = {};
+	uint64_t pareto_bandwidth = 0;
+	int n, level;
+
+	for (n = 0; n < nthreads; n++) {
+		struct sim_thread *t = &threads[n];
+
+		if (t->failures && (!total.failures ||
+		    t->smallest_failure.bandwidth < total.smallest_failure.bandwidth))
+			total.smallest_failure = t->smallest_failure;
+		total.failures += t->failures;
+		total.configs += t->configs;
+
+		for (level = 0; level < sim->num_levels; level++) {
+			if (t->levels[level] && (!total.levels[level] ||
+			    t->best[level].bandwidth > total.best[level].bandwidth))
+				total.best[level] = t->best[level];
+			total.levels[level] += t->levels[level];
+		}
+	}
+
+	printf("%"PRIu64" configurations in %.2fs (%.0f/s), %d threads\n",
+	       total.configs, elapsed, total.configs / elapsed, nthreads);
+
+	printf("%"PRIu64" failed the first WM level (%uus)\n",
+	       total.failures, sim->latency[0]);
+	if (total.failures) {
+		printf("  smallest, %"PRIu64" MB/s:\n",
+		       total.smallest_failure.bandwidth / 1000000);
+		sim_print_config(&total.smallest_failure);
+	}
+
+	printf("Latency headroom:\n");
+	for (level = 0; level < sim->num_levels; level++)
+		printf("  level %d (%3uus): %"PRIu64"\n",
+		       level, sim->latency[level], total.levels[level]);
+
+	/* The most bandwidth for a given headroom, if more headroom can't do it */
+	printf("Pareto set (bandwidth vs latency headroom):\n");
+	for (level = sim->num_levels - 1; level >= 0; level--) {
+		const struct sim_config *config = &total.best[level];
+
+		if (!total.levels[level] ||
+		    config->bandwidth <= pareto_bandwidth)
+			continue;
+
+		pareto_bandwidth = config->bandwidth;
+		printf("  %3uus, %"PRIu64" MB/s:\n", sim->latency[level],
+		       config->bandwidth / 1000000);
+		sim_print_config(config);
+	}
+}
+
+static int simulate(const uint32_t *latency, int num_levels, int nthreads)
+{
+	struct sim_thread threads[SIM_MAX_THREADS] = {};
+	struct timespec start = {};
+	struct sim sim;
+	int n;
+
+	memcpy(sim.latency, latency, num_levels * sizeof(*latency));
+	sim.num_levels = num_levels;
+	sim_init(&sim);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads < 1)
+		nthreads = 1;
+	if (nthreads > SIM_MAX_THREADS)
+		nthreads = SIM_MAX_THREADS;
+
+	printf("%d pipe setups, %d pipe mode combinations, %d WM levels\n",
+	       (int)ARRAY_SIZE(sim_modes) * sim.num_layouts, sim.num_modes,
+	       num_levels);
+
+	igt_nsec_elapsed(&start);
+	for (n = 0; n < nthreads; n++) {
+		threads[n].sim = &sim;
+		if (n)
+			igt_assert(pthread_create(&threads[n].thread, NULL,
+						  sim_thread, &threads[n]) == 0);
+	}
+	sim_thread(&threads[0]);
+	for (n = 1; n < nthreads; n++)
+		pthread_join(threads[n].thread, NULL);
+
+	sim_report(&sim, threads, nthreads, igt_nsec_elapsed(&start) / 1e9);
+	sim_fini(&sim);
+
+	return 0;
+}
+
+static int parse_latency(char *arg, uint32_t *latency)
+{
+	char *tok, *save;
+	int n = 0;
+
+	for (tok = strtok_r(arg, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (n == SKL_MAX_WM_LEVELS)
+			return -1;
+
+		latency[n] = strtoul(tok, NULL, 0);
+		/* The WM levels need increasing latencies */
+		if (!latency[n] || (n && latency[n] <= latency[n - 1]))
+			return -1;
+		n++;
+	}
+
+	return n ?: -1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-s] [-j threads] [-l latency,...]\n"
+		"  -s  simulate all the mode and plane combinations\n"
+		"  -j  worker threads (default one per CPU)\n"
+		"  -l  latency of each WM level in us, up to %d levels\n",
+		name, SKL_MAX_WM_LEVELS);
+}
+
 int main(int argc, char **argv)
 {
 	struct wm_input in;
 	static struct skl_ddb_allocation ddb;
+	uint32_t latency[SKL_MAX_WM_LEVELS];
+	int num_levels = ARRAY_SIZE(sim_default_latency);
+	bool sim = false;
+	int nthreads = 0;
+	int c;
+
+	memcpy(latency, sim_default_latency, sizeof(sim_default_latency));
+
+	while ((c = getopt(argc, argv, "sj:l:")) != -1) {
+		switch (c) {
+		case 's':
+			sim = true;
+			break;
+		case 'j':
+			nthreads = atoi(optarg);
+			break;
+		case 'l':
+			num_levels = parse_latency(optarg, latency);
+			if (num_levels < 0) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
 
 	init_stub();
 
+	if (sim)
+		return simulate(latency, num_levels, nthreads);
+
 	wm_input_reset(&in);
 	wm_enable_plane(&in, PIPE_A, PLANE_1, 1280, 1024, 4);
 	wm_enable_plane(&in, PIPE_A, PLANE_2,  100,  100, 4);
@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+
+/*
+ * Shared harness of the *_compute_wrpll tools: runs the reference and the
+ * implementation of a divider computation over every pixel clock of a
+ * range, spread over all CPUs, then reports where they disagree, how far
+ * the solutions deviate from ideal, how fast both are and optionally
+ * writes the chosen dividers out as a table of clock ranges.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wrpll_sweep.h"
+
+#define SWEEP_CHUNK	4096
+#define SWEEP_MAX_THREADS 64
+#define SWEEP_MAX_REPORTS 16
+
+struct sweep_stats {
+	uint64_t solved;
+	double min, max, sum, sum2;
+	uint64_t ns;
+};
+
+struct sweep_thread {
+	pthread_t thread;
+	const struct wrpll_sweep *sweep;
+	uint32_t ref_clock;
+	uint32_t nclocks;
+	uint32_t *next;
+	uint32_t *packed[2];
+	void *params;
+	size_t params_size;
+	struct sweep_stats stats[2];
+};
+
+static uint64_t ns_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void stats_init(struct sweep_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->min = INFINITY;
+	stats->max = -INFINITY;
+}
+
+static void stats_add(struct sweep_stats *stats, double value)
+{
+	stats->solved++;
+	stats->sum += value;
+	stats->sum2 += value * value;
+	if (value < stats->min)
+		stats->min = value;
+	if (value > stats->max)
+		stats->max = value;
+}
+
+static void stats_merge(struct sweep_stats *dst, const struct sweep_stats *src)
+{
+	dst->solved += src->solved;
+	dst->sum += src->sum;
+	dst->sum2 += src->sum2;
+	dst->ns += src->ns;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+static void sweep_chunk(struct sweep_thread *t, int v,
+			uint32_t first, uint32_t count)
+{
+	const struct wrpll_sweep_ops *ops = t->sweep->ops[v];
+	uint64_t start = ns_now();
+
+	for (uint32_t i = first; i < first + count; i++) {
+		uint32_t clock = t->sweep->min_clock + i * t->sweep->step;
+
+		memset(t->params, 0, t->params_size);
+		if (!ops->compute(clock, t->ref_clock, t->params)) {
+			t->packed[v][i] = 0;
+			continue;
+		}
+
+		t->packed[v][i] = ops->pack(t->params);
+		stats_add(&t->stats[v],
+			  ops->deviation(clock, t->ref_clock, t->params));
+	}
+
+	t->stats[v].ns += ns_now() - start;
+}
+
+static void *sweep_thread(void *data)
+{
+	struct sweep_thread *t = data;
+
+	for (;;) {
+		uint32_t first = __sync_fetch_and_add(t->next, SWEEP_CHUNK);
+		uint32_t count;
+
+		if (first >= t->nclocks)
+			break;
+
+		count = t->nclocks - first;
+		if (count > SWEEP_CHUNK)
+			count = SWEEP_CHUNK;
+
+		for (int v = t->sweep->skip_reference; v < 2; v++)
+			sweep_chunk(t, v, first, count);
+	}
+
+	return NULL;
+}
+
+static void print_stats(const struct wrpll_sweep *sweep, int v,
+			const struct sweep_stats *stats, uint32_t nclocks)
+{
+	double mean = stats->solved ? stats->sum / stats->solved : 0;
+	double var = stats->solved ? stats->sum2 / stats->solved - mean * mean : 0;
+
+	printf("%s: %"PRIu64" unsolved\n", sweep->ops[v]->name,
+	       nclocks - stats->solved);
+	if (stats->solved)
+		printf("  deviation (%s): min %.2f, mean %.2f, max %.2f, stddev %.2f\n",
+		       sweep->deviation_unit, stats->min, mean, stats->max,
+		       sqrt(var > 0 ? var : 0));
+	printf("  %.0f clocks/s per thread\n",
+	       stats->ns ? nclocks * 1e9 / stats->ns : 0);
+}
+
+static uint64_t report_disagreements(const struct wrpll_sweep *sweep,
+				     uint32_t *packed[2], uint32_t nclocks)
+{
+	uint64_t count = 0;
+
+	for (uint32_t i = 0; i < nclocks; i++) {
+		if (packed[0][i] == packed[1][i])
+			continue;
+
+		if (count++ < SWEEP_MAX_REPORTS)
+			printf("  %u Hz: %s 0x%08x, %s 0x%08x\n",
+			       sweep->min_clock + i * sweep->step,
+			       sweep->ops[0]->name, packed[0][i],
+			       sweep->ops[1]->name, packed[1][i]);
+	}
+
+	printf("%"PRIu64" disagreements\n", count);
+
+	return count;
+}
+
+/* Runs of clocks with the same dividers, as "first last packed" lines */
+static void write_table(const struct wrpll_sweep *sweep, FILE *file,
+			uint32_t ref_clock, const uint32_t *packed,
+			uint32_t nclocks)
+{
+	unsigned int ranges = 0;
+	uint32_t i = 0;
+
+	fprintf(file, "# %s, %s, ref clock %u kHz, packed as %s\n",
+		sweep->name, sweep->ops[1]->name, ref_clock, sweep->pack_desc);
+
+	while (i < nclocks) {
+		uint32_t last = i;
+
+		while (last + 1 < nclocks && packed[last + 1] == packed[i])
+			last++;
+
+		if (packed[i]) {
+			fprintf(file, "%u %u 0x%08x\n",
+				sweep->min_clock + i * sweep->step,
+				sweep->min_clock + last * sweep->step,
+				packed[i]);
+			ranges++;
+		}
+
+		i = last + 1;
+	}
+
+	printf("%u table entries\n", ranges);
+}
+
+static unsigned int sweep_nthreads(const struct wrpll_sweep *sweep)
+{
+	long n = sweep->nthreads ?: sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n < 1)
+		n = 1;
+	if (n > SWEEP_MAX_THREADS)
+		n = SWEEP_MAX_THREADS;
+
+	return n;
+}
+
+/**
+ * wrpll_sweep_run:
+ * @sweep: the sweep to run
+ *
+ * Runs @sweep for each of its reference clocks and prints a report.
+ *
+ * Returns: the number of pixel clocks for which the reference and the
+ * implementation chose different dividers.
+ */
+uint64_t wrpll_sweep_run(const struct wrpll_sweep *sweep)
+{
+	struct sweep_thread threads[SWEEP_MAX_THREADS];
+	unsigned int nthreads = sweep_nthreads(sweep);
+	uint32_t nclocks = (sweep->max_clock - sweep->min_clock) / sweep->step + 1;
+	uint64_t disagreements = 0, total = 0;
+	uint64_t start = ns_now();
+	uint32_t *packed[2];
+	FILE *table = NULL;
+	size_t params_size;
+
+	if (sweep->table) {
+		table = fopen(sweep->table, "w");
+		if (!table) {
+			fprintf(stderr, "Couldn't open %s: %s\n",
+				sweep->table, strerror(errno));
+			exit(1);
+		}
+	}
+
+	params_size = sweep->ops[0]->params_size;
+	if (sweep->ops[1]->params_size > params_size)
+		params_size = sweep->ops[1]->params_size;
+
+	packed[0] = calloc(nclocks, sizeof(uint32_t));
+	packed[1] = calloc(nclocks, sizeof(uint32_t));
+	if (!packed[0] || !packed[1])
+		abort();
+
+	for (unsigned int r = 0; r < sweep->num_ref_clocks; r++) {
+		struct sweep_stats stats[2];
+		uint32_t next = 0;
+
+		printf("=== %s, ref clock %u kHz, %u-%u Hz in %u Hz steps, %u threads\n",
+		       sweep->name, sweep->ref_clocks[r], sweep->min_clock,
+		       sweep->max_clock, sweep->step, nthreads);
+
+		for (unsigned int n = 0; n < nthreads; n++) {
+			struct sweep_thread *t = &threads[n];
+
+			t->sweep = sweep;
+			t->ref_clock = sweep->ref_clocks[r];
+			t->nclocks = nclocks;
+			t->next = &next;
+			t->packed[0] = packed[0];
+			t->packed[1] = packed[1];
+			t->params_size = params_size;
+			t->params = malloc(params_size);
+			if (!t->params)
+				abort();
+			stats_init(&t->stats[0]);
+			stats_init(&t->stats[1]);
+
+			if (n && pthread_create(&t->thread, NULL, sweep_thread, t))
+				abort();
+		}
+
+		sweep_thread(&threads[0]);
+
+		stats_init(&stats[0]);
+		stats_init(&stats[1]);
+		for (unsigned int n = 0; n < nthreads; n++) {
+			if (n)
+				pthread_join(threads[n].thread, NULL);
+			stats_merge(&stats[0], &threads[n].stats[0]);
+			stats_merge(&stats[1], &threads[n].stats[1]);
+			free(threads[n].params);
+		}
+
+		for (int v = sweep->skip_reference; v < 2; v++)
+			print_stats(sweep, v, &stats[v], nclocks);
+
+		if (!sweep->skip_reference)
+			disagreements += report_disagreements(sweep, packed, nclocks);
+
+		if (table)
+			write_table(sweep, table, sweep->ref_clocks[r],
+				    packed[1], nclocks);
+
+		total += nclocks;
+	}
+
+	printf("%"PRIu64" clocks in %.2fs\n", total, (ns_now() - start) / 1e9);
+
+	if (table)
+		fclose(table);
+	free(packed[0]);
+	free(packed[1]);
+
+	return disagreements;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-s] [-n] [-f min_khz] [-t max_khz] [-i step_khz] "
+		"[-j threads] [-o table]\n"
+		"  -s  sweep the whole clock range instead of the known modes\n"
+		"  -n  skip the reference computation\n"
+		"  -f  first pixel clock of the sweep (default %u kHz)\n"
+		"  -t  last pixel clock of the sweep (default %u kHz)\n"
+		"  -i  step of the sweep (default %u kHz)\n"
+		"  -j  worker threads (default one per CPU)\n"
+		"  -o  write the dividers chosen by the implementation to a table\n",
+		name, 25000, 1200000, 1);
+}
+
+static bool parse_khz(const char *arg, uint32_t *hz)
+{
+	char *end;
+	unsigned long v;
+
+	errno = 0;
+	v = strtoul(arg, &end, 0);
+	if (errno || *end || !v || v > UINT32_MAX / 1000)
+		return false;
+
+	*hz = v * 1000;
+
+	return true;
+}
+
+/**
+ * wrpll_sweep_parse_args:
+ * @sweep: sweep with everything but the range and options filled in
+ * @argc: argument count of main()
+ * @argv: arguments of main()
+ *
+ * Parses the command line options shared by the wrpll tools into @sweep.
+ *
+ * Returns: 1 if a sweep was requested, 0 if the tool should test its list
+ * of known modes and -1 on invalid arguments.
+ */
+int wrpll_sweep_parse_args(struct wrpll_sweep *sweep, int argc, char **argv)
+{
+	bool run = false;
+	int c;
+
+	sweep->min_clock = 25000000;
+	sweep->max_clock = 1200000000;
+	sweep->step = 1000;
+
+	while ((c = getopt(argc, argv, "snf:t:i:j:o:")) != -1) {
+		switch (c) {
+		case 's':
+			run = true;
+			break;
+		case 'n':
+			sweep->skip_reference = true;
+			break;
+		case 'f':
+			if (!parse_khz(optarg, &sweep->min_clock))
+				goto err;
+			break;
+		case 't':
+			if (!parse_khz(optarg, &sweep->max_clock))
+				goto err;
+			break;
+		case 'i':
+			if (!parse_khz(optarg, &sweep->step))
+				goto err;
+			break;
+		case 'j':
+			sweep->nthreads = atoi(optarg);
+			break;
+		case 'o':
+			sweep->table = optarg;
+			break;
+		default:
+			goto err;
+		}
+	}
+
+	if (optind != argc || sweep->min_clock > sweep->max_clock)
+		goto err;
+
+	return run;
+
+err:
+	usage(argv[0]);
+	return -1;
+}
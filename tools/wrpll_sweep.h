@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2026 Intel Corporation
+ */
+#ifndef WRPLL_SWEEP_H
+#define WRPLL_SWEEP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * struct wrpll_sweep_ops - one way of computing the PLL dividers
+ * @name:        printed in the reports
+ * @params_size: size of the parameters filled in by @compute
+ * @compute:     computes the dividers for a pixel @clock in Hz from a
+ *               @ref_clock in kHz, returns false if there is no solution
+ * @pack:        the chosen dividers as a non-zero value, two solutions
+ *               agree when they pack to the same value
+ * @deviation:   how far the solution is from ideal, in the unit of
+ *               &wrpll_sweep.deviation_unit
+ */
+struct wrpll_sweep_ops {
+	const char *name;
+	size_t params_size;
+	bool (*compute)(uint32_t clock, uint32_t ref_clock, void *params);
+	uint32_t (*pack)(const void *params);
+	double (*deviation)(uint32_t clock, uint32_t ref_clock,
+			    const void *params);
+};
+
+/**
+ * struct wrpll_sweep - a sweep over a range of pixel clocks
+ * @name:           printed in the reports and the table headers
+ * @ops:            the reference and the implementation under test,
+ *                  the tables are generated from the latter
+ * @pack_desc:      layout of the packed dividers, for the table header
+ * @deviation_unit: unit of &wrpll_sweep_ops.deviation
+ * @ref_clocks:     reference clocks to sweep, in kHz
+ * @num_ref_clocks: number of entries in @ref_clocks
+ * @min_clock:      first pixel clock, in Hz
+ * @max_clock:      last pixel clock, in Hz
+ * @step:           distance between pixel clocks, in Hz
+ * @nthreads:       worker threads, 0 for one per CPU
+ * @skip_reference: only run the implementation
+ * @table:          file to write the lookup tables to, or NULL
+ */
+struct wrpll_sweep {
+	const char *name;
+	const struct wrpll_sweep_ops *ops[2];
+	const char *pack_desc;
+	const char *deviation_unit;
+	const uint32_t *ref_clocks;
+	unsigned int num_ref_clocks;
+
+	uint32_t min_clock, max_clock, step;
+	unsigned int nthreads;
+	bool skip_reference;
+	const char *table;
+};
+
+int wrpll_sweep_parse_args(struct wrpll_sweep *sweep, int argc, char **argv);
+uint64_t wrpll_sweep_run(const struct wrpll_sweep *sweep);
+
+#endif /* WRPLL_SWEEP_H */